@@ -0,0 +1,261 @@
+// Generates synthetic Kong corpora and measures kongruent on every backend.
+//
+// Usage: node benchmarks/benchmark.js --kongruent <path/to/kongruent> [options]
+//
+//   --files <n>        Number of .kong files the corpus is split into (default 4)
+//   --structs <n>      Number of plain structs (default 16)
+//   --depth <n>        Length of the call chain behind every entry point (default 8)
+//   --pipelines <n>    Number of #[pipe] render pipelines (default 8)
+//   --computes <n>     Number of compute shaders, every second one with #[cpu] (default 4)
+//   --sets <n>         Number of descriptor sets (default 4)
+//   --globals <n>      Number of constant buffer globals (default 16)
+//   --runs <n>         Runs per backend, the fastest one is reported (default 3)
+//   --backends <list>  Comma separated backends: hlsl,glsl,metal,wgsl,spirv,kompjuta (default all)
+//   --out <file>       Write the results as JSON to <file> (default stdout)
+//   --keep <dir>       Generate the corpus into <dir> and keep it
+//
+// kompjuta compiles a copy of the corpus without matrix math from the vectors subdirectory.
+
+const child_process = require('child_process');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+
+const apis = [
+	{api: 'direct3d12', platform: 'windows', backend: 'hlsl'},
+	{api: 'opengl', platform: 'linux', backend: 'glsl'},
+	{api: 'metal', platform: 'macos', backend: 'metal'},
+	{api: 'webgpu', platform: 'wasm', backend: 'wgsl'},
+	{api: 'vulkan', platform: 'linux', backend: 'spirv'},
+	// kompjuta has no matrix operations, its corpus transforms the vertices without one
+	{api: 'default', platform: 'kompjuta', backend: 'kompjuta', matrices: false}
+];
+
+function parseOptions(args) {
+	const options = {
+		kongruent: null,
+		files: 4,
+		structs: 16,
+		depth: 8,
+		pipelines: 8,
+		computes: 4,
+		sets: 4,
+		globals: 16,
+		runs: 3,
+		backends: apis.map((api) => api.backend),
+		out: null,
+		keep: null
+	};
+
+	for (let i = 0; i < args.length; ++i) {
+		const arg = args[i];
+		if (!arg.startsWith('--') || i + 1 >= args.length) {
+			throw new Error('Unknown parameter ' + arg);
+		}
+		const name = arg.substring(2);
+		const value = args[++i];
+		if (!(name in options)) {
+			throw new Error('Unknown parameter ' + arg);
+		}
+		if (name === 'backends') {
+			options.backends = value.split(',');
+		}
+		else if (typeof options[name] === 'number') {
+			options[name] = parseInt(value);
+		}
+		else {
+			options[name] = value;
+		}
+	}
+
+	if (options.kongruent === null) {
+		throw new Error('--kongruent is required');
+	}
+	options.files = Math.max(1, options.files);
+	options.sets = Math.max(1, options.sets);
+	options.globals = Math.max(1, options.globals);
+	options.depth = Math.max(1, options.depth);
+	options.runs = Math.max(1, options.runs);
+
+	return options;
+}
+
+function generateCorpus(options, directory, matrices) {
+	const files = [];
+	for (let i = 0; i < options.files; ++i) {
+		files.push('');
+	}
+	let nextFile = 0;
+	function emit(code) {
+		files[nextFile] += code + '\n';
+		nextFile = (nextFile + 1) % files.length;
+	}
+
+	for (let i = 0; i < options.structs; ++i) {
+		emit(`struct Data${i} {\n\ta: float4;\n\tb: float3;\n\tc: float2;\n\td: float;\n}\n`);
+	}
+
+	for (let i = 0; i < options.globals; ++i) {
+		emit(`#[set(set${i % options.sets})]\nconst buffer${i}: {\n\ttransform: float4x4;\n\tcolor: float4;\n\tscale: float;\n};\n`);
+	}
+
+	function emitChain(prefix) {
+		for (let i = 0; i < options.depth; ++i) {
+			if (i === options.depth - 1) {
+				emit(`fun ${prefix}_chain${i}(x: float): float {\n\treturn x * 0.5 + 1.0;\n}\n`);
+			}
+			else {
+				emit(`fun ${prefix}_chain${i}(x: float): float {\n\tvar y: float = ${prefix}_chain${i + 1}(x * 1.5);\n\treturn y + 1.0;\n}\n`);
+			}
+		}
+	}
+
+	for (let i = 0; i < options.pipelines; ++i) {
+		const g = i % options.globals;
+		emitChain(`pipeline${i}`);
+
+		emit(`struct VertexIn${i} {\n\tposition: float3;\n\tcolor: float4;\n}\n`);
+		emit(`struct FragmentIn${i} {\n\tposition: float4;\n\tcolor: float4;\n}\n`);
+
+		emit(`fun vertex${i}(input: VertexIn${i}): FragmentIn${i} {\n` +
+			`\tvar output: FragmentIn${i};\n` +
+			(matrices ? `\toutput.position = buffer${g}.transform * float4(input.position, 1.0);\n`
+				: `\toutput.position = float4(input.position, 1.0) * buffer${g}.scale;\n`) +
+			`\toutput.color = input.color * pipeline${i}_chain0(buffer${g}.scale);\n` +
+			`\treturn output;\n}\n`);
+
+		emit(`fun fragment${i}(input: FragmentIn${i}): float4 {\n` +
+			`\tvar color: float4 = input.color * buffer${g}.color;\n` +
+			`\tfor (var j: int = 0; j < 4; j += 1) {\n` +
+			`\t\tcolor.x = color.x * 0.5;\n` +
+			`\t}\n` +
+			`\treturn color;\n}\n`);
+
+		emit(`#[pipe]\nstruct Pipeline${i} {\n\tvertex = vertex${i};\n\tfragment = fragment${i};\n\tformat = framebuffer_format();\n}\n`);
+	}
+
+	for (let i = 0; i < options.computes; ++i) {
+		const g = i % options.globals;
+		const cpu = i % 2 === 1 ? ', cpu' : '';
+		emitChain(`compute${i}`);
+		emit(`#[compute${cpu}, threads(32, 1, 1)]\nfun compute${i}(): void {\n` +
+			`\tvar id: uint3 = dispatch_thread_id();\n` +
+			`\tvar x: float = compute${i}_chain0(buffer${g}.scale);\n}\n`);
+	}
+
+	fs.mkdirSync(directory, {recursive: true});
+	for (let i = 0; i < files.length; ++i) {
+		fs.writeFileSync(path.join(directory, `corpus${i}.kong`), files[i]);
+	}
+}
+
+function run(options, input, api) {
+	const output = fs.mkdtempSync(path.join(os.tmpdir(), 'kong-benchmark-out-'));
+	const statsFile = path.join(output, 'stats.json');
+
+	const start = process.hrtime.bigint();
+	const result = child_process.spawnSync(options.kongruent,
+		['-i', input, '-o', output, '-p', api.platform, '-a', api.api, '--stats-json', statsFile],
+		{encoding: 'utf8', stdio: ['ignore', 'ignore', 'pipe'], maxBuffer: 64 * 1024 * 1024});
+	const milliseconds = Number(process.hrtime.bigint() - start) / 1000000.0;
+
+	let stats = null;
+	if (result.status === 0 && fs.existsSync(statsFile)) {
+		stats = JSON.parse(fs.readFileSync(statsFile, 'utf8'));
+	}
+
+	fs.rmSync(output, {recursive: true, force: true});
+
+	return {status: result.status, milliseconds, stats, error: result.status === 0 ? null : (result.stderr || '').trim().split('\n').pop()};
+}
+
+function summarize(api, runs) {
+	const ok = runs.filter((run) => run.stats !== null);
+	if (ok.length === 0) {
+		return {api: api.api, backend: api.backend, status: 'failed', exit_code: runs[0].status, error: runs[0].error};
+	}
+
+	const best = ok.reduce((a, b) => (a.milliseconds <= b.milliseconds ? a : b));
+
+	// phases like transform run once per permutation, their durations add up
+	const phases = {};
+	for (const phase of best.stats.phases) {
+		if (phase.depth === 0) {
+			phases[phase.name] = (phases[phase.name] || 0) + phase.milliseconds;
+		}
+	}
+
+	const entryPoints = {};
+	for (const phase of best.stats.phases) {
+		if (phase.depth === 1 && phase.name.startsWith(api.backend + '_export_')) {
+			entryPoints[phase.name] = (entryPoints[phase.name] || 0) + phase.milliseconds;
+		}
+	}
+
+	let peakMemory = 0;
+	for (const phase of best.stats.phases) {
+		peakMemory = Math.max(peakMemory, phase.peak_memory);
+	}
+
+	return {
+		api: api.api,
+		backend: api.backend,
+		status: 'ok',
+		milliseconds: best.milliseconds,
+		peak_memory: peakMemory,
+		phases,
+		entry_points: entryPoints,
+		counters: best.stats.counters
+	};
+}
+
+function main() {
+	const options = parseOptions(process.argv.slice(2));
+
+	const corpus = options.keep !== null ? options.keep : fs.mkdtempSync(path.join(os.tmpdir(), 'kong-benchmark-in-'));
+	generateCorpus(options, corpus, true);
+
+	const vectorCorpus = path.join(corpus, 'vectors');
+	generateCorpus(options, vectorCorpus, false);
+
+	const results = [];
+	for (const api of apis) {
+		if (!options.backends.includes(api.backend)) {
+			continue;
+		}
+		const runs = [];
+		for (let i = 0; i < options.runs; ++i) {
+			runs.push(run(options, api.matrices === false ? vectorCorpus : corpus, api));
+		}
+		results.push(summarize(api, runs));
+	}
+
+	if (options.keep === null) {
+		fs.rmSync(corpus, {recursive: true, force: true});
+	}
+
+	const report = {
+		version: 1,
+		corpus: {
+			files: options.files,
+			structs: options.structs,
+			depth: options.depth,
+			pipelines: options.pipelines,
+			computes: options.computes,
+			sets: options.sets,
+			globals: options.globals
+		},
+		runs: options.runs,
+		results
+	};
+
+	const json = JSON.stringify(report, null, '\t') + '\n';
+	if (options.out !== null) {
+		fs.writeFileSync(options.out, json);
+	}
+	else {
+		process.stdout.write(json);
+	}
+}
+
+main();
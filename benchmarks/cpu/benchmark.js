@@ -0,0 +1,112 @@
+// Compiles the reference compute shaders in benchmarks/cpu/shaders through the CPU backend
+// and measures how fast the generated kong_cpu_<name>.c kernels run.
+//
+// Usage: node benchmarks/cpu/benchmark.js --kongruent <path/to/kongruent> [options]
+//
+//   --cc <compiler>     C compiler used for the kernels (default cc)
+//   --cflags <flags>    Space separated compiler flags (default -O2)
+//   --elements <n>      Elements processed per kernel invocation (default 1048576)
+//   --iterations <n>    Timed invocations per kernel, the fastest one is reported (default 10)
+//   --out <file>        Write the results as JSON to <file> (default stdout)
+//   --keep <dir>        Generate the kernels and the harness binary into <dir> and keep them
+//
+// The stand-in headers in benchmarks/cpu/include replace Kore, the harness verifies every
+// kernel against a scalar reference before timing it.
+
+const child_process = require('child_process');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+
+function parseOptions(args) {
+	const options = {
+		kongruent: null,
+		cc: 'cc',
+		cflags: '-O2',
+		elements: 1024 * 1024,
+		iterations: 10,
+		out: null,
+		keep: null
+	};
+
+	for (let i = 0; i < args.length; ++i) {
+		const arg = args[i];
+		if (!arg.startsWith('--') || i + 1 >= args.length) {
+			throw new Error('Unknown parameter ' + arg);
+		}
+		const name = arg.substring(2);
+		const value = args[++i];
+		if (!(name in options)) {
+			throw new Error('Unknown parameter ' + arg);
+		}
+		if (typeof options[name] === 'number') {
+			options[name] = parseInt(value);
+		}
+		else {
+			options[name] = value;
+		}
+	}
+
+	if (options.kongruent === null) {
+		throw new Error('--kongruent is required');
+	}
+	options.elements = Math.max(64, options.elements);
+	options.iterations = Math.max(1, options.iterations);
+
+	return options;
+}
+
+function check(result, what) {
+	if (result.error) {
+		throw result.error;
+	}
+	if (result.status !== 0) {
+		throw new Error(what + ' failed with exit code ' + result.status + '\n' + (result.stderr || ''));
+	}
+}
+
+function main() {
+	const options = parseOptions(process.argv.slice(2));
+
+	const directory = options.keep !== null ? options.keep : fs.mkdtempSync(path.join(os.tmpdir(), 'kong-cpu-benchmark-'));
+	const kernels = path.join(directory, 'kernels');
+	fs.mkdirSync(kernels, {recursive: true});
+
+	const compile = child_process.spawnSync(path.resolve(options.kongruent),
+		['-i', path.join(__dirname, 'shaders'), '-o', kernels, '-p', 'linux', '-a', 'opengl'],
+		{encoding: 'utf8', stdio: ['ignore', 'ignore', 'pipe'], maxBuffer: 64 * 1024 * 1024});
+	check(compile, 'kongruent');
+
+	const sources = fs.readdirSync(kernels).filter((file) => file.startsWith('kong_cpu_') && file.endsWith('.c')).map((file) => path.join(kernels, file));
+
+	const harness = path.join(directory, os.platform() === 'win32' ? 'harness.exe' : 'harness');
+	const build = child_process.spawnSync(options.cc,
+		[...options.cflags.split(' ').filter((flag) => flag.length > 0), '-std=gnu11', '-I', path.join(__dirname, 'include'), '-I', kernels, '-o', harness,
+			path.join(__dirname, 'harness.c'), ...sources, '-lm'],
+		{encoding: 'utf8'});
+	check(build, options.cc);
+
+	const execution = child_process.spawnSync(harness, [options.elements.toString(), options.iterations.toString()], {encoding: 'utf8'});
+	check(execution, 'harness');
+
+	if (options.keep === null) {
+		fs.rmSync(directory, {recursive: true, force: true});
+	}
+
+	const report = {
+		version: 1,
+		compiler: options.cc,
+		cflags: options.cflags,
+		...JSON.parse(execution.stdout)
+	};
+
+	const json = JSON.stringify(report, null, '\t') + '\n';
+	if (options.out !== null) {
+		fs.writeFileSync(options.out, json);
+	}
+	else {
+		process.stdout.write(json);
+	}
+}
+
+main();
@@ -0,0 +1,201 @@
+// Runs the CPU kernels generated from benchmarks/cpu/shaders and prints their throughput as JSON.
+//
+// Usage: harness <elements> <iterations>
+
+#include "kong_cpu_blur.h"
+#include "kong_cpu_integrate.h"
+#include "kong_cpu_reduce.h"
+#include "kong_cpu_scan.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define LOCAL_SIZE 64
+#define SCAN_PADDING 64
+
+static double now_milliseconds(void) {
+	struct timespec time;
+	timespec_get(&time, TIME_UTC);
+	return (double)time.tv_sec * 1000.0 + (double)time.tv_nsec / 1000000.0;
+}
+
+static kore_float4 *allocate(uint32_t count) {
+	kore_float4 *data = calloc(count, sizeof(kore_float4));
+	if (data == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+	return data;
+}
+
+static void fill(kore_float4 *data, uint32_t count, float seed) {
+	for (uint32_t i = 0; i < count; ++i) {
+		data[i].x = seed + (float)(i % 17);
+		data[i].y = seed - (float)(i % 13);
+		data[i].z = seed * (float)(i % 7);
+		data[i].w = 1.0f;
+	}
+}
+
+static bool nearly(kore_float4 a, kore_float4 b) {
+	return fabsf(a.x - b.x) < 0.001f && fabsf(a.y - b.y) < 0.001f && fabsf(a.z - b.z) < 0.001f && fabsf(a.w - b.w) < 0.001f;
+}
+
+static kore_float4 add(kore_float4 a, kore_float4 b) {
+	kore_float4 value = {a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w};
+	return value;
+}
+
+static kore_float4 scale(kore_float4 a, float b) {
+	kore_float4 value = {a.x * b, a.y * b, a.z * b, a.w * b};
+	return value;
+}
+
+typedef struct kernel {
+	const char *name;
+	void (*prepare)(uint32_t elements);
+	void (*run)(uint32_t workgroup_count_x, uint32_t workgroup_count_y, uint32_t workgroup_count_z);
+	bool (*validate)(uint32_t elements);
+} kernel;
+
+static kore_float4 *input;
+static kore_float4 *output;
+static kore_float4 *reference;
+
+static blur_params_type     blur_params;
+static scan_params_type     scan_params;
+static particle_params_type particle_params;
+
+static void prepare_reduce(uint32_t elements) {
+	input  = allocate(elements * 2);
+	output = allocate(elements);
+	fill(input, elements * 2, 1.0f);
+	set_reduce_input(input);
+	set_reduce_output(output);
+}
+
+static bool validate_reduce(uint32_t elements) {
+	for (uint32_t i = 0; i < elements; ++i) {
+		if (!nearly(output[i], add(input[i * 2], input[i * 2 + 1]))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void prepare_scan(uint32_t elements) {
+	input  = allocate(SCAN_PADDING + elements);
+	output = allocate(SCAN_PADDING + elements);
+	fill(&input[SCAN_PADDING], elements, 2.0f);
+	scan_params.offset  = 1;
+	scan_params.padding = SCAN_PADDING;
+	set_scan_input(input);
+	set_scan_output(output);
+	set_scan_params(&scan_params);
+}
+
+static bool validate_scan(uint32_t elements) {
+	for (uint32_t i = SCAN_PADDING; i < SCAN_PADDING + elements; ++i) {
+		if (!nearly(output[i], add(input[i], input[i - scan_params.offset]))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void prepare_blur(uint32_t elements) {
+	input  = allocate(elements + 2);
+	output = allocate(elements);
+	fill(input, elements + 2, 3.0f);
+	blur_params.weight = 0.25f;
+	set_blur_input(input);
+	set_blur_output(output);
+	set_blur_params(&blur_params);
+}
+
+static bool validate_blur(uint32_t elements) {
+	for (uint32_t i = 0; i < elements; ++i) {
+		kore_float4 expected = add(scale(input[i + 1], 1.0f - 2.0f * blur_params.weight), scale(add(input[i], input[i + 2]), blur_params.weight));
+		if (!nearly(output[i], expected)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void prepare_integrate(uint32_t elements) {
+	input     = allocate(elements);
+	output    = allocate(elements);
+	reference = allocate(elements);
+	fill(input, elements, 0.5f);
+	fill(output, elements, 4.0f);
+	fill(reference, elements, 4.0f);
+	particle_params.dt = 1.0f / 60.0f;
+	set_positions(output);
+	set_velocities(input);
+	set_particle_params(&particle_params);
+}
+
+static bool validate_integrate(uint32_t elements) {
+	bool valid = true;
+	for (uint32_t i = 0; i < elements; ++i) {
+		if (!nearly(output[i], add(reference[i], scale(input[i], particle_params.dt)))) {
+			valid = false;
+			break;
+		}
+	}
+	free(reference);
+	return valid;
+}
+
+static kernel kernels[] = {
+    {"reduce", prepare_reduce, reduce_on_cpu, validate_reduce},
+    {"scan", prepare_scan, scan_on_cpu, validate_scan},
+    {"blur", prepare_blur, blur_on_cpu, validate_blur},
+    {"integrate", prepare_integrate, integrate_on_cpu, validate_integrate},
+};
+
+int main(int argc, char **argv) {
+	uint32_t elements   = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 1024 * 1024;
+	uint32_t iterations = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 10;
+
+	elements = (elements + LOCAL_SIZE - 1) / LOCAL_SIZE * LOCAL_SIZE;
+	if (iterations < 1) {
+		iterations = 1;
+	}
+
+	// The CPU backend emits four lanes per iteration and walks all workgroups on the calling thread
+	printf("{\n\t\"simd_width\": 4,\n\t\"threads\": 1,\n\t\"elements\": %u,\n\t\"iterations\": %u,\n\t\"kernels\": [\n", elements, iterations);
+
+	size_t kernels_count = sizeof(kernels) / sizeof(kernels[0]);
+	for (size_t i = 0; i < kernels_count; ++i) {
+		kernel *k = &kernels[i];
+		k->prepare(elements);
+
+		k->run(elements / LOCAL_SIZE, 1, 1);
+		bool valid = k->validate(elements);
+
+		double best = INFINITY;
+		for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+			double start = now_milliseconds();
+			k->run(elements / LOCAL_SIZE, 1, 1);
+			double milliseconds = now_milliseconds() - start;
+			if (milliseconds < best) {
+				best = milliseconds;
+			}
+		}
+
+		printf("\t\t{\"name\": \"%s\", \"valid\": %s, \"milliseconds\": %.3f, \"elements_per_second\": %.0f}%s\n", k->name, valid ? "true" : "false", best,
+		       best > 0.0 ? (double)elements / (best / 1000.0) : 0.0, i + 1 < kernels_count ? "," : "");
+
+		free(input);
+		free(output);
+	}
+
+	printf("\t]\n}\n");
+
+	return 0;
+}
@@ -0,0 +1,25 @@
+#ifndef KORE_GPU_DEVICE_HEADER
+#define KORE_GPU_DEVICE_HEADER
+
+// Stand-in for the parts of Kore's GPU API that kong.h refers to, the CPU kernels never touch them
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct kore_gpu_device {
+	int unused;
+} kore_gpu_device;
+
+typedef struct kore_gpu_buffer {
+	int unused;
+} kore_gpu_buffer;
+
+typedef struct kore_gpu_texture {
+	int unused;
+} kore_gpu_texture;
+
+typedef struct kore_gpu_command_list {
+	int unused;
+} kore_gpu_command_list;
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef KORE_GPU_SAMPLER_HEADER
+#define KORE_GPU_SAMPLER_HEADER
+
+typedef struct kore_gpu_sampler {
+	int unused;
+} kore_gpu_sampler;
+
+#endif
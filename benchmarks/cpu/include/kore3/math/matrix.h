@@ -0,0 +1,12 @@
+#ifndef KORE_MATH_MATRIX_HEADER
+#define KORE_MATH_MATRIX_HEADER
+
+typedef struct kore_matrix3x3 {
+	float m[3 * 3];
+} kore_matrix3x3;
+
+typedef struct kore_matrix4x4 {
+	float m[4 * 4];
+} kore_matrix4x4;
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef KORE_MATH_VECTOR_HEADER
+#define KORE_MATH_VECTOR_HEADER
+
+#include <stdint.h>
+
+typedef struct kore_float2 {
+	float x, y;
+} kore_float2;
+
+typedef struct kore_float3 {
+	float x, y, z;
+} kore_float3;
+
+typedef struct kore_float4 {
+	float x, y, z, w;
+} kore_float4;
+
+typedef struct kore_int2 {
+	int32_t x, y;
+} kore_int2;
+
+typedef struct kore_int3 {
+	int32_t x, y, z;
+} kore_int3;
+
+typedef struct kore_int4 {
+	int32_t x, y, z, w;
+} kore_int4;
+
+typedef struct kore_uint2 {
+	uint32_t x, y;
+} kore_uint2;
+
+typedef struct kore_uint3 {
+	uint32_t x, y, z;
+} kore_uint3;
+
+typedef struct kore_uint4 {
+	uint32_t x, y, z, w;
+} kore_uint4;
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef KORE_OPENGL_DESCRIPTORSET_STRUCTS_HEADER
+#define KORE_OPENGL_DESCRIPTORSET_STRUCTS_HEADER
+
+typedef struct kore_opengl_descriptor_set {
+	int unused;
+} kore_opengl_descriptor_set;
+
+#endif
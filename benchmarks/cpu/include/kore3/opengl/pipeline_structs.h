@@ -0,0 +1,4 @@
+#ifndef KORE_OPENGL_PIPELINE_STRUCTS_HEADER
+#define KORE_OPENGL_PIPELINE_STRUCTS_HEADER
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef KORE_UTIL_CPUCOMPUTE_HEADER
+#define KORE_UTIL_CPUCOMPUTE_HEADER
+
+// Portable stand-in for Kore's CPU compute helpers. Every lane type is a plain array so the
+// C compiler is free to vectorize, which keeps the numbers comparable across machines.
+
+#include <kore3/math/vector.h>
+
+#include <stdint.h>
+
+typedef struct kore_float32x4 {
+	float values[4];
+} kore_float32x4;
+
+typedef struct kore_int32x4 {
+	int32_t values[4];
+} kore_int32x4;
+
+typedef struct kore_uint32x4 {
+	uint32_t values[4];
+} kore_uint32x4;
+
+#define KORE_CPU_COMPUTE_LANES(prefix, scalar)                                                                                                                 \
+	static inline prefix prefix##_load(scalar a, scalar b, scalar c, scalar d) {                                                                           \
+		prefix value = {{a, b, c, d}};                                                                                                                 \
+		return value;                                                                                                                                  \
+	}                                                                                                                                                      \
+	static inline prefix prefix##_load_all(scalar a) {                                                                                                     \
+		prefix value = {{a, a, a, a}};                                                                                                                 \
+		return value;                                                                                                                                  \
+	}                                                                                                                                                      \
+	static inline scalar prefix##_get(prefix value, int lane) {                                                                                            \
+		return value.values[lane];                                                                                                                     \
+	}                                                                                                                                                      \
+	static inline prefix prefix##_add(prefix a, prefix b) {                                                                                                \
+		prefix value;                                                                                                                                  \
+		for (int lane = 0; lane < 4; ++lane) {                                                                                                         \
+			value.values[lane] = a.values[lane] + b.values[lane];                                                                                  \
+		}                                                                                                                                              \
+		return value;                                                                                                                                  \
+	}                                                                                                                                                      \
+	static inline prefix prefix##_mul(prefix a, prefix b) {                                                                                                \
+		prefix value;                                                                                                                                  \
+		for (int lane = 0; lane < 4; ++lane) {                                                                                                         \
+			value.values[lane] = a.values[lane] * b.values[lane];                                                                                  \
+		}                                                                                                                                              \
+		return value;                                                                                                                                  \
+	}
+
+KORE_CPU_COMPUTE_LANES(kore_float32x4, float)
+KORE_CPU_COMPUTE_LANES(kore_int32x4, int32_t)
+KORE_CPU_COMPUTE_LANES(kore_uint32x4, uint32_t)
+
+typedef struct kore_float2x4 {
+	kore_float32x4 x, y;
+} kore_float2x4;
+
+typedef struct kore_float3x4 {
+	kore_float32x4 x, y, z;
+} kore_float3x4;
+
+typedef struct kore_float4x4 {
+	kore_float32x4 x, y, z, w;
+} kore_float4x4;
+
+typedef struct kore_int2x4 {
+	kore_int32x4 x, y;
+} kore_int2x4;
+
+typedef struct kore_int3x4 {
+	kore_int32x4 x, y, z;
+} kore_int3x4;
+
+typedef struct kore_int4x4 {
+	kore_int32x4 x, y, z, w;
+} kore_int4x4;
+
+typedef struct kore_uint2x4 {
+	kore_uint32x4 x, y;
+} kore_uint2x4;
+
+typedef struct kore_uint3x4 {
+	kore_uint32x4 x, y, z;
+} kore_uint3x4;
+
+typedef struct kore_uint4x4 {
+	kore_uint32x4 x, y, z, w;
+} kore_uint4x4;
+
+// Scalar lanes, mixed int and uint operands produce int like the typer does
+
+#define KORE_CPU_COMPUTE_SCALAR_OP(name, op, a_mini, a_type, b_mini, b_type, result_type)                                                                     \
+	static inline result_type kore_cpu_compute_##name##_##a_mini##_##b_mini##_x4(a_type a, b_type b) {                                                    \
+		result_type value;                                                                                                                             \
+		for (int lane = 0; lane < 4; ++lane) {                                                                                                         \
+			value.values[lane] = a.values[lane] op b.values[lane];                                                                                 \
+		}                                                                                                                                              \
+		return value;                                                                                                                                  \
+	}
+
+#define KORE_CPU_COMPUTE_SCALAR_OPS(a_mini, a_type, b_mini, b_type, result_type)                                                                              \
+	KORE_CPU_COMPUTE_SCALAR_OP(add, +, a_mini, a_type, b_mini, b_type, result_type)                                                                       \
+	KORE_CPU_COMPUTE_SCALAR_OP(sub, -, a_mini, a_type, b_mini, b_type, result_type)                                                                       \
+	KORE_CPU_COMPUTE_SCALAR_OP(mult, *, a_mini, a_type, b_mini, b_type, result_type)                                                                      \
+	KORE_CPU_COMPUTE_SCALAR_OP(div, /, a_mini, a_type, b_mini, b_type, result_type)
+
+KORE_CPU_COMPUTE_SCALAR_OPS(f1, kore_float32x4, f1, kore_float32x4, kore_float32x4)
+KORE_CPU_COMPUTE_SCALAR_OPS(i1, kore_int32x4, i1, kore_int32x4, kore_int32x4)
+KORE_CPU_COMPUTE_SCALAR_OPS(u1, kore_uint32x4, u1, kore_uint32x4, kore_uint32x4)
+KORE_CPU_COMPUTE_SCALAR_OPS(u1, kore_uint32x4, i1, kore_int32x4, kore_int32x4)
+KORE_CPU_COMPUTE_SCALAR_OPS(i1, kore_int32x4, u1, kore_uint32x4, kore_int32x4)
+
+// Vector lanes, component-wise with the scalar operand broadcast
+
+#define KORE_CPU_COMPUTE_VECTOR_OP(name, mini, vector_type, scalar_mini, scalar_type, components)                                                             \
+	static inline vector_type kore_cpu_compute_##name##_##mini##_##mini##_x4(vector_type a, vector_type b) {                                               \
+		vector_type    value;                                                                                                                          \
+		scalar_type   *v  = (scalar_type *)&value;                                                                                                     \
+		scalar_type   *va = (scalar_type *)&a;                                                                                                         \
+		scalar_type   *vb = (scalar_type *)&b;                                                                                                         \
+		for (int component = 0; component < components; ++component) {                                                                                \
+			v[component] = kore_cpu_compute_##name##_##scalar_mini##_##scalar_mini##_x4(va[component], vb[component]);                             \
+		}                                                                                                                                              \
+		return value;                                                                                                                                  \
+	}                                                                                                                                                      \
+	static inline vector_type kore_cpu_compute_##name##_##mini##_##scalar_mini##_x4(vector_type a, scalar_type b) {                                       \
+		vector_type  value;                                                                                                                            \
+		scalar_type *v  = (scalar_type *)&value;                                                                                                       \
+		scalar_type *va = (scalar_type *)&a;                                                                                                           \
+		for (int component = 0; component < components; ++component) {                                                                                \
+			v[component] = kore_cpu_compute_##name##_##scalar_mini##_##scalar_mini##_x4(va[component], b);                                        \
+		}                                                                                                                                              \
+		return value;                                                                                                                                  \
+	}                                                                                                                                                      \
+	static inline vector_type kore_cpu_compute_##name##_##scalar_mini##_##mini##_x4(scalar_type a, vector_type b) {                                       \
+		vector_type  value;                                                                                                                            \
+		scalar_type *v  = (scalar_type *)&value;                                                                                                       \
+		scalar_type *vb = (scalar_type *)&b;                                                                                                           \
+		for (int component = 0; component < components; ++component) {                                                                                \
+			v[component] = kore_cpu_compute_##name##_##scalar_mini##_##scalar_mini##_x4(a, vb[component]);                                        \
+		}                                                                                                                                              \
+		return value;                                                                                                                                  \
+	}
+
+#define KORE_CPU_COMPUTE_VECTOR_OPS(mini, vector_type, scalar_mini, scalar_type, components)                                                                  \
+	KORE_CPU_COMPUTE_VECTOR_OP(add, mini, vector_type, scalar_mini, scalar_type, components)                                                              \
+	KORE_CPU_COMPUTE_VECTOR_OP(sub, mini, vector_type, scalar_mini, scalar_type, components)                                                              \
+	KORE_CPU_COMPUTE_VECTOR_OP(mult, mini, vector_type, scalar_mini, scalar_type, components)                                                             \
+	KORE_CPU_COMPUTE_VECTOR_OP(div, mini, vector_type, scalar_mini, scalar_type, components)
+
+KORE_CPU_COMPUTE_VECTOR_OPS(f2, kore_float2x4, f1, kore_float32x4, 2)
+KORE_CPU_COMPUTE_VECTOR_OPS(f3, kore_float3x4, f1, kore_float32x4, 3)
+KORE_CPU_COMPUTE_VECTOR_OPS(f4, kore_float4x4, f1, kore_float32x4, 4)
+KORE_CPU_COMPUTE_VECTOR_OPS(i2, kore_int2x4, i1, kore_int32x4, 2)
+KORE_CPU_COMPUTE_VECTOR_OPS(i3, kore_int3x4, i1, kore_int32x4, 3)
+KORE_CPU_COMPUTE_VECTOR_OPS(i4, kore_int4x4, i1, kore_int32x4, 4)
+KORE_CPU_COMPUTE_VECTOR_OPS(u2, kore_uint2x4, u1, kore_uint32x4, 2)
+KORE_CPU_COMPUTE_VECTOR_OPS(u3, kore_uint3x4, u1, kore_uint32x4, 3)
+KORE_CPU_COMPUTE_VECTOR_OPS(u4, kore_uint4x4, u1, kore_uint32x4, 4)
+
+#endif
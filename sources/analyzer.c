@@ -3,6 +3,7 @@
 #include "array.h"
 #include "errors.h"
 #include "global.h"
+#include "stats.h"
 
 #include <string.h>
 
@@ -79,11 +80,40 @@ void find_referenced_globals(function *f, global_array *globals) {
 			case OPCODE_GREATER:
 			case OPCODE_GREATER_EQUAL:
 			case OPCODE_LESS:
-			case OPCODE_LESS_EQUAL: {
+			case OPCODE_LESS_EQUAL:
+			case OPCODE_MOD:
+			case OPCODE_AND:
+			case OPCODE_OR:
+			case OPCODE_BITWISE_XOR:
+			case OPCODE_BITWISE_AND:
+			case OPCODE_BITWISE_OR:
+			case OPCODE_LEFT_SHIFT:
+			case OPCODE_RIGHT_SHIFT: {
 				find_referenced_global_for_var(o->op_binary.left, globals, false, false);
 				find_referenced_global_for_var(o->op_binary.right, globals, false, false);
 				break;
 			}
+			// scalar consts are used directly
+			case OPCODE_NOT: {
+				find_referenced_global_for_var(o->op_not.from, globals, false, false);
+				break;
+			}
+			case OPCODE_NEGATE: {
+				find_referenced_global_for_var(o->op_negate.from, globals, false, false);
+				break;
+			}
+			case OPCODE_STORE_VARIABLE:
+			case OPCODE_SUB_AND_STORE_VARIABLE:
+			case OPCODE_ADD_AND_STORE_VARIABLE:
+			case OPCODE_DIVIDE_AND_STORE_VARIABLE:
+			case OPCODE_MULTIPLY_AND_STORE_VARIABLE: {
+				find_referenced_global_for_var(o->op_store_var.from, globals, false, false);
+				break;
+			}
+			case OPCODE_IF: {
+				find_referenced_global_for_var(o->op_if.condition, globals, false, false);
+				break;
+			}
 			case OPCODE_LOAD_ACCESS_LIST: {
 				find_referenced_global_for_var(o->op_load_access_list.from, globals, true, false);
 				break;
@@ -102,6 +132,10 @@ void find_referenced_globals(function *f, global_array *globals) {
 				}
 				break;
 			}
+			case OPCODE_ATOMIC: {
+				find_referenced_global_for_var(o->op_atomic.to, globals, true, true);
+				break;
+			}
 			default:
 				break;
 			}
@@ -196,15 +230,25 @@ void find_used_builtins(function *f) {
 				f->used_builtins.vertex_id = true;
 			}
 
+			if (func == add_name("wave_lane_index")) {
+				f->used_builtins.wave_lane_index = true;
+			}
+
+			if (func == add_name("wave_lane_count")) {
+				f->used_builtins.wave_lane_count = true;
+			}
+
 			for (function_id i = 0; get_function(i) != NULL; ++i) {
 				function *called = get_function(i);
 				if (called->name == o->op_call.func) {
-					find_used_builtins(f);
+					find_used_builtins(called);
 
 					f->used_builtins.dispatch_thread_id |= called->used_builtins.dispatch_thread_id;
 					f->used_builtins.group_thread_id |= called->used_builtins.group_thread_id;
 					f->used_builtins.group_id |= called->used_builtins.group_id;
 					f->used_builtins.vertex_id |= called->used_builtins.vertex_id;
+					f->used_builtins.wave_lane_index |= called->used_builtins.wave_lane_index;
+					f->used_builtins.wave_lane_count |= called->used_builtins.wave_lane_count;
 
 					break;
 				}
@@ -229,6 +273,11 @@ static global *find_global_by_var(variable var) {
 	return NULL;
 }
 
+static bool is_group_shared(variable var) {
+	global *g = find_global_by_var(var);
+	return g != NULL && g->group_shared;
+}
+
 void find_used_capabilities(function *f) {
 	if (f->block == NULL) {
 		// built-in
@@ -264,6 +313,35 @@ void find_used_capabilities(function *f) {
 				assert(g != NULL);
 				g->usage |= GLOBAL_USAGE_TEXTURE_WRITE;
 			}
+			else if (to.kind == VARIABLE_GLOBAL && is_group_shared(to)) {
+				f->used_capabilities.group_shared = true;
+			}
+			else if (to.kind == VARIABLE_GLOBAL) {
+				global *g = find_global_by_var(to);
+				if (g != NULL && global_is_buffer(g)) {
+					g->usage |= GLOBAL_USAGE_BUFFER_WRITE;
+				}
+			}
+			break;
+		}
+		case OPCODE_ATOMIC: {
+			f->used_capabilities.atomics = true;
+
+			global *g = find_global_by_var(o->op_atomic.to);
+			assert(g != NULL);
+			g->usage |= GLOBAL_USAGE_ATOMIC;
+
+			if (is_texture(g->type)) {
+				f->used_capabilities.image_read  = true;
+				f->used_capabilities.image_write = true;
+				g->usage |= GLOBAL_USAGE_TEXTURE_READ | GLOBAL_USAGE_TEXTURE_WRITE;
+			}
+			else if (g->group_shared) {
+				f->used_capabilities.group_shared = true;
+			}
+			else {
+				g->usage |= GLOBAL_USAGE_BUFFER_WRITE;
+			}
 			break;
 		}
 		case OPCODE_LOAD_ACCESS_LIST: {
@@ -283,13 +361,16 @@ void find_used_capabilities(function *f) {
 					g->usage |= GLOBAL_USAGE_TEXTURE_READ;
 				}
 			}
+			else if (from.kind == VARIABLE_GLOBAL && is_group_shared(from)) {
+				f->used_capabilities.group_shared = true;
+			}
 
 			break;
 		}
 		case OPCODE_CALL: {
 			name_id func_name = o->op_call.func;
 
-			if (func_name == add_name("sample") || func_name == add_name("sample_lod")) {
+			if (is_texture_function(func_name)) {
 				variable tex_parameter = o->op_call.parameters[0];
 
 				global *g = NULL;
@@ -307,13 +388,66 @@ void find_used_capabilities(function *f) {
 				g->usage |= GLOBAL_USAGE_TEXTURE_SAMPLE;
 			}
 
+			if (is_gather_function(func_name)) {
+				f->used_capabilities.texture_gather = true;
+				if (gather_component(func_name) != 0) {
+					f->used_capabilities.texture_gather_component = true;
+				}
+			}
+
+			if (func_name == add_name("wave_lane_index") || func_name == add_name("wave_lane_count") || func_name == add_name("wave_is_first_lane")) {
+				f->used_capabilities.wave_basic = true;
+			}
+
+			if (func_name == add_name("wave_all_true") || func_name == add_name("wave_any_true")) {
+				f->used_capabilities.wave_basic = true;
+				f->used_capabilities.wave_vote  = true;
+			}
+
+			if (func_name == add_name("wave_ballot") || func_name == add_name("wave_count_bits") || func_name == add_name("wave_read_first")) {
+				f->used_capabilities.wave_basic  = true;
+				f->used_capabilities.wave_ballot = true;
+			}
+
+			if (func_name == add_name("wave_sum") || func_name == add_name("wave_min") || func_name == add_name("wave_max") ||
+			    func_name == add_name("wave_prefix_sum")) {
+				f->used_capabilities.wave_basic      = true;
+				f->used_capabilities.wave_arithmetic = true;
+			}
+
+			if (func_name == add_name("wave_read_lane")) {
+				f->used_capabilities.wave_basic   = true;
+				f->used_capabilities.wave_shuffle = true;
+			}
+
+			if (func_name == add_name("group_barrier") || func_name == add_name("group_memory_barrier") || func_name == add_name("device_barrier") ||
+			    func_name == add_name("device_memory_barrier")) {
+				f->used_capabilities.barriers = true;
+			}
+
+			if (func_name == add_name("dispatch_mesh") || func_name == add_name("set_mesh_output_counts") || func_name == add_name("set_mesh_vertex") ||
+			    func_name == add_name("set_mesh_triangle")) {
+				f->used_capabilities.mesh_shading = true;
+			}
+
 			for (function_id i = 0; get_function(i) != NULL; ++i) {
 				function *called = get_function(i);
 				if (called->name == func_name) {
-					find_used_capabilities(f);
+					find_used_capabilities(called);
 
 					f->used_capabilities.image_read |= called->used_capabilities.image_read;
 					f->used_capabilities.image_write |= called->used_capabilities.image_write;
+					f->used_capabilities.wave_basic |= called->used_capabilities.wave_basic;
+					f->used_capabilities.wave_vote |= called->used_capabilities.wave_vote;
+					f->used_capabilities.wave_ballot |= called->used_capabilities.wave_ballot;
+					f->used_capabilities.wave_arithmetic |= called->used_capabilities.wave_arithmetic;
+					f->used_capabilities.wave_shuffle |= called->used_capabilities.wave_shuffle;
+					f->used_capabilities.group_shared |= called->used_capabilities.group_shared;
+					f->used_capabilities.barriers |= called->used_capabilities.barriers;
+					f->used_capabilities.atomics |= called->used_capabilities.atomics;
+					f->used_capabilities.texture_gather |= called->used_capabilities.texture_gather;
+					f->used_capabilities.texture_gather_component |= called->used_capabilities.texture_gather_component;
+					f->used_capabilities.mesh_shading |= called->used_capabilities.mesh_shading;
 
 					break;
 				}
@@ -382,6 +516,44 @@ void find_referenced_types(function *f, type_id *types, size_t *types_size) {
 	}
 }
 
+void find_referenced_indirect_args(function *f, type_id *types, size_t *types_size) {
+	global_array globals = KONG_INIT_ZERO;
+	find_referenced_globals(f, &globals);
+
+	for (size_t global_index = 0; global_index < globals.size; ++global_index) {
+		global *g = get_global(globals.globals[global_index]);
+		if (global_is_buffer(g) && is_indirect_args(get_type(g->type)->base)) {
+			add_found_type(get_type(g->type)->base, types, types_size);
+		}
+	}
+}
+
+type_id find_mesh_payload_type(function *main) {
+	function *functions[256];
+	size_t    functions_size = 0;
+
+	functions[functions_size] = main;
+	functions_size += 1;
+
+	find_referenced_functions(main, functions, &functions_size);
+
+	for (size_t function_index = 0; function_index < functions_size; ++function_index) {
+		uint8_t *data = functions[function_index]->code.o;
+		size_t   size = functions[function_index]->code.size;
+
+		size_t index = 0;
+		while (index < size) {
+			opcode *o = (opcode *)&data[index];
+			if (o->type == OPCODE_CALL && o->op_call.func == add_name("dispatch_mesh") && o->op_call.parameters_size == 4) {
+				return o->op_call.parameters[3].type.type;
+			}
+			index += o->size;
+		}
+	}
+
+	return NO_TYPE;
+}
+
 static bool has_set(descriptor_sets *sets, descriptor_set *set) {
 	for (size_t set_index = 0; set_index < sets->size; ++set_index) {
 		if (sets->values[set_index] == set) {
@@ -800,9 +972,7 @@ static void find_descriptor_set_groups(void) {
 		uint32_t descriptor_set_group_index = (uint32_t)all_descriptor_set_groups.size;
 		static_array_push(all_descriptor_set_groups, group);
 
-		for (size_t compute_shader_index = 0; compute_shader_index < all_compute_shaders.size; ++compute_shader_index) {
-			assign_descriptor_set_group_index(all_compute_shaders.values[compute_shader_index], descriptor_set_group_index);
-		}
+		assign_descriptor_set_group_index(all_compute_shaders.values[compute_shader_index], descriptor_set_group_index);
 	}
 
 	for (size_t pipeline_group_index = 0; pipeline_group_index < all_raytracing_pipeline_groups.size; ++pipeline_group_index) {
@@ -867,15 +1037,15 @@ descriptor_set_group *find_descriptor_set_group_for_pipe_type(type *t) {
 	if (!t->built_in && has_attribute(&t->attributes, add_name("pipe"))) {
 		render_pipeline pipeline = extract_render_pipeline_from_type(t);
 
-		if (pipeline.vertex_shader->descriptor_set_group_index != UINT32_MAX) {
+		if (pipeline.vertex_shader != NULL && pipeline.vertex_shader->descriptor_set_group_index != UINT32_MAX) {
 			return &all_descriptor_set_groups.values[pipeline.vertex_shader->descriptor_set_group_index];
 		}
 
-		if (pipeline.amplification_shader->descriptor_set_group_index != UINT32_MAX) {
+		if (pipeline.amplification_shader != NULL && pipeline.amplification_shader->descriptor_set_group_index != UINT32_MAX) {
 			return &all_descriptor_set_groups.values[pipeline.amplification_shader->descriptor_set_group_index];
 		}
 
-		if (pipeline.mesh_shader->descriptor_set_group_index != UINT32_MAX) {
+		if (pipeline.mesh_shader != NULL && pipeline.mesh_shader->descriptor_set_group_index != UINT32_MAX) {
 			return &all_descriptor_set_groups.values[pipeline.mesh_shader->descriptor_set_group_index];
 		}
 
@@ -941,7 +1111,21 @@ void find_sampler_use() {
 
 			switch (o->type) {
 			case OPCODE_CALL:
-				if (o->op_call.func == add_name("sample") || o->op_call.func == add_name("sample_lod")) {
+				if (o->op_call.func == add_name("sample_compare")) {
+					debug_context context = KONG_INIT_ZERO;
+					check(is_depth(get_type(o->op_call.parameters[0].type.type)->tex_format), context, "sample_compare requires a depth texture");
+
+					global *g = find_global_by_var(o->op_call.parameters[1]);
+					assert(g != NULL);
+					g->usage |= GLOBAL_USAGE_SAMPLE_DEPTH | GLOBAL_USAGE_SAMPLE_COMPARE;
+
+					// GLSL, HLSL and Metal declare comparison textures differently
+					global *texture = find_global_by_var(o->op_call.parameters[0]);
+					if (texture != NULL) {
+						texture->usage |= GLOBAL_USAGE_SAMPLE_COMPARE;
+					}
+				}
+				else if (is_texture_function(o->op_call.func) && o->op_call.func != add_name("load")) {
 					if (is_depth(get_type(o->op_call.parameters[0].type.type)->tex_format)) {
 
 						type *sampler_type = get_type(o->op_call.parameters[1].type.type);
@@ -959,18 +1143,73 @@ void find_sampler_use() {
 			index += o->size;
 		}
 	}
+
+	// comparison samplers have their own type in HLSL and WGSL and can not be used for anything else
+	for (function_id i = 0; get_function(i) != NULL; ++i) {
+		function *f = get_function(i);
+
+		if (f->block == NULL) {
+			continue;
+		}
+
+		uint8_t *data = f->code.o;
+		size_t   size = f->code.size;
+
+		size_t index = 0;
+		while (index < size) {
+			opcode *o = (opcode *)&data[index];
+
+			if (o->type == OPCODE_CALL && is_texture_function(o->op_call.func) && o->op_call.func != add_name("load") &&
+			    o->op_call.func != add_name("sample_compare")) {
+				global *g = find_global_by_var(o->op_call.parameters[1]);
+
+				debug_context context = KONG_INIT_ZERO;
+				check(g == NULL || (g->usage & GLOBAL_USAGE_SAMPLE_COMPARE) == 0, context, "Sampler %s is used by sample_compare and by %s",
+				      g != NULL ? get_name(g->name) : "", get_name(o->op_call.func));
+			}
+
+			index += o->size;
+		}
+	}
+}
+
+static void check_compute_only_capabilities(function *f) {
+	if (f == NULL) {
+		return;
+	}
+
+	find_used_capabilities(f);
+
+	debug_context context = KONG_INIT_ZERO;
+	check(!f->used_capabilities.group_shared && !f->used_capabilities.barriers, context,
+	      "Group shared variables and barriers are only available in compute, amplification and mesh shaders but are used by %s", get_name(f->name));
 }
 
 void analyze(void) {
+	stats_begin("find_render_pipelines");
 	find_all_render_pipelines();
 	find_render_pipeline_groups();
+	stats_end();
+
+	for (size_t pipeline_index = 0; pipeline_index < all_render_pipelines.size; ++pipeline_index) {
+		check_compute_only_capabilities(all_render_pipelines.values[pipeline_index].vertex_shader);
+		check_compute_only_capabilities(all_render_pipelines.values[pipeline_index].fragment_shader);
+	}
 
+	stats_begin("find_compute_shaders");
 	find_all_compute_shaders();
+	stats_end();
 
+	stats_begin("find_raytracing_pipelines");
 	find_all_raytracing_pipelines();
 	find_raytracing_pipeline_groups();
+	stats_end();
 
+	stats_begin("find_descriptor_set_groups");
 	find_descriptor_set_groups();
+	stats_end();
 
+	stats_begin("find_sampler_use");
 	find_sampler_use();
+	stats_end();
 }
@@ -0,0 +1,568 @@
+#include "blobs.h"
+
+#include "../errors.h"
+#include "../global.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_BLOBS 1024
+
+typedef struct blob {
+	uint8_t *data;
+	size_t   size;
+	uint64_t hash;
+	size_t   arena_offset;
+} blob;
+
+typedef struct blob_reference {
+	char   c_type[64];
+	char   name[256];
+	size_t blob_index;
+} blob_reference;
+
+static blob_mode mode = BLOB_MODE_STRINGS;
+
+static blob   blobs[MAX_BLOBS];
+static size_t blobs_count = 0;
+
+static blob_reference references[MAX_BLOBS];
+static size_t         references_count = 0;
+
+void set_blob_mode(blob_mode new_mode) {
+	mode = new_mode;
+}
+
+blob_mode get_blob_mode(void) {
+	return mode;
+}
+
+bool blobs_need_init(void) {
+	return mode == BLOB_MODE_COMPRESSED || mode == BLOB_MODE_PACK;
+}
+
+static uint64_t hash_data(const uint8_t *data, size_t size) {
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= data[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static size_t add_blob(const uint8_t *data, size_t size) {
+	uint64_t hash = hash_data(data, size);
+
+	for (size_t blob_index = 0; blob_index < blobs_count; ++blob_index) {
+		if (blobs[blob_index].hash == hash && blobs[blob_index].size == size && memcmp(blobs[blob_index].data, data, size) == 0) {
+			return blob_index;
+		}
+	}
+
+	debug_context context = KONG_INIT_ZERO;
+	check(blobs_count < MAX_BLOBS, context, "Too many shader blobs");
+
+	blob *b = &blobs[blobs_count];
+	b->data = (uint8_t *)malloc(size);
+	assert(b->data != NULL);
+	memcpy(b->data, data, size);
+	b->size = size;
+	b->hash = hash;
+
+	return blobs_count++;
+}
+
+void write_blob_definition(FILE *file, const char *c_type, const char *name, const uint8_t *data, size_t size, bool text) {
+	assert(mode != BLOB_MODE_STRINGS);
+
+	size_t blob_index;
+	if (text) {
+		uint8_t *terminated = (uint8_t *)malloc(size + 1);
+		assert(terminated != NULL);
+		memcpy(terminated, data, size);
+		terminated[size] = 0;
+		blob_index = add_blob(terminated, size + 1);
+		free(terminated);
+	}
+	else {
+		blob_index = add_blob(data, size);
+	}
+
+	debug_context context = KONG_INIT_ZERO;
+	check(references_count < MAX_BLOBS, context, "Too many shader blobs");
+
+	blob_reference *reference = &references[references_count++];
+	strcpy(reference->c_type, c_type);
+	strcpy(reference->name, name);
+	reference->blob_index = blob_index;
+
+	if (blobs_need_init()) {
+		// kong_blobs_init points this into the arena or the pack
+		fprintf(file, "%s%s = NULL;\n", c_type, name);
+	}
+	else {
+		// unsigned char because the GLSL and WGSL headers do not include stdint.h
+		fprintf(file, "extern const unsigned char kong_blob_%zu[];\n", blob_index);
+		fprintf(file, "%s%s = (%s)kong_blob_%zu;\n", c_type, name, c_type, blob_index);
+	}
+	fprintf(file, "size_t %s_size = %zu;\n\n", name, size);
+}
+
+// based on the encoding described in https://github.com/adobe/bin2c
+static void write_bytes(FILE *file, const uint8_t *data, size_t size) {
+	for (size_t i = 0; i < size; ++i) {
+		if (data[i] == '!' || data[i] == '#' || (data[i] >= '%' && data[i] <= '>') || (data[i] >= 'A' && data[i] <= '[') ||
+		    (data[i] >= ']' && data[i] <= '~')) {
+			fprintf(file, "%c", data[i]);
+		}
+		else if (data[i] == '\"') {
+			fprintf(file, "\\\"");
+		}
+		else if (data[i] == '\\') {
+			fprintf(file, "\\\\");
+		}
+		else {
+			fprintf(file, "\\%03o", data[i]);
+		}
+
+		// keeps the lines short enough for every C compiler
+		if (i % 4096 == 4095) {
+			fprintf(file, "\"\n\"");
+		}
+	}
+}
+
+#define MIN_MATCH 3
+#define MAX_MATCH (0x7f + MIN_MATCH)
+#define MAX_LITERALS 0x80
+#define MAX_DISTANCE 0xffff
+#define HASH_SIZE 4096
+
+static size_t write_literals(const uint8_t *data, size_t start, size_t end, uint8_t *compressed, size_t compressed_size) {
+	while (start < end) {
+		size_t length = end - start < MAX_LITERALS ? end - start : MAX_LITERALS;
+		compressed[compressed_size++] = (uint8_t)(length - 1);
+		memcpy(&compressed[compressed_size], &data[start], length);
+		compressed_size += length;
+		start += length;
+	}
+	return compressed_size;
+}
+
+static uint32_t hash_prefix(const uint8_t *data) {
+	return ((uint32_t)data[0] * 2654435761u ^ (uint32_t)data[1] * 40503u ^ (uint32_t)data[2]) % HASH_SIZE;
+}
+
+// A small LZ77 variant: a token below 0x80 is followed by token + 1 literal bytes, any other token copies
+// (token & 0x7f) + 3 bytes from a distance given by the next two bytes (little endian) back in the output
+static size_t compress(const uint8_t *data, size_t size, uint8_t *compressed) {
+	static size_t positions[HASH_SIZE];
+	memset(positions, 0, sizeof(positions));
+
+	size_t compressed_size = 0;
+	size_t literal_start   = 0;
+	size_t i               = 0;
+
+	while (i + MIN_MATCH <= size) {
+		uint32_t hash      = hash_prefix(&data[i]);
+		size_t   candidate = positions[hash];
+		positions[hash]    = i + 1;
+
+		size_t length = 0;
+		if (candidate != 0 && i - (candidate - 1) <= MAX_DISTANCE) {
+			size_t start = candidate - 1;
+			while (i + length < size && length < MAX_MATCH && data[start + length] == data[i + length]) {
+				++length;
+			}
+		}
+
+		if (length >= MIN_MATCH) {
+			size_t distance = i - (candidate - 1);
+
+			compressed_size = write_literals(data, literal_start, i, compressed, compressed_size);
+
+			compressed[compressed_size++] = (uint8_t)(0x80 | (length - MIN_MATCH));
+			compressed[compressed_size++] = (uint8_t)(distance & 0xff);
+			compressed[compressed_size++] = (uint8_t)(distance >> 8);
+
+			for (size_t skipped = i + 1; skipped < i + length && skipped + MIN_MATCH <= size; ++skipped) {
+				positions[hash_prefix(&data[skipped])] = skipped + 1;
+			}
+
+			i += length;
+			literal_start = i;
+		}
+		else {
+			++i;
+		}
+	}
+
+	return write_literals(data, literal_start, size, compressed, compressed_size);
+}
+
+static void write_decompressor(FILE *file) {
+	fprintf(file, "static void kong_blobs_decompress(const uint8_t *source, size_t source_size, uint8_t *destination) {\n");
+	fprintf(file, "\tsize_t read = 0;\n");
+	fprintf(file, "\tsize_t written = 0;\n");
+	fprintf(file, "\twhile (read < source_size) {\n");
+	fprintf(file, "\t\tuint8_t token = source[read++];\n");
+	fprintf(file, "\t\tif (token < 0x80) {\n");
+	fprintf(file, "\t\t\tmemcpy(&destination[written], &source[read], token + 1);\n");
+	fprintf(file, "\t\t\tread += token + 1;\n");
+	fprintf(file, "\t\t\twritten += token + 1;\n");
+	fprintf(file, "\t\t}\n");
+	fprintf(file, "\t\telse {\n");
+	fprintf(file, "\t\t\tsize_t length = (token & 0x7f) + %d;\n", MIN_MATCH);
+	fprintf(file, "\t\t\tsize_t distance = source[read] | ((size_t)source[read + 1] << 8);\n");
+	fprintf(file, "\t\t\tread += 2;\n");
+	fprintf(file, "\t\t\t// the source and the destination overlap for repeating patterns\n");
+	fprintf(file, "\t\t\tfor (size_t index = 0; index < length; ++index) {\n");
+	fprintf(file, "\t\t\t\tdestination[written] = destination[written - distance];\n");
+	fprintf(file, "\t\t\t\t++written;\n");
+	fprintf(file, "\t\t\t}\n");
+	fprintf(file, "\t\t}\n");
+	fprintf(file, "\t}\n");
+	fprintf(file, "}\n\n");
+}
+
+static FILE *open_output(char *directory, const char *filename) {
+	char full_filename[512];
+	sprintf(full_filename, "%s/%s", directory, filename);
+	FILE *file = fopen(full_filename, "wb");
+
+	if (file == NULL) {
+		debug_context context = KONG_INIT_ZERO;
+		error(context, "Could not open file %s.", full_filename);
+	}
+
+	return file;
+}
+
+static void write_header(char *directory) {
+	FILE *file = open_output(directory, "kong_blobs.h");
+
+	fprintf(file, "#ifndef KONG_BLOBS_HEADER\n");
+	fprintf(file, "#define KONG_BLOBS_HEADER\n\n");
+
+	if (mode == BLOB_MODE_PACK) {
+		fprintf(file, "#include <stdbool.h>\n");
+		fprintf(file, "#include <stddef.h>\n\n");
+	}
+
+	fprintf(file, "#ifdef __cplusplus\n");
+	fprintf(file, "extern \"C\" {\n");
+	fprintf(file, "#endif\n\n");
+
+	fprintf(file, "// Has to run before any shader code is used, kong_init takes care of that\n");
+	fprintf(file, "void kong_blobs_init(void);\n");
+
+	if (mode == BLOB_MODE_PACK) {
+		fprintf(file, "\n// Uses a kong_blobs.pack that is already in memory (for example memory mapped or loaded as an asset) instead of\n");
+		fprintf(file, "// reading KONG_BLOBS_PACK in kong_blobs_init, data is not copied and has to stay valid\n");
+		fprintf(file, "bool kong_blobs_init_from_memory(const void *data, size_t size);\n");
+	}
+
+	fprintf(file, "\n#ifdef __cplusplus\n");
+	fprintf(file, "}\n");
+	fprintf(file, "#endif\n\n");
+
+	fprintf(file, "#endif\n");
+
+	fclose(file);
+}
+
+// SPIR-V and DXIL are read as 32 bit words
+static size_t layout_arena(void) {
+	size_t arena_size = 0;
+	for (size_t blob_index = 0; blob_index < blobs_count; ++blob_index) {
+		arena_size                     = (arena_size + 7) & ~(size_t)7;
+		blobs[blob_index].arena_offset = arena_size;
+		arena_size += blobs[blob_index].size;
+	}
+	return arena_size;
+}
+
+static uint8_t *build_arena(size_t arena_size) {
+	uint8_t *arena = (uint8_t *)calloc(arena_size + 1, 1);
+	assert(arena != NULL);
+	for (size_t blob_index = 0; blob_index < blobs_count; ++blob_index) {
+		memcpy(&arena[blobs[blob_index].arena_offset], blobs[blob_index].data, blobs[blob_index].size);
+	}
+	return arena;
+}
+
+static void write_reference_declarations(FILE *file) {
+	for (size_t reference_index = 0; reference_index < references_count; ++reference_index) {
+		fprintf(file, "extern %s%s;\n", references[reference_index].c_type, references[reference_index].name);
+	}
+	fprintf(file, "\n");
+}
+
+static void write_deduplicated(FILE *file) {
+	for (size_t blob_index = 0; blob_index < blobs_count; ++blob_index) {
+		// one more for the zero the string literal ends with
+		fprintf(file, "const unsigned char kong_blob_%zu[%zu] = \"", blob_index, blobs[blob_index].size + 1);
+		write_bytes(file, blobs[blob_index].data, blobs[blob_index].size);
+		fprintf(file, "\";\n\n");
+	}
+
+	fprintf(file, "void kong_blobs_init(void) {}\n");
+}
+
+static void write_compressed(FILE *file) {
+	size_t   arena_size = layout_arena();
+	uint8_t *arena      = build_arena(arena_size);
+
+	uint8_t *compressed = (uint8_t *)malloc(arena_size + arena_size / MAX_LITERALS + 16);
+	assert(compressed != NULL);
+	size_t compressed_size = compress(arena, arena_size, compressed);
+
+	fprintf(file, "#define KONG_BLOBS_SIZE %zu\n\n", arena_size);
+
+	fprintf(file, "static const uint8_t kong_blobs_compressed[%zu] = \"", compressed_size + 1);
+	write_bytes(file, compressed, compressed_size);
+	fprintf(file, "\";\n\n");
+
+	write_reference_declarations(file);
+
+	fprintf(file, "static uint8_t *kong_blobs_arena = NULL;\n\n");
+
+	write_decompressor(file);
+
+	fprintf(file, "void kong_blobs_init(void) {\n");
+	fprintf(file, "\tif (kong_blobs_arena != NULL) {\n");
+	fprintf(file, "\t\treturn;\n");
+	fprintf(file, "\t}\n\n");
+	fprintf(file, "\tkong_blobs_arena = (uint8_t *)malloc(KONG_BLOBS_SIZE + 1);\n");
+	fprintf(file, "\tassert(kong_blobs_arena != NULL);\n");
+	fprintf(file, "\tkong_blobs_decompress(kong_blobs_compressed, sizeof(kong_blobs_compressed) - 1, kong_blobs_arena);\n\n");
+	for (size_t reference_index = 0; reference_index < references_count; ++reference_index) {
+		blob_reference *reference = &references[reference_index];
+		fprintf(file, "\t%s = (%s)&kong_blobs_arena[%zu];\n", reference->name, reference->c_type, blobs[reference->blob_index].arena_offset);
+	}
+	fprintf(file, "}\n");
+
+	free(compressed);
+	free(arena);
+}
+
+static void absolute_directory(char *directory, char *absolute) {
+#ifdef _WIN32
+	if (_fullpath(absolute, directory, 512) == NULL) {
+#else
+	if (realpath(directory, absolute) == NULL) {
+#endif
+		debug_context context = KONG_INIT_ZERO;
+		error(context, "Could not resolve directory %s.", directory);
+	}
+
+	// the assembler takes forward slashes everywhere and backslashes would need escaping
+	for (size_t i = 0; absolute[i] != 0; ++i) {
+		if (absolute[i] == '\\') {
+			absolute[i] = '/';
+		}
+	}
+}
+
+static void write_incbin(FILE *file, char *directory) {
+	for (size_t blob_index = 0; blob_index < blobs_count; ++blob_index) {
+		char filename[64];
+		sprintf(filename, "kong_blob_%zu.bin", blob_index);
+		FILE *binary = open_output(directory, filename);
+		fwrite(blobs[blob_index].data, 1, blobs[blob_index].size, binary);
+		fclose(binary);
+	}
+
+	char absolute[4096];
+	absolute_directory(directory, absolute);
+
+	fprintf(file, "#if defined(_MSC_VER) && !defined(__clang__)\n");
+	fprintf(file, "#error \"--blobs incbin needs GCC or Clang, use --blobs pack for MSVC\"\n");
+	fprintf(file, "#endif\n\n");
+
+	fprintf(file, "// define this when the generated files are moved after running kongruent\n");
+	fprintf(file, "#ifndef KONG_BLOBS_DIRECTORY\n");
+	fprintf(file, "#define KONG_BLOBS_DIRECTORY \"%s\"\n", absolute);
+	fprintf(file, "#endif\n\n");
+
+	fprintf(file, "#if defined(__APPLE__)\n");
+	fprintf(file, "#define KONG_BLOBS_SECTION \".const_data\"\n");
+	fprintf(file, "#define KONG_BLOBS_SYMBOL(name) \"_\" name\n");
+	fprintf(file, "#elif defined(_WIN32)\n");
+	fprintf(file, "#define KONG_BLOBS_SECTION \".section .rdata,\\\"dr\\\"\"\n");
+	fprintf(file, "#define KONG_BLOBS_SYMBOL(name) name\n");
+	fprintf(file, "#else\n");
+	fprintf(file, "#define KONG_BLOBS_SECTION \".section .rodata\"\n");
+	fprintf(file, "#define KONG_BLOBS_SYMBOL(name) name\n");
+	fprintf(file, "#endif\n\n");
+
+	for (size_t blob_index = 0; blob_index < blobs_count; ++blob_index) {
+		fprintf(file, "__asm__(KONG_BLOBS_SECTION \"\\n\"\n");
+		fprintf(file, "        \".global \" KONG_BLOBS_SYMBOL(\"kong_blob_%zu\") \"\\n\"\n", blob_index);
+		fprintf(file, "        \".balign 8\\n\"\n");
+		fprintf(file, "        KONG_BLOBS_SYMBOL(\"kong_blob_%zu\") \":\\n\"\n", blob_index);
+		fprintf(file, "        \".incbin \\\"\" KONG_BLOBS_DIRECTORY \"/kong_blob_%zu.bin\\\"\\n\"\n", blob_index);
+		fprintf(file, "        \".text\\n\");\n\n");
+	}
+
+	fprintf(file, "void kong_blobs_init(void) {}\n");
+}
+
+#define PACK_MAGIC 0x424c424bu // KBLB
+#define PACK_VERSION 1
+
+static void write_u32(uint8_t *data, uint32_t value) {
+	for (int i = 0; i < 4; ++i) {
+		data[i] = (uint8_t)(value >> (i * 8));
+	}
+}
+
+static void write_u64(uint8_t *data, uint64_t value) {
+	for (int i = 0; i < 8; ++i) {
+		data[i] = (uint8_t)(value >> (i * 8));
+	}
+}
+
+// kong_blobs.pack: magic, version, blob count, then per blob a 64 bit offset and size, then the 8 byte aligned blobs
+static void write_pack(FILE *file, char *directory) {
+	size_t header_size = 16 + blobs_count * 16;
+	size_t arena_size  = layout_arena();
+
+	uint8_t *header = (uint8_t *)calloc(header_size, 1);
+	assert(header != NULL);
+	write_u32(&header[0], PACK_MAGIC);
+	write_u32(&header[4], PACK_VERSION);
+	write_u32(&header[8], (uint32_t)blobs_count);
+	for (size_t blob_index = 0; blob_index < blobs_count; ++blob_index) {
+		write_u64(&header[16 + blob_index * 16], header_size + blobs[blob_index].arena_offset);
+		write_u64(&header[16 + blob_index * 16 + 8], blobs[blob_index].size);
+	}
+
+	uint8_t *arena = build_arena(arena_size);
+
+	FILE *pack = open_output(directory, "kong_blobs.pack");
+	fwrite(header, 1, header_size, pack);
+	fwrite(arena, 1, arena_size, pack);
+	fclose(pack);
+
+	free(arena);
+	free(header);
+
+	fprintf(file, "#include <stdio.h>\n\n");
+
+	fprintf(file, "#ifndef KONG_BLOBS_PACK\n");
+	fprintf(file, "#define KONG_BLOBS_PACK \"kong_blobs.pack\"\n");
+	fprintf(file, "#endif\n\n");
+
+	fprintf(file, "#define KONG_BLOBS_COUNT %zu\n\n", blobs_count);
+
+	write_reference_declarations(file);
+
+	fprintf(file, "static const uint8_t *kong_blobs_pack = NULL;\n\n");
+
+	fprintf(file, "static uint64_t kong_blobs_read(const uint8_t *data, int size) {\n");
+	fprintf(file, "\tuint64_t value = 0;\n");
+	fprintf(file, "\tfor (int i = 0; i < size; ++i) {\n");
+	fprintf(file, "\t\tvalue |= (uint64_t)data[i] << (i * 8);\n");
+	fprintf(file, "\t}\n");
+	fprintf(file, "\treturn value;\n");
+	fprintf(file, "}\n\n");
+
+	fprintf(file, "static const uint8_t *kong_blobs_get(const uint8_t *pack, size_t size, size_t blob_index, size_t blob_size) {\n");
+	fprintf(file, "\tuint64_t offset = kong_blobs_read(&pack[16 + blob_index * 16], 8);\n");
+	fprintf(file, "\tif (kong_blobs_read(&pack[16 + blob_index * 16 + 8], 8) != blob_size || offset + blob_size > size) {\n");
+	fprintf(file, "\t\treturn NULL;\n");
+	fprintf(file, "\t}\n");
+	fprintf(file, "\treturn &pack[offset];\n");
+	fprintf(file, "}\n\n");
+
+	fprintf(file, "bool kong_blobs_init_from_memory(const void *data, size_t size) {\n");
+	fprintf(file, "\tconst uint8_t *pack = (const uint8_t *)data;\n");
+	fprintf(file, "\tif (size < 16 + KONG_BLOBS_COUNT * 16 || kong_blobs_read(&pack[0], 4) != 0x%08xu || kong_blobs_read(&pack[4], 4) != %d ||\n",
+	        PACK_MAGIC, PACK_VERSION);
+	fprintf(file, "\t    kong_blobs_read(&pack[8], 4) != KONG_BLOBS_COUNT) {\n");
+	fprintf(file, "\t\treturn false;\n");
+	fprintf(file, "\t}\n\n");
+	fprintf(file, "\t// a pack from a different kongruent run does not match the sizes in the shader sources\n");
+	fprintf(file, "\tconst uint8_t *blobs[KONG_BLOBS_COUNT];\n");
+	fprintf(file, "\tfor (size_t blob_index = 0; blob_index < KONG_BLOBS_COUNT; ++blob_index) {\n");
+	fprintf(file, "\t\tstatic const size_t sizes[KONG_BLOBS_COUNT] = {");
+	for (size_t blob_index = 0; blob_index < blobs_count; ++blob_index) {
+		fprintf(file, "%s%zu", blob_index == 0 ? "" : ", ", blobs[blob_index].size);
+	}
+	fprintf(file, "};\n");
+	fprintf(file, "\t\tblobs[blob_index] = kong_blobs_get(pack, size, blob_index, sizes[blob_index]);\n");
+	fprintf(file, "\t\tif (blobs[blob_index] == NULL) {\n");
+	fprintf(file, "\t\t\treturn false;\n");
+	fprintf(file, "\t\t}\n");
+	fprintf(file, "\t}\n\n");
+	for (size_t reference_index = 0; reference_index < references_count; ++reference_index) {
+		blob_reference *reference = &references[reference_index];
+		fprintf(file, "\t%s = (%s)blobs[%zu];\n", reference->name, reference->c_type, reference->blob_index);
+	}
+	fprintf(file, "\n\tkong_blobs_pack = pack;\n");
+	fprintf(file, "\treturn true;\n");
+	fprintf(file, "}\n\n");
+
+	fprintf(file, "void kong_blobs_init(void) {\n");
+	fprintf(file, "\tif (kong_blobs_pack != NULL) {\n");
+	fprintf(file, "\t\treturn;\n");
+	fprintf(file, "\t}\n\n");
+	fprintf(file, "\tFILE *file = fopen(KONG_BLOBS_PACK, \"rb\");\n");
+	fprintf(file, "\tassert(file != NULL);\n");
+	fprintf(file, "\tfseek(file, 0, SEEK_END);\n");
+	fprintf(file, "\tsize_t size = (size_t)ftell(file);\n");
+	fprintf(file, "\tfseek(file, 0, SEEK_SET);\n\n");
+	fprintf(file, "\t// malloc keeps the blobs aligned like in the file\n");
+	fprintf(file, "\tuint8_t *data = (uint8_t *)malloc(size);\n");
+	fprintf(file, "\tassert(data != NULL);\n");
+	fprintf(file, "\tsize_t read = fread(data, 1, size, file);\n");
+	fprintf(file, "\tfclose(file);\n\n");
+	fprintf(file, "\tbool loaded = read == size && kong_blobs_init_from_memory(data, size);\n");
+	fprintf(file, "\tassert(loaded);\n");
+	fprintf(file, "\t(void)loaded;\n");
+	fprintf(file, "}\n");
+}
+
+void write_blobs(char *directory) {
+	if (mode == BLOB_MODE_STRINGS) {
+		return;
+	}
+
+	write_header(directory);
+
+	FILE *file = open_output(directory, "kong_blobs.c");
+
+	fprintf(file, "#include \"kong_blobs.h\"\n\n");
+
+	fprintf(file, "#include <assert.h>\n");
+	fprintf(file, "#include <stdbool.h>\n");
+	fprintf(file, "#include <stddef.h>\n");
+	fprintf(file, "#include <stdint.h>\n");
+	fprintf(file, "#include <stdlib.h>\n");
+	fprintf(file, "#include <string.h>\n");
+	if (mode != BLOB_MODE_PACK) {
+		fprintf(file, "\n");
+	}
+
+	switch (mode) {
+	case BLOB_MODE_DEDUPLICATED:
+		write_deduplicated(file);
+		break;
+	case BLOB_MODE_COMPRESSED:
+		write_compressed(file);
+		break;
+	case BLOB_MODE_INCBIN:
+		write_incbin(file, directory);
+		break;
+	case BLOB_MODE_PACK:
+		write_pack(file, directory);
+		break;
+	default:
+		assert(false);
+		break;
+	}
+
+	fclose(file);
+}
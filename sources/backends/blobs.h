@@ -0,0 +1,43 @@
+#ifndef KONG_BLOBS_HEADER
+#define KONG_BLOBS_HEADER
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum blob_mode {
+	// every shader carries its own string literal
+	BLOB_MODE_STRINGS,
+	// identical shaders share one array in kong_blobs.c
+	BLOB_MODE_DEDUPLICATED,
+	// like BLOB_MODE_DEDUPLICATED but compressed, kong_blobs_init unpacks everything into one arena
+	BLOB_MODE_COMPRESSED,
+	// unique shaders are written to kong_blob_<n>.bin and assembled into the binary with .incbin
+	BLOB_MODE_INCBIN,
+	// unique shaders are written to kong_blobs.pack, kong_blobs_init loads it or takes it from memory
+	BLOB_MODE_PACK,
+} blob_mode;
+
+void      set_blob_mode(blob_mode mode);
+blob_mode get_blob_mode(void);
+
+// Whether the shader pointers are only valid after kong_blobs_init
+bool blobs_need_init(void);
+
+// Writes the definitions of name and name_size for a shader whose data goes to kong_blobs.c,
+// text blobs keep a terminating zero after size bytes
+void write_blob_definition(FILE *file, const char *c_type, const char *name, const uint8_t *data, size_t size, bool text);
+
+// Writes kong_blobs.h and kong_blobs.c for all blobs added by write_blob_definition
+void write_blobs(char *directory);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -7,6 +7,7 @@
 #include "../global.h"
 #include "../parser.h"
 #include "../shader_stage.h"
+#include "../stats.h"
 #include "../types.h"
 #include "cstyle.h"
 #include "util.h"
@@ -18,7 +19,16 @@
 #include <stdlib.h>
 #include <string.h>
 
+static void check_full_precision(type_id type) {
+	if (is_16bit_type(type)) {
+		debug_context context = KONG_INIT_ZERO;
+		error(context, "%s is not supported in cpu kernels, compile with --16bit-types fallback", get_name(get_type(type)->name));
+	}
+}
+
 static const char *type_string_simd1(type_id type) {
+	check_full_precision(type);
+
 	if (type == float_id) {
 		return "float";
 	}
@@ -59,6 +69,8 @@ static const char *type_string_simd1(type_id type) {
 }
 
 static const char *type_string_simd4(type_id type) {
+	check_full_precision(type);
+
 	if (type == float_id) {
 		return "kore_float32x4";
 	}
@@ -118,33 +130,43 @@ static const char *type_string(type_id type, uint8_t simd_width) {
 static void write_code(char *code, char *header_code, char *directory, const char *filename, const char *name) {
 	char full_filename[512];
 
+	size_t file_size = strlen(code) + strlen(header_code) + 4096;
+	char  *file_code = (char *)malloc(file_size);
+
+	debug_context context = KONG_INIT_ZERO;
+	check(file_code != NULL, context, "Could not allocate code string");
+
+	// Unchanged kernels keep their timestamps so only edited shaders get rebuilt
 	{
 		sprintf(full_filename, "%s/%s.h", directory, filename);
-		FILE *file = fopen(full_filename, "wb");
-		fprintf(file, "#include <kong.h>\n\n");
-		fprintf(file, "#include <stddef.h>\n");
-		fprintf(file, "#include <stdint.h>\n\n");
 
-		fprintf(file, "%s", header_code);
+		size_t offset = 0;
+		offset += sprintf(&file_code[offset], "#include <kong.h>\n\n");
+		offset += sprintf(&file_code[offset], "#include <stddef.h>\n");
+		offset += sprintf(&file_code[offset], "#include <stdint.h>\n\n");
+
+		offset += sprintf(&file_code[offset], "%s", header_code);
 
-		fprintf(file, "void %s(uint32_t workgroup_count_x, uint32_t workgroup_count_y, uint32_t workgroup_count_z);\n\n", name);
+		offset += sprintf(&file_code[offset], "void %s(uint32_t workgroup_count_x, uint32_t workgroup_count_y, uint32_t workgroup_count_z);\n\n", name);
 
-		fclose(file);
+		write_file_if_changed(full_filename, file_code, offset);
 	}
 
 	{
 		sprintf(full_filename, "%s/%s.c", directory, filename);
 
-		FILE *file = fopen(full_filename, "wb");
-		fprintf(file, "#include \"%s.h\"\n\n", filename);
+		size_t offset = 0;
+		offset += sprintf(&file_code[offset], "#include \"%s.h\"\n\n", filename);
 
-		fprintf(file, "#include <kore3/math/vector.h>\n");
-		fprintf(file, "#include <kore3/util/cpucompute.h>\n\n");
+		offset += sprintf(&file_code[offset], "#include <kore3/math/vector.h>\n");
+		offset += sprintf(&file_code[offset], "#include <kore3/util/cpucompute.h>\n\n");
 
-		fprintf(file, "%s", code);
+		offset += sprintf(&file_code[offset], "%s", code);
 
-		fclose(file);
+		write_file_if_changed(full_filename, file_code, offset);
 	}
+
+	free(file_code);
 }
 
 static void write_types(char *code, size_t *offset, function *main, uint8_t simd_width) {
@@ -178,7 +200,11 @@ static void write_globals(char *code, size_t *offset, char *header_code, size_t
 		type   *t         = get_type(g->type);
 		type_id base_type = t->array_size > 0 ? t->base : g->type;
 
-		if (base_type == sampler_type_id) {
+		if (g->group_shared) {
+			// workgroups run one after another and can share the memory
+			*offset += sprintf(&code[*offset], "static %s _%" PRIu64 "[%u];\n\n", type_string_simd1(base_type), g->var_index, t->array_size);
+		}
+		else if (base_type == sampler_type_id) {
 			*offset += sprintf(&code[*offset], "SamplerState _%" PRIu64 ";\n\n", g->var_index);
 		}
 		else if (get_type(base_type)->tex_kind != TEXTURE_KIND_NONE) {
@@ -209,8 +235,10 @@ static void write_globals(char *code, size_t *offset, char *header_code, size_t
 		else if (base_type == bvh_type_id) {
 			*offset += sprintf(&code[*offset], "RaytracingAccelerationStructure  _%" PRIu64 ";\n\n", g->var_index);
 		}
-		else if (base_type == float_id) {
-			*offset += sprintf(&code[*offset], "static const float _%" PRIu64 " = %f;\n\n", g->var_index, g->value.value.floats[0]);
+		else if (global_is_scalar_constant(g)) {
+			*offset += sprintf(&code[*offset], "static const %s _%" PRIu64 " = ", type_string_simd1(g->type), g->var_index);
+			write_global_value(code, offset, g);
+			*offset += sprintf(&code[*offset], ";\n\n");
 		}
 		else if (base_type == float2_id) {
 			*offset += sprintf(&code[*offset], "static const kore_float2 _%" PRIu64 " = float2(%f, %f);\n\n", g->var_index, g->value.value.floats[0],
@@ -220,6 +248,16 @@ static void write_globals(char *code, size_t *offset, char *header_code, size_t
 			*offset += sprintf(&code[*offset], "static const kore_float3 _%" PRIu64 " = float3(%f, %f, %f);\n\n", g->var_index, g->value.value.floats[0],
 			                   g->value.value.floats[1], g->value.value.floats[2]);
 		}
+		else if (t->array_size > 0 && (base_type == uint_id || base_type == int_id)) {
+			const char *element_type = base_type == uint_id ? "uint32_t" : "int32_t";
+
+			*header_offset += sprintf(&header_code[*header_offset], "void set_%s(%s *value);\n\n", get_name(g->name), element_type);
+
+			*offset += sprintf(&code[*offset], "static %s *_%" PRIu64 ";\n\n", element_type, g->var_index);
+			*offset += sprintf(&code[*offset], "void set_%s(%s *value) {\n", get_name(g->name), element_type);
+			*offset += sprintf(&code[*offset], "\t_%" PRIu64 " = value;\n", g->var_index);
+			*offset += sprintf(&code[*offset], "}\n\n");
+		}
 		else if (base_type == float4_id) {
 			if (t->array_size > 0) {
 				*header_offset += sprintf(&header_code[*header_offset], "void set_%s(kore_float4 *value);\n\n", get_name(g->name));
@@ -289,6 +327,442 @@ static const char *type_to_mini(type_ref t) {
 	}
 }
 
+static bool is_global_variable(variable v) {
+	for (global_id i = 0; get_global(i) != NULL && get_global(i)->type != NO_TYPE; ++i) {
+		if (get_global(i)->var_index == v.index) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool is_uniform_struct(variable v) {
+	type *t = get_type(v.type.type);
+	return !t->built_in && t->array_size == 0;
+}
+
+static const char *simd4_scalar_type(type_id t) {
+	type_id base = vector_base_type(t);
+	if (base == int_id) {
+		return "kore_int32x4";
+	}
+	if (base == uint_id) {
+		return "kore_uint32x4";
+	}
+	return "kore_float32x4";
+}
+
+static const char *store_operation(opcode_type type) {
+	switch (type) {
+	case OPCODE_SUB_AND_STORE_ACCESS_LIST:
+		return "-=";
+	case OPCODE_ADD_AND_STORE_ACCESS_LIST:
+		return "+=";
+	case OPCODE_DIVIDE_AND_STORE_ACCESS_LIST:
+		return "/=";
+	case OPCODE_MULTIPLY_AND_STORE_ACCESS_LIST:
+		return "*=";
+	default:
+		return "=";
+	}
+}
+
+static size_t write_access_list(char *expression, size_t length, kong_access *access_list, size_t start, size_t end, bool pointer) {
+	for (size_t i = start; i < end; ++i) {
+		switch (access_list[i].kind) {
+		case ACCESS_ELEMENT:
+			length += sprintf(&expression[length], "[_%" PRIu64 "]", access_list[i].access_element.index.index);
+			break;
+		case ACCESS_MEMBER:
+			length += sprintf(&expression[length], "%s%s", pointer && i == 0 ? "->" : ".", get_name(access_list[i].access_member.name));
+			break;
+		case ACCESS_SWIZZLE: {
+			swizzle *swizzle = &access_list[i].access_swizzle.swizzle;
+
+			if (swizzle->size == 1) {
+				length += sprintf(&expression[length], ".%c", "xyzw"[swizzle->indices[0]]);
+			}
+			else {
+				char from[512];
+				strcpy(from, expression);
+
+				length = sprintf(expression, "(%s){", type_string_simd1(access_list[i].type));
+				for (uint32_t swizzle_index = 0; swizzle_index < swizzle->size; ++swizzle_index) {
+					length += sprintf(&expression[length], "%s%s.%c", swizzle_index == 0 ? "" : ", ", from, "xyzw"[swizzle->indices[swizzle_index]]);
+				}
+				length += sprintf(&expression[length], "}");
+			}
+			break;
+		}
+		}
+	}
+	return length;
+}
+
+static void write_broadcast(char *code, size_t *offset, type_id t, const char *expression) {
+	uint32_t size = vector_size(t);
+	if (size == 1) {
+		*offset += sprintf(&code[*offset], "%s_load_all(%s)", simd4_scalar_type(t), expression);
+	}
+	else {
+		*offset += sprintf(&code[*offset], "{");
+		for (uint32_t component = 0; component < size; ++component) {
+			*offset += sprintf(&code[*offset], "%s%s_load_all(%s.%c)", component == 0 ? "" : ", ", simd4_scalar_type(t), expression, "xyzw"[component]);
+		}
+		*offset += sprintf(&code[*offset], "}");
+	}
+}
+
+static void write_gather(char *code, size_t *offset, type_id t, char lanes[4][512]) {
+	uint32_t size = vector_size(t);
+	if (size == 1) {
+		*offset += sprintf(&code[*offset], "%s_load(%s, %s, %s, %s)", simd4_scalar_type(t), lanes[0], lanes[1], lanes[2], lanes[3]);
+	}
+	else {
+		*offset += sprintf(&code[*offset], "{");
+		for (uint32_t component = 0; component < size; ++component) {
+			char c = "xyzw"[component];
+			*offset += sprintf(&code[*offset], "%s%s_load(%s.%c, %s.%c, %s.%c, %s.%c)", component == 0 ? "" : ", ", simd4_scalar_type(t), lanes[0], c, lanes[1],
+			                   c, lanes[2], c, lanes[3], c);
+		}
+		*offset += sprintf(&code[*offset], "}");
+	}
+}
+
+// The four lanes of a kore_*x4 value form one wave which is combined using the lane accessors
+static void write_wave_operation(char *code, size_t *offset, int indentation, name_id func, variable result, variable value, variable lane) {
+	type_id     t      = result.type.type;
+	const char *lanes  = simd4_scalar_type(t);
+	const char *scalar = vector_base_type(t) == float_id ? "float" : (vector_base_type(t) == uint_id ? "uint32_t" : "int32_t");
+	uint32_t    size   = vector_size(t);
+
+	char components[4][64];
+	for (uint32_t component = 0; component < size; ++component) {
+		if (size == 1) {
+			sprintf(components[component], "_%" PRIu64, value.index);
+		}
+		else {
+			sprintf(components[component], "_%" PRIu64 ".%c", value.index, "xyzw"[component]);
+		}
+	}
+
+	bool minimum = func == add_name("wave_min");
+	if (minimum || func == add_name("wave_max")) {
+		for (uint32_t component = 0; component < size; ++component) {
+			char c = "xyzw"[component];
+
+			indent(code, offset, indentation);
+			*offset += sprintf(&code[*offset], "%s _%" PRIu64 "_%c = %s_get(%s, 0);\n", scalar, result.index, c, lanes, components[component]);
+
+			for (int index = 1; index < 4; ++index) {
+				indent(code, offset, indentation);
+				*offset += sprintf(&code[*offset], "_%" PRIu64 "_%c = %s_get(%s, %i) %s _%" PRIu64 "_%c ? %s_get(%s, %i) : _%" PRIu64 "_%c;\n", result.index, c,
+				                   lanes, components[component], index, minimum ? "<" : ">", result.index, c, lanes, components[component], index,
+				                   result.index, c);
+			}
+		}
+	}
+
+	indent(code, offset, indentation);
+	*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = %s", type_string(t, 4), result.index, size > 1 ? "{" : "");
+
+	for (uint32_t component = 0; component < size; ++component) {
+		const char *v = components[component];
+
+		*offset += sprintf(&code[*offset], "%s", component == 0 ? "" : ", ");
+
+		if (func == add_name("wave_sum")) {
+			*offset += sprintf(&code[*offset], "%s_load_all(%s_get(%s, 0) + %s_get(%s, 1) + %s_get(%s, 2) + %s_get(%s, 3))", lanes, lanes, v, lanes, v,
+			                   lanes, v, lanes, v);
+		}
+		else if (func == add_name("wave_prefix_sum")) {
+			*offset += sprintf(&code[*offset], "%s_load(0, %s_get(%s, 0), %s_get(%s, 0) + %s_get(%s, 1), %s_get(%s, 0) + %s_get(%s, 1) + %s_get(%s, 2))", lanes,
+			                   lanes, v, lanes, v, lanes, v, lanes, v, lanes, v, lanes, v);
+		}
+		else if (func == add_name("wave_read_first")) {
+			*offset += sprintf(&code[*offset], "%s_load_all(%s_get(%s, 0))", lanes, lanes, v);
+		}
+		else if (func == add_name("wave_read_lane")) {
+			const char *lane_lanes = simd4_scalar_type(lane.type.type);
+
+			*offset += sprintf(&code[*offset], "%s_load(", lanes);
+			for (int index = 0; index < 4; ++index) {
+				*offset += sprintf(&code[*offset], "%s%s_get(%s, %s_get(_%" PRIu64 ", %i) & 3)", index == 0 ? "" : ", ", lanes, v, lane_lanes, lane.index,
+				                   index);
+			}
+			*offset += sprintf(&code[*offset], ")");
+		}
+		else {
+			*offset += sprintf(&code[*offset], "%s_load_all(_%" PRIu64 "_%c)", lanes, result.index, "xyzw"[component]);
+		}
+	}
+
+	*offset += sprintf(&code[*offset], "%s;\n", size > 1 ? "}" : "");
+}
+
+// Workgroups and their threads run one after another so atomics are plain read-modify-writes
+static void write_atomic_update(char *code, size_t *offset, name_id func, const char *target, const char *old, const char *values[2]) {
+	if (func == add_name("atomic_add")) {
+		*offset += sprintf(&code[*offset], "%s = %s + %s;\n", target, old, values[0]);
+	}
+	else if (func == add_name("atomic_min")) {
+		*offset += sprintf(&code[*offset], "%s = %s < %s ? %s : %s;\n", target, old, values[0], old, values[0]);
+	}
+	else if (func == add_name("atomic_max")) {
+		*offset += sprintf(&code[*offset], "%s = %s > %s ? %s : %s;\n", target, old, values[0], old, values[0]);
+	}
+	else if (func == add_name("atomic_and")) {
+		*offset += sprintf(&code[*offset], "%s = %s & %s;\n", target, old, values[0]);
+	}
+	else if (func == add_name("atomic_or")) {
+		*offset += sprintf(&code[*offset], "%s = %s | %s;\n", target, old, values[0]);
+	}
+	else if (func == add_name("atomic_xor")) {
+		*offset += sprintf(&code[*offset], "%s = %s ^ %s;\n", target, old, values[0]);
+	}
+	else if (func == add_name("atomic_exchange")) {
+		*offset += sprintf(&code[*offset], "%s = %s;\n", target, values[0]);
+	}
+	else if (func == add_name("atomic_compare_exchange")) {
+		*offset += sprintf(&code[*offset], "if (%s == %s) %s = %s;\n", old, values[0], target, values[1]);
+	}
+}
+
+static void write_lane_loops(char *code, size_t *offset, int *indentation, uint8_t simd_width) {
+	if (simd_width == 4) {
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "for (uint32_t local_index_z = 0; local_index_z < local_size_z; ++local_index_z) {\n");
+		*indentation += 1;
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "for (uint32_t local_index_y = 0; local_index_y < local_size_y; ++local_index_y) {\n");
+		*indentation += 1;
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "for (uint32_t local_index_x = 0; local_index_x < local_size_x; local_index_x += 4) {\n");
+		*indentation += 1;
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "kore_uint3x4 group_id;\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "group_id.x = kore_uint32x4_load_all(workgroup_index_x);\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "group_id.y = kore_uint32x4_load_all(workgroup_index_y);\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "group_id.z = kore_uint32x4_load_all(workgroup_index_z);\n\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "kore_uint3x4 group_thread_id;\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset],
+		                   "group_thread_id.x = kore_uint32x4_load(local_index_x, local_index_x + 1, local_index_x + 2, local_index_x + 3);\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "group_thread_id.y = kore_uint32x4_load_all(local_index_y);\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "group_thread_id.z = kore_uint32x4_load_all(local_index_z);\n\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "kore_uint3x4 dispatch_thread_id;\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(
+		    &code[*offset],
+		    "dispatch_thread_id.x = kore_uint32x4_add(kore_uint32x4_mul(group_id.x, kore_uint32x4_load_all(local_size_x)), group_thread_id.x);\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(
+		    &code[*offset],
+		    "dispatch_thread_id.y = kore_uint32x4_add(kore_uint32x4_mul(group_id.y, kore_uint32x4_load_all(local_size_y)), group_thread_id.y);\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "dispatch_thread_id.z = kore_uint32x4_add(kore_uint32x4_mul(group_id.z, "
+		                                   "kore_uint32x4_load_all(local_size_z)), group_thread_id.z);\n\n");
+
+		indent(code, offset, *indentation);
+		*offset +=
+		    sprintf(&code[*offset],
+		            "kore_uint32x4 group_index = kore_uint32x4_add(kore_uint32x4_mul(group_thread_id.z, "
+		            "kore_uint32x4_mul(kore_uint32x4_load_all(local_size_x), kore_uint32x4_load_all(local_size_y))), "
+		            "kore_uint32x4_add(kore_uint32x4_mul(group_thread_id.y, kore_uint32x4_load_all(local_size_x)), group_thread_id.x));\n\n");
+	}
+	else if (simd_width == 1) {
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "for (uint32_t local_index_z = 0; local_index_z < local_size_z; ++local_index_z) {\n");
+		*indentation += 1;
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "for (uint32_t local_index_y = 0; local_index_y < local_size_y; ++local_index_y) {\n");
+		*indentation += 1;
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "for (uint32_t local_index_x = 0; local_index_x < local_size_x; ++local_index_x) {\n");
+		*indentation += 1;
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "kore_uint3 group_id;\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "group_id.x = workgroup_index_x;\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "group_id.y = workgroup_index_y;\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "group_id.z = workgroup_index_z;\n\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "kore_uint3 group_thread_id;\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "group_thread_id.x = local_index_x;\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "group_thread_id.y = local_index_y;\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "group_thread_id.z = local_index_z;\n\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "kore_uint3 dispatch_thread_id;\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "dispatch_thread_id.x = group_id.x * local_size_x + group_thread_id.x;\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "dispatch_thread_id.y = group_id.y * local_size_y + group_thread_id.y;\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "dispatch_thread_id.z = group_id.z * local_size_z + group_thread_id.z;\n\n");
+
+		indent(code, offset, *indentation);
+		*offset += sprintf(&code[*offset], "uint32_t group_index = group_thread_id.z * local_size_x * local_size_y + group_thread_id.y * "
+		                                   "local_size_x + group_thread_id.x;\n\n");
+	}
+}
+
+// A barrier ends the lane loops and starts them again, values computed before it are out of scope afterwards
+static uint32_t *value_phases = NULL;
+
+static void define_value(variable v, uint32_t phase) {
+	value_phases[v.index] = phase + 1;
+}
+
+static void use_value(variable v, uint32_t phase) {
+	debug_context context = KONG_INIT_ZERO;
+	check(value_phases[v.index] == 0 || value_phases[v.index] == phase + 1, context,
+	      "A value computed before a barrier is used after it, cpu kernels can only pass values across barriers in group shared variables");
+}
+
+static void use_access_list(kong_access *access_list, size_t access_list_size, uint32_t phase) {
+	for (size_t access_index = 0; access_index < access_list_size; ++access_index) {
+		if (access_list[access_index].kind == ACCESS_ELEMENT) {
+			use_value(access_list[access_index].access_element.index, phase);
+		}
+	}
+}
+
+static void track_value_phases(opcode *o, uint32_t phase) {
+	switch (o->type) {
+	case OPCODE_VAR:
+		define_value(o->op_var.var, phase);
+		break;
+	case OPCODE_NOT:
+		use_value(o->op_not.from, phase);
+		define_value(o->op_not.to, phase);
+		break;
+	case OPCODE_NEGATE:
+		use_value(o->op_negate.from, phase);
+		define_value(o->op_negate.to, phase);
+		break;
+	case OPCODE_STORE_VARIABLE:
+	case OPCODE_SUB_AND_STORE_VARIABLE:
+	case OPCODE_ADD_AND_STORE_VARIABLE:
+	case OPCODE_DIVIDE_AND_STORE_VARIABLE:
+	case OPCODE_MULTIPLY_AND_STORE_VARIABLE:
+		use_value(o->op_store_var.from, phase);
+		use_value(o->op_store_var.to, phase);
+		break;
+	case OPCODE_STORE_ACCESS_LIST:
+	case OPCODE_SUB_AND_STORE_ACCESS_LIST:
+	case OPCODE_ADD_AND_STORE_ACCESS_LIST:
+	case OPCODE_DIVIDE_AND_STORE_ACCESS_LIST:
+	case OPCODE_MULTIPLY_AND_STORE_ACCESS_LIST:
+		use_value(o->op_store_access_list.from, phase);
+		use_value(o->op_store_access_list.to, phase);
+		use_access_list(o->op_store_access_list.access_list, o->op_store_access_list.access_list_size, phase);
+		break;
+	case OPCODE_LOAD_FLOAT_CONSTANT:
+		define_value(o->op_load_float_constant.to, phase);
+		break;
+	case OPCODE_LOAD_INT_CONSTANT:
+		define_value(o->op_load_int_constant.to, phase);
+		break;
+	case OPCODE_LOAD_BOOL_CONSTANT:
+		define_value(o->op_load_bool_constant.to, phase);
+		break;
+	case OPCODE_LOAD_ACCESS_LIST:
+		use_value(o->op_load_access_list.from, phase);
+		use_access_list(o->op_load_access_list.access_list, o->op_load_access_list.access_list_size, phase);
+		define_value(o->op_load_access_list.to, phase);
+		break;
+	case OPCODE_RETURN:
+		if (o->size > offsetof(opcode, op_return)) {
+			use_value(o->op_return.var, phase);
+		}
+		break;
+	case OPCODE_CALL:
+		for (uint8_t parameter_index = 0; parameter_index < o->op_call.parameters_size; ++parameter_index) {
+			use_value(o->op_call.parameters[parameter_index], phase);
+		}
+		define_value(o->op_call.var, phase);
+		break;
+	case OPCODE_ATOMIC:
+		use_value(o->op_atomic.to, phase);
+		use_value(o->op_atomic.index, phase);
+		for (uint8_t value_index = 0; value_index < o->op_atomic.values_size; ++value_index) {
+			use_value(o->op_atomic.values[value_index], phase);
+		}
+		define_value(o->op_atomic.var, phase);
+		break;
+	case OPCODE_MULTIPLY:
+	case OPCODE_DIVIDE:
+	case OPCODE_MOD:
+	case OPCODE_ADD:
+	case OPCODE_SUB:
+	case OPCODE_EQUALS:
+	case OPCODE_NOT_EQUALS:
+	case OPCODE_GREATER:
+	case OPCODE_GREATER_EQUAL:
+	case OPCODE_LESS:
+	case OPCODE_LESS_EQUAL:
+	case OPCODE_AND:
+	case OPCODE_OR:
+	case OPCODE_BITWISE_XOR:
+	case OPCODE_BITWISE_AND:
+	case OPCODE_BITWISE_OR:
+	case OPCODE_LEFT_SHIFT:
+	case OPCODE_RIGHT_SHIFT:
+		use_value(o->op_binary.left, phase);
+		use_value(o->op_binary.right, phase);
+		define_value(o->op_binary.result, phase);
+		break;
+	case OPCODE_IF:
+		use_value(o->op_if.condition, phase);
+		break;
+	case OPCODE_WHILE_CONDITION:
+		use_value(o->op_while.condition, phase);
+		break;
+	default:
+		break;
+	}
+}
+
 static void write_functions(char *code, const char *name, size_t *offset, function *main, uint8_t simd_width) {
 	function *functions[256];
 	size_t    functions_size = 0;
@@ -347,121 +821,7 @@ static void write_functions(char *code, const char *name, size_t *offset, functi
 			*offset += sprintf(&code[*offset], "for (uint32_t workgroup_index_x = 0; workgroup_index_x < workgroup_count_x; ++workgroup_index_x) {\n");
 			++indentation;
 
-			if (simd_width == 4) {
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "for (uint32_t local_index_z = 0; local_index_z < local_size_z; ++local_index_z) {\n");
-				++indentation;
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "for (uint32_t local_index_y = 0; local_index_y < local_size_y; ++local_index_y) {\n");
-				++indentation;
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "for (uint32_t local_index_x = 0; local_index_x < local_size_x; local_index_x += 4) {\n");
-				++indentation;
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "kore_uint3x4 group_id;\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "group_id.x = kore_uint32x4_load_all(workgroup_index_x);\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "group_id.y = kore_uint32x4_load_all(workgroup_index_y);\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "group_id.z = kore_uint32x4_load_all(workgroup_index_z);\n\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "kore_uint3x4 group_thread_id;\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset],
-				                   "group_thread_id.x = kore_uint32x4_load(local_index_x, local_index_x + 1, local_index_x + 2, local_index_x + 3);\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "group_thread_id.y = kore_uint32x4_load_all(local_index_y);\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "group_thread_id.z = kore_uint32x4_load_all(local_index_z);\n\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "kore_uint3x4 dispatch_thread_id;\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(
-				    &code[*offset],
-				    "dispatch_thread_id.x = kore_uint32x4_add(kore_uint32x4_mul(group_id.x, kore_uint32x4_load_all(workgroup_count_x)), group_thread_id.x);\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(
-				    &code[*offset],
-				    "dispatch_thread_id.y = kore_uint32x4_add(kore_uint32x4_mul(group_id.y, kore_uint32x4_load_all(workgroup_count_y)), group_thread_id.y);\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "dispatch_thread_id.z = kore_uint32x4_add(kore_uint32x4_mul(group_id.z, "
-				                                   "kore_uint32x4_load_all(workgroup_count_z)), group_thread_id.z);\n\n");
-
-				indent(code, offset, indentation);
-				*offset +=
-				    sprintf(&code[*offset],
-				            "kore_uint32x4 group_index = kore_uint32x4_add(kore_uint32x4_mul(group_thread_id.z, "
-				            "kore_uint32x4_mul(kore_uint32x4_load_all(workgroup_count_x), kore_uint32x4_load_all(workgroup_count_y))), "
-				            "kore_uint32x4_add(kore_uint32x4_mul(group_thread_id.y, kore_uint32x4_load_all(workgroup_count_x)), group_thread_id.x));\n\n");
-			}
-			else if (simd_width == 1) {
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "for (uint32_t local_index_z = 0; local_index_z < local_size_z; ++local_index_z) {\n");
-				++indentation;
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "for (uint32_t local_index_y = 0; local_index_y < local_size_y; ++local_index_y) {\n");
-				++indentation;
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "for (uint32_t local_index_x = 0; local_index_x < local_size_x; ++local_index_x) {\n");
-				++indentation;
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "kore_uint3 group_id;\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "group_id.x = workgroup_index_x;\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "group_id.y = workgroup_index_y;\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "group_id.z = workgroup_index_z;\n\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "kore_uint3 group_thread_id;\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "group_thread_id.x = local_index_x;\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "group_thread_id.y = local_index_y;\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "group_thread_id.z = local_index_z;\n\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "kore_uint3 dispatch_thread_id;\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "dispatch_thread_id.x = group_id.x * workgroup_count_x + group_thread_id.x;\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "dispatch_thread_id.y = group_id.y * workgroup_count_y + group_thread_id.y;\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "dispatch_thread_id.z = group_id.z * workgroup_count_z + group_thread_id.z;\n\n");
-
-				indent(code, offset, indentation);
-				*offset += sprintf(&code[*offset], "uint32_t group_index = group_thread_id.z * workgroup_count_x * workgroup_count_y + group_thread_id.y * "
-				                                   "workgroup_count_x + group_thread_id.x;\n\n");
-			}
+			write_lane_loops(code, offset, &indentation, simd_width);
 		}
 		else {
 			*offset += sprintf(&code[*offset], "%s %s(", type_string(f->return_type.type, simd_width), get_name(f->name));
@@ -478,9 +838,24 @@ static void write_functions(char *code, const char *name, size_t *offset, functi
 			*offset += sprintf(&code[*offset], ") {\n");
 		}
 
+		uint32_t phase = 0;
+		int      depth = 0;
+
 		size_t index = 0;
 		while (index < size) {
 			opcode *o = (opcode *)&data[index];
+
+			if (f == main) {
+				track_value_phases(o, phase);
+			}
+
+			if (o->type == OPCODE_BLOCK_START || o->type == OPCODE_WHILE_START) {
+				depth += 1;
+			}
+			else if (o->type == OPCODE_BLOCK_END || o->type == OPCODE_WHILE_END) {
+				depth -= 1;
+			}
+
 			switch (o->type) {
 			case OPCODE_ADD: {
 				indent(code, offset, indentation);
@@ -536,9 +911,8 @@ static void write_functions(char *code, const char *name, size_t *offset, functi
 					cstyle_write_opcode(code, offset, o, type_string_simd1, &indentation);
 				}
 				else if (simd_width == 4) {
-					*offset +=
-					    sprintf(&code[*offset], "%s _%" PRIu64 " = kore_int32x4_load_all(%i);\n", type_string(o->op_load_int_constant.to.type.type, simd_width),
-					            o->op_load_int_constant.to.index, o->op_load_int_constant.number);
+					*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = %s_load_all(%i);\n", type_string(o->op_load_int_constant.to.type.type, simd_width),
+					                   o->op_load_int_constant.to.index, simd4_scalar_type(o->op_load_int_constant.to.type.type), o->op_load_int_constant.number);
 				}
 				break;
 			case OPCODE_CALL: {
@@ -566,6 +940,72 @@ static void write_functions(char *code, const char *name, size_t *offset, functi
 					*offset +=
 					    sprintf(&code[*offset], "%s _%" PRIu64 " = group_index;\n", type_string(o->op_call.var.type.type, simd_width), o->op_call.var.index);
 				}
+				else if (o->op_call.func == add_name("wave_lane_index")) {
+					// the lanes of one kore_*x4 value form a wave
+					check(o->op_call.parameters_size == 0, context, "wave_lane_index can not have a parameter");
+					indent(code, offset, indentation);
+					if (simd_width == 4) {
+						*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = kore_uint32x4_load(0, 1, 2, 3);\n",
+						                   type_string(o->op_call.var.type.type, simd_width), o->op_call.var.index);
+					}
+					else {
+						*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = 0;\n", type_string(o->op_call.var.type.type, simd_width), o->op_call.var.index);
+					}
+				}
+				else if (o->op_call.func == add_name("wave_lane_count")) {
+					check(o->op_call.parameters_size == 0, context, "wave_lane_count can not have a parameter");
+					indent(code, offset, indentation);
+					if (simd_width == 4) {
+						*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = kore_uint32x4_load_all(4);\n", type_string(o->op_call.var.type.type, simd_width),
+						                   o->op_call.var.index);
+					}
+					else {
+						*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = 1;\n", type_string(o->op_call.var.type.type, simd_width), o->op_call.var.index);
+					}
+				}
+				else if (o->op_call.func == add_name("group_barrier") || o->op_call.func == add_name("device_barrier")) {
+					check(f == main && depth == 0, context, "%s is only supported at the top level of cpu kernels", get_name(o->op_call.func));
+
+					for (int i = 0; i < 3; ++i) {
+						--indentation;
+						indent(code, offset, indentation);
+						*offset += sprintf(&code[*offset], "}\n");
+					}
+
+					*offset += sprintf(&code[*offset], "\n");
+
+					write_lane_loops(code, offset, &indentation, simd_width);
+
+					phase += 1;
+				}
+				else if (o->op_call.func == add_name("group_memory_barrier") || o->op_call.func == add_name("device_memory_barrier")) {
+					// the threads of a workgroup run one after another, their memory accesses are ordered already
+				}
+				else if (o->op_call.func == add_name("wave_sum") || o->op_call.func == add_name("wave_min") || o->op_call.func == add_name("wave_max") ||
+				         o->op_call.func == add_name("wave_prefix_sum") || o->op_call.func == add_name("wave_read_first") ||
+				         o->op_call.func == add_name("wave_read_lane")) {
+					variable value = o->op_call.parameters[0];
+					if (simd_width == 4) {
+						write_wave_operation(code, offset, indentation, o->op_call.func, o->op_call.var, value, o->op_call.parameters[1]);
+					}
+					else {
+						// a single lane is a wave of its own
+						indent(code, offset, indentation);
+						if (o->op_call.func == add_name("wave_prefix_sum")) {
+							*offset +=
+							    sprintf(&code[*offset], "%s _%" PRIu64 " = {0};\n", type_string(o->op_call.var.type.type, simd_width), o->op_call.var.index);
+						}
+						else {
+							*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = _%" PRIu64 ";\n", type_string(o->op_call.var.type.type, simd_width),
+							                   o->op_call.var.index, value.index);
+						}
+					}
+				}
+				else if (o->op_call.func == add_name("wave_is_first_lane") || o->op_call.func == add_name("wave_all_true") ||
+				         o->op_call.func == add_name("wave_any_true") || o->op_call.func == add_name("wave_ballot") ||
+				         o->op_call.func == add_name("wave_count_bits")) {
+					error(context, "%s is not supported in cpu kernels, they have no bool lanes", get_name(o->op_call.func));
+				}
 				else {
 					const char *function_name = get_name(o->op_call.func);
 					if (o->op_call.func == add_name("float")) {
@@ -604,178 +1044,144 @@ static void write_functions(char *code, const char *name, size_t *offset, functi
 				break;
 			}
 			case OPCODE_LOAD_ACCESS_LIST: {
-				uint64_t global_var_index = 0;
-				for (global_id j = 0; get_global(j) != NULL && get_global(j)->type != NO_TYPE; ++j) {
-					global *g = get_global(j);
-					if (o->op_load_access_list.from.index == g->var_index) {
-						global_var_index = g->var_index;
-						break;
+				variable from = o->op_load_access_list.from;
+				variable to   = o->op_load_access_list.to;
+
+				kong_access *access_list      = o->op_load_access_list.access_list;
+				size_t       access_list_size = o->op_load_access_list.access_list_size;
+
+				bool from_global = is_global_variable(from);
+
+				indent(code, offset, indentation);
+
+				if (simd_width == 4 && from_global && access_list[0].kind == ACCESS_ELEMENT) {
+					char lanes[4][512];
+					for (int lane = 0; lane < 4; ++lane) {
+						size_t length = sprintf(lanes[lane], "_%" PRIu64 "[%s_get(_%" PRIu64 ", %i)]", from.index,
+						                        simd4_scalar_type(access_list[0].access_element.index.type.type), access_list[0].access_element.index.index, lane);
+						write_access_list(lanes[lane], length, access_list, 1, access_list_size, false);
 					}
+
+					*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = ", type_string(to.type.type, simd_width), to.index);
+					write_gather(code, offset, to.type.type, lanes);
+					*offset += sprintf(&code[*offset], ";\n");
 				}
+				else if (simd_width == 4 && from_global) {
+					char expression[512];
+					write_access_list(expression, sprintf(expression, "_%" PRIu64, from.index), access_list, 0, access_list_size, is_uniform_struct(from));
 
-				indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = ", type_string(to.type.type, simd_width), to.index);
+					write_broadcast(code, offset, to.type.type, expression);
+					*offset += sprintf(&code[*offset], ";\n");
+				}
+				else {
+					char expression[512];
+					write_access_list(expression, sprintf(expression, "_%" PRIu64, from.index), access_list, 0, access_list_size,
+					                  from_global && is_uniform_struct(from));
 
-				type *s = get_type(o->op_load_access_list.from.type.type);
+					*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = %s;\n", type_string(to.type.type, simd_width), to.index, expression);
+				}
 
-				for (size_t i = 0; i < o->op_load_access_list.access_list_size; ++i) {
-					switch (o->op_load_access_list.access_list[i].kind) {
-					case ACCESS_ELEMENT:
-						*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = _%" PRIu64, type_string(o->op_load_access_list.to.type.type, simd_width),
-						                   o->op_load_access_list.to.index, o->op_load_access_list.from.index);
-						*offset += sprintf(&code[*offset], "[_%" PRIu64 "]", o->op_load_access_list.access_list[i].access_element.index.index);
-						break;
-					case ACCESS_MEMBER:
-						*offset += sprintf(&code[*offset], ".%s", get_name(o->op_load_access_list.access_list[i].access_member.name));
+				break;
+			}
+			case OPCODE_STORE_ACCESS_LIST:
+			case OPCODE_SUB_AND_STORE_ACCESS_LIST:
+			case OPCODE_ADD_AND_STORE_ACCESS_LIST:
+			case OPCODE_DIVIDE_AND_STORE_ACCESS_LIST:
+			case OPCODE_MULTIPLY_AND_STORE_ACCESS_LIST: {
+				variable from = o->op_store_access_list.from;
+				variable to   = o->op_store_access_list.to;
 
-						if (simd_width == 1) {
-							*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = _%" PRIu64, type_string(o->op_load_access_list.to.type.type, simd_width),
-							                   o->op_load_access_list.to.index, o->op_load_access_list.from.index);
+				kong_access *access_list      = o->op_store_access_list.access_list;
+				size_t       access_list_size = o->op_store_access_list.access_list_size;
 
-							if (global_var_index != 0) {
-								*offset += sprintf(&code[*offset], ".%s", get_name(o->op_load_access_list.access_list[i].access_member.name));
-							}
-							else {
-								*offset += sprintf(&code[*offset], ".%s", get_name(o->op_load_access_list.access_list[i].access_member.name));
-							}
-						}
-						else if (simd_width == 4) {
-							if (global_var_index != 0) {
-								*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = kore_float32x4_load_all(_%" PRIu64,
-								                   type_string(o->op_load_access_list.to.type.type, simd_width), o->op_load_access_list.to.index,
-								                   o->op_load_access_list.from.index);
-								*offset += sprintf(&code[*offset], "->%s", get_name(o->op_load_access_list.access_list[i].access_member.name));
-							}
-							else {
-								*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = _%" PRIu64, type_string(o->op_load_access_list.to.type.type, simd_width),
-								                   o->op_load_access_list.to.index, o->op_load_access_list.from.index);
-								*offset += sprintf(&code[*offset], ".%s", get_name(o->op_load_access_list.access_list[i].access_member.name));
-							}
-						}
+				const char *operation = store_operation(o->type);
 
-						break;
-					case ACCESS_SWIZZLE: {
-						swizzle *swizzle = &o->op_load_access_list.access_list[i].access_swizzle.swizzle;
+				if (simd_width == 4 && is_global_variable(to) && access_list[0].kind == ACCESS_ELEMENT) {
+					uint32_t    components = vector_size(from.type.type);
+					const char *from_type  = simd4_scalar_type(from.type.type);
 
-						if (o->op_load_access_list.from.type.type == uint2_id) {
-							assert(swizzle->size == 1); // TODO
+					for (int lane = 0; lane < 4; ++lane) {
+						char   target[512];
+						size_t length = sprintf(target, "_%" PRIu64 "[%s_get(_%" PRIu64 ", %i)]", to.index,
+						                        simd4_scalar_type(access_list[0].access_element.index.type.type), access_list[0].access_element.index.index, lane);
+						write_access_list(target, length, access_list, 1, access_list_size, false);
 
-							if (swizzle->size == 1 && swizzle->indices[0] == 0) {
-								*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = kore_cpu_compute_swizzle_x_u2_x%i(_%" PRIu64 ");\n",
-								                   type_string(o->op_load_access_list.to.type.type, simd_width), o->op_load_access_list.to.index, simd_width,
-								                   o->op_load_access_list.from.index);
-							}
-							else if (swizzle->size == 1 && swizzle->indices[0] == 1) {
-								*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = kore_cpu_compute_swizzle_y_u2_x%i(_%" PRIu64 ");\n",
-								                   type_string(o->op_load_access_list.to.type.type, simd_width), o->op_load_access_list.to.index, simd_width,
-								                   o->op_load_access_list.from.index);
-							}
-							else {
-								assert(false); // TODO
-							}
+						if (components == 1) {
+							indent(code, offset, indentation);
+							*offset += sprintf(&code[*offset], "%s %s %s_get(_%" PRIu64 ", %i);\n", target, operation, from_type, from.index, lane);
 						}
-						else if (o->op_load_access_list.from.type.type == uint3_id) {
-							assert(swizzle->size == 1); // TODO
-
-							if (swizzle->size == 2 && swizzle->indices[0] == 0 && swizzle->indices[1] == 1) {
-								*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = kore_cpu_compute_swizzle_xy_u3_x%i(_%" PRIu64 ");\n",
-								                   type_string(o->op_load_access_list.to.type.type, simd_width), o->op_load_access_list.to.index, simd_width,
-								                   o->op_load_access_list.from.index);
-							}
-							else if (swizzle->size == 1 && swizzle->indices[0] == 0) {
-								*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = kore_cpu_compute_swizzle_x_u3_x%i(_%" PRIu64 ");\n",
-								                   type_string(o->op_load_access_list.to.type.type, simd_width), o->op_load_access_list.to.index, simd_width,
-								                   o->op_load_access_list.from.index);
-							}
-							else if (swizzle->size == 1 && swizzle->indices[0] == 1) {
-								*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = kore_cpu_compute_swizzle_y_u3_x%i(_%" PRIu64 ");\n",
-								                   type_string(o->op_load_access_list.to.type.type, simd_width), o->op_load_access_list.to.index, simd_width,
-								                   o->op_load_access_list.from.index);
-							}
-							else {
-								assert(false); // TODO
+						else {
+							for (uint32_t component = 0; component < components; ++component) {
+								indent(code, offset, indentation);
+								*offset += sprintf(&code[*offset], "%s.%c %s %s_get(_%" PRIu64 ".%c, %i);\n", target, "xyzw"[component], operation, from_type,
+								                   from.index, "xyzw"[component], lane);
 							}
 						}
-
-						break;
-					}
 					}
-
-					s = get_type(o->op_load_access_list.access_list[i].type);
 				}
+				else {
+					char expression[512];
+					write_access_list(expression, sprintf(expression, "_%" PRIu64, to.index), access_list, 0, access_list_size,
+					                  is_global_variable(to) && is_uniform_struct(to));
 
-				*offset += sprintf(&code[*offset], ";\n");
-
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "%s %s _%" PRIu64 ";\n", expression, operation, from.index);
+				}
 				break;
 			}
-			case OPCODE_STORE_ACCESS_LIST:
-			case OPCODE_SUB_AND_STORE_ACCESS_LIST:
-			case OPCODE_ADD_AND_STORE_ACCESS_LIST:
-			case OPCODE_DIVIDE_AND_STORE_ACCESS_LIST:
-			case OPCODE_MULTIPLY_AND_STORE_ACCESS_LIST: {
-				if (simd_width == 1) {
-					cstyle_write_opcode(code, offset, o, type_string_simd1, &indentation);
-				}
-				else if (simd_width == 4) {
-					for (int simd_index = 0; simd_index < 4; ++simd_index) {
+			case OPCODE_ATOMIC: {
+				check(!is_texture(o->op_atomic.to.type.type), context, "Texture atomics are not supported in cpu kernels");
+
+				type_id     element_type = o->op_atomic.var.type.type;
+				const char *c_type       = element_type == uint_id ? "uint32_t" : "int32_t";
+
+				if (simd_width == 4) {
+					for (int lane = 0; lane < 4; ++lane) {
+						char target[512];
+						sprintf(target, "_%" PRIu64 "[%s_get(_%" PRIu64 ", %i)]", o->op_atomic.to.index, simd4_scalar_type(o->op_atomic.index.type.type),
+						        o->op_atomic.index.index, lane);
+
+						char old[64];
+						sprintf(old, "_%" PRIu64 "_%i", o->op_atomic.var.index, lane);
+
+						char        lane_values[2][256];
+						const char *values[2];
+						for (uint8_t value_index = 0; value_index < o->op_atomic.values_size; ++value_index) {
+							variable value = o->op_atomic.values[value_index];
+							sprintf(lane_values[value_index], "(%s)%s_get(_%" PRIu64 ", %i)", c_type, simd4_scalar_type(value.type.type), value.index, lane);
+							values[value_index] = lane_values[value_index];
+						}
+
 						indent(code, offset, indentation);
-						*offset += sprintf(&code[*offset], "_%" PRIu64, o->op_store_access_list.to.index);
-
-						type *s = get_type(o->op_store_access_list.to.type.type);
-
-						for (size_t i = 0; i < o->op_store_access_list.access_list_size; ++i) {
-							switch (o->op_store_access_list.access_list[i].kind) {
-							case ACCESS_ELEMENT:
-								*offset += sprintf(&code[*offset], "[kore_int32x4_get(_%" PRIu64 ", %i)]",
-								                   o->op_store_access_list.access_list[i].access_element.index.index, simd_index);
-								break;
-							case ACCESS_MEMBER:
-								*offset += sprintf(&code[*offset], ".%s", get_name(o->op_store_access_list.access_list[i].access_member.name));
-								break;
-							case ACCESS_SWIZZLE: {
-								char swizzle[4];
-
-								for (uint32_t swizzle_index = 0; swizzle_index < o->op_store_access_list.access_list[i].access_swizzle.swizzle.size;
-								     ++swizzle_index) {
-									swizzle[swizzle_index] = "xyzw"[o->op_store_access_list.access_list[i].access_swizzle.swizzle.indices[swizzle_index]];
-								}
-								swizzle[o->op_store_access_list.access_list[i].access_swizzle.swizzle.size] = 0;
-
-								*offset += sprintf(&code[*offset], ".%s", swizzle);
-
-								break;
-							}
-							}
+						*offset += sprintf(&code[*offset], "%s %s = %s;\n", c_type, old, target);
+						indent(code, offset, indentation);
+						write_atomic_update(code, offset, o->op_atomic.func, target, old, values);
+					}
 
-							s = get_type(o->op_store_access_list.access_list[i].type);
-						}
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = %s_load(_%" PRIu64 "_0, _%" PRIu64 "_1, _%" PRIu64 "_2, _%" PRIu64 "_3);\n",
+					                   type_string(element_type, simd_width), o->op_atomic.var.index, simd4_scalar_type(element_type), o->op_atomic.var.index,
+					                   o->op_atomic.var.index, o->op_atomic.var.index, o->op_atomic.var.index);
+				}
+				else {
+					char target[512];
+					sprintf(target, "_%" PRIu64 "[_%" PRIu64 "]", o->op_atomic.to.index, o->op_atomic.index.index);
 
-						switch (o->type) {
-						case OPCODE_STORE_ACCESS_LIST:
-							*offset += sprintf(&code[*offset], " = _%" PRIu64 ";\n", o->op_store_access_list.from.index);
-
-							*offset += sprintf(&code[*offset],
-							                   " = kore_cpu_compute_create_float4(kore_float32x4_get(_%" PRIu64 ".x, %i), kore_float32x4_get(_%" PRIu64
-							                   ".y, %i), kore_float32x4_get(_%" PRIu64 ".z, %i), kore_float32x4_get(_%" PRIu64 ".w, %i));\n",
-							                   o->op_store_access_list.from.index, simd_index, o->op_store_access_list.from.index, simd_index,
-							                   o->op_store_access_list.from.index, simd_index, o->op_store_access_list.from.index, simd_index);
-							break;
-						case OPCODE_SUB_AND_STORE_ACCESS_LIST:
-							*offset += sprintf(&code[*offset], " -= _%" PRIu64 ";\n", o->op_store_access_list.from.index);
-							break;
-						case OPCODE_ADD_AND_STORE_ACCESS_LIST:
-							*offset += sprintf(&code[*offset], " += _%" PRIu64 ";\n", o->op_store_access_list.from.index);
-							break;
-						case OPCODE_DIVIDE_AND_STORE_ACCESS_LIST:
-							*offset += sprintf(&code[*offset], " /= _%" PRIu64 ";\n", o->op_store_access_list.from.index);
-							break;
-						case OPCODE_MULTIPLY_AND_STORE_ACCESS_LIST:
-							*offset += sprintf(&code[*offset], " *= _%" PRIu64 ";\n", o->op_store_access_list.from.index);
-							break;
-						default:
-							assert(false);
-							break;
-						}
+					char old[64];
+					sprintf(old, "_%" PRIu64, o->op_atomic.var.index);
+
+					char        scalar_values[2][256];
+					const char *values[2];
+					for (uint8_t value_index = 0; value_index < o->op_atomic.values_size; ++value_index) {
+						sprintf(scalar_values[value_index], "(%s)_%" PRIu64, c_type, o->op_atomic.values[value_index].index);
+						values[value_index] = scalar_values[value_index];
 					}
+
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "%s %s = %s;\n", c_type, old, target);
+					indent(code, offset, indentation);
+					write_atomic_update(code, offset, o->op_atomic.func, target, old, values);
 				}
 				break;
 			}
@@ -844,8 +1250,14 @@ static void cpu_export_compute(char *directory, function *main) {
 	char func_name[256];
 	sprintf(func_name, "%s_on_cpu", name);
 
+	value_phases = (uint32_t *)calloc(allocated_variables_count() + 1, sizeof(uint32_t));
+	check(value_phases != NULL, context, "Could not allocate value phases");
+
 	write_functions(code, func_name, &offset, main, simd_width);
 
+	free(value_phases);
+	value_phases = NULL;
+
 	char filename[512];
 	sprintf(filename, "kong_cpu_%s", name);
 
@@ -865,6 +1277,8 @@ void cpu_export(char *directory) {
 	}
 
 	for (size_t i = 0; i < compute_shaders_size; ++i) {
+		stats_begin("cpu_export_compute %s", get_name(compute_shaders[i]->name));
 		cpu_export_compute(directory, compute_shaders[i]);
+		stats_end();
 	}
 }
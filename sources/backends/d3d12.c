@@ -13,20 +13,20 @@
 #endif
 
 #ifdef _WIN32
-static const wchar_t *shader_string(shader_stage stage) {
+static const wchar_t *shader_string(shader_stage stage, bool resource_heap) {
 	switch (stage) {
 	case SHADER_STAGE_VERTEX:
-		return L"vs_6_0";
+		return resource_heap ? L"vs_6_6" : L"vs_6_0";
 	case SHADER_STAGE_FRAGMENT:
-		return L"ps_6_0";
+		return resource_heap ? L"ps_6_6" : L"ps_6_0";
 	case SHADER_STAGE_COMPUTE:
-		return L"cs_6_0";
+		return resource_heap ? L"cs_6_6" : L"cs_6_0";
 	case SHADER_STAGE_RAY_GENERATION:
-		return L"lib_6_3";
+		return resource_heap ? L"lib_6_6" : L"lib_6_3";
 	case SHADER_STAGE_AMPLIFICATION:
-		return L"as_6_5";
+		return resource_heap ? L"as_6_6" : L"as_6_5";
 	case SHADER_STAGE_MESH:
-		return L"ms_6_5";
+		return resource_heap ? L"ms_6_6" : L"ms_6_5";
 	default: {
 		debug_context context = KONG_INIT_ZERO;
 		error(context, "Unsupported shader stage/version combination");
@@ -36,19 +36,19 @@ static const wchar_t *shader_string(shader_stage stage) {
 }
 #endif
 
-int compile_hlsl_to_d3d12(const char *source, uint8_t **output, size_t *outputlength, shader_stage stage, bool debug) {
+int compile_hlsl_to_d3d12(const char *source, uint8_t **output, size_t *outputlength, shader_stage stage, bool resource_heap, bool debug) {
 #ifdef _WIN32
 	IDxcCompiler3 *compiler;
 	HRESULT        result = DxcCreateInstance(&CLSID_DxcCompiler, &IID_IDxcCompiler3, &compiler);
 	assert(result == S_OK);
 
 	const wchar_t *compiler_args[] = {
-	    L"-E", L"main", L"-T", shader_string(stage),
+	    L"-E", L"main", L"-T", shader_string(stage, resource_heap),
 	    // L"-Qstrip_reflect", // strip reflection into a seperate blob
 	};
 
 	const wchar_t *debug_compiler_args[] = {
-	    L"-E",  L"main", L"-T", shader_string(stage),
+	    L"-E",  L"main", L"-T", shader_string(stage, resource_heap),
 	    L"-Zi", // enable debug info
 	    // L"-Fd", L"myshader.pdb", // the file name of the pdb.  This must either be supplied or the auto generated file name must be used
 	    // L"myshader.hlsl", // optional shader source file name for error reporting and for PIX shader source view
@@ -11,7 +11,8 @@
 extern "C" {
 #endif
 
-int compile_hlsl_to_d3d12(const char *source, uint8_t **output, size_t *outputlength, shader_stage stage, bool debug);
+// resource_heap selects shader model 6.6 for ResourceDescriptorHeap
+int compile_hlsl_to_d3d12(const char *source, uint8_t **output, size_t *outputlength, shader_stage stage, bool resource_heap, bool debug);
 
 #ifdef __cplusplus
 }
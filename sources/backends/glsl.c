@@ -6,8 +6,11 @@
 #include "../functions.h"
 #include "../global.h"
 #include "../parser.h"
+#include "../permutations.h"
 #include "../shader_stage.h"
+#include "../stats.h"
 #include "../types.h"
+#include "blobs.h"
 #include "cstyle.h"
 #include "util.h"
 
@@ -18,6 +21,59 @@
 #include <stdlib.h>
 #include <string.h>
 
+// 16 bit types become mediump 32 bit types, the constructors drop the qualifier
+static const char *mediump_type_string(type_id type) {
+	if (!is_16bit_type(type)) {
+		return NULL;
+	}
+	if (type == half_id) {
+		return "mediump float";
+	}
+	if (type == half2_id) {
+		return "mediump vec2";
+	}
+	if (type == half3_id) {
+		return "mediump vec3";
+	}
+	if (type == half4_id) {
+		return "mediump vec4";
+	}
+	if (type == half2x2_id) {
+		return "mediump mat2";
+	}
+	if (type == half3x3_id) {
+		return "mediump mat3";
+	}
+	if (type == half4x4_id) {
+		return "mediump mat4";
+	}
+	if (type == short_id) {
+		return "mediump int";
+	}
+	if (type == short2_id) {
+		return "mediump ivec2";
+	}
+	if (type == short3_id) {
+		return "mediump ivec3";
+	}
+	if (type == short4_id) {
+		return "mediump ivec4";
+	}
+	if (type == ushort_id) {
+		return "mediump uint";
+	}
+	if (type == ushort2_id) {
+		return "mediump uvec2";
+	}
+	if (type == ushort3_id) {
+		return "mediump uvec3";
+	}
+	if (type == ushort4_id) {
+		return "mediump uvec4";
+	}
+	return NULL;
+}
+
 static const char *type_string(type_id type) {
 	if (type == float_id) {
 		return "float";
@@ -37,9 +93,102 @@ static const char *type_string(type_id type) {
 	if (type == float4x4_id) {
 		return "mat4";
 	}
+	const char *mediump = mediump_type_string(type);
+	if (mediump != NULL) {
+		return mediump;
+	}
 	return get_name(get_type(type)->name);
 }
 
+static const char *wave_function_string(name_id func) {
+	static const char *wave_functions[][2] = {
+	    {"wave_is_first_lane", "subgroupElect"}, {"wave_all_true", "subgroupAll"},            {"wave_any_true", "subgroupAny"},
+	    {"wave_ballot", "subgroupBallot"},       {"wave_sum", "subgroupAdd"},                 {"wave_min", "subgroupMin"},
+	    {"wave_max", "subgroupMax"},             {"wave_prefix_sum", "subgroupExclusiveAdd"}, {"wave_read_first", "subgroupBroadcastFirst"},
+	    {"wave_read_lane", "subgroupShuffle"},
+	};
+	for (size_t wave_function_index = 0; wave_function_index < sizeof(wave_functions) / sizeof(wave_functions[0]); ++wave_function_index) {
+		if (func == add_name(wave_functions[wave_function_index][0])) {
+			return wave_functions[wave_function_index][1];
+		}
+	}
+	return get_name(func);
+}
+
+static const char *atomic_function_suffix(name_id func) {
+	static const char *atomic_functions[][2] = {
+	    {"atomic_add", "Add"}, {"atomic_min", "Min"}, {"atomic_max", "Max"}, {"atomic_and", "And"}, {"atomic_or", "Or"}, {"atomic_xor", "Xor"},
+	    {"atomic_exchange", "Exchange"}, {"atomic_compare_exchange", "CompSwap"},
+	};
+	for (size_t atomic_function_index = 0; atomic_function_index < sizeof(atomic_functions) / sizeof(atomic_functions[0]); ++atomic_function_index) {
+		if (func == add_name(atomic_functions[atomic_function_index][0])) {
+			return atomic_functions[atomic_function_index][1];
+		}
+	}
+	assert(false);
+	return NULL;
+}
+
+// Integer textures which are written to become images, everything else stays a sampler
+static bool is_integer_image(global *g) {
+	type *t = get_type(g->type);
+	return t->tex_kind == TEXTURE_KIND_2D && (t->tex_format == TEXTURE_FORMAT_R32_UINT || t->tex_format == TEXTURE_FORMAT_R32_SINT) &&
+	       (g->usage & (GLOBAL_USAGE_TEXTURE_WRITE | GLOBAL_USAGE_ATOMIC)) != 0;
+}
+
+static global *find_global_by_var_index(uint64_t var_index) {
+	for (global_id i = 0; get_global(i) != NULL && get_global(i)->type != NO_TYPE; ++i) {
+		if (get_global(i)->var_index == var_index) {
+			return get_global(i);
+		}
+	}
+	return NULL;
+}
+
+static void write_extensions(char *glsl, size_t *offset, function *main) {
+	find_used_capabilities(main);
+
+	if (main->used_capabilities.wave_basic) {
+		*offset += sprintf(&glsl[*offset], "#extension GL_KHR_shader_subgroup_basic : require\n");
+	}
+	if (main->used_capabilities.wave_vote) {
+		*offset += sprintf(&glsl[*offset], "#extension GL_KHR_shader_subgroup_vote : require\n");
+	}
+	if (main->used_capabilities.wave_ballot) {
+		*offset += sprintf(&glsl[*offset], "#extension GL_KHR_shader_subgroup_ballot : require\n");
+	}
+	if (main->used_capabilities.wave_arithmetic) {
+		*offset += sprintf(&glsl[*offset], "#extension GL_KHR_shader_subgroup_arithmetic : require\n");
+	}
+	if (main->used_capabilities.wave_shuffle) {
+		*offset += sprintf(&glsl[*offset], "#extension GL_KHR_shader_subgroup_shuffle : require\n");
+	}
+	if (main->used_capabilities.texture_gather) {
+		*offset += sprintf(&glsl[*offset], "#extension GL_ARB_texture_gather : require\n");
+	}
+	if (main->used_capabilities.texture_gather_component) {
+		*offset += sprintf(&glsl[*offset], "#extension GL_ARB_gpu_shader5 : require\n");
+	}
+
+	global_array globals = KONG_INIT_ZERO;
+	find_referenced_globals(main, &globals);
+
+	bool buffers = false;
+	bool images  = false;
+	for (size_t i = 0; i < globals.size; ++i) {
+		global *g = get_global(globals.globals[i]);
+		buffers |= global_is_buffer(g);
+		images |= is_integer_image(g);
+	}
+
+	if (buffers) {
+		*offset += sprintf(&glsl[*offset], "#extension GL_ARB_shader_storage_buffer_object : require\n");
+	}
+	if (images) {
+		*offset += sprintf(&glsl[*offset], "#extension GL_ARB_shader_image_load_store : require\n");
+	}
+}
+
 static void write_code(char *glsl, char *directory, const char *filename, const char *name) {
 	char full_filename[512];
 
@@ -58,10 +207,19 @@ static void write_code(char *glsl, char *directory, const char *filename, const
 		FILE *file = fopen(full_filename, "wb");
 		fprintf(file, "#include \"%s.h\"\n\n", filename);
 
-		fprintf(file, "const char *%s = \"", name);
-
 		size_t length = strlen(glsl);
 
+		if (get_blob_mode() != BLOB_MODE_STRINGS) {
+			write_blob_definition(file, "const char *", name, (const uint8_t *)glsl, length, true);
+
+			fprintf(file, "/*\n%s*/\n", glsl);
+
+			fclose(file);
+			return;
+		}
+
+		fprintf(file, "const char *%s = \"", name);
+
 		for (size_t i = 0; i < length; ++i) {
 			if (glsl[i] == '\n') {
 				fprintf(file, "\\n");
@@ -150,6 +308,22 @@ static void write_types(char *glsl, size_t *offset, shader_stage stage, type_id
 			*offset += sprintf(&glsl[*offset], "};\n\n");
 		}
 	}
+
+	type_id indirect_args[8];
+	size_t  indirect_args_size = 0;
+	find_referenced_indirect_args(main, indirect_args, &indirect_args_size);
+
+	for (size_t i = 0; i < indirect_args_size; ++i) {
+		type *t = get_type(indirect_args[i]);
+
+		*offset += sprintf(&glsl[*offset], "struct %s {\n", get_name(t->name));
+
+		for (size_t j = 0; j < t->members.size; ++j) {
+			*offset += sprintf(&glsl[*offset], "\t%s %s;\n", type_string(t->members.m[j].type.type), get_name(t->members.m[j].name));
+		}
+
+		*offset += sprintf(&glsl[*offset], "};\n\n");
+	}
 }
 
 static void write_globals(char *glsl, size_t *offset, function *main) {
@@ -160,24 +334,44 @@ static void write_globals(char *glsl, size_t *offset, function *main) {
 	for (size_t i = 0; i < globals.size; ++i) {
 		global *g = get_global(globals.globals[i]);
 
-		if (g->type == sampler_type_id) {
+		if (g->group_shared) {
+			type *t = get_type(g->type);
+			*offset += sprintf(&glsl[*offset], "shared %s _%" PRIu64 "[%u];\n\n", type_string(t->base), g->var_index, t->array_size);
+		}
+		else if (g->type == sampler_type_id) {
+		}
+		else if (global_is_buffer(g)) {
+			*offset += sprintf(&glsl[*offset], "layout(std430) buffer _%" PRIu64 "_block {\n\t%s _%" PRIu64 "[];\n};\n\n", g->var_index,
+			                   type_string(get_type(g->type)->base), g->var_index);
+		}
+		else if (is_integer_image(g)) {
+			if (get_type(g->type)->tex_format == TEXTURE_FORMAT_R32_UINT) {
+				*offset += sprintf(&glsl[*offset], "layout(r32ui) uniform uimage2D _%" PRIu64 ";\n\n", g->var_index);
+			}
+			else {
+				*offset += sprintf(&glsl[*offset], "layout(r32i) uniform iimage2D _%" PRIu64 ";\n\n", g->var_index);
+			}
 		}
 		else if (get_type(g->type)->tex_kind != TEXTURE_KIND_NONE) {
+			const char *shadow = (g->usage & GLOBAL_USAGE_SAMPLE_COMPARE) != 0 ? "Shadow" : "";
 			if (get_type(g->type)->tex_kind == TEXTURE_KIND_2D) {
-				*offset += sprintf(&glsl[*offset], "uniform sampler2D _%" PRIu64 ";\n\n", g->var_index);
+				*offset += sprintf(&glsl[*offset], "uniform sampler2D%s _%" PRIu64 ";\n\n", shadow, g->var_index);
 			}
 			else if (get_type(g->type)->tex_kind == TEXTURE_KIND_2D_ARRAY) {
-				*offset += sprintf(&glsl[*offset], "uniform sampler2DArray _%" PRIu64 ";\n\n", g->var_index);
+				*offset += sprintf(&glsl[*offset], "uniform sampler2DArray%s _%" PRIu64 ";\n\n", shadow, g->var_index);
 			}
 			else if (get_type(g->type)->tex_kind == TEXTURE_KIND_CUBE) {
-				*offset += sprintf(&glsl[*offset], "uniform samplerCube _%" PRIu64 ";\n\n", g->var_index);
+				*offset += sprintf(&glsl[*offset], "uniform samplerCube%s _%" PRIu64 ";\n\n", shadow, g->var_index);
 			}
 			else {
 				// TODO
 				assert(false);
 			}
 		}
-		else if (g->type == float_id) {
+		else if (global_is_scalar_constant(g)) {
+			*offset += sprintf(&glsl[*offset], "const %s _%" PRIu64 " = ", type_string(g->type), g->var_index);
+			write_global_value(glsl, offset, g);
+			*offset += sprintf(&glsl[*offset], ";\n\n");
 		}
 		else {
 			*offset += sprintf(&glsl[*offset], "layout(std140) uniform _%" PRIu64 " {\n", g->var_index);
@@ -274,6 +468,16 @@ static void write_functions(char *code, size_t *offset, shader_stage stage, type
 			opcode *o = (opcode *)&data[index];
 			switch (o->type) {
 			case OPCODE_CALL: {
+				if (is_texture_function(o->op_call.func) && o->op_call.func != add_name("sample_compare")) {
+					// shadow samplers can only be used for comparisons
+					global       *texture = find_global_by_var_index(o->op_call.parameters[0].index);
+					debug_context context = KONG_INIT_ZERO;
+					if (texture != NULL) {
+						check((texture->usage & GLOBAL_USAGE_SAMPLE_COMPARE) == 0, context, "Texture %s is used by sample_compare and by %s",
+						      get_name(texture->name), get_name(o->op_call.func));
+					}
+				}
+
 				if (o->op_call.func == add_name("sample")) {
 					debug_context context = KONG_INIT_ZERO;
 					check(o->op_call.parameters_size == 3, context, "sample requires three parameters");
@@ -299,6 +503,59 @@ static void write_functions(char *code, size_t *offset, shader_stage stage, type
 					                   type_string(o->op_call.var.type.type), o->op_call.var.index, o->op_call.parameters[0].index,
 					                   o->op_call.parameters[2].index, o->op_call.parameters[3].index);
 				}
+				else if (o->op_call.func == add_name("load")) {
+					debug_context context = KONG_INIT_ZERO;
+					check(o->op_call.parameters_size == 3, context, "load requires three parameters");
+					texture_kind kind = get_type(o->op_call.parameters[0].type.type)->tex_kind;
+					check(kind != TEXTURE_KIND_CUBE, context, "load does not support cube textures");
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = texelFetch(_%" PRIu64 ", ivec%i(_%" PRIu64 "), int(_%" PRIu64 "))%s;\n",
+					                   type_string(o->op_call.var.type.type), o->op_call.var.index, o->op_call.parameters[0].index,
+					                   kind == TEXTURE_KIND_2D_ARRAY ? 3 : 2, o->op_call.parameters[1].index, o->op_call.parameters[2].index,
+					                   o->op_call.var.type.type == float_id ? ".r" : "");
+				}
+				else if (is_gather_function(o->op_call.func)) {
+					debug_context context = KONG_INIT_ZERO;
+					check(o->op_call.parameters_size == 3, context, "%s requires three parameters", get_name(o->op_call.func));
+					indent(code, offset, indentation);
+					if (gather_component(o->op_call.func) == 0) {
+						*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = textureGather(_%" PRIu64 ", _%" PRIu64 ");\n",
+						                   type_string(o->op_call.var.type.type), o->op_call.var.index, o->op_call.parameters[0].index,
+						                   o->op_call.parameters[2].index);
+					}
+					else {
+						*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = textureGather(_%" PRIu64 ", _%" PRIu64 ", %i);\n",
+						                   type_string(o->op_call.var.type.type), o->op_call.var.index, o->op_call.parameters[0].index,
+						                   o->op_call.parameters[2].index, gather_component(o->op_call.func));
+					}
+				}
+				else if (o->op_call.func == add_name("sample_grad")) {
+					debug_context context = KONG_INIT_ZERO;
+					check(o->op_call.parameters_size == 5, context, "sample_grad requires five parameters");
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = textureGrad(_%" PRIu64 ", _%" PRIu64 ", _%" PRIu64 ", _%" PRIu64 ")%s;\n",
+					                   type_string(o->op_call.var.type.type), o->op_call.var.index, o->op_call.parameters[0].index,
+					                   o->op_call.parameters[2].index, o->op_call.parameters[3].index, o->op_call.parameters[4].index,
+					                   o->op_call.var.type.type == float_id ? ".r" : "");
+				}
+				else if (o->op_call.func == add_name("sample_bias")) {
+					debug_context context = KONG_INIT_ZERO;
+					check(o->op_call.parameters_size == 4, context, "sample_bias requires four parameters");
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = texture(_%" PRIu64 ", _%" PRIu64 ", _%" PRIu64 ")%s;\n",
+					                   type_string(o->op_call.var.type.type), o->op_call.var.index, o->op_call.parameters[0].index,
+					                   o->op_call.parameters[2].index, o->op_call.parameters[3].index, o->op_call.var.type.type == float_id ? ".r" : "");
+				}
+				else if (o->op_call.func == add_name("sample_compare")) {
+					debug_context context = KONG_INIT_ZERO;
+					check(o->op_call.parameters_size == 4, context, "sample_compare requires four parameters");
+					indent(code, offset, indentation);
+					// the reference goes into the last component of the coordinate, shaders other than fragment shaders sample the base level
+					*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = texture(_%" PRIu64 ", vec%i(_%" PRIu64 ", _%" PRIu64 "));\n",
+					                   type_string(o->op_call.var.type.type), o->op_call.var.index, o->op_call.parameters[0].index,
+					                   get_type(o->op_call.parameters[0].type.type)->tex_kind == TEXTURE_KIND_2D ? 3 : 4, o->op_call.parameters[2].index,
+					                   o->op_call.parameters[3].index);
+				}
 				else if (o->op_call.func == add_name("group_id")) {
 					check(o->op_call.parameters_size == 0, context, "group_id can not have a parameter");
 					*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = gl_WorkGroupID;\n", type_string(o->op_call.var.type.type), o->op_call.var.index);
@@ -318,8 +575,49 @@ static void write_functions(char *code, size_t *offset, shader_stage stage, type
 					*offset +=
 					    sprintf(&code[*offset], "%s _%" PRIu64 " = gl_LocalInvocationIndex;\n", type_string(o->op_call.var.type.type), o->op_call.var.index);
 				}
+				else if (o->op_call.func == add_name("wave_lane_index")) {
+					check(o->op_call.parameters_size == 0, context, "wave_lane_index can not have a parameter");
+					indent(code, offset, indentation);
+					*offset +=
+					    sprintf(&code[*offset], "%s _%" PRIu64 " = gl_SubgroupInvocationID;\n", type_string(o->op_call.var.type.type), o->op_call.var.index);
+				}
+				else if (o->op_call.func == add_name("wave_lane_count")) {
+					check(o->op_call.parameters_size == 0, context, "wave_lane_count can not have a parameter");
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = gl_SubgroupSize;\n", type_string(o->op_call.var.type.type), o->op_call.var.index);
+				}
+				else if (o->op_call.func == add_name("wave_count_bits")) {
+					check(o->op_call.parameters_size == 1, context, "wave_count_bits requires one parameter");
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = subgroupBallotBitCount(subgroupBallot(_%" PRIu64 "));\n",
+					                   type_string(o->op_call.var.type.type), o->op_call.var.index, o->op_call.parameters[0].index);
+				}
+				else if (o->op_call.func == add_name("group_barrier")) {
+					check(o->op_call.parameters_size == 0, context, "group_barrier can not have a parameter");
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "memoryBarrierShared();\n");
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "barrier();\n");
+				}
+				else if (o->op_call.func == add_name("group_memory_barrier")) {
+					check(o->op_call.parameters_size == 0, context, "group_memory_barrier can not have a parameter");
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "memoryBarrierShared();\n");
+				}
+				else if (o->op_call.func == add_name("device_barrier")) {
+					check(o->op_call.parameters_size == 0, context, "device_barrier can not have a parameter");
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "memoryBarrier();\n");
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "barrier();\n");
+				}
+				else if (o->op_call.func == add_name("device_memory_barrier")) {
+					check(o->op_call.parameters_size == 0, context, "device_memory_barrier can not have a parameter");
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "memoryBarrier();\n");
+				}
 				else {
-					const char *function_name = get_name(o->op_call.func);
+					const char *function_name = wave_function_string(o->op_call.func);
 					if (o->op_call.func == add_name("float2")) {
 						function_name = "vec2";
 					}
@@ -329,9 +627,20 @@ static void write_functions(char *code, size_t *offset, shader_stage stage, type
 					else if (o->op_call.func == add_name("float4")) {
 						function_name = "vec4";
 					}
+					else {
+						type_id constructed = find_type_by_name(o->op_call.func);
+						if (constructed != NO_TYPE && is_16bit_type(constructed)) {
+							function_name = &mediump_type_string(constructed)[strlen("mediump ")];
+						}
+					}
 
 					indent(code, offset, indentation);
-					*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = %s(", type_string(o->op_call.var.type.type), o->op_call.var.index, function_name);
+					if (o->op_call.var.type.type == void_id) {
+						*offset += sprintf(&code[*offset], "%s(", function_name);
+					}
+					else {
+						*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = %s(", type_string(o->op_call.var.type.type), o->op_call.var.index, function_name);
+					}
 					if (o->op_call.parameters_size > 0) {
 						*offset += sprintf(&code[*offset], "_%" PRIu64, o->op_call.parameters[0].index);
 						for (uint8_t i = 1; i < o->op_call.parameters_size; ++i) {
@@ -343,6 +652,15 @@ static void write_functions(char *code, size_t *offset, shader_stage stage, type
 				break;
 			}
 			case OPCODE_LOAD_ACCESS_LIST: {
+				global *image = find_global_by_var_index(o->op_load_access_list.from.index);
+				if (image != NULL && is_integer_image(image)) {
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = imageLoad(_%" PRIu64 ", ivec2(_%" PRIu64 ")).x;\n",
+					                   type_string(o->op_load_access_list.to.type.type), o->op_load_access_list.to.index, o->op_load_access_list.from.index,
+					                   o->op_load_access_list.access_list[0].access_element.index.index);
+					break;
+				}
+
 				uint64_t global_var_index = 0;
 				for (global_id j = 0; get_global(j) != NULL && get_global(j)->type != NO_TYPE; ++j) {
 					global *g = get_global(j);
@@ -381,7 +699,7 @@ static void write_functions(char *code, size_t *offset, shader_stage stage, type
 						*offset += sprintf(&code[*offset], "[_%" PRIu64 "]", o->op_load_access_list.access_list[i].access_element.index.index);
 						break;
 					case ACCESS_MEMBER:
-						if (global_var_index != 0 || (from_is_input && i == 0)) {
+						if ((global_var_index != 0 || from_is_input) && i == 0) {
 							*offset += sprintf(&code[*offset], "_%s", get_name(o->op_load_access_list.access_list[i].access_member.name));
 						}
 						else {
@@ -477,6 +795,42 @@ static void write_functions(char *code, size_t *offset, shader_stage stage, type
 				}
 				break;
 			}
+			case OPCODE_STORE_ACCESS_LIST: {
+				global *image = find_global_by_var_index(o->op_store_access_list.to.index);
+				if (image != NULL && is_integer_image(image)) {
+					const char *vector_type = get_type(image->type)->tex_format == TEXTURE_FORMAT_R32_UINT ? "uvec4" : "ivec4";
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "imageStore(_%" PRIu64 ", ivec2(_%" PRIu64 "), %s(_%" PRIu64 "));\n", o->op_store_access_list.to.index,
+					                   o->op_store_access_list.access_list[0].access_element.index.index, vector_type, o->op_store_access_list.from.index);
+				}
+				else {
+					cstyle_write_opcode(code, offset, o, type_string, &indentation);
+				}
+				break;
+			}
+			case OPCODE_ATOMIC: {
+				const char *element_type = type_string(o->op_atomic.var.type.type);
+
+				indent(code, offset, indentation);
+				*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = ", element_type, o->op_atomic.var.index);
+
+				global *g = find_global_by_var_index(o->op_atomic.to.index);
+				if (g != NULL && is_integer_image(g)) {
+					*offset += sprintf(&code[*offset], "imageAtomic%s(_%" PRIu64 ", ivec2(_%" PRIu64 ")", atomic_function_suffix(o->op_atomic.func),
+					                   o->op_atomic.to.index, o->op_atomic.index.index);
+				}
+				else {
+					*offset += sprintf(&code[*offset], "atomic%s(_%" PRIu64 "[_%" PRIu64 "]", atomic_function_suffix(o->op_atomic.func), o->op_atomic.to.index,
+					                   o->op_atomic.index.index);
+				}
+
+				// GLSL does not convert between int and uint implicitly
+				for (uint8_t i = 0; i < o->op_atomic.values_size; ++i) {
+					*offset += sprintf(&code[*offset], ", %s(_%" PRIu64 ")", element_type, o->op_atomic.values[i].index);
+				}
+				*offset += sprintf(&code[*offset], ");\n");
+				break;
+			}
 			default:
 				cstyle_write_opcode(code, offset, o, type_string, &indentation);
 				break;
@@ -506,13 +860,15 @@ static void glsl_export_vertex(char *directory, function *main, bool flip) {
 
 	offset += sprintf(&glsl[offset], "#version 330\n\n");
 
+	write_extensions(glsl, &offset, main);
+
 	write_types(glsl, &offset, SHADER_STAGE_VERTEX, vertex_inputs, main->parameters_size, vertex_output, main);
 
 	write_globals(glsl, &offset, main);
 
 	write_functions(glsl, &offset, SHADER_STAGE_VERTEX, vertex_inputs, main->parameters_size, vertex_output, main, flip);
 
-	char *name = get_name(main->name);
+	char *name = shader_name(main);
 
 	char filename[512];
 	if (flip) {
@@ -547,13 +903,15 @@ static void glsl_export_fragment(char *directory, function *main) {
 
 	offset += sprintf(&glsl[offset], "#version 330\n\n");
 
+	write_extensions(glsl, &offset, main);
+
 	write_types(glsl, &offset, SHADER_STAGE_FRAGMENT, &pixel_input, 1, NO_TYPE, main);
 
 	write_globals(glsl, &offset, main);
 
 	write_functions(glsl, &offset, SHADER_STAGE_FRAGMENT, &pixel_input, 1, NO_TYPE, main, false);
 
-	char *name = get_name(main->name);
+	char *name = shader_name(main);
 
 	char filename[512];
 	sprintf(filename, "kong_%s", name);
@@ -575,13 +933,15 @@ static void glsl_export_compute(char *directory, function *main) {
 
 	offset += sprintf(&glsl[offset], "#version 330\n\n");
 
+	write_extensions(glsl, &offset, main);
+
 	write_types(glsl, &offset, SHADER_STAGE_COMPUTE, NULL, 0, NO_TYPE, main);
 
 	write_globals(glsl, &offset, main);
 
 	write_functions(glsl, &offset, SHADER_STAGE_COMPUTE, NULL, 0, NO_TYPE, main, false);
 
-	char *name = get_name(main->name);
+	char *name = shader_name(main);
 
 	char filename[512];
 	sprintf(filename, "kong_%s", name);
@@ -648,15 +1008,32 @@ void glsl_export(char *directory) {
 	}
 
 	for (size_t i = 0; i < vertex_shaders_size; ++i) {
+		if (!shader_needs_export(vertex_shaders[i])) {
+			continue;
+		}
+		stats_begin("glsl_export_vertex %s", get_name(vertex_shaders[i]->name));
 		glsl_export_vertex(directory, vertex_shaders[i], false);
+		stats_end();
+		stats_begin("glsl_export_vertex %s_flip", get_name(vertex_shaders[i]->name));
 		glsl_export_vertex(directory, vertex_shaders[i], true);
+		stats_end();
 	}
 
 	for (size_t i = 0; i < fragment_shaders_size; ++i) {
+		if (!shader_needs_export(fragment_shaders[i])) {
+			continue;
+		}
+		stats_begin("glsl_export_fragment %s", get_name(fragment_shaders[i]->name));
 		glsl_export_fragment(directory, fragment_shaders[i]);
+		stats_end();
 	}
 
 	for (size_t i = 0; i < compute_shaders_size; ++i) {
+		if (!shader_needs_export(compute_shaders[i])) {
+			continue;
+		}
+		stats_begin("glsl_export_compute %s", get_name(compute_shaders[i]->name));
 		glsl_export_compute(directory, compute_shaders[i]);
+		stats_end();
 	}
 }
@@ -7,12 +7,16 @@
 #include "../functions.h"
 #include "../global.h"
 #include "../parser.h"
+#include "../permutations.h"
 #include "../sets.h"
 #include "../shader_stage.h"
+#include "../stats.h"
 #include "../types.h"
+#include "blobs.h"
 #include "cstyle.h"
 #include "d3d11.h"
 #include "d3d12.h"
+#include "layout.h"
 #include "util.h"
 
 #include <assert.h>
@@ -61,6 +65,51 @@ static const char *type_string(type_id type) {
 	if (type == float4x4_id) {
 		return "float4x4";
 	}
+	if (type == half_id) {
+		return "min16float";
+	}
+	if (type == half2_id) {
+		return "min16float2";
+	}
+	if (type == half3_id) {
+		return "min16float3";
+	}
+	if (type == half4_id) {
+		return "min16float4";
+	}
+	if (type == half2x2_id) {
+		return "min16float2x2";
+	}
+	if (type == half3x3_id) {
+		return "min16float3x3";
+	}
+	if (type == half4x4_id) {
+		return "min16float4x4";
+	}
+	if (type == short_id) {
+		return "min16int";
+	}
+	if (type == short2_id) {
+		return "min16int2";
+	}
+	if (type == short3_id) {
+		return "min16int3";
+	}
+	if (type == short4_id) {
+		return "min16int4";
+	}
+	if (type == ushort_id) {
+		return "min16uint";
+	}
+	if (type == ushort2_id) {
+		return "min16uint2";
+	}
+	if (type == ushort3_id) {
+		return "min16uint3";
+	}
+	if (type == ushort4_id) {
+		return "min16uint4";
+	}
 	if (type == ray_type_id) {
 		return "RayDesc";
 	}
@@ -92,10 +141,48 @@ static void type_arr(type_ref t_ref, char *arr) {
 	}
 }
 
-static char *function_string(name_id func) {
+static const char *function_string(name_id func) {
+	type_id constructed = find_type_by_name(func);
+	if (constructed != NO_TYPE && is_16bit_type(constructed)) {
+		return type_string(constructed);
+	}
+
+	static const char *wave_functions[][2] = {
+	    {"wave_lane_index", "WaveGetLaneIndex"},    {"wave_lane_count", "WaveGetLaneCount"}, {"wave_is_first_lane", "WaveIsFirstLane"},
+	    {"wave_all_true", "WaveActiveAllTrue"},     {"wave_any_true", "WaveActiveAnyTrue"},  {"wave_ballot", "WaveActiveBallot"},
+	    {"wave_count_bits", "WaveActiveCountBits"}, {"wave_sum", "WaveActiveSum"},           {"wave_min", "WaveActiveMin"},
+	    {"wave_max", "WaveActiveMax"},              {"wave_prefix_sum", "WavePrefixSum"},    {"wave_read_first", "WaveReadLaneFirst"},
+	    {"wave_read_lane", "WaveReadLaneAt"},
+	};
+	for (size_t wave_function_index = 0; wave_function_index < sizeof(wave_functions) / sizeof(wave_functions[0]); ++wave_function_index) {
+		if (func == add_name(wave_functions[wave_function_index][0])) {
+			return wave_functions[wave_function_index][1];
+		}
+	}
+
+	static const char *barrier_functions[][2] = {
+	    {"group_barrier", "GroupMemoryBarrierWithGroupSync"},
+	    {"group_memory_barrier", "GroupMemoryBarrier"},
+	    {"device_barrier", "DeviceMemoryBarrierWithGroupSync"},
+	    {"device_memory_barrier", "DeviceMemoryBarrier"},
+	};
+	for (size_t barrier_function_index = 0; barrier_function_index < sizeof(barrier_functions) / sizeof(barrier_functions[0]); ++barrier_function_index) {
+		if (func == add_name(barrier_functions[barrier_function_index][0])) {
+			return barrier_functions[barrier_function_index][1];
+		}
+	}
+
 	return get_name(func);
 }
 
+static void check_wave_support(api_kind d3d, function *main) {
+	find_used_capabilities(main);
+
+	debug_context context = KONG_INIT_ZERO;
+	check(d3d != API_DIRECT3D11 || !main->used_capabilities.wave_basic, context, "Wave operations in %s require shader model 6 and Direct3D 12",
+	      get_name(main->name));
+}
+
 static void write_bytecode(char *hlsl, char *directory, const char *filename, const char *name, uint8_t *output, size_t output_size) {
 	char full_filename[512];
 
@@ -142,6 +229,15 @@ static void write_bytecode(char *hlsl, char *directory, const char *filename, co
 
 		fprintf(file, "#include \"%s.h\"\n\n", filename);
 
+		if (get_blob_mode() != BLOB_MODE_STRINGS) {
+			write_blob_definition(file, "uint8_t *", name, output, output_size, false);
+
+			fprintf(file, "/*\n%s*/\n", hlsl);
+
+			fclose(file);
+			return;
+		}
+
 		fprintf(file, "uint8_t *%s = \"", name);
 		for (size_t i = 0; i < output_size; ++i) {
 			// based on the encoding described in https://github.com/adobe/bin2c
@@ -280,6 +376,24 @@ static void write_types(char *hlsl, size_t *offset, shader_stage stage, type_id
 			*offset += sprintf(&hlsl[*offset], "};\n\n");
 		}
 	}
+
+	type_id indirect_args[8];
+	size_t  indirect_args_size = 0;
+	if (main != NULL) {
+		find_referenced_indirect_args(main, indirect_args, &indirect_args_size);
+	}
+
+	for (size_t i = 0; i < indirect_args_size; ++i) {
+		type *t = get_type(indirect_args[i]);
+
+		*offset += sprintf(&hlsl[*offset], "struct %s {\n", get_name(t->name));
+
+		for (size_t j = 0; j < t->members.size; ++j) {
+			*offset += sprintf(&hlsl[*offset], "\t%s %s;\n", type_string(t->members.m[j].type.type), get_name(t->members.m[j].name));
+		}
+
+		*offset += sprintf(&hlsl[*offset], "};\n\n");
+	}
 }
 
 static void assign_register_indices(uint32_t *register_indices, function *shader) {
@@ -307,8 +421,8 @@ static void assign_register_indices(uint32_t *register_indices, function *shader
 				error(context, "Unsupported type for a root constant");
 			}
 
-			register_indices[g_id] = srv_index;
-			srv_index += 1;
+			register_indices[g_id] = cbv_index;
+			cbv_index += 1;
 
 			continue;
 		}
@@ -363,6 +477,23 @@ static void assign_register_indices(uint32_t *register_indices, function *shader
 	}
 }
 
+// The integer formats are the ones atomics can work on
+static const char *texture_element_string(texture_format format) {
+	switch (format) {
+	case TEXTURE_FORMAT_R32_UINT:
+		return "uint";
+	case TEXTURE_FORMAT_R32_SINT:
+		return "int";
+	default:
+		return "float4";
+	}
+}
+
+// SampleCmp needs textures with a single component
+static const char *texture_value_string(global *g) {
+	return (g->usage & GLOBAL_USAGE_SAMPLE_COMPARE) != 0 ? "float" : "float4";
+}
+
 static void write_globals(char *hlsl, size_t *offset, function *main, function **rayshaders, size_t rayshaders_count) {
 	if (main == NULL) {
 		main = rayshaders[0]; // TODO: Consider all raytracing pipelines
@@ -406,28 +537,38 @@ static void write_globals(char *hlsl, size_t *offset, function *main, function *
 		type   *t         = get_type(g->type);
 		type_id base_type = t->array_size > 0 ? t->base : g->type;
 
-		if (base_type == sampler_type_id) {
-			*offset += sprintf(&hlsl[*offset], "SamplerState _%" PRIu64 " : register(s%i);\n\n", g->var_index, register_index);
+		if (g->group_shared) {
+			*offset += sprintf(&hlsl[*offset], "groupshared %s _%" PRIu64 "[%u];\n\n", type_string(base_type), g->var_index, t->array_size);
+		}
+		else if (base_type == sampler_type_id) {
+			*offset += sprintf(&hlsl[*offset], "%s _%" PRIu64 " : register(s%i);\n\n",
+			                   (g->usage & GLOBAL_USAGE_SAMPLE_COMPARE) != 0 ? "SamplerComparisonState" : "SamplerState", g->var_index, register_index);
 		}
 		else if (get_type(base_type)->tex_kind != TEXTURE_KIND_NONE) {
 			if (get_type(base_type)->tex_kind == TEXTURE_KIND_2D) {
 				if (writable) {
-					*offset += sprintf(&hlsl[*offset], "RWTexture2D<float4> _%" PRIu64 " : register(u%i);\n\n", g->var_index, register_index);
+					*offset += sprintf(&hlsl[*offset], "RWTexture2D<%s> _%" PRIu64 " : register(u%i);\n\n",
+					                   texture_element_string(get_type(base_type)->tex_format), g->var_index, register_index);
 				}
 				else {
 					if (t->array_size > 0 && t->array_size == UINT32_MAX) {
-						*offset += sprintf(&hlsl[*offset], "Texture2D<float4> _%" PRIu64 "[] : register(t%i, space1);\n\n", g->var_index, register_index);
+						// bindless textures are fetched from ResourceDescriptorHeap where they are used
+						if (!global_is_bindless(g)) {
+							*offset += sprintf(&hlsl[*offset], "Texture2D<float4> _%" PRIu64 "[] : register(t%i, space1);\n\n", g->var_index, register_index);
+						}
 					}
 					else {
-						*offset += sprintf(&hlsl[*offset], "Texture2D<float4> _%" PRIu64 " : register(t%i);\n\n", g->var_index, register_index);
+						*offset += sprintf(&hlsl[*offset], "Texture2D<%s> _%" PRIu64 " : register(t%i);\n\n", texture_value_string(g), g->var_index,
+						                   register_index);
 					}
 				}
 			}
 			else if (get_type(base_type)->tex_kind == TEXTURE_KIND_2D_ARRAY) {
-				*offset += sprintf(&hlsl[*offset], "Texture2DArray<float4> _%" PRIu64 " : register(t%i);\n\n", g->var_index, register_index);
+				*offset += sprintf(&hlsl[*offset], "Texture2DArray<%s> _%" PRIu64 " : register(t%i);\n\n", texture_value_string(g), g->var_index,
+				                   register_index);
 			}
 			else if (get_type(base_type)->tex_kind == TEXTURE_KIND_CUBE) {
-				*offset += sprintf(&hlsl[*offset], "TextureCube<float4> _%" PRIu64 " : register(t%i);\n\n", g->var_index, register_index);
+				*offset += sprintf(&hlsl[*offset], "TextureCube<%s> _%" PRIu64 " : register(t%i);\n\n", texture_value_string(g), g->var_index, register_index);
 			}
 			else {
 				// TODO
@@ -437,8 +578,11 @@ static void write_globals(char *hlsl, size_t *offset, function *main, function *
 		else if (base_type == bvh_type_id) {
 			*offset += sprintf(&hlsl[*offset], "RaytracingAccelerationStructure  _%" PRIu64 " : register(t%i);\n\n", g->var_index, register_index);
 		}
-		else if (base_type == float_id) {
-			*offset += sprintf(&hlsl[*offset], "static const float _%" PRIu64 " = %f;\n\n", g->var_index, g->value.value.floats[0]);
+		else if (global_is_scalar_constant(g)) {
+			// #[specialize] consts keep their value, permutations bake it
+			*offset += sprintf(&hlsl[*offset], "static const %s _%" PRIu64 " = ", type_string(g->type), g->var_index);
+			write_global_value(hlsl, offset, g);
+			*offset += sprintf(&hlsl[*offset], ";\n\n");
 		}
 		else if (base_type == float2_id) {
 			*offset += sprintf(&hlsl[*offset], "static const float2 _%" PRIu64 " = float2(%f, %f);\n\n", g->var_index, g->value.value.floats[0],
@@ -458,14 +602,22 @@ static void write_globals(char *hlsl, size_t *offset, function *main, function *
 				                   g->value.value.floats[1], g->value.value.floats[2], g->value.value.floats[3]);
 			}
 		}
+		else if ((base_type == uint_id || base_type == int_id || is_indirect_args(base_type)) && t->array_size > 0) {
+			*offset += sprintf(&hlsl[*offset], "RWStructuredBuffer<%s> _%" PRIu64 " : register(u%i);\n\n", get_name(get_type(base_type)->name), g->var_index,
+			                   register_index);
+		}
 		else {
 			*offset += sprintf(&hlsl[*offset], "cbuffer _%" PRIu64 " : register(b%i) {\n", g->var_index, register_index);
 			type *t = get_type(g->type);
+
+			static struct_layout layout;
+			layout_struct(g->type, LAYOUT_RULES_HLSL_CBUFFER, &layout);
+
 			for (size_t i = 0; i < t->members.size; ++i) {
 				char arr[16];
 				type_arr(t->members.m[i].type, arr);
-				*offset += sprintf(&hlsl[*offset], "\t%s _%" PRIu64 "_%s%s;\n", type_string(t->members.m[i].type.type), g->var_index,
-				                   get_name(t->members.m[i].name), arr);
+				*offset += sprintf(&hlsl[*offset], "\t%s _%" PRIu64 "_%s%s : packoffset(c%u.%c);\n", type_string(t->members.m[i].type.type), g->var_index,
+				                   get_name(t->members.m[i].name), arr, layout.offsets[i] / 16, "xyzw"[layout.offsets[i] % 16 / 4]);
 			}
 			*offset += sprintf(&hlsl[*offset], "}\n\n");
 		}
@@ -535,11 +687,29 @@ static bool is_rayanyhit_shader(function *f) {
 static descriptor_set *all_descriptor_sets[256];
 static size_t          all_descriptor_sets_count = 0;
 
+static bool uses_resource_heap(function *main) {
+	descriptor_set_group *set_group = get_descriptor_set_group(main->descriptor_set_group_index);
+
+	for (size_t group_index = 0; group_index < set_group->size; ++group_index) {
+		descriptor_set *set = set_group->values[group_index];
+
+		for (size_t global_index = 0; global_index < set->globals.size; ++global_index) {
+			if (global_is_bindless(get_global(set->globals.globals[global_index]))) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
 static void write_root_signature(function *main, char *hlsl, size_t *offset) {
 	uint32_t register_indices[512] = KONG_INIT_ZERO;
 	assign_register_indices(register_indices, main);
 
-	*offset += sprintf(&hlsl[*offset], "[RootSignature(\"RootFlags(ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT)");
+	// the descriptor tables of bindless textures stay in place so the root parameters still match the ones of the descriptor sets
+	*offset += sprintf(&hlsl[*offset], "[RootSignature(\"RootFlags(ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT%s)",
+	                   uses_resource_heap(main) ? " | CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED" : "");
 
 	descriptor_set_group *set_group = get_descriptor_set_group(main->descriptor_set_group_index);
 
@@ -560,7 +730,7 @@ static void write_root_signature(function *main, char *hlsl, size_t *offset) {
 				error(context, "Unsupported type for a root constant");
 			}
 
-			size += struct_size(get_global(g)->type);
+			size += struct_size(get_global(g)->type, LAYOUT_RULES_HLSL_CBUFFER);
 
 			*offset += sprintf(&hlsl[*offset], "\\\n, RootConstants(num32BitConstants=%i, b%i)", size / 4, register_indices[g]);
 
@@ -1142,8 +1312,14 @@ static void write_functions(char *hlsl, size_t *offset, shader_stage stage, func
 				}
 
 				indent(hlsl, offset, indentation);
-				*offset += sprintf(&hlsl[*offset], "%s _%" PRIu64 " = _%" PRIu64, type_string(o->op_load_access_list.to.type.type),
-				                   o->op_load_access_list.to.index, o->op_load_access_list.from.index);
+				if (g != NULL && g->var_index == o->op_load_access_list.from.index && global_is_bindless(g)) {
+					*offset += sprintf(&hlsl[*offset], "%s _%" PRIu64 " = ResourceDescriptorHeap", type_string(o->op_load_access_list.to.type.type),
+					                   o->op_load_access_list.to.index);
+				}
+				else {
+					*offset += sprintf(&hlsl[*offset], "%s _%" PRIu64 " = _%" PRIu64, type_string(o->op_load_access_list.to.type.type),
+					                   o->op_load_access_list.to.index, o->op_load_access_list.from.index);
+				}
 
 				type *s = get_type(o->op_load_access_list.from.type.type);
 
@@ -1302,7 +1478,8 @@ static void write_functions(char *hlsl, size_t *offset, shader_stage stage, func
 				break;
 			}
 			case OPCODE_MULTIPLY: {
-				if (o->op_binary.left.type.type == float4x4_id || o->op_binary.left.type.type == float3x3_id) {
+				type_id left_type = o->op_binary.left.type.type;
+				if (left_type == float4x4_id || left_type == float3x3_id || left_type == half4x4_id || left_type == half3x3_id) {
 					indent(hlsl, offset, indentation);
 					*offset += sprintf(&hlsl[*offset], "%s _%" PRIu64 " = mul(_%" PRIu64 ", _%" PRIu64 ");\n", type_string(o->op_binary.result.type.type),
 					                   o->op_binary.result.index, o->op_binary.right.index, o->op_binary.left.index);
@@ -1329,6 +1506,44 @@ static void write_functions(char *hlsl, size_t *offset, shader_stage stage, func
 					                   type_string(o->op_call.var.type.type), o->op_call.var.index, o->op_call.parameters[0].index,
 					                   o->op_call.parameters[1].index, o->op_call.parameters[2].index, o->op_call.parameters[3].index);
 				}
+				else if (o->op_call.func == add_name("load")) {
+					check(o->op_call.parameters_size == 3, context, "load requires three parameters");
+					texture_kind kind = get_type(o->op_call.parameters[0].type.type)->tex_kind;
+					check(kind != TEXTURE_KIND_CUBE, context, "load does not support cube textures");
+					*offset += sprintf(&hlsl[*offset], "%s _%" PRIu64 " = _%" PRIu64 ".Load(int%i(_%" PRIu64 ", _%" PRIu64 "))%s;\n",
+					                   type_string(o->op_call.var.type.type), o->op_call.var.index, o->op_call.parameters[0].index,
+					                   kind == TEXTURE_KIND_2D_ARRAY ? 4 : 3, o->op_call.parameters[1].index, o->op_call.parameters[2].index,
+					                   o->op_call.var.type.type == float_id ? ".r" : "");
+				}
+				else if (is_gather_function(o->op_call.func)) {
+					static const char *gathers[] = {"GatherRed", "GatherGreen", "GatherBlue", "GatherAlpha"};
+					check(o->op_call.parameters_size == 3, context, "%s requires three parameters", get_name(o->op_call.func));
+					*offset += sprintf(&hlsl[*offset], "%s _%" PRIu64 " = _%" PRIu64 ".%s(_%" PRIu64 ", _%" PRIu64 ");\n",
+					                   type_string(o->op_call.var.type.type), o->op_call.var.index, o->op_call.parameters[0].index,
+					                   gathers[gather_component(o->op_call.func)], o->op_call.parameters[1].index, o->op_call.parameters[2].index);
+				}
+				else if (o->op_call.func == add_name("sample_grad")) {
+					check(o->op_call.parameters_size == 5, context, "sample_grad requires five parameters");
+					*offset += sprintf(&hlsl[*offset], "%s _%" PRIu64 " = _%" PRIu64 ".SampleGrad(_%" PRIu64 ", _%" PRIu64 ", _%" PRIu64 ", _%" PRIu64 ")%s;\n",
+					                   type_string(o->op_call.var.type.type), o->op_call.var.index, o->op_call.parameters[0].index,
+					                   o->op_call.parameters[1].index, o->op_call.parameters[2].index, o->op_call.parameters[3].index,
+					                   o->op_call.parameters[4].index, o->op_call.var.type.type == float_id ? ".r" : "");
+				}
+				else if (o->op_call.func == add_name("sample_bias")) {
+					check(o->op_call.parameters_size == 4, context, "sample_bias requires four parameters");
+					*offset += sprintf(&hlsl[*offset], "%s _%" PRIu64 " = _%" PRIu64 ".SampleBias(_%" PRIu64 ", _%" PRIu64 ", _%" PRIu64 ")%s;\n",
+					                   type_string(o->op_call.var.type.type), o->op_call.var.index, o->op_call.parameters[0].index,
+					                   o->op_call.parameters[1].index, o->op_call.parameters[2].index, o->op_call.parameters[3].index,
+					                   o->op_call.var.type.type == float_id ? ".r" : "");
+				}
+				else if (o->op_call.func == add_name("sample_compare")) {
+					check(o->op_call.parameters_size == 4, context, "sample_compare requires four parameters");
+					// only pixel shaders have the derivatives to pick a mip level
+					*offset += sprintf(&hlsl[*offset], "%s _%" PRIu64 " = _%" PRIu64 ".%s(_%" PRIu64 ", _%" PRIu64 ", _%" PRIu64 ");\n",
+					                   type_string(o->op_call.var.type.type), o->op_call.var.index, o->op_call.parameters[0].index,
+					                   stage == SHADER_STAGE_FRAGMENT ? "SampleCmp" : "SampleCmpLevelZero", o->op_call.parameters[1].index,
+					                   o->op_call.parameters[2].index, o->op_call.parameters[3].index);
+				}
 				else if (o->op_call.func == add_name("group_id")) {
 					check(o->op_call.parameters_size == 0, context, "group_id can not have a parameter");
 					*offset += sprintf(&hlsl[*offset], "%s _%" PRIu64 " = _kong_group_id;\n", type_string(o->op_call.var.type.type), o->op_call.var.index);
@@ -1434,6 +1649,61 @@ static void write_functions(char *hlsl, size_t *offset, shader_stage stage, func
 				}
 				break;
 			}
+			case OPCODE_ATOMIC: {
+				name_id     func     = o->op_atomic.func;
+				const char *function = NULL;
+				if (func == add_name("atomic_add")) {
+					function = "InterlockedAdd";
+				}
+				else if (func == add_name("atomic_min")) {
+					function = "InterlockedMin";
+				}
+				else if (func == add_name("atomic_max")) {
+					function = "InterlockedMax";
+				}
+				else if (func == add_name("atomic_and")) {
+					function = "InterlockedAnd";
+				}
+				else if (func == add_name("atomic_or")) {
+					function = "InterlockedOr";
+				}
+				else if (func == add_name("atomic_xor")) {
+					function = "InterlockedXor";
+				}
+				else if (func == add_name("atomic_exchange")) {
+					function = "InterlockedExchange";
+				}
+				else {
+					function = "InterlockedCompareExchange";
+				}
+
+				indent(hlsl, offset, indentation);
+				*offset += sprintf(&hlsl[*offset], "%s _%" PRIu64 ";\n", type_string(o->op_atomic.var.type.type), o->op_atomic.var.index);
+				indent(hlsl, offset, indentation);
+				*offset += sprintf(&hlsl[*offset], "%s(_%" PRIu64 "[_%" PRIu64 "]", function, o->op_atomic.to.index, o->op_atomic.index.index);
+				for (uint8_t i = 0; i < o->op_atomic.values_size; ++i) {
+					*offset += sprintf(&hlsl[*offset], ", _%" PRIu64, o->op_atomic.values[i].index);
+				}
+				*offset += sprintf(&hlsl[*offset], ", _%" PRIu64 ");\n", o->op_atomic.var.index);
+				break;
+			}
+			case OPCODE_WHILE_START: {
+				if (o->op_while_start.hint == LOOP_HINT_UNROLL) {
+					indent(hlsl, offset, indentation);
+					if (o->op_while_start.unroll_count > 0) {
+						*offset += sprintf(&hlsl[*offset], "[unroll(%u)]\n", o->op_while_start.unroll_count);
+					}
+					else {
+						*offset += sprintf(&hlsl[*offset], "[unroll]\n");
+					}
+				}
+				else if (o->op_while_start.hint == LOOP_HINT_LOOP) {
+					indent(hlsl, offset, indentation);
+					*offset += sprintf(&hlsl[*offset], "[loop]\n");
+				}
+				cstyle_write_opcode(hlsl, offset, o, type_string, &indentation);
+				break;
+			}
 			default:
 				cstyle_write_opcode(hlsl, offset, o, type_string, &indentation);
 				break;
@@ -1461,6 +1731,8 @@ static void hlsl_export_vertex(char *directory, api_kind d3d, function *main, bo
 	check(main->parameters_size > 0, context, "vertex input missing");
 	check(vertex_output != NO_TYPE, context, "vertex output missing");
 
+	check_wave_support(d3d, main);
+
 	write_types(hlsl, &offset, SHADER_STAGE_VERTEX, vertex_inputs, main->parameters_size, vertex_output, main, NULL, 0);
 
 	write_globals(hlsl, &offset, main, NULL, 0);
@@ -1475,14 +1747,14 @@ static void hlsl_export_vertex(char *directory, api_kind d3d, function *main, bo
 		result = compile_hlsl_to_d3d11(hlsl, &output, &output_size, SHADER_STAGE_VERTEX, debug);
 		break;
 	case API_DIRECT3D12:
-		result = compile_hlsl_to_d3d12(hlsl, &output, &output_size, SHADER_STAGE_VERTEX, debug);
+		result = compile_hlsl_to_d3d12(hlsl, &output, &output_size, SHADER_STAGE_VERTEX, uses_resource_heap(main), debug);
 		break;
 	default:
 		error(context, "Unsupported API for HLSL");
 	}
 	check(result == 0, context, "HLSL compilation failed");
 
-	char *name = get_name(main->name);
+	char *name = shader_name(main);
 
 	char filename[512];
 	sprintf(filename, "kong_%s", name);
@@ -1505,12 +1777,12 @@ static void hlsl_export_amplification(char *directory, function *main, bool debu
 
 	uint8_t *output      = NULL;
 	size_t   output_size = 0;
-	int      result      = compile_hlsl_to_d3d12(hlsl, &output, &output_size, SHADER_STAGE_AMPLIFICATION, debug);
+	int      result      = compile_hlsl_to_d3d12(hlsl, &output, &output_size, SHADER_STAGE_AMPLIFICATION, uses_resource_heap(main), debug);
 
 	debug_context context = KONG_INIT_ZERO;
 	check(result == 0, context, "HLSL compilation failed");
 
-	char *name = get_name(main->name);
+	char *name = shader_name(main);
 
 	char filename[512];
 	sprintf(filename, "kong_%s", name);
@@ -1541,12 +1813,12 @@ static void hlsl_export_mesh(char *directory, function *main, bool debug) {
 
 	uint8_t *output      = NULL;
 	size_t   output_size = 0;
-	int      result      = compile_hlsl_to_d3d12(hlsl, &output, &output_size, SHADER_STAGE_MESH, debug);
+	int      result      = compile_hlsl_to_d3d12(hlsl, &output, &output_size, SHADER_STAGE_MESH, uses_resource_heap(main), debug);
 
 	debug_context context = KONG_INIT_ZERO;
 	check(result == 0, context, "HLSL compilation failed");
 
-	char *name = get_name(main->name);
+	char *name = shader_name(main);
 
 	char filename[512];
 	sprintf(filename, "kong_%s", name);
@@ -1567,6 +1839,8 @@ static void hlsl_export_fragment(char *directory, api_kind d3d, function *main,
 	debug_context context = KONG_INIT_ZERO;
 	check(pixel_input != NO_TYPE, context, "fragment input missing");
 
+	check_wave_support(d3d, main);
+
 	write_types(hlsl, &offset, SHADER_STAGE_FRAGMENT, &pixel_input, 1, NO_TYPE, main, NULL, 0);
 
 	write_globals(hlsl, &offset, main, NULL, 0);
@@ -1581,14 +1855,14 @@ static void hlsl_export_fragment(char *directory, api_kind d3d, function *main,
 		result = compile_hlsl_to_d3d11(hlsl, &output, &output_size, SHADER_STAGE_FRAGMENT, debug);
 		break;
 	case API_DIRECT3D12:
-		result = compile_hlsl_to_d3d12(hlsl, &output, &output_size, SHADER_STAGE_FRAGMENT, debug);
+		result = compile_hlsl_to_d3d12(hlsl, &output, &output_size, SHADER_STAGE_FRAGMENT, uses_resource_heap(main), debug);
 		break;
 	default:
 		error(context, "Unsupported API for HLSL");
 	}
 	check(result == 0, context, "HLSL compilation failed");
 
-	char *name = get_name(main->name);
+	char *name = shader_name(main);
 
 	char filename[512];
 	sprintf(filename, "kong_%s", name);
@@ -1603,6 +1877,8 @@ static void hlsl_export_compute(char *directory, api_kind d3d, function *main, b
 	char  *hlsl   = (char *)calloc(1024 * 1024, 1);
 	size_t offset = 0;
 
+	check_wave_support(d3d, main);
+
 	write_types(hlsl, &offset, SHADER_STAGE_COMPUTE, NULL, 0, NO_TYPE, main, NULL, 0);
 
 	write_globals(hlsl, &offset, main, NULL, 0);
@@ -1619,14 +1895,14 @@ static void hlsl_export_compute(char *directory, api_kind d3d, function *main, b
 		result = compile_hlsl_to_d3d11(hlsl, &output, &output_size, SHADER_STAGE_COMPUTE, debug);
 		break;
 	case API_DIRECT3D12:
-		result = compile_hlsl_to_d3d12(hlsl, &output, &output_size, SHADER_STAGE_COMPUTE, debug);
+		result = compile_hlsl_to_d3d12(hlsl, &output, &output_size, SHADER_STAGE_COMPUTE, uses_resource_heap(main), debug);
 		break;
 	default:
 		error(context, "Unsupported API for HLSL");
 	}
 	check(result == 0, context, "HLSL compilation failed");
 
-	char *name = get_name(main->name);
+	char *name = shader_name(main);
 
 	char filename[512];
 	sprintf(filename, "kong_%s", name);
@@ -1698,7 +1974,7 @@ static void hlsl_export_all_ray_shaders(char *directory, bool debug) {
 
 	uint8_t *output      = NULL;
 	size_t   output_size = 0;
-	int      result      = compile_hlsl_to_d3d12(hlsl, &output, &output_size, SHADER_STAGE_RAY_GENERATION, debug);
+	int      result      = compile_hlsl_to_d3d12(hlsl, &output, &output_size, SHADER_STAGE_RAY_GENERATION, false, debug);
 	check(result == 0, context, "HLSL compilation failed");
 
 	const char *name = "ray";
@@ -1906,28 +2182,56 @@ void hlsl_export(char *directory, api_kind d3d, bool debug) {
 	}
 
 	for (size_t i = 0; i < vertex_shaders.size; ++i) {
+		if (!shader_needs_export(vertex_shaders.values[i])) {
+			continue;
+		}
+		stats_begin("hlsl_export_vertex %s", get_name(vertex_shaders.values[i]->name));
 		hlsl_export_vertex(directory, d3d, vertex_shaders.values[i], debug);
+		stats_end();
 	}
 
 	if (d3d == API_DIRECT3D12) {
 		for (size_t i = 0; i < amplification_shaders.size; ++i) {
+			if (!shader_needs_export(amplification_shaders.values[i])) {
+				continue;
+			}
+			stats_begin("hlsl_export_amplification %s", get_name(amplification_shaders.values[i]->name));
 			hlsl_export_amplification(directory, amplification_shaders.values[i], debug);
+			stats_end();
 		}
 
 		for (size_t i = 0; i < mesh_shaders.size; ++i) {
+			if (!shader_needs_export(mesh_shaders.values[i])) {
+				continue;
+			}
+			stats_begin("hlsl_export_mesh %s", get_name(mesh_shaders.values[i]->name));
 			hlsl_export_mesh(directory, mesh_shaders.values[i], debug);
+			stats_end();
 		}
 	}
 
 	for (size_t i = 0; i < fragment_shaders.size; ++i) {
+		if (!shader_needs_export(fragment_shaders.values[i])) {
+			continue;
+		}
+		stats_begin("hlsl_export_fragment %s", get_name(fragment_shaders.values[i]->name));
 		hlsl_export_fragment(directory, d3d, fragment_shaders.values[i], debug);
+		stats_end();
 	}
 
 	for (size_t i = 0; i < compute_shaders_size; ++i) {
+		if (!shader_needs_export(compute_shaders[i])) {
+			continue;
+		}
+		stats_begin("hlsl_export_compute %s", get_name(compute_shaders[i]->name));
 		hlsl_export_compute(directory, d3d, compute_shaders[i], debug);
+		stats_end();
 	}
 
-	if (d3d == API_DIRECT3D12) {
+	// ray shaders are not permutated, they are only written once
+	if (d3d == API_DIRECT3D12 && current_permutation() == 0) {
+		stats_begin("hlsl_export_all_ray_shaders");
 		hlsl_export_all_ray_shaders(directory, debug);
+		stats_end();
 	}
 }
@@ -0,0 +1,1128 @@
+#include "jit.h"
+
+#include "../analyzer.h"
+#include "../compiler.h"
+#include "../errors.h"
+#include "../globals.h"
+#include "../sets.h"
+#include "../types.h"
+#include "layout.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+typedef enum jit_register { RAX = 0, RCX = 1, RDX = 2, RBP = 5, RSI = 6, RDI = 7 } jit_register;
+
+// Counters sit right below rbp, every variable gets a 16 byte slot below them
+static const int32_t workgroup_counts[3]  = {-4, -8, -12};
+static const int32_t workgroup_indices[3] = {-16, -20, -24};
+static const int32_t local_indices[3]     = {-28, -32, -36};
+
+#define COUNTERS_SIZE 64
+
+// xmm0 to xmm5 are volatile in both the System V and the Windows calling convention
+#define XMM_REGISTERS 6
+#define NO_XMM 0xff
+#define NO_VARIABLE UINT64_MAX
+#define INVOCATION_END UINT64_MAX
+
+#define EMIT(...) emit_sequence((uint8_t[]){__VA_ARGS__}, sizeof((uint8_t[]){__VA_ARGS__}))
+#define EMIT_MEMORY(reg, base, displacement, ...) (EMIT(__VA_ARGS__), emit_memory(reg, base, displacement))
+
+static uint8_t *code          = NULL;
+static size_t   code_size     = 0;
+static size_t   code_capacity = 0;
+
+static int32_t *variable_slots = NULL;
+static uint64_t scratch_index;
+static uint64_t temporary_index;
+static uint32_t frame_size;
+
+// Slots stay authoritative, a register only mirrors the slot of the variable it is assigned to
+static uint64_t xmm_variables[XMM_REGISTERS];
+static uint8_t  next_xmm = 0;
+
+typedef struct jit_label {
+	uint64_t id;
+	size_t   offset;
+} jit_label;
+
+static jit_label labels[1024];
+static size_t    labels_size;
+static jit_label jumps[4096];
+static size_t    jumps_size;
+
+static uint32_t local_size[3];
+static api_kind layout_api;
+
+static void *global_pointers[1024];
+
+typedef struct jit_memory {
+	void  *memory;
+	size_t size;
+} jit_memory;
+
+static jit_memory kernels[256];
+static size_t     kernels_size = 0;
+
+static void emit(uint8_t byte) {
+	if (code_size == code_capacity) {
+		debug_context context = KONG_INIT_ZERO;
+
+		code_capacity = code_capacity == 0 ? 4096 : code_capacity * 2;
+		code          = realloc(code, code_capacity);
+		check(code != NULL, context, "Could not allocate jit code");
+	}
+	code[code_size++] = byte;
+}
+
+static void emit_sequence(const uint8_t *bytes, size_t size) {
+	for (size_t i = 0; i < size; ++i) {
+		emit(bytes[i]);
+	}
+}
+
+static void emit_uint32(uint32_t value) {
+	for (int i = 0; i < 4; ++i) {
+		emit((uint8_t)(value >> (i * 8)));
+	}
+}
+
+static void emit_uint64(uint64_t value) {
+	for (int i = 0; i < 8; ++i) {
+		emit((uint8_t)(value >> (i * 8)));
+	}
+}
+
+// [base + disp32], none of the bases used need a SIB byte
+static void emit_memory(uint8_t reg, jit_register base, int32_t displacement) {
+	emit(0x80 | ((reg & 7) << 3) | base);
+	emit_uint32((uint32_t)displacement);
+}
+
+static void patch_uint32(size_t offset, uint32_t value) {
+	for (int i = 0; i < 4; ++i) {
+		code[offset + i] = (uint8_t)(value >> (i * 8));
+	}
+}
+
+static void patch_rel32(size_t offset, size_t target) {
+	patch_uint32(offset, (uint32_t)(int32_t)((int64_t)target - (int64_t)(offset + 4)));
+}
+
+static void load_eax(jit_register base, int32_t displacement) {
+	EMIT_MEMORY(RAX, base, displacement, 0x8b);
+}
+
+static void store_eax(jit_register base, int32_t displacement) {
+	EMIT_MEMORY(RAX, base, displacement, 0x89);
+}
+
+static void store_immediate(jit_register base, int32_t displacement, uint32_t value) {
+	EMIT_MEMORY(0, base, displacement, 0xc7);
+	emit_uint32(value);
+}
+
+static void forget_xmm(void) {
+	for (int i = 0; i < XMM_REGISTERS; ++i) {
+		xmm_variables[i] = NO_VARIABLE;
+	}
+}
+
+static void forget_variable(uint64_t index) {
+	for (int i = 0; i < XMM_REGISTERS; ++i) {
+		if (xmm_variables[i] == index) {
+			xmm_variables[i] = NO_VARIABLE;
+		}
+	}
+}
+
+static void bind_label(uint64_t id) {
+	debug_context context = KONG_INIT_ZERO;
+	check(labels_size < sizeof(labels) / sizeof(labels[0]), context, "Too many jit labels");
+
+	// jumps can arrive from anywhere, registers no longer mirror anything
+	forget_xmm();
+
+	labels[labels_size].id     = id;
+	labels[labels_size].offset = code_size;
+	++labels_size;
+}
+
+static bool label_pending(uint64_t id) {
+	for (size_t i = 0; i < jumps_size; ++i) {
+		if (jumps[i].id == id) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void emit_jump(bool if_zero, uint64_t id) {
+	debug_context context = KONG_INIT_ZERO;
+	check(jumps_size < sizeof(jumps) / sizeof(jumps[0]), context, "Too many jit jumps");
+
+	if (if_zero) {
+		EMIT(0x0f, 0x84);
+	}
+	else {
+		EMIT(0xe9);
+	}
+
+	jumps[jumps_size].id     = id;
+	jumps[jumps_size].offset = code_size;
+	++jumps_size;
+
+	emit_uint32(0);
+}
+
+static uint32_t components(type_id t) {
+	debug_context context = KONG_INIT_ZERO;
+	if (!is_vector_or_scalar(t) || is_16bit_type(t)) {
+		error(context, "%s is not supported by the jit", get_name(get_type(t)->name));
+	}
+	return vector_size(t);
+}
+
+static type_id base_type(type_id t) {
+	components(t);
+	return vector_base_type(t);
+}
+
+static int32_t slot_of_index(uint64_t index) {
+	if (variable_slots[index] == 0) {
+		frame_size += 16;
+		variable_slots[index] = -(int32_t)frame_size;
+	}
+	return variable_slots[index];
+}
+
+static int32_t variable_slot(variable v) {
+	return slot_of_index(v.index);
+}
+
+// Scalars are broadcast to every component
+static int32_t component(variable v, uint32_t c) {
+	return variable_slot(v) + (components(v.type.type) == 1 ? 0 : 4 * c);
+}
+
+static bool find_global_variable(variable v, global_id *id) {
+	for (global_id i = 0; get_global(i) != NULL && get_global(i)->type != NO_TYPE; ++i) {
+		if (get_global(i)->var_index == v.index) {
+			*id = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+static uint8_t take_xmm(uint8_t avoid_a, uint8_t avoid_b) {
+	uint8_t reg;
+	do {
+		reg      = next_xmm;
+		next_xmm = (next_xmm + 1) % XMM_REGISTERS;
+	} while (reg == avoid_a || reg == avoid_b);
+
+	xmm_variables[reg] = NO_VARIABLE;
+	return reg;
+}
+
+static uint8_t load_float(variable v, uint32_t width, uint8_t avoid) {
+	uint32_t size      = components(v.type.type);
+	bool     broadcast = size == 1 && width > 1;
+
+	if (!broadcast) {
+		for (uint8_t reg = 0; reg < XMM_REGISTERS; ++reg) {
+			if (xmm_variables[reg] == v.index) {
+				return reg;
+			}
+		}
+	}
+
+	uint8_t reg = take_xmm(avoid, NO_XMM);
+
+	if (size == 1) {
+		EMIT_MEMORY(reg, RBP, variable_slot(v), 0xf3, 0x0f, 0x10);
+		if (broadcast) {
+			EMIT(0x0f, 0xc6, 0xc0 | (reg << 3) | reg, 0x00);
+			return reg;
+		}
+	}
+	else {
+		EMIT_MEMORY(reg, RBP, variable_slot(v), 0x0f, 0x10);
+	}
+
+	xmm_variables[reg] = v.index;
+	return reg;
+}
+
+static void store_float(variable to, uint8_t reg) {
+	if (components(to.type.type) == 1) {
+		EMIT_MEMORY(reg, RBP, variable_slot(to), 0xf3, 0x0f, 0x11);
+	}
+	else {
+		EMIT_MEMORY(reg, RBP, variable_slot(to), 0x0f, 0x11);
+	}
+
+	forget_variable(to.index);
+	xmm_variables[reg] = to.index;
+}
+
+// A copy of reg that can be overwritten, reg itself when it does not mirror a variable
+static uint8_t writable_xmm(uint8_t reg, uint8_t avoid) {
+	if (xmm_variables[reg] == NO_VARIABLE) {
+		return reg;
+	}
+
+	uint8_t copy = take_xmm(reg, avoid);
+	EMIT(0x0f, 0x28, 0xc0 | (copy << 3) | reg);
+	return copy;
+}
+
+// addps, subps, mulps, divps, minps and maxps or their scalar versions
+static void emit_float_arithmetic(uint8_t op, variable result, variable left, variable right) {
+	uint32_t width = components(result.type.type);
+
+	uint8_t l = load_float(left, width, NO_XMM);
+	uint8_t r = load_float(right, width, l);
+	uint8_t d = writable_xmm(l, r);
+
+	if (width == 1) {
+		EMIT(0xf3, 0x0f, op, 0xc0 | (d << 3) | r);
+	}
+	else {
+		EMIT(0x0f, op, 0xc0 | (d << 3) | r);
+	}
+
+	store_float(result, d);
+}
+
+// The condition codes of setcc, ucomiss sets the flags like an unsigned compare
+static uint8_t condition_code(opcode_type type, bool is_signed) {
+	switch (type) {
+	case OPCODE_EQUALS:
+		return 0x4;
+	case OPCODE_NOT_EQUALS:
+		return 0x5;
+	case OPCODE_GREATER:
+		return is_signed ? 0xf : 0x7;
+	case OPCODE_GREATER_EQUAL:
+		return is_signed ? 0xd : 0x3;
+	case OPCODE_LESS:
+		return is_signed ? 0xc : 0x2;
+	case OPCODE_LESS_EQUAL:
+		return is_signed ? 0xe : 0x6;
+	default: {
+		debug_context context = KONG_INIT_ZERO;
+		error(context, "Unexpected comparison");
+	}
+	}
+}
+
+static void emit_float_comparison(opcode_type type, variable result, variable left, variable right) {
+	forget_variable(result.index);
+
+	for (uint32_t c = 0; c < components(result.type.type); ++c) {
+		uint8_t reg = take_xmm(NO_XMM, NO_XMM);
+		EMIT_MEMORY(reg, RBP, component(left, c), 0xf3, 0x0f, 0x10);
+		EMIT_MEMORY(reg, RBP, component(right, c), 0x0f, 0x2e);
+		EMIT(0x0f, 0x90 | condition_code(type, false), 0xc0);
+		EMIT(0x0f, 0xb6, 0xc0);
+		store_eax(RBP, component(result, c));
+	}
+}
+
+static void emit_integer_binary(opcode_type type, variable result, variable left, variable right) {
+	bool is_signed = base_type(left.type.type) == int_id;
+
+	forget_variable(result.index);
+
+	for (uint32_t c = 0; c < components(result.type.type); ++c) {
+		int32_t r = component(right, c);
+
+		load_eax(RBP, component(left, c));
+
+		switch (type) {
+		case OPCODE_ADD:
+			EMIT_MEMORY(RAX, RBP, r, 0x03);
+			break;
+		case OPCODE_SUB:
+			EMIT_MEMORY(RAX, RBP, r, 0x2b);
+			break;
+		case OPCODE_MULTIPLY:
+			EMIT_MEMORY(RAX, RBP, r, 0x0f, 0xaf);
+			break;
+		case OPCODE_DIVIDE:
+		case OPCODE_MOD:
+			if (is_signed) {
+				EMIT(0x99);
+			}
+			else {
+				EMIT(0x31, 0xd2);
+			}
+			EMIT_MEMORY(RCX, RBP, r, 0x8b);
+			EMIT(0xf7, is_signed ? 0xf9 : 0xf1);
+			if (type == OPCODE_MOD) {
+				EMIT(0x89, 0xd0);
+			}
+			break;
+		case OPCODE_AND:
+		case OPCODE_BITWISE_AND:
+			EMIT_MEMORY(RAX, RBP, r, 0x23);
+			break;
+		case OPCODE_OR:
+		case OPCODE_BITWISE_OR:
+			EMIT_MEMORY(RAX, RBP, r, 0x0b);
+			break;
+		case OPCODE_BITWISE_XOR:
+			EMIT_MEMORY(RAX, RBP, r, 0x33);
+			break;
+		case OPCODE_LEFT_SHIFT:
+			EMIT_MEMORY(RCX, RBP, r, 0x8b);
+			EMIT(0xd3, 0xe0);
+			break;
+		case OPCODE_RIGHT_SHIFT:
+			EMIT_MEMORY(RCX, RBP, r, 0x8b);
+			EMIT(0xd3, is_signed ? 0xf8 : 0xe8);
+			break;
+		default:
+			EMIT_MEMORY(RAX, RBP, r, 0x3b);
+			EMIT(0x0f, 0x90 | condition_code(type, is_signed), 0xc0);
+			EMIT(0x0f, 0xb6, 0xc0);
+			break;
+		}
+
+		store_eax(RBP, component(result, c));
+	}
+}
+
+static void emit_binary(opcode_type type, variable result, variable left, variable right) {
+	debug_context context = KONG_INIT_ZERO;
+
+	if (base_type(left.type.type) != float_id) {
+		emit_integer_binary(type, result, left, right);
+		return;
+	}
+
+	switch (type) {
+	case OPCODE_ADD:
+		emit_float_arithmetic(0x58, result, left, right);
+		break;
+	case OPCODE_SUB:
+		emit_float_arithmetic(0x5c, result, left, right);
+		break;
+	case OPCODE_MULTIPLY:
+		emit_float_arithmetic(0x59, result, left, right);
+		break;
+	case OPCODE_DIVIDE:
+		emit_float_arithmetic(0x5e, result, left, right);
+		break;
+	case OPCODE_EQUALS:
+	case OPCODE_NOT_EQUALS:
+	case OPCODE_GREATER:
+	case OPCODE_GREATER_EQUAL:
+	case OPCODE_LESS:
+	case OPCODE_LESS_EQUAL:
+		emit_float_comparison(type, result, left, right);
+		break;
+	default:
+		error(context, "This float operation is not supported by the jit");
+	}
+}
+
+// Copies one component and converts it between float, int and uint
+static void emit_convert(variable to, uint32_t to_component, variable from, uint32_t from_component) {
+	type_id to_base   = base_type(to.type.type);
+	type_id from_base = base_type(from.type.type);
+	int32_t target    = component(to, to_component);
+	int32_t source    = component(from, from_component);
+
+	if (to_base == float_id && from_base != float_id) {
+		uint8_t reg = take_xmm(NO_XMM, NO_XMM);
+		load_eax(RBP, source);
+		// unsigned values were zero extended to rax and convert as 64 bit integers
+		if (from_base == int_id) {
+			EMIT(0xf3, 0x0f, 0x2a, 0xc0 | (reg << 3));
+		}
+		else {
+			EMIT(0xf3, 0x48, 0x0f, 0x2a, 0xc0 | (reg << 3));
+		}
+		EMIT_MEMORY(reg, RBP, target, 0xf3, 0x0f, 0x11);
+	}
+	else if (to_base != float_id && from_base == float_id) {
+		if (to_base == int_id) {
+			EMIT_MEMORY(RAX, RBP, source, 0xf3, 0x0f, 0x2c);
+		}
+		else {
+			EMIT_MEMORY(RAX, RBP, source, 0xf3, 0x48, 0x0f, 0x2c);
+		}
+		store_eax(RBP, target);
+	}
+	else {
+		load_eax(RBP, source);
+		store_eax(RBP, target);
+	}
+}
+
+static void emit_store_variable(variable to, variable from) {
+	uint32_t width = components(to.type.type);
+
+	if (base_type(to.type.type) == float_id && base_type(from.type.type) == float_id) {
+		store_float(to, load_float(from, width, NO_XMM));
+		return;
+	}
+
+	forget_variable(to.index);
+	for (uint32_t c = 0; c < width; ++c) {
+		emit_convert(to, c, from, c);
+	}
+}
+
+static bool in_root_constants(global *g) {
+	for (size_t i = 0; i < g->sets_count; ++i) {
+		if (g->sets[i]->name == add_name("root_constants")) {
+			return true;
+		}
+	}
+	return false;
+}
+
+typedef struct jit_address {
+	jit_register base;
+	int32_t      displacement;
+	type_id      type;
+	kong_access *swizzle;
+} jit_address;
+
+// Leaves the address an access list reads or writes in base + displacement, buffers are addressed through rcx
+static jit_address emit_address(variable from, kong_access *access_list, uint8_t access_list_size) {
+	debug_context context = KONG_INIT_ZERO;
+
+	jit_address  address = {RBP, 0, from.type.type, NULL};
+	layout_rules rules   = LAYOUT_RULES_STD430;
+
+	global_id id;
+	if (find_global_variable(from, &id) && get_global(id)->value.kind == GLOBAL_VALUE_NONE) {
+		global *g = get_global(id);
+
+		// mov rcx, &global_pointers[id]; mov rcx, [rcx]
+		EMIT(0x48, 0xb9);
+		emit_uint64((uint64_t)(uintptr_t)&global_pointers[id]);
+		EMIT_MEMORY(RCX, RCX, 0, 0x48, 0x8b);
+
+		address.base = RCX;
+		address.type = g->type;
+		rules        = api_layout_rules(layout_api, in_root_constants(g));
+	}
+	else {
+		address.displacement = variable_slot(from);
+	}
+
+	for (uint8_t i = 0; i < access_list_size; ++i) {
+		kong_access *access = &access_list[i];
+
+		switch (access->kind) {
+		case ACCESS_ELEMENT: {
+			type *t = get_type(address.type);
+			check(address.base == RCX && t->array_size > 0, context, "Only buffers can be indexed by the jit");
+
+			uint32_t stride = is_vector_or_scalar(t->base) ? 4 * components(t->base) : array_stride(t->base, rules);
+
+			// mov eax, index; imul rax, rax, stride; add rcx, rax
+			load_eax(RBP, variable_slot(access->access_element.index));
+			EMIT(0x48, 0x69, 0xc0);
+			emit_uint32(stride);
+			EMIT(0x48, 0x01, 0xc1);
+			address.type = access->type;
+			break;
+		}
+		case ACCESS_MEMBER: {
+			type *t = get_type(address.type);
+			check(address.base == RCX && !t->built_in, context, "Only members of buffers and uniform structs can be accessed by the jit");
+
+			struct_layout layout;
+			layout_struct(address.type, rules, &layout);
+
+			size_t member_index = 0;
+			while (member_index < t->members.size && t->members.m[member_index].name != access->access_member.name) {
+				++member_index;
+			}
+			check(member_index < t->members.size, context, "Member %s not found", get_name(access->access_member.name));
+
+			address.displacement += layout.offsets[member_index];
+			address.type = access->type;
+			break;
+		}
+		case ACCESS_SWIZZLE:
+			check(i == access_list_size - 1, context, "Only a final swizzle is supported by the jit");
+			address.swizzle = access;
+			break;
+		}
+	}
+
+	return address;
+}
+
+static uint32_t address_component(jit_address *address, uint32_t c) {
+	return address->swizzle != NULL ? address->swizzle->access_swizzle.swizzle.indices[c] : c;
+}
+
+static void emit_load_access_list(variable to, variable from, kong_access *access_list, uint8_t access_list_size) {
+	jit_address address = emit_address(from, access_list, access_list_size);
+	uint32_t    width   = components(to.type.type);
+
+	if (address.swizzle == NULL && width == 4 && base_type(to.type.type) == float_id) {
+		uint8_t reg = take_xmm(NO_XMM, NO_XMM);
+		EMIT_MEMORY(reg, address.base, address.displacement, 0x0f, 0x10);
+		store_float(to, reg);
+		return;
+	}
+
+	forget_variable(to.index);
+	for (uint32_t c = 0; c < width; ++c) {
+		load_eax(address.base, address.displacement + 4 * address_component(&address, c));
+		store_eax(RBP, component(to, c));
+	}
+}
+
+static opcode_type compound_operation(opcode_type type) {
+	switch (type) {
+	case OPCODE_SUB_AND_STORE_VARIABLE:
+	case OPCODE_SUB_AND_STORE_ACCESS_LIST:
+		return OPCODE_SUB;
+	case OPCODE_ADD_AND_STORE_VARIABLE:
+	case OPCODE_ADD_AND_STORE_ACCESS_LIST:
+		return OPCODE_ADD;
+	case OPCODE_DIVIDE_AND_STORE_VARIABLE:
+	case OPCODE_DIVIDE_AND_STORE_ACCESS_LIST:
+		return OPCODE_DIVIDE;
+	default:
+		return OPCODE_MULTIPLY;
+	}
+}
+
+static void emit_store_access_list(opcode_type type, variable to, variable from, kong_access *access_list, uint8_t access_list_size) {
+	if (type != OPCODE_STORE_ACCESS_LIST) {
+		variable value;
+		value.kind      = VARIABLE_INTERNAL;
+		value.index     = scratch_index;
+		value.type.type = access_list[access_list_size - 1].type;
+
+		emit_load_access_list(value, to, access_list, access_list_size);
+		emit_binary(compound_operation(type), value, value, from);
+		from = value;
+	}
+
+	jit_address address = emit_address(to, access_list, access_list_size);
+	uint32_t    width   = components(access_list[access_list_size - 1].type);
+
+	if (address.swizzle == NULL && width == 4 && base_type(from.type.type) == float_id) {
+		uint8_t reg = load_float(from, 4, NO_XMM);
+		EMIT_MEMORY(reg, address.base, address.displacement, 0x0f, 0x11);
+	}
+	else {
+		for (uint32_t c = 0; c < width; ++c) {
+			load_eax(RBP, component(from, c));
+			store_eax(address.base, address.displacement + 4 * address_component(&address, c));
+		}
+	}
+
+	if (address.base == RBP) {
+		forget_variable(to.index);
+	}
+}
+
+static bool is_constructor(name_id func) {
+	const char *constructors[] = {"float", "float2", "float3", "float4", "int", "int2", "int3", "int4", "uint", "uint2", "uint3", "uint4"};
+	for (size_t i = 0; i < sizeof(constructors) / sizeof(constructors[0]); ++i) {
+		if (func == add_name(constructors[i])) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void emit_call(opcode *o) {
+	debug_context context = KONG_INIT_ZERO;
+
+	name_id   func       = o->op_call.func;
+	variable  to         = o->op_call.var;
+	variable *parameters = o->op_call.parameters;
+
+	if (func == add_name("group_id") || func == add_name("group_thread_id")) {
+		const int32_t *indices = func == add_name("group_id") ? workgroup_indices : local_indices;
+
+		forget_variable(to.index);
+		for (uint32_t c = 0; c < 3; ++c) {
+			load_eax(RBP, indices[c]);
+			store_eax(RBP, component(to, c));
+		}
+	}
+	else if (func == add_name("dispatch_thread_id")) {
+		forget_variable(to.index);
+		for (uint32_t c = 0; c < 3; ++c) {
+			// group * local size + local
+			load_eax(RBP, workgroup_indices[c]);
+			EMIT(0x69, 0xc0);
+			emit_uint32(local_size[c]);
+			EMIT_MEMORY(RAX, RBP, local_indices[c], 0x03);
+			store_eax(RBP, component(to, c));
+		}
+	}
+	else if (func == add_name("group_index")) {
+		forget_variable(to.index);
+		load_eax(RBP, local_indices[2]);
+		EMIT(0x69, 0xc0);
+		emit_uint32(local_size[0] * local_size[1]);
+		EMIT_MEMORY(RDX, RBP, local_indices[1], 0x8b);
+		EMIT(0x69, 0xd2);
+		emit_uint32(local_size[0]);
+		EMIT(0x01, 0xd0);
+		EMIT_MEMORY(RAX, RBP, local_indices[0], 0x03);
+		store_eax(RBP, variable_slot(to));
+	}
+	else if (is_constructor(func)) {
+		uint32_t width = components(to.type.type);
+
+		forget_variable(to.index);
+		if (o->op_call.parameters_size == 1 && components(parameters[0].type.type) == 1) {
+			for (uint32_t c = 0; c < width; ++c) {
+				emit_convert(to, c, parameters[0], 0);
+			}
+		}
+		else {
+			uint32_t c = 0;
+			for (uint8_t i = 0; i < o->op_call.parameters_size; ++i) {
+				for (uint32_t pc = 0; pc < components(parameters[i].type.type) && c < width; ++pc) {
+					emit_convert(to, c, parameters[i], pc);
+					++c;
+				}
+			}
+		}
+	}
+	else if (func == add_name("sqrt") && base_type(to.type.type) == float_id) {
+		uint32_t width = components(to.type.type);
+
+		uint8_t reg = load_float(parameters[0], width, NO_XMM);
+		uint8_t d   = take_xmm(reg, NO_XMM);
+		if (width == 1) {
+			EMIT(0xf3, 0x0f, 0x51, 0xc0 | (d << 3) | reg);
+		}
+		else {
+			EMIT(0x0f, 0x51, 0xc0 | (d << 3) | reg);
+		}
+		store_float(to, d);
+	}
+	else if ((func == add_name("min") || func == add_name("max")) && base_type(to.type.type) == float_id) {
+		emit_float_arithmetic(func == add_name("min") ? 0x5d : 0x5f, to, parameters[0], parameters[1]);
+	}
+	else if (func == add_name("abs") && base_type(to.type.type) == float_id) {
+		forget_variable(to.index);
+		for (uint32_t c = 0; c < components(to.type.type); ++c) {
+			load_eax(RBP, component(parameters[0], c));
+			EMIT(0x25);
+			emit_uint32(0x7fffffff);
+			store_eax(RBP, component(to, c));
+		}
+	}
+	else if (func == add_name("dot") && base_type(parameters[0].type.type) == float_id) {
+		uint32_t width = components(parameters[0].type.type);
+
+		uint8_t l = load_float(parameters[0], width, NO_XMM);
+		uint8_t r = load_float(parameters[1], width, l);
+		uint8_t d = writable_xmm(l, r);
+		EMIT(0x0f, 0x59, 0xc0 | (d << 3) | r);
+
+		// the products go through a temporary slot to be summed up
+		int32_t temporary = slot_of_index(temporary_index);
+		EMIT_MEMORY(d, RBP, temporary, 0x0f, 0x11);
+		for (uint32_t c = 1; c < width; ++c) {
+			EMIT_MEMORY(d, RBP, temporary + 4 * c, 0xf3, 0x0f, 0x58);
+		}
+		store_float(to, d);
+	}
+	else {
+		error(context, "%s is not supported by the jit", get_name(func));
+	}
+}
+
+static void emit_jump_if_false(variable condition, uint64_t id) {
+	load_eax(RBP, variable_slot(condition));
+	EMIT(0x85, 0xc0);
+	emit_jump(true, id);
+}
+
+static void emit_opcodes(function *f) {
+	debug_context context = KONG_INIT_ZERO;
+
+	uint8_t *data = f->code.o;
+	size_t   size = f->code.size;
+
+	size_t index = 0;
+	while (index < size) {
+		opcode *o = (opcode *)&data[index];
+		switch (o->type) {
+		case OPCODE_VAR:
+		case OPCODE_BLOCK_START:
+		case OPCODE_WHILE_BODY:
+			break;
+		case OPCODE_NOT:
+			forget_variable(o->op_not.to.index);
+			load_eax(RBP, variable_slot(o->op_not.from));
+			EMIT(0x83, 0xf0, 0x01);
+			store_eax(RBP, variable_slot(o->op_not.to));
+			break;
+		case OPCODE_NEGATE: {
+			bool floats = base_type(o->op_negate.from.type.type) == float_id;
+
+			forget_variable(o->op_negate.to.index);
+			for (uint32_t c = 0; c < components(o->op_negate.to.type.type); ++c) {
+				load_eax(RBP, component(o->op_negate.from, c));
+				if (floats) {
+					EMIT(0x35);
+					emit_uint32(0x80000000);
+				}
+				else {
+					EMIT(0xf7, 0xd8);
+				}
+				store_eax(RBP, component(o->op_negate.to, c));
+			}
+			break;
+		}
+		case OPCODE_STORE_VARIABLE:
+			emit_store_variable(o->op_store_var.to, o->op_store_var.from);
+			break;
+		case OPCODE_SUB_AND_STORE_VARIABLE:
+		case OPCODE_ADD_AND_STORE_VARIABLE:
+		case OPCODE_DIVIDE_AND_STORE_VARIABLE:
+		case OPCODE_MULTIPLY_AND_STORE_VARIABLE:
+			emit_binary(compound_operation(o->type), o->op_store_var.to, o->op_store_var.to, o->op_store_var.from);
+			break;
+		case OPCODE_STORE_ACCESS_LIST:
+		case OPCODE_SUB_AND_STORE_ACCESS_LIST:
+		case OPCODE_ADD_AND_STORE_ACCESS_LIST:
+		case OPCODE_DIVIDE_AND_STORE_ACCESS_LIST:
+		case OPCODE_MULTIPLY_AND_STORE_ACCESS_LIST:
+			emit_store_access_list(o->type, o->op_store_access_list.to, o->op_store_access_list.from, o->op_store_access_list.access_list,
+			                       o->op_store_access_list.access_list_size);
+			break;
+		case OPCODE_LOAD_FLOAT_CONSTANT: {
+			uint32_t bits;
+			memcpy(&bits, &o->op_load_float_constant.number, sizeof(bits));
+			forget_variable(o->op_load_float_constant.to.index);
+			store_immediate(RBP, variable_slot(o->op_load_float_constant.to), bits);
+			break;
+		}
+		case OPCODE_LOAD_INT_CONSTANT:
+			forget_variable(o->op_load_int_constant.to.index);
+			store_immediate(RBP, variable_slot(o->op_load_int_constant.to), (uint32_t)o->op_load_int_constant.number);
+			break;
+		case OPCODE_LOAD_BOOL_CONSTANT:
+			forget_variable(o->op_load_bool_constant.to.index);
+			store_immediate(RBP, variable_slot(o->op_load_bool_constant.to), o->op_load_bool_constant.boolean ? 1 : 0);
+			break;
+		case OPCODE_LOAD_ACCESS_LIST:
+			emit_load_access_list(o->op_load_access_list.to, o->op_load_access_list.from, o->op_load_access_list.access_list,
+			                      o->op_load_access_list.access_list_size);
+			break;
+		case OPCODE_RETURN:
+			emit_jump(false, INVOCATION_END);
+			break;
+		case OPCODE_CALL:
+			emit_call(o);
+			break;
+		case OPCODE_MULTIPLY:
+		case OPCODE_DIVIDE:
+		case OPCODE_MOD:
+		case OPCODE_ADD:
+		case OPCODE_SUB:
+		case OPCODE_EQUALS:
+		case OPCODE_NOT_EQUALS:
+		case OPCODE_GREATER:
+		case OPCODE_GREATER_EQUAL:
+		case OPCODE_LESS:
+		case OPCODE_LESS_EQUAL:
+		case OPCODE_AND:
+		case OPCODE_OR:
+		case OPCODE_BITWISE_XOR:
+		case OPCODE_BITWISE_AND:
+		case OPCODE_BITWISE_OR:
+		case OPCODE_LEFT_SHIFT:
+		case OPCODE_RIGHT_SHIFT:
+			emit_binary(o->type, o->op_binary.result, o->op_binary.left, o->op_binary.right);
+			break;
+		case OPCODE_IF:
+			emit_jump_if_false(o->op_if.condition, o->op_if.end_id);
+			break;
+		case OPCODE_WHILE_START:
+			bind_label(o->op_while_start.start_id);
+			break;
+		case OPCODE_WHILE_CONDITION:
+			emit_jump_if_false(o->op_while.condition, o->op_while.end_id);
+			break;
+		case OPCODE_WHILE_END:
+			emit_jump(false, o->op_while_end.start_id);
+			bind_label(o->op_while_end.end_id);
+			break;
+		case OPCODE_BLOCK_END:
+			if (label_pending(o->op_block.end_id)) {
+				bind_label(o->op_block.end_id);
+			}
+			break;
+		case OPCODE_DISCARD:
+			error(context, "discard is not supported by the jit");
+		case OPCODE_ATOMIC:
+			error(context, "Atomics are not supported by the jit");
+		}
+
+		index += o->size;
+	}
+}
+
+typedef struct jit_loop {
+	size_t start;
+	size_t exit;
+} jit_loop;
+
+// Counts from zero to the value in the count slot or to the immediate count when there is no slot
+static jit_loop emit_loop_start(int32_t counter, int32_t count, uint32_t immediate_count) {
+	jit_loop loop;
+
+	store_immediate(RBP, counter, 0);
+
+	loop.start = code_size;
+	forget_xmm();
+
+	load_eax(RBP, counter);
+	if (count != 0) {
+		EMIT_MEMORY(RAX, RBP, count, 0x3b);
+	}
+	else {
+		EMIT(0x3d);
+		emit_uint32(immediate_count);
+	}
+
+	// jae
+	EMIT(0x0f, 0x83);
+	loop.exit = code_size;
+	emit_uint32(0);
+
+	return loop;
+}
+
+static void emit_loop_end(jit_loop loop, int32_t counter) {
+	EMIT_MEMORY(0, RBP, counter, 0xff);
+
+	EMIT(0xe9);
+	emit_uint32(0);
+	patch_rel32(code_size - 4, loop.start);
+
+	patch_rel32(loop.exit, code_size);
+	forget_xmm();
+}
+
+static void emit_constants(function *f) {
+	global_array globals = KONG_INIT_ZERO;
+	find_referenced_globals(f, &globals);
+
+	for (size_t i = 0; i < globals.size; ++i) {
+		global *g = get_global(globals.globals[i]);
+		type   *t = get_type(g->type);
+
+		debug_context context = KONG_INIT_ZERO;
+		check(!g->group_shared, context, "Group shared memory is not supported by the jit");
+		check(t->tex_kind == TEXTURE_KIND_NONE && g->type != sampler_type_id && g->type != bvh_type_id, context, "%s is not supported by the jit",
+		      get_name(g->name));
+
+		if (g->value.kind == GLOBAL_VALUE_NONE) {
+			continue;
+		}
+
+		variable v;
+		v.kind      = VARIABLE_GLOBAL;
+		v.index     = g->var_index;
+		v.type.type = g->type;
+
+		for (uint32_t c = 0; c < components(g->type); ++c) {
+			uint32_t bits;
+			if (g->value.kind == GLOBAL_VALUE_BOOL) {
+				bits = g->value.value.b ? 1 : 0;
+			}
+			else {
+				memcpy(&bits, &g->value.value.uints[c], sizeof(bits));
+			}
+			store_immediate(RBP, component(v, c), bits);
+		}
+	}
+}
+
+static void *make_executable(const uint8_t *bytes, size_t size) {
+	debug_context context = KONG_INIT_ZERO;
+
+#ifdef _WIN32
+	void *memory = VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	check(memory != NULL, context, "Could not allocate jit memory");
+	memcpy(memory, bytes, size);
+	DWORD old_protection;
+	VirtualProtect(memory, size, PAGE_EXECUTE_READ, &old_protection);
+#else
+	void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	check(memory != MAP_FAILED, context, "Could not allocate jit memory");
+	memcpy(memory, bytes, size);
+	mprotect(memory, size, PROT_READ | PROT_EXEC);
+#endif
+
+	return memory;
+}
+
+jit_kernel jit_compile(function *f, api_kind api) {
+	debug_context context = KONG_INIT_ZERO;
+
+#if !defined(__x86_64__) && !defined(_M_X64)
+	error(context, "The jit only emits x86-64 code");
+#endif
+
+	check(has_attribute(&f->attributes, add_name("compute")) && has_attribute(&f->attributes, add_name("cpu")), context,
+	      "The jit compiles #[compute, cpu] functions only");
+	check(kernels_size < sizeof(kernels) / sizeof(kernels[0]), context, "Too many jit kernels");
+
+	attribute *threads_attribute = find_attribute(&f->attributes, add_name("threads"));
+	if (threads_attribute == NULL || threads_attribute->paramters_count != 3) {
+		error(context, "Compute function requires a threads attribute with three parameters");
+	}
+
+	function *functions[256];
+	size_t    functions_size = 0;
+	find_referenced_functions(f, functions, &functions_size);
+	for (size_t i = 0; i < functions_size; ++i) {
+		check(functions[i] == f, context, "Calling %s is not supported by the jit", get_name(functions[i]->name));
+	}
+
+	for (int i = 0; i < 3; ++i) {
+		local_size[i] = (uint32_t)threads_attribute->parameters[i];
+	}
+	layout_api = api;
+
+	uint64_t variables_count = allocated_variables_count();
+	scratch_index            = variables_count + 1;
+	temporary_index          = variables_count + 2;
+	variable_slots           = calloc(variables_count + 3, sizeof(int32_t));
+	check(variable_slots != NULL, context, "Could not allocate jit slots");
+
+	code_size   = 0;
+	frame_size  = COUNTERS_SIZE;
+	labels_size = 0;
+	jumps_size  = 0;
+	forget_xmm();
+
+	// push rbp; mov rbp, rsp
+	EMIT(0x55, 0x48, 0x89, 0xe5);
+
+	// touches every page of big frames on the way down, Windows only commits the stack one guard page at a time
+	EMIT(0xb8);
+	size_t pages_offset = code_size;
+	emit_uint32(0);
+	EMIT(0x85, 0xc0, 0x0f, 0x84);
+	size_t skip_offset = code_size;
+	emit_uint32(0);
+	size_t probe = code_size;
+	EMIT(0x48, 0x81, 0xec, 0x00, 0x10, 0x00, 0x00, 0x83, 0x0c, 0x24, 0x00, 0xff, 0xc8, 0x0f, 0x85);
+	emit_uint32(0);
+	patch_rel32(code_size - 4, probe);
+	patch_rel32(skip_offset, code_size);
+	EMIT(0x48, 0x81, 0xec);
+	size_t remainder_offset = code_size;
+	emit_uint32(0);
+
+#ifdef _WIN32
+	EMIT_MEMORY(RCX, RBP, workgroup_counts[0], 0x89);
+	EMIT_MEMORY(RDX, RBP, workgroup_counts[1], 0x89);
+	EMIT_MEMORY(0, RBP, workgroup_counts[2], 0x44, 0x89);
+#else
+	EMIT_MEMORY(RDI, RBP, workgroup_counts[0], 0x89);
+	EMIT_MEMORY(RSI, RBP, workgroup_counts[1], 0x89);
+	EMIT_MEMORY(RDX, RBP, workgroup_counts[2], 0x89);
+#endif
+
+	emit_constants(f);
+
+	jit_loop loops[6];
+	for (int i = 2; i >= 0; --i) {
+		loops[2 - i] = emit_loop_start(workgroup_indices[i], workgroup_counts[i], 0);
+	}
+	for (int i = 2; i >= 0; --i) {
+		loops[5 - i] = emit_loop_start(local_indices[i], 0, local_size[i]);
+	}
+
+	emit_opcodes(f);
+	bind_label(INVOCATION_END);
+
+	for (int i = 0; i <= 2; ++i) {
+		emit_loop_end(loops[5 - i], local_indices[i]);
+	}
+	for (int i = 0; i <= 2; ++i) {
+		emit_loop_end(loops[2 - i], workgroup_indices[i]);
+	}
+
+	// mov rsp, rbp; pop rbp; ret
+	EMIT(0x48, 0x89, 0xec, 0x5d, 0xc3);
+
+	uint32_t frame = (frame_size + 15) / 16 * 16;
+	patch_uint32(pages_offset, frame / 4096);
+	patch_uint32(remainder_offset, frame % 4096);
+
+	for (size_t i = 0; i < jumps_size; ++i) {
+		size_t label = 0;
+		while (label < labels_size && labels[label].id != jumps[i].id) {
+			++label;
+		}
+		check(label < labels_size, context, "Unresolved jit jump");
+		patch_rel32(jumps[i].offset, labels[label].offset);
+	}
+
+	free(variable_slots);
+	variable_slots = NULL;
+
+	void *memory = make_executable(code, code_size);
+
+	kernels[kernels_size].memory = memory;
+	kernels[kernels_size].size   = code_size;
+	++kernels_size;
+
+	return (jit_kernel)memory;
+}
+
+void jit_set_global(name_id name, void *value) {
+	debug_context context = KONG_INIT_ZERO;
+
+	for (global_id i = 0; get_global(i) != NULL && get_global(i)->type != NO_TYPE; ++i) {
+		if (get_global(i)->name == name) {
+			global_pointers[i] = value;
+			return;
+		}
+	}
+
+	error(context, "Global %s not found", get_name(name));
+}
+
+void jit_release(void) {
+	for (size_t i = 0; i < kernels_size; ++i) {
+#ifdef _WIN32
+		VirtualFree(kernels[i].memory, 0, MEM_RELEASE);
+#else
+		munmap(kernels[i].memory, kernels[i].size);
+#endif
+	}
+	kernels_size = 0;
+
+	free(code);
+	code          = NULL;
+	code_size     = 0;
+	code_capacity = 0;
+}
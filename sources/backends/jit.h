@@ -0,0 +1,30 @@
+#ifndef KONG_JIT_HEADER
+#define KONG_JIT_HEADER
+
+#include "../api.h"
+#include "../functions.h"
+#include "../names.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Same signature as the generated *_on_cpu functions of the cpu backend
+typedef void (*jit_kernel)(uint32_t workgroup_count_x, uint32_t workgroup_count_y, uint32_t workgroup_count_z);
+
+// Lowers a #[compute, cpu] function to x86-64 code in executable memory, api picks the layout of uniform structs
+jit_kernel jit_compile(function *f, api_kind api);
+
+// Counterpart of the generated set_<name> functions, the pointer is read every time a kernel runs
+void jit_set_global(name_id name, void *value);
+
+// Frees the code of every compiled kernel
+void jit_release(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
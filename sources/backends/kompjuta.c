@@ -7,6 +7,7 @@
 #include "../global.h"
 #include "../parser.h"
 #include "../shader_stage.h"
+#include "../stats.h"
 #include "../types.h"
 #include "cstyle.h"
 #include "util.h"
@@ -249,8 +250,10 @@ static void write_globals(char *code, size_t *offset, char *header_code, size_t
 		else if (base_type == bvh_type_id) {
 			*offset += sprintf(&code[*offset], "RaytracingAccelerationStructure  _%" PRIu64 ";\n\n", g->var_index);
 		}
-		else if (base_type == float_id) {
-			*offset += sprintf(&code[*offset], "static const float _%" PRIu64 " = %f;\n\n", g->var_index, g->value.value.floats[0]);
+		else if (global_is_scalar_constant(g)) {
+			*offset += sprintf(&code[*offset], "static const %s _%" PRIu64 " = ", type_string(g->type), g->var_index);
+			write_global_value(code, offset, g);
+			*offset += sprintf(&code[*offset], ";\n\n");
 		}
 		else if (base_type == float2_id) {
 			*offset += sprintf(&code[*offset], "static const kore_float2 _%" PRIu64 " = float2(%f, %f);\n\n", g->var_index, g->value.value.floats[0],
@@ -755,6 +758,9 @@ static void write_functions(char *code, const char *main_name, size_t *offset, s
 				}
 				break;
 			}
+			case OPCODE_ATOMIC:
+				error(context, "Atomics are not supported by Kompjuta");
+				break;
 			default:
 				cstyle_write_opcode(code, offset, o, type_string_simd, &indentation);
 				break;
@@ -913,14 +919,20 @@ void kompjuta_export(char *directory) {
 	}
 
 	for (size_t i = 0; i < vertex_shaders_size; ++i) {
+		stats_begin("kompjuta_export_vertex %s", get_name(vertex_shaders[i]->name));
 		kompjuta_export_vertex(directory, vertex_shaders[i]);
+		stats_end();
 	}
 
 	for (size_t i = 0; i < fragment_shaders_size; ++i) {
+		stats_begin("kompjuta_export_fragment %s", get_name(fragment_shaders[i]->name));
 		kompjuta_export_fragment(directory, fragment_shaders[i]);
+		stats_end();
 	}
 
 	for (size_t i = 0; i < compute_shaders_size; ++i) {
+		stats_begin("kompjuta_export_compute %s", get_name(compute_shaders[i]->name));
 		kompjuta_export_compute(directory, compute_shaders[i]);
+		stats_end();
 	}
 }
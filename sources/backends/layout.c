@@ -0,0 +1,174 @@
+#include "layout.h"
+
+#include "../errors.h"
+#include "../global.h"
+#include "../names.h"
+
+layout_rules api_layout_rules(api_kind api, bool root_constants) {
+	switch (api) {
+	case API_DIRECT3D11:
+	case API_DIRECT3D12:
+		return LAYOUT_RULES_HLSL_CBUFFER;
+	case API_OPENGL:
+		return LAYOUT_RULES_STD140_MEDIUMP;
+	case API_VULKAN:
+		// push constants are not bound to the std140 rules
+		return root_constants ? LAYOUT_RULES_STD430 : LAYOUT_RULES_STD140;
+	case API_METAL:
+		return LAYOUT_RULES_METAL;
+	case API_WEBGPU:
+		return LAYOUT_RULES_WGSL_UNIFORM;
+	default:
+		return LAYOUT_RULES_STD430;
+	}
+}
+
+static uint32_t align_to(uint32_t offset, uint32_t alignment) {
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+bool layout_stores_16bit_types(layout_rules rules) {
+	return rules != LAYOUT_RULES_HLSL_CBUFFER && rules != LAYOUT_RULES_STD140_MEDIUMP;
+}
+
+type_id storage_type(type_id type, layout_rules rules) {
+	if (!is_16bit_type(type) || layout_stores_16bit_types(rules)) {
+		return type;
+	}
+
+	if (type == half2x2_id) {
+		return float2x2_id;
+	}
+	if (type == half3x3_id) {
+		return float3x3_id;
+	}
+	if (type == half4x4_id) {
+		return float4x4_id;
+	}
+
+	type_id base = vector_base_type(type);
+	type_id wide = base == half_id ? float_id : (base == short_id ? int_id : uint_id);
+	return vector_to_size(wide, vector_size(type));
+}
+
+static void member_layout(type_id type, layout_rules rules, uint32_t *size, uint32_t *alignment) {
+	type = storage_type(type, rules);
+
+	// the 16 bit ids alias the 32 bit ones when the 16 bit types fall back
+	bool sixteen_bits = is_16bit_type(type) && is_vector_or_scalar(type);
+
+	if (sixteen_bits && vector_size(type) == 1) {
+		*size      = 2;
+		*alignment = 2;
+	}
+	else if (sixteen_bits && vector_size(type) == 2) {
+		*size      = 4;
+		*alignment = 4;
+	}
+	else if (sixteen_bits && vector_size(type) == 3) {
+		*size      = rules == LAYOUT_RULES_METAL ? 8 : 6;
+		*alignment = 8;
+	}
+	else if (sixteen_bits && vector_size(type) == 4) {
+		*size      = 8;
+		*alignment = 8;
+	}
+	else if (type == float_id || type == int_id || type == uint_id) {
+		*size      = 4;
+		*alignment = 4;
+	}
+	else if (type == float2_id || type == int2_id || type == uint2_id) {
+		*size      = 8;
+		*alignment = rules == LAYOUT_RULES_HLSL_CBUFFER ? 4 : 8;
+	}
+	else if (type == float3_id || type == int3_id || type == uint3_id) {
+		*size      = rules == LAYOUT_RULES_METAL ? 16 : 12;
+		*alignment = rules == LAYOUT_RULES_HLSL_CBUFFER ? 4 : 16;
+	}
+	else if (type == float4_id || type == int4_id || type == uint4_id) {
+		*size      = 16;
+		*alignment = rules == LAYOUT_RULES_HLSL_CBUFFER ? 4 : 16;
+	}
+	else if (type == float3x3_id) {
+		// three columns with a stride of 16, HLSL does not pad the last one
+		*size      = rules == LAYOUT_RULES_HLSL_CBUFFER ? 16 * 2 + 12 : 16 * 3;
+		*alignment = 16;
+	}
+	else if (type == float4x4_id) {
+		*size      = 16 * 4;
+		*alignment = 16;
+	}
+	else if (is_indirect_args(type)) {
+		*size      = 4 * (uint32_t)get_type(type)->members.size;
+		*alignment = 4;
+	}
+	else {
+		debug_context context = KONG_INIT_ZERO;
+		error(context, "Unsupported type %s in a buffer layout", get_name(get_type(type)->name));
+	}
+}
+
+void layout_struct(type_id id, layout_rules rules, struct_layout *layout) {
+	type *t = get_type(id);
+
+	uint32_t offset    = 0;
+	uint32_t alignment = 4;
+
+	for (size_t member_index = 0; member_index < t->members.size; ++member_index) {
+		uint32_t member_size      = 0;
+		uint32_t member_alignment = 0;
+		member_layout(t->members.m[member_index].type.type, rules, &member_size, &member_alignment);
+
+		offset = align_to(offset, member_alignment);
+
+		// HLSL packs members into 16 byte registers and only starts a new one when a member would straddle it
+		if (rules == LAYOUT_RULES_HLSL_CBUFFER && member_size <= 16 && offset % 16 + member_size > 16) {
+			offset = align_to(offset, 16);
+		}
+
+		layout->offsets[member_index] = offset;
+		layout->sizes[member_index]   = member_size;
+
+		offset += member_size;
+		alignment = member_alignment > alignment ? member_alignment : alignment;
+	}
+
+	if (rules == LAYOUT_RULES_HLSL_CBUFFER || rules == LAYOUT_RULES_STD140 || rules == LAYOUT_RULES_STD140_MEDIUMP || rules == LAYOUT_RULES_WGSL_UNIFORM) {
+		alignment = 16;
+	}
+
+	layout->alignment = alignment;
+	layout->size      = align_to(offset, alignment);
+}
+
+uint32_t struct_size(type_id id, layout_rules rules) {
+	static struct_layout layout;
+	layout_struct(id, rules, &layout);
+	return layout.size;
+}
+
+uint32_t array_stride(type_id type, layout_rules rules) {
+	uint32_t size      = 0;
+	uint32_t alignment = 0;
+	member_layout(type, rules, &size, &alignment);
+
+	// every array element starts a new register
+	if (rules == LAYOUT_RULES_HLSL_CBUFFER || rules == LAYOUT_RULES_STD140 || rules == LAYOUT_RULES_STD140_MEDIUMP || rules == LAYOUT_RULES_WGSL_UNIFORM) {
+		alignment = 16;
+	}
+
+	return align_to(size, alignment);
+}
+
+uint32_t c_member_size(type_id type, layout_rules rules) {
+	type = storage_type(type, rules);
+
+	if (type == float3x3_id) {
+		return 4 * 3 * 3;
+	}
+
+	uint32_t size      = 0;
+	uint32_t alignment = 0;
+	member_layout(type, LAYOUT_RULES_STD430, &size, &alignment);
+	return size;
+}
@@ -0,0 +1,50 @@
+#ifndef KONG_LAYOUT_HEADER
+#define KONG_LAYOUT_HEADER
+
+#include "../api.h"
+#include "../types.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum layout_rules {
+	LAYOUT_RULES_HLSL_CBUFFER,
+	LAYOUT_RULES_STD140,
+	LAYOUT_RULES_STD140_MEDIUMP, // std140 for OpenGL where the 16 bit types keep their 32 bit storage
+	LAYOUT_RULES_STD430,
+	LAYOUT_RULES_METAL,
+	LAYOUT_RULES_WGSL_UNIFORM,
+} layout_rules;
+
+typedef struct struct_layout {
+	uint32_t offsets[MAX_MEMBERS];
+	uint32_t sizes[MAX_MEMBERS];
+	uint32_t size;
+	uint32_t alignment;
+} struct_layout;
+
+layout_rules api_layout_rules(api_kind api, bool root_constants);
+
+// min16float and mediump only hint at a lower precision, those rules store 16 bit types like their 32 bit counterparts
+bool layout_stores_16bit_types(layout_rules rules);
+
+type_id storage_type(type_id type, layout_rules rules);
+
+void layout_struct(type_id id, layout_rules rules, struct_layout *layout);
+
+uint32_t struct_size(type_id id, layout_rules rules);
+
+uint32_t array_stride(type_id type, layout_rules rules);
+
+// Size of a member in the structs kong.h declares for the C side
+uint32_t c_member_size(type_id type, layout_rules rules);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -7,6 +7,7 @@
 #include "../global.h"
 #include "../parser.h"
 #include "../shader_stage.h"
+#include "../stats.h"
 #include "../types.h"
 #include "cstyle.h"
 #include "util.h"
@@ -37,7 +38,17 @@ static const char *type_string(type_id type) {
 	return get_name(get_type(type)->name);
 }
 
-static char *function_string(name_id func) {
+static const char *function_string(name_id func) {
+	static const char *wave_functions[][2] = {
+	    {"wave_is_first_lane", "simd_is_first"},          {"wave_all_true", "simd_all"},               {"wave_any_true", "simd_any"},
+	    {"wave_sum", "simd_sum"},                         {"wave_min", "simd_min"},                    {"wave_max", "simd_max"},
+	    {"wave_prefix_sum", "simd_prefix_exclusive_sum"}, {"wave_read_first", "simd_broadcast_first"}, {"wave_read_lane", "simd_shuffle"},
+	};
+	for (size_t wave_function_index = 0; wave_function_index < sizeof(wave_functions) / sizeof(wave_functions[0]); ++wave_function_index) {
+		if (func == add_name(wave_functions[wave_function_index][0])) {
+			return wave_functions[wave_function_index][1];
+		}
+	}
 	return get_name(func);
 }
 
@@ -173,6 +184,30 @@ static void write_types(char *metal, size_t *offset) {
 			*offset += sprintf(&metal[*offset], "};\n\n");
 		}
 	}
+
+	type_id indirect_args[] = {draw_indirect_args_type_id, draw_indexed_indirect_args_type_id, dispatch_indirect_args_type_id};
+
+	for (size_t i = 0; i < sizeof(indirect_args) / sizeof(indirect_args[0]); ++i) {
+		bool used = false;
+		for (global_id g = 0; get_global(g) != NULL; ++g) {
+			if (global_is_buffer(get_global(g)) && get_type(get_global(g)->type)->base == indirect_args[i]) {
+				used = true;
+				break;
+			}
+		}
+
+		if (used) {
+			type *t = get_type(indirect_args[i]);
+
+			*offset += sprintf(&metal[*offset], "struct %s {\n", get_name(t->name));
+
+			for (size_t j = 0; j < t->members.size; ++j) {
+				*offset += sprintf(&metal[*offset], "\t%s %s;\n", type_string(t->members.m[j].type.type), get_name(t->members.m[j].name));
+			}
+
+			*offset += sprintf(&metal[*offset], "};\n\n");
+		}
+	}
 }
 
 static int global_register_indices[512];
@@ -183,6 +218,10 @@ static function_id fragment_functions[256];
 static size_t      fragment_functions_size = 0;
 static function_id compute_functions[256];
 static size_t      compute_functions_size = 0;
+static function_id amplification_functions[256];
+static size_t      amplification_functions_size = 0;
+static function_id mesh_functions[256];
+static size_t      mesh_functions_size = 0;
 
 static bool is_vertex_function(function_id f) {
 	for (size_t i = 0; i < vertex_functions_size; ++i) {
@@ -211,6 +250,90 @@ static bool is_compute_function(function_id f) {
 	return false;
 }
 
+static bool is_amplification_function(function_id f) {
+	for (size_t i = 0; i < amplification_functions_size; ++i) {
+		if (f == amplification_functions[i]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool is_mesh_function(function_id f) {
+	for (size_t i = 0; i < mesh_functions_size; ++i) {
+		if (f == mesh_functions[i]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Only code which never runs outside of fragment functions has the derivatives to pick a mip level implicitly
+static bool runs_in_fragment_functions_only(function_id f) {
+	function_id entries[1024];
+	size_t      entries_size = 0;
+	for (size_t i = 0; i < vertex_functions_size; ++i) {
+		entries[entries_size++] = vertex_functions[i];
+	}
+	for (size_t i = 0; i < compute_functions_size; ++i) {
+		entries[entries_size++] = compute_functions[i];
+	}
+	for (size_t i = 0; i < amplification_functions_size; ++i) {
+		entries[entries_size++] = amplification_functions[i];
+	}
+	for (size_t i = 0; i < mesh_functions_size; ++i) {
+		entries[entries_size++] = mesh_functions[i];
+	}
+
+	for (size_t i = 0; i < entries_size; ++i) {
+		function *functions[256];
+		size_t    functions_size = 0;
+
+		functions[functions_size] = get_function(entries[i]);
+		functions_size += 1;
+
+		find_referenced_functions(get_function(entries[i]), functions, &functions_size);
+
+		for (size_t j = 0; j < functions_size; ++j) {
+			if (functions[j] == get_function(f)) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+// Array layers are passed as a separate parameter
+static void texture_coords(char *coords, variable tex, variable coord) {
+	if (get_type(tex.type.type)->tex_kind == TEXTURE_KIND_2D_ARRAY) {
+		sprintf(coords, "_%" PRIu64 ".xy, uint(_%" PRIu64 ".z)", coord.index, coord.index);
+	}
+	else {
+		sprintf(coords, "_%" PRIu64, coord.index);
+	}
+}
+
+// The integer formats are the ones atomics can work on
+static bool is_integer_texture(type_id t) {
+	return get_type(t)->tex_format == TEXTURE_FORMAT_R32_UINT || get_type(t)->tex_format == TEXTURE_FORMAT_R32_SINT;
+}
+
+static const char *atomic_function_name(name_id func) {
+	static const char *atomic_functions[][2] = {
+	    {"atomic_add", "atomic_fetch_add"}, {"atomic_min", "atomic_fetch_min"}, {"atomic_max", "atomic_fetch_max"},
+	    {"atomic_and", "atomic_fetch_and"}, {"atomic_or", "atomic_fetch_or"},   {"atomic_xor", "atomic_fetch_xor"},
+	    {"atomic_exchange", "atomic_exchange"},
+	};
+	for (size_t atomic_function_index = 0; atomic_function_index < sizeof(atomic_functions) / sizeof(atomic_functions[0]); ++atomic_function_index) {
+		if (func == add_name(atomic_functions[atomic_function_index][0])) {
+			return atomic_functions[atomic_function_index][1];
+		}
+	}
+	assert(false);
+	return NULL;
+}
+
 static void write_argument_buffers(char *code, size_t *offset) {
 	for (size_t set_index = 0; set_index < get_sets_count(); ++set_index) {
 		descriptor_set *set = get_set(set_index);
@@ -240,19 +363,28 @@ static void write_argument_buffers(char *code, size_t *offset) {
 				}
 			}
 			else if (is_texture(g->type)) {
+				// sample_compare is only available for depth textures
+				bool compare = (g->usage & GLOBAL_USAGE_SAMPLE_COMPARE) != 0;
 				if (get_type(g->type)->tex_kind == TEXTURE_KIND_2D) {
-					if (writable) {
+					if (is_integer_texture(g->type) && (writable || global_has_usage(g_id, GLOBAL_USAGE_ATOMIC))) {
+						*offset += sprintf(&code[*offset], "\ttexture2d<%s, access::read_write> _%" PRIu64 " [[id(%zu)]];\n",
+						                   get_type(g->type)->tex_format == TEXTURE_FORMAT_R32_UINT ? "uint" : "int", g->var_index, global_index);
+					}
+					else if (writable) {
 						*offset += sprintf(&code[*offset], "\ttexture2d<float, access::write> _%" PRIu64 " [[id(%zu)]];\n", g->var_index, global_index);
 					}
 					else {
-						*offset += sprintf(&code[*offset], "\ttexture2d<float> _%" PRIu64 " [[id(%zu)]];\n", g->var_index, global_index);
+						*offset += sprintf(&code[*offset], "\t%s<float> _%" PRIu64 " [[id(%zu)]];\n", compare ? "depth2d" : "texture2d", g->var_index,
+						                   global_index);
 					}
 				}
 				else if (get_type(g->type)->tex_kind == TEXTURE_KIND_2D_ARRAY) {
-					*offset += sprintf(&code[*offset], "\ttexture2d_array<float> _%" PRIu64 " [[id(%zu)]];\n", g->var_index, global_index);
+					*offset += sprintf(&code[*offset], "\t%s<float> _%" PRIu64 " [[id(%zu)]];\n", compare ? "depth2d_array" : "texture2d_array", g->var_index,
+					                   global_index);
 				}
 				else if (get_type(g->type)->tex_kind == TEXTURE_KIND_CUBE) {
-					*offset += sprintf(&code[*offset], "\ttexturecube<float> _%" PRIu64 " [[id(%zu)]];\n", g->var_index, global_index);
+					*offset += sprintf(&code[*offset], "\t%s<float> _%" PRIu64 " [[id(%zu)]];\n", compare ? "depthcube" : "texturecube", g->var_index,
+					                   global_index);
 				}
 				else {
 					// TODO
@@ -287,8 +419,25 @@ static void write_globals(char *code, size_t *offset) {
 		type   *t         = get_type(g->type);
 		type_id base_type = t->array_size > 0 ? t->base : g->type;
 
-		if (base_type == float_id) {
-			*offset += sprintf(&code[*offset], "constant float _%" PRIu64 " = %f;\n\n", g->var_index, g->value.value.floats[0]);
+		if (g->group_shared) {
+			// declared in the kernel and passed on to other functions
+			continue;
+		}
+
+		if (g->specialization) {
+			// unset function constants fall back to the declared value
+			*offset += sprintf(&code[*offset], "constant %s _%" PRIu64 "_specialized [[function_constant(%u)]];\n", type_string(g->type), g->var_index,
+			                   g->specialization_id);
+			*offset += sprintf(&code[*offset], "constant %s _%" PRIu64 " = is_function_constant_defined(_%" PRIu64 "_specialized) ? ", type_string(g->type),
+			                   g->var_index, g->var_index);
+			*offset += sprintf(&code[*offset], "_%" PRIu64 "_specialized : ", g->var_index);
+			write_global_value(code, offset, g);
+			*offset += sprintf(&code[*offset], ";\n\n");
+		}
+		else if (global_is_scalar_constant(g)) {
+			*offset += sprintf(&code[*offset], "constant %s _%" PRIu64 " = ", type_string(g->type), g->var_index);
+			write_global_value(code, offset, g);
+			*offset += sprintf(&code[*offset], ";\n\n");
 		}
 		else if (base_type == float2_id) {
 			*offset +=
@@ -305,17 +454,64 @@ static void write_globals(char *code, size_t *offset) {
 	}
 }
 
-static bool var_name(variable var, char *output_name) {
-	global *g = NULL;
+static void write_group_shared_parameters(char *code, size_t *offset, function *f, bool declaration) {
+	global_array globals = KONG_INIT_ZERO;
+	find_referenced_globals(f, &globals);
 
+	for (size_t global_index = 0; global_index < globals.size; ++global_index) {
+		global *g = get_global(globals.globals[global_index]);
+		if (!g->group_shared) {
+			continue;
+		}
+
+		if (declaration) {
+			*offset += sprintf(&code[*offset], ", threadgroup %s *_%" PRIu64, type_string(get_type(g->type)->base), g->var_index);
+		}
+		else {
+			*offset += sprintf(&code[*offset], ", _%" PRIu64, g->var_index);
+		}
+	}
+}
+
+// The thread position built-ins of compute, object and mesh functions
+static void write_thread_parameters(char *code, size_t *offset, function *f) {
+	*offset += sprintf(&code[*offset], "uint3 _kong_group_thread_id [[thread_position_in_threadgroup]], uint3 _kong_group_id [[threadgroup_position_in_grid]], "
+	                                   "uint _kong_group_index [[thread_index_in_threadgroup]], uint3 _kong_dispatch_thread_id [[thread_position_in_grid]]");
+	find_used_builtins(f);
+	if (f->used_builtins.wave_lane_index) {
+		*offset += sprintf(&code[*offset], ", uint _kong_wave_lane_index [[thread_index_in_simdgroup]]");
+	}
+	if (f->used_builtins.wave_lane_count) {
+		*offset += sprintf(&code[*offset], ", uint _kong_wave_lane_count [[threads_per_simdgroup]]");
+	}
+}
+
+static void write_group_shared_declarations(char *code, size_t *offset, function *f) {
+	global_array globals = KONG_INIT_ZERO;
+	find_referenced_globals(f, &globals);
+
+	for (size_t global_index = 0; global_index < globals.size; ++global_index) {
+		global *g = get_global(globals.globals[global_index]);
+		if (g->group_shared) {
+			type *t = get_type(g->type);
+			*offset += sprintf(&code[*offset], "\tthreadgroup %s _%" PRIu64 "[%u];\n", type_string(t->base), g->var_index, t->array_size);
+		}
+	}
+}
+
+static global *find_global_by_var_index(uint64_t var_index) {
 	for (global_id j = 0; get_global(j) != NULL && get_global(j)->type != NO_TYPE; ++j) {
-		if (get_global(j)->var_index == var.index) {
-			g = get_global(j);
-			break;
+		if (get_global(j)->var_index == var_index) {
+			return get_global(j);
 		}
 	}
+	return NULL;
+}
+
+static bool var_name(variable var, char *output_name) {
+	global *g = find_global_by_var_index(var.index);
 
-	if (g == NULL || has_attribute(&g->attributes, add_name("indexed"))) {
+	if (g == NULL || g->group_shared || has_attribute(&g->attributes, add_name("indexed"))) {
 		sprintf(output_name, "_%" PRIu64, var.index);
 	}
 	else if (g->sets[0]->name == add_name("root_constants")) {
@@ -359,7 +555,7 @@ static void write_functions(char *code, size_t *offset) {
 
 		size_t buffer_index = f->parameters_size;
 
-		if (is_vertex_function(i) || is_fragment_function(i) || is_compute_function(i)) {
+		if (is_vertex_function(i) || is_fragment_function(i) || is_compute_function(i) || is_amplification_function(i) || is_mesh_function(i)) {
 			size_t buffers_offset = 0;
 
 			descriptor_set_group *set_group = get_descriptor_set_group(f->descriptor_set_group_index);
@@ -403,6 +599,12 @@ static void write_functions(char *code, size_t *offset) {
 			}
 		}
 
+		if (is_vertex_function(i) || is_fragment_function(i)) {
+			find_used_builtins(f);
+			check(!f->used_builtins.wave_lane_index && !f->used_builtins.wave_lane_count, context,
+			      "wave_lane_index and wave_lane_count are only supported in compute shaders in Metal");
+		}
+
 		if (is_vertex_function(i)) {
 			*offset += sprintf(&code[*offset], "vertex %s %s(_kong_%s_attributes _kong_stage_in [[stage_in]]", type_string(f->return_type.type),
 			                   get_name(f->name), get_name(f->name));
@@ -434,15 +636,46 @@ static void write_functions(char *code, size_t *offset) {
 			}
 		}
 		else if (is_compute_function(i)) {
-			*offset +=
-			    sprintf(&code[*offset],
-			            "kernel void %s(uint3 _kong_group_thread_id [[thread_position_in_threadgroup]], uint3 _kong_group_id [[threadgroup_position_in_grid]], "
-			            "uint _kong_group_index [[thread_index_in_threadgroup]], uint3 _kong_dispatch_thread_id [[thread_position_in_grid]]",
-			            get_name(f->name));
+			*offset += sprintf(&code[*offset], "kernel void %s(", get_name(f->name));
+			write_thread_parameters(code, offset, f);
 			for (uint8_t parameter_index = 1; parameter_index < f->parameters_size; ++parameter_index) {
 				*offset += sprintf(&code[*offset], ", %s _%" PRIu64, type_string(f->parameter_types[0].type), parameter_ids[0]);
 			}
 			*offset += sprintf(&code[*offset], "%s) {\n", buffers);
+
+			write_group_shared_declarations(code, offset, f);
+		}
+		else if (is_amplification_function(i)) {
+			check(f->parameters_size == 0, context, "Amplification functions can not have parameters");
+
+			type_id payload_type = find_mesh_payload_type(f);
+			check(payload_type != NO_TYPE, context, "Amplification functions have to end with a call to dispatch_mesh");
+
+			*offset += sprintf(&code[*offset], "[[object]] void %s(object_data %s& _kong_payload [[payload]], mesh_grid_properties _kong_mesh_grid, ",
+			                   get_name(f->name), type_string(payload_type));
+			write_thread_parameters(code, offset, f);
+			*offset += sprintf(&code[*offset], "%s) {\n", buffers);
+
+			write_group_shared_declarations(code, offset, f);
+		}
+		else if (is_mesh_function(i)) {
+			check(f->parameters_size <= 1, context, "Mesh functions can only take the amplification payload as a parameter");
+
+			attribute *vertices_attribute = find_attribute(&f->attributes, add_name("vertices"));
+			attribute *tris_attribute     = find_attribute(&f->attributes, add_name("tris"));
+			check(tris_attribute != NULL && tris_attribute->paramters_count == 1, context, "Mesh function requires a tris attribute with one parameter");
+
+			*offset += sprintf(&code[*offset], "[[mesh]] void %s(metal::mesh<%s, void, %u, %u, metal::topology::triangle> _kong_mesh, ", get_name(f->name),
+			                   type_string((type_id)vertices_attribute->parameters[1]), (uint32_t)vertices_attribute->parameters[0],
+			                   (uint32_t)tris_attribute->parameters[0]);
+			if (f->parameters_size > 0) {
+				*offset +=
+				    sprintf(&code[*offset], "const object_data %s& _%" PRIu64 " [[payload]], ", type_string(f->parameter_types[0].type), parameter_ids[0]);
+			}
+			write_thread_parameters(code, offset, f);
+			*offset += sprintf(&code[*offset], "%s) {\n", buffers);
+
+			write_group_shared_declarations(code, offset, f);
 		}
 		else {
 			descriptor_set_group *set_group = get_descriptor_set_group(0);
@@ -453,6 +686,7 @@ static void write_functions(char *code, size_t *offset) {
 			for (uint8_t parameter_index = 0; parameter_index < f->parameters_size; ++parameter_index) {
 				*offset += sprintf(&code[*offset], ", %s _%" PRIu64, type_string(f->parameter_types[parameter_index].type), parameter_ids[parameter_index]);
 			}
+			write_group_shared_parameters(code, offset, f, true);
 			*offset += sprintf(&code[*offset], ") {\n");
 		}
 
@@ -488,7 +722,8 @@ static void write_functions(char *code, size_t *offset) {
 						}
 
 						if (is_texture(o->op_load_access_list.from.type.type) && i == 0) {
-							*offset += sprintf(&code[*offset], ".read(_%" PRIu64 ")", o->op_load_access_list.access_list[i].access_element.index.index);
+							*offset += sprintf(&code[*offset], ".read(_%" PRIu64 ")%s", o->op_load_access_list.access_list[i].access_element.index.index,
+							                   is_integer_texture(o->op_load_access_list.from.type.type) ? ".x" : "");
 						}
 						else {
 							*offset += sprintf(&code[*offset], "[_%" PRIu64 "]", o->op_load_access_list.access_list[i].access_element.index.index);
@@ -653,6 +888,15 @@ static void write_functions(char *code, size_t *offset) {
 			case OPCODE_CALL: {
 				debug_context context = KONG_INIT_ZERO;
 
+				if (is_texture_function(o->op_call.func) && o->op_call.func != add_name("sample_compare")) {
+					// depth textures which are used for comparisons are declared as depth2d, depth2d_array or depthcube
+					global *texture = find_global_by_var_index(o->op_call.parameters[0].index);
+					if (texture != NULL) {
+						check((texture->usage & GLOBAL_USAGE_SAMPLE_COMPARE) == 0, context, "Texture %s is used by sample_compare and by %s",
+						      get_name(texture->name), get_name(o->op_call.func));
+					}
+				}
+
 				indent(code, offset, indentation);
 
 				if (o->op_call.func == add_name("sample")) {
@@ -691,6 +935,88 @@ static void write_functions(char *code, size_t *offset) {
 					            type_string(o->op_call.var.type.type), o->op_call.var.index, o->op_call.parameters[0].index, o->op_call.parameters[1].index,
 					            o->op_call.parameters[2].index, o->op_call.parameters[3].index);
 				}
+				else if (o->op_call.func == add_name("load")) {
+					check(o->op_call.parameters_size == 3, context, "load requires three parameters");
+
+					variable tex   = o->op_call.parameters[0];
+					variable coord = o->op_call.parameters[1];
+
+					texture_kind kind = get_type(tex.type.type)->tex_kind;
+					check(kind != TEXTURE_KIND_CUBE, context, "load does not support cube textures");
+
+					const char *component = o->op_call.var.type.type == float_id ? ".r" : "";
+
+					if (kind == TEXTURE_KIND_2D_ARRAY) {
+						*offset += sprintf(&code[*offset],
+						                   "%s _%" PRIu64 " = argument_buffer0._%" PRIu64 ".read(uint2(_%" PRIu64 ".xy), uint(_%" PRIu64
+						                   ".z), uint(_%" PRIu64 "))%s;\n",
+						                   type_string(o->op_call.var.type.type), o->op_call.var.index, tex.index, coord.index, coord.index,
+						                   o->op_call.parameters[2].index, component);
+					}
+					else {
+						*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = argument_buffer0._%" PRIu64 ".read(uint2(_%" PRIu64 "), uint(_%" PRIu64 "))%s;\n",
+						                   type_string(o->op_call.var.type.type), o->op_call.var.index, tex.index, coord.index, o->op_call.parameters[2].index,
+						                   component);
+					}
+				}
+				else if (is_gather_function(o->op_call.func)) {
+					static const char *components[] = {"x", "y", "z", "w"};
+					check(o->op_call.parameters_size == 3, context, "%s requires three parameters", get_name(o->op_call.func));
+
+					variable tex = o->op_call.parameters[0];
+
+					char coords[256];
+					texture_coords(coords, tex, o->op_call.parameters[2]);
+
+					// cube textures have no offset parameter
+					const char *texel_offset = get_type(tex.type.type)->tex_kind == TEXTURE_KIND_CUBE ? "" : ", int2(0)";
+
+					*offset += sprintf(&code[*offset],
+					                   "%s _%" PRIu64 " = argument_buffer0._%" PRIu64 ".gather(argument_buffer0._%" PRIu64 ", %s%s, component::%s);\n",
+					                   type_string(o->op_call.var.type.type), o->op_call.var.index, tex.index, o->op_call.parameters[1].index, coords,
+					                   texel_offset, components[gather_component(o->op_call.func)]);
+				}
+				else if (o->op_call.func == add_name("sample_grad")) {
+					check(o->op_call.parameters_size == 5, context, "sample_grad requires five parameters");
+
+					variable tex = o->op_call.parameters[0];
+
+					char coords[256];
+					texture_coords(coords, tex, o->op_call.parameters[2]);
+
+					*offset += sprintf(&code[*offset],
+					                   "%s _%" PRIu64 " = argument_buffer0._%" PRIu64 ".sample(argument_buffer0._%" PRIu64 ", %s, %s(_%" PRIu64 ", _%" PRIu64
+					                   "))%s;\n",
+					                   type_string(o->op_call.var.type.type), o->op_call.var.index, tex.index, o->op_call.parameters[1].index, coords,
+					                   get_type(tex.type.type)->tex_kind == TEXTURE_KIND_CUBE ? "gradientcube" : "gradient2d", o->op_call.parameters[3].index,
+					                   o->op_call.parameters[4].index, o->op_call.var.type.type == float_id ? ".r" : "");
+				}
+				else if (o->op_call.func == add_name("sample_bias")) {
+					check(o->op_call.parameters_size == 4, context, "sample_bias requires four parameters");
+
+					variable tex = o->op_call.parameters[0];
+
+					char coords[256];
+					texture_coords(coords, tex, o->op_call.parameters[2]);
+
+					*offset += sprintf(&code[*offset],
+					                   "%s _%" PRIu64 " = argument_buffer0._%" PRIu64 ".sample(argument_buffer0._%" PRIu64 ", %s, bias(_%" PRIu64 "))%s;\n",
+					                   type_string(o->op_call.var.type.type), o->op_call.var.index, tex.index, o->op_call.parameters[1].index, coords,
+					                   o->op_call.parameters[3].index, o->op_call.var.type.type == float_id ? ".r" : "");
+				}
+				else if (o->op_call.func == add_name("sample_compare")) {
+					check(o->op_call.parameters_size == 4, context, "sample_compare requires four parameters");
+
+					variable tex = o->op_call.parameters[0];
+
+					char coords[256];
+					texture_coords(coords, tex, o->op_call.parameters[2]);
+
+					*offset += sprintf(&code[*offset],
+					                   "%s _%" PRIu64 " = argument_buffer0._%" PRIu64 ".sample_compare(argument_buffer0._%" PRIu64 ", %s, _%" PRIu64 "%s);\n",
+					                   type_string(o->op_call.var.type.type), o->op_call.var.index, tex.index, o->op_call.parameters[1].index, coords,
+					                   o->op_call.parameters[3].index, runs_in_fragment_functions_only(i) ? "" : ", level(0)");
+				}
 				else if (o->op_call.func == add_name("group_id")) {
 					check(o->op_call.parameters_size == 0, context, "group_id can not have a parameter");
 					*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = _kong_group_id;\n", type_string(o->op_call.var.type.type), o->op_call.var.index);
@@ -713,6 +1039,57 @@ static void write_functions(char *code, size_t *offset) {
 					check(o->op_call.parameters_size == 0, context, "vertex_id can not have a parameter");
 					*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = _kong_vertex_id;\n", type_string(o->op_call.var.type.type), o->op_call.var.index);
 				}
+				else if (o->op_call.func == add_name("wave_lane_index")) {
+					check(o->op_call.parameters_size == 0, context, "wave_lane_index can not have a parameter");
+					*offset +=
+					    sprintf(&code[*offset], "%s _%" PRIu64 " = _kong_wave_lane_index;\n", type_string(o->op_call.var.type.type), o->op_call.var.index);
+				}
+				else if (o->op_call.func == add_name("wave_lane_count")) {
+					check(o->op_call.parameters_size == 0, context, "wave_lane_count can not have a parameter");
+					*offset +=
+					    sprintf(&code[*offset], "%s _%" PRIu64 " = _kong_wave_lane_count;\n", type_string(o->op_call.var.type.type), o->op_call.var.index);
+				}
+				else if (o->op_call.func == add_name("wave_ballot")) {
+					check(o->op_call.parameters_size == 1, context, "wave_ballot requires one parameter");
+					*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = uint4(as_type<uint2>((simd_vote::vote_t)simd_ballot(_%" PRIu64 ")), 0, 0);\n",
+					                   type_string(o->op_call.var.type.type), o->op_call.var.index, o->op_call.parameters[0].index);
+				}
+				else if (o->op_call.func == add_name("wave_count_bits")) {
+					check(o->op_call.parameters_size == 1, context, "wave_count_bits requires one parameter");
+					*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = (uint)popcount((simd_vote::vote_t)simd_ballot(_%" PRIu64 "));\n",
+					                   type_string(o->op_call.var.type.type), o->op_call.var.index, o->op_call.parameters[0].index);
+				}
+				else if (o->op_call.func == add_name("dispatch_mesh")) {
+					check(o->op_call.parameters_size == 4, context, "dispatch_mesh requires four parameters");
+					check(is_amplification_function(i), context, "dispatch_mesh can only be called directly in an amplification function");
+					*offset += sprintf(&code[*offset], "_kong_payload = _%" PRIu64 ";\n", o->op_call.parameters[3].index);
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "_kong_mesh_grid.set_threadgroups_per_grid(uint3(_%" PRIu64 ", _%" PRIu64 ", _%" PRIu64 "));\n",
+					                   o->op_call.parameters[0].index, o->op_call.parameters[1].index, o->op_call.parameters[2].index);
+				}
+				else if (o->op_call.func == add_name("set_mesh_output_counts")) {
+					check(o->op_call.parameters_size == 2, context, "set_mesh_output_counts requires two parameters");
+					check(is_mesh_function(i), context, "set_mesh_output_counts can only be called directly in a mesh function");
+					// Metal only takes the primitive count, the vertex count is implied by the vertices which are written
+					*offset += sprintf(&code[*offset], "_kong_mesh.set_primitive_count(_%" PRIu64 ");\n", o->op_call.parameters[1].index);
+				}
+				else if (o->op_call.func == add_name("set_mesh_triangle")) {
+					check(o->op_call.parameters_size == 2, context, "set_mesh_triangle requires two parameters");
+					check(is_mesh_function(i), context, "set_mesh_triangle can only be called directly in a mesh function");
+					for (int component = 0; component < 3; ++component) {
+						if (component > 0) {
+							indent(code, offset, indentation);
+						}
+						*offset += sprintf(&code[*offset], "_kong_mesh.set_index(_%" PRIu64 " * 3 + %i, _%" PRIu64 ".%c);\n", o->op_call.parameters[0].index,
+						                   component, o->op_call.parameters[1].index, "xyz"[component]);
+					}
+				}
+				else if (o->op_call.func == add_name("set_mesh_vertex")) {
+					check(o->op_call.parameters_size == 2, context, "set_mesh_vertex requires two parameters");
+					check(is_mesh_function(i), context, "set_mesh_vertex can only be called directly in a mesh function");
+					*offset += sprintf(&code[*offset], "_kong_mesh.set_vertex(_%" PRIu64 ", _%" PRIu64 ");\n", o->op_call.parameters[0].index,
+					                   o->op_call.parameters[1].index);
+				}
 				else if (o->op_call.func == add_name("lerp")) {
 					*offset +=
 					    sprintf(&code[*offset], "%s _%" PRIu64 " = mix(_%" PRIu64 ", _%" PRIu64 ", _%" PRIu64 ");\n", type_string(o->op_call.var.type.type),
@@ -730,20 +1107,33 @@ static void write_functions(char *code, size_t *offset) {
 					*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = dfdy(_%" PRIu64 ");\n", type_string(o->op_call.var.type.type), o->op_call.var.index,
 					                   o->op_call.parameters[0].index);
 				}
+				else if (o->op_call.func == add_name("group_barrier") || o->op_call.func == add_name("group_memory_barrier")) {
+					check(o->op_call.parameters_size == 0, context, "%s can not have a parameter", get_name(o->op_call.func));
+					*offset += sprintf(&code[*offset], "threadgroup_barrier(mem_flags::mem_threadgroup);\n");
+				}
+				else if (o->op_call.func == add_name("device_barrier") || o->op_call.func == add_name("device_memory_barrier")) {
+					check(o->op_call.parameters_size == 0, context, "%s can not have a parameter", get_name(o->op_call.func));
+					*offset += sprintf(&code[*offset], "threadgroup_barrier(mem_flags::mem_device);\n");
+				}
 				else {
-					*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = %s(", type_string(o->op_call.var.type.type), o->op_call.var.index,
-					                   function_string(o->op_call.func));
+					if (o->op_call.var.type.type == void_id) {
+						*offset += sprintf(&code[*offset], "%s(", function_string(o->op_call.func));
+					}
+					else {
+						*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = %s(", type_string(o->op_call.var.type.type), o->op_call.var.index,
+						                   function_string(o->op_call.func));
+					}
 
-					bool is_built_in = true;
+					function *called = NULL;
 					for (function_id i = 0; get_function(i) != NULL; ++i) {
 						function *f = get_function(i);
 						if (o->op_call.func == f->name && f->block != NULL) {
-							is_built_in = false;
+							called = f;
 							break;
 						}
 					}
 
-					if (!is_built_in) {
+					if (called != NULL) {
 						*offset += sprintf(&code[*offset], "argument_buffer0");
 						if (o->op_call.parameters_size > 0) {
 							*offset += sprintf(&code[*offset], ", ");
@@ -756,10 +1146,77 @@ static void write_functions(char *code, size_t *offset) {
 							*offset += sprintf(&code[*offset], ", _%" PRIu64, o->op_call.parameters[i].index);
 						}
 					}
+
+					if (called != NULL) {
+						write_group_shared_parameters(code, offset, called, false);
+					}
+
 					*offset += sprintf(&code[*offset], ");\n");
 				}
 				break;
 			}
+			case OPCODE_ATOMIC: {
+				char to_name[256];
+				var_name(o->op_atomic.to, to_name);
+
+				const char *element_type = type_string(o->op_atomic.var.type.type);
+				uint64_t    result       = o->op_atomic.var.index;
+				uint64_t    element      = o->op_atomic.index.index;
+				uint64_t    value        = o->op_atomic.values[0].index;
+
+				if (is_texture(o->op_atomic.to.type.type)) {
+					if (o->op_atomic.func == add_name("atomic_compare_exchange")) {
+						uint64_t desired = o->op_atomic.values[1].index;
+
+						// only the weak version exists, a spurious failure leaves the expected value untouched
+						indent(code, offset, indentation);
+						*offset += sprintf(&code[*offset], "%s4 _%" PRIu64 "_expected;\n", element_type, result);
+						indent(code, offset, indentation);
+						*offset += sprintf(&code[*offset],
+						                   "do { _%" PRIu64 "_expected = %s4(_%" PRIu64 "); } while (!%s.atomic_compare_exchange_weak(_%" PRIu64 ", &_%" PRIu64
+						                   "_expected, %s4(_%" PRIu64 ")) && _%" PRIu64 "_expected.x == _%" PRIu64 ");\n",
+						                   result, element_type, value, to_name, element, result, element_type, desired, result, value);
+						indent(code, offset, indentation);
+						*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = _%" PRIu64 "_expected.x;\n", element_type, result, result);
+					}
+					else {
+						indent(code, offset, indentation);
+						*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = %s.%s(_%" PRIu64 ", _%" PRIu64 ").x;\n", element_type, result, to_name,
+						                   atomic_function_name(o->op_atomic.func), element, value);
+					}
+				}
+				else {
+					global *g = NULL;
+					for (global_id j = 0; get_global(j) != NULL && get_global(j)->type != NO_TYPE; ++j) {
+						if (o->op_atomic.to.index == get_global(j)->var_index) {
+							g = get_global(j);
+							break;
+						}
+					}
+					assert(g != NULL);
+
+					char pointer[512];
+					sprintf(pointer, "(%s atomic_%s *)&%s[_%" PRIu64 "]", g->group_shared ? "threadgroup" : "device", element_type, to_name, element);
+
+					if (o->op_atomic.func == add_name("atomic_compare_exchange")) {
+						uint64_t desired = o->op_atomic.values[1].index;
+
+						indent(code, offset, indentation);
+						*offset += sprintf(&code[*offset], "%s _%" PRIu64 ";\n", element_type, result);
+						indent(code, offset, indentation);
+						*offset += sprintf(&code[*offset],
+						                   "do { _%" PRIu64 " = _%" PRIu64 "; } while (!atomic_compare_exchange_weak_explicit(%s, &_%" PRIu64 ", _%" PRIu64
+						                   ", memory_order_relaxed, memory_order_relaxed) && _%" PRIu64 " == _%" PRIu64 ");\n",
+						                   result, value, pointer, result, desired, result, value);
+					}
+					else {
+						indent(code, offset, indentation);
+						*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = %s_explicit(%s, _%" PRIu64 ", memory_order_relaxed);\n", element_type, result,
+						                   atomic_function_name(o->op_atomic.func), pointer, value);
+					}
+				}
+				break;
+			}
 			case OPCODE_MOD: {
 				indent(code, offset, indentation);
 				*offset += sprintf(&code[*offset], "%s _%" PRIu64 " = fmod(_%" PRIu64 ", _%" PRIu64 ");\n", type_string(o->op_binary.result.type.type),
@@ -831,20 +1288,28 @@ void metal_export(char *directory) {
 	for (type_id i = 0; get_type(i) != NULL; ++i) {
 		type *t = get_type(i);
 		if (!t->built_in && has_attribute(&t->attributes, add_name("pipe"))) {
-			name_id vertex_shader_name   = NO_NAME;
-			name_id fragment_shader_name = NO_NAME;
+			name_id vertex_shader_name        = NO_NAME;
+			name_id amplification_shader_name = NO_NAME;
+			name_id mesh_shader_name          = NO_NAME;
+			name_id fragment_shader_name      = NO_NAME;
 
 			for (size_t j = 0; j < t->members.size; ++j) {
 				if (t->members.m[j].name == add_name("vertex")) {
 					vertex_shader_name = t->members.m[j].value.identifier;
 				}
+				else if (t->members.m[j].name == add_name("amplification")) {
+					amplification_shader_name = t->members.m[j].value.identifier;
+				}
+				else if (t->members.m[j].name == add_name("mesh")) {
+					mesh_shader_name = t->members.m[j].value.identifier;
+				}
 				else if (t->members.m[j].name == add_name("fragment")) {
 					fragment_shader_name = t->members.m[j].value.identifier;
 				}
 			}
 
 			debug_context context = KONG_INIT_ZERO;
-			check(vertex_shader_name != NO_NAME, context, "vertex shader missing");
+			check(vertex_shader_name != NO_NAME || mesh_shader_name != NO_NAME, context, "vertex or mesh shader missing");
 			check(fragment_shader_name != NO_NAME, context, "fragment shader missing");
 
 			for (function_id i = 0; get_function(i) != NULL; ++i) {
@@ -858,6 +1323,22 @@ void metal_export(char *directory) {
 						vertex_inputs_size += 1;
 					}
 				}
+				else if (amplification_shader_name != NO_NAME && f->name == amplification_shader_name) {
+					amplification_functions[amplification_functions_size] = i;
+					amplification_functions_size += 1;
+				}
+				else if (mesh_shader_name != NO_NAME && f->name == mesh_shader_name) {
+					mesh_functions[mesh_functions_size] = i;
+					mesh_functions_size += 1;
+
+					attribute *vertices_attribute = find_attribute(&f->attributes, add_name("vertices"));
+					check(vertices_attribute != NULL && vertices_attribute->paramters_count == 2, context,
+					      "Mesh function requires a vertices attribute with two parameters");
+
+					// the vertices are passed on to the rasterizer like the outputs of a vertex function
+					fragment_inputs[fragment_inputs_size] = (type_id)vertices_attribute->parameters[1];
+					fragment_inputs_size += 1;
+				}
 				else if (f->name == fragment_shader_name) {
 					fragment_functions[fragment_functions_size] = i;
 					fragment_functions_size += 1;
@@ -878,5 +1359,7 @@ void metal_export(char *directory) {
 		}
 	}
 
+	stats_begin("metal_export_everything");
 	metal_export_everything(directory);
+	stats_end();
 }
@@ -8,11 +8,15 @@
 #include "../hashmap.h"
 #include "../log.h"
 #include "../parser.h"
+#include "../permutations.h"
 #include "../shader_stage.h"
+#include "../stats.h"
 #include "../types.h"
 
 #include "../libs/stb_ds.h"
 
+#include "blobs.h"
+#include "layout.h"
 #include "util.h"
 
 #include <stdbool.h>
@@ -108,19 +112,44 @@ static void write_bytecode(char *directory, const char *filename, const char *na
 		FILE *file = fopen(full_filename, "wb");
 		fprintf(file, "#include \"%s.h\"\n\n", filename);
 
-		fprintf(file, "uint8_t *%s = \"", name);
-		write_buffer(file, output_header, output_header_size);
-		write_buffer(file, output_decorations, output_decorations_size);
-		write_buffer(file, output_base_types, output_base_types_size);
-		write_buffer(file, output_constants, output_constants_size);
-		write_buffer(file, output_aggregate_types, output_aggregate_types_size);
-		write_buffer(file, output_global_vars, output_global_vars_size);
-		write_buffer(file, output_instructions, output_instructions_size);
-		fprintf(file, "\";\n");
-
-		fprintf(file, "size_t %s_size = %zu;\n\n", name,
-		        output_header_size + output_decorations_size + output_base_types_size + output_constants_size + output_aggregate_types_size +
-		            output_global_vars_size + output_instructions_size);
+		size_t output_size = output_header_size + output_decorations_size + output_base_types_size + output_constants_size + output_aggregate_types_size +
+		                     output_global_vars_size + output_instructions_size;
+
+		if (get_blob_mode() == BLOB_MODE_STRINGS) {
+			fprintf(file, "uint8_t *%s = \"", name);
+			write_buffer(file, output_header, output_header_size);
+			write_buffer(file, output_decorations, output_decorations_size);
+			write_buffer(file, output_base_types, output_base_types_size);
+			write_buffer(file, output_constants, output_constants_size);
+			write_buffer(file, output_aggregate_types, output_aggregate_types_size);
+			write_buffer(file, output_global_vars, output_global_vars_size);
+			write_buffer(file, output_instructions, output_instructions_size);
+			fprintf(file, "\";\n");
+
+			fprintf(file, "size_t %s_size = %zu;\n\n", name, output_size);
+		}
+		else {
+			uint8_t *output = (uint8_t *)malloc(output_size);
+			uint8_t *next   = output;
+
+			memcpy(next, output_header, output_header_size);
+			next += output_header_size;
+			memcpy(next, output_decorations, output_decorations_size);
+			next += output_decorations_size;
+			memcpy(next, output_base_types, output_base_types_size);
+			next += output_base_types_size;
+			memcpy(next, output_constants, output_constants_size);
+			next += output_constants_size;
+			memcpy(next, output_aggregate_types, output_aggregate_types_size);
+			next += output_aggregate_types_size;
+			memcpy(next, output_global_vars, output_global_vars_size);
+			next += output_global_vars_size;
+			memcpy(next, output_instructions, output_instructions_size);
+
+			write_blob_definition(file, "uint8_t *", name, output, output_size, false);
+
+			free(output);
+		}
 
 		fclose(file);
 	}
@@ -159,96 +188,143 @@ static void write_bytecode(char *directory, const char *filename, const char *na
 }
 
 typedef enum spirv_opcode {
-	SPIRV_OPCODE_EXT_INST_IMPORT           = 11,
-	SPIRV_OPCODE_EXT_INST                  = 12,
-	SPIRV_OPCODE_MEMORY_MODEL              = 14,
-	SPIRV_OPCODE_ENTRY_POINT               = 15,
-	SPIRV_OPCODE_EXECUTION_MODE            = 16,
-	SPIRV_OPCODE_CAPABILITY                = 17,
-	SPIRV_OPCODE_TYPE_VOID                 = 19,
-	SPIRV_OPCODE_TYPE_BOOL                 = 20,
-	SPIRV_OPCODE_TYPE_INT                  = 21,
-	SPIRV_OPCODE_TYPE_FLOAT                = 22,
-	SPIRV_OPCODE_TYPE_VECTOR               = 23,
-	SPIRV_OPCODE_TYPE_MATRIX               = 24,
-	SPIRV_OPCODE_TYPE_IMAGE                = 25,
-	SPIRV_OPCODE_TYPE_SAMPLER              = 26,
-	SPIRV_OPCODE_TYPE_SAMPLED_IMAGE        = 27,
-	SPIRV_OPCODE_TYPE_ARRAY                = 28,
-	SPIRV_OPCODE_TYPE_STRUCT               = 30,
-	SPIRV_OPCODE_TYPE_POINTER              = 32,
-	SPIRV_OPCODE_TYPE_FUNCTION             = 33,
-	SPIRV_OPCODE_CONSTANT                  = 43,
-	SPIRV_OPCODE_CONSTANT_COMPOSITE        = 44,
-	SPIRV_OPCODE_FUNCTION                  = 54,
-	SPIRV_OPCODE_FUNCTION_PARAMETER        = 55,
-	SPIRV_OPCODE_FUNCTION_END              = 56,
-	SPIRV_OPCODE_FUNCTION_CALL             = 57,
-	SPIRV_OPCODE_VARIABLE                  = 59,
-	SPIRV_OPCODE_LOAD                      = 61,
-	SPIRV_OPCODE_STORE                     = 62,
-	SPIRV_OPCODE_ACCESS_CHAIN              = 65,
-	SPIRV_OPCODE_DECORATE                  = 71,
-	SPIRV_OPCODE_MEMBER_DECORATE           = 72,
-	SPIRV_OPCODE_COMPOSITE_CONSTRUCT       = 80,
-	SPIRV_OPCODE_COMPOSITE_EXTRACT         = 81,
-	SPIRV_OPCODE_SAMPLED_IMAGE             = 86,
-	SPIRV_OPCODE_IMAGE_SAMPLE_IMPLICIT_LOD = 87,
-	SPIRV_OPCODE_IMAGE_SAMPLE_EXPLICIT_LOD = 88,
-	SPIRV_OPCODE_IMAGE_READ                = 98,
-	SPIRV_OPCODE_IMAGE_WRITE               = 99,
-	SPIRV_OPCODE_CONVERT_F_TO_U            = 109,
-	SPIRV_OPCODE_CONVERT_F_TO_S            = 110,
-	SPIRV_OPCODE_CONVERT_S_TO_F            = 111,
-	SPIRV_OPCODE_CONVERT_U_TO_F            = 112,
-	SPIRV_OPCODE_BITCAST                   = 124,
-	SPIRV_OPCODE_S_NEGATE                  = 126,
-	SPIRV_OPCODE_F_NEGATE                  = 127,
-	SPIRV_OPCODE_I_ADD                     = 128,
-	SPIRV_OPCODE_F_ADD                     = 129,
-	SPIRV_OPCODE_I_SUB                     = 130,
-	SPIRV_OPCODE_F_SUB                     = 131,
-	SPIRV_OPCODE_F_MUL                     = 133,
-	SPIRV_OPCODE_F_DIV                     = 136,
-	SPIRV_OPCODE_F_MOD                     = 141,
-	SPIRV_OPCODE_VECTOR_TIMES_MATRIX       = 144,
-	SPIRV_OPCODE_MATRIX_TIMES_VECTOR       = 145,
-	SPIRV_OPCODE_MATRIX_TIMES_MATRIX       = 146,
-	SPIRV_OPCODE_DOT                       = 148,
-	SPIRV_OPCODE_LOGICAL_OR                = 166,
-	SPIRV_OPCODE_LOGICAL_AND               = 167,
-	SPIRV_OPCODE_LOGICAL_NOT               = 168,
-	SPIRV_OPCODE_I_EQUAL                   = 170,
-	SPIRV_OPCODE_I_NOT_EQUAL               = 171,
-	SPIRV_OPCODE_U_GREATER_THAN            = 172,
-	SPIRV_OPCODE_S_GREATER_THAN            = 173,
-	SPIRV_OPCODE_U_GREATER_THAN_EQUAL      = 174,
-	SPIRV_OPCODE_S_GREATER_THAN_EQUAL      = 175,
-	SPIRV_OPCODE_U_LESS_THAN               = 176,
-	SPIRV_OPCODE_S_LESS_THAN               = 177,
-	SPIRV_OPCODE_U_LESS_THAN_EQUAL         = 178,
-	SPIRV_OPCODE_S_LESS_THAN_EQUAL         = 179,
-	SPIRV_OPCODE_F_ORD_EQUAL               = 180,
-	SPIRV_OPCODE_F_ORD_NOT_EQUAL           = 182,
-	SPIRV_OPCODE_F_ORD_LESS_THAN           = 184,
-	SPIRV_OPCODE_F_ORD_GREATER_THAN        = 186,
-	SPIRV_OPCODE_F_ORD_LESS_THAN_EQUAL     = 188,
-	SPIRV_OPCODE_F_ORD_GREATER_THAN_EQUAL  = 190,
-	SPIRV_OPCODE_SHIFT_RIGHT_LOGICAL       = 194,
-	SPIRV_OPCODE_SHIFT_LEFT_LOGICAL        = 196,
-	SPIRV_OPCODE_BITWISE_OR                = 197,
-	SPIRV_OPCODE_BITWISE_XOR               = 198,
-	SPIRV_OPCODE_BITWISE_AND               = 199,
-	SPIRV_OPCODE_DPDX                      = 207,
-	SPIRV_OPCODE_DPDY                      = 208,
-	SPIRV_OPCODE_LOOP_MERGE                = 246,
-	SPIRV_OPCODE_SELECTION_MERGE           = 247,
-	SPIRV_OPCODE_LABEL                     = 248,
-	SPIRV_OPCODE_BRANCH                    = 249,
-	SPIRV_OPCODE_BRANCH_CONDITIONAL        = 250,
-	SPIRV_OPCODE_KILL                      = 252,
-	SPIRV_OPCODE_RETURN                    = 253,
-	SPIRV_OPCODE_RETURN_VALUE              = 254,
+	SPIRV_OPCODE_EXTENSION                          = 10,
+	SPIRV_OPCODE_EXT_INST_IMPORT                    = 11,
+	SPIRV_OPCODE_EXT_INST                           = 12,
+	SPIRV_OPCODE_MEMORY_MODEL                       = 14,
+	SPIRV_OPCODE_ENTRY_POINT                        = 15,
+	SPIRV_OPCODE_EXECUTION_MODE                     = 16,
+	SPIRV_OPCODE_CAPABILITY                         = 17,
+	SPIRV_OPCODE_TYPE_VOID                          = 19,
+	SPIRV_OPCODE_TYPE_BOOL                          = 20,
+	SPIRV_OPCODE_TYPE_INT                           = 21,
+	SPIRV_OPCODE_TYPE_FLOAT                         = 22,
+	SPIRV_OPCODE_TYPE_VECTOR                        = 23,
+	SPIRV_OPCODE_TYPE_MATRIX                        = 24,
+	SPIRV_OPCODE_TYPE_IMAGE                         = 25,
+	SPIRV_OPCODE_TYPE_SAMPLER                       = 26,
+	SPIRV_OPCODE_TYPE_SAMPLED_IMAGE                 = 27,
+	SPIRV_OPCODE_TYPE_ARRAY                         = 28,
+	SPIRV_OPCODE_TYPE_RUNTIME_ARRAY                 = 29,
+	SPIRV_OPCODE_TYPE_STRUCT                        = 30,
+	SPIRV_OPCODE_TYPE_POINTER                       = 32,
+	SPIRV_OPCODE_TYPE_FUNCTION                      = 33,
+	SPIRV_OPCODE_CONSTANT_TRUE                      = 41,
+	SPIRV_OPCODE_CONSTANT_FALSE                     = 42,
+	SPIRV_OPCODE_CONSTANT                           = 43,
+	SPIRV_OPCODE_CONSTANT_COMPOSITE                 = 44,
+	SPIRV_OPCODE_SPEC_CONSTANT_TRUE                 = 48,
+	SPIRV_OPCODE_SPEC_CONSTANT_FALSE                = 49,
+	SPIRV_OPCODE_SPEC_CONSTANT                      = 50,
+	SPIRV_OPCODE_FUNCTION                           = 54,
+	SPIRV_OPCODE_FUNCTION_PARAMETER                 = 55,
+	SPIRV_OPCODE_FUNCTION_END                       = 56,
+	SPIRV_OPCODE_FUNCTION_CALL                      = 57,
+	SPIRV_OPCODE_VARIABLE                           = 59,
+	SPIRV_OPCODE_IMAGE_TEXEL_POINTER                = 60,
+	SPIRV_OPCODE_LOAD                               = 61,
+	SPIRV_OPCODE_STORE                              = 62,
+	SPIRV_OPCODE_ACCESS_CHAIN                       = 65,
+	SPIRV_OPCODE_DECORATE                           = 71,
+	SPIRV_OPCODE_MEMBER_DECORATE                    = 72,
+	SPIRV_OPCODE_COMPOSITE_CONSTRUCT                = 80,
+	SPIRV_OPCODE_COMPOSITE_EXTRACT                  = 81,
+	SPIRV_OPCODE_SAMPLED_IMAGE                      = 86,
+	SPIRV_OPCODE_IMAGE_SAMPLE_IMPLICIT_LOD          = 87,
+	SPIRV_OPCODE_IMAGE_SAMPLE_EXPLICIT_LOD          = 88,
+	SPIRV_OPCODE_IMAGE_SAMPLE_DREF_IMPLICIT_LOD     = 89,
+	SPIRV_OPCODE_IMAGE_SAMPLE_DREF_EXPLICIT_LOD     = 90,
+	SPIRV_OPCODE_IMAGE_FETCH                        = 95,
+	SPIRV_OPCODE_IMAGE_GATHER                       = 96,
+	SPIRV_OPCODE_IMAGE_READ                         = 98,
+	SPIRV_OPCODE_IMAGE_WRITE                        = 99,
+	SPIRV_OPCODE_CONVERT_F_TO_U                     = 109,
+	SPIRV_OPCODE_CONVERT_F_TO_S                     = 110,
+	SPIRV_OPCODE_CONVERT_S_TO_F                     = 111,
+	SPIRV_OPCODE_CONVERT_U_TO_F                     = 112,
+	SPIRV_OPCODE_U_CONVERT                          = 113,
+	SPIRV_OPCODE_S_CONVERT                          = 114,
+	SPIRV_OPCODE_F_CONVERT                          = 115,
+	SPIRV_OPCODE_BITCAST                            = 124,
+	SPIRV_OPCODE_S_NEGATE                           = 126,
+	SPIRV_OPCODE_F_NEGATE                           = 127,
+	SPIRV_OPCODE_I_ADD                              = 128,
+	SPIRV_OPCODE_F_ADD                              = 129,
+	SPIRV_OPCODE_I_SUB                              = 130,
+	SPIRV_OPCODE_F_SUB                              = 131,
+	SPIRV_OPCODE_I_MUL                              = 132,
+	SPIRV_OPCODE_F_MUL                              = 133,
+	SPIRV_OPCODE_U_DIV                              = 134,
+	SPIRV_OPCODE_S_DIV                              = 135,
+	SPIRV_OPCODE_F_DIV                              = 136,
+	SPIRV_OPCODE_F_MOD                              = 141,
+	SPIRV_OPCODE_VECTOR_TIMES_MATRIX                = 144,
+	SPIRV_OPCODE_MATRIX_TIMES_VECTOR                = 145,
+	SPIRV_OPCODE_MATRIX_TIMES_MATRIX                = 146,
+	SPIRV_OPCODE_DOT                                = 148,
+	SPIRV_OPCODE_LOGICAL_OR                         = 166,
+	SPIRV_OPCODE_LOGICAL_AND                        = 167,
+	SPIRV_OPCODE_LOGICAL_NOT                        = 168,
+	SPIRV_OPCODE_I_EQUAL                            = 170,
+	SPIRV_OPCODE_I_NOT_EQUAL                        = 171,
+	SPIRV_OPCODE_U_GREATER_THAN                     = 172,
+	SPIRV_OPCODE_S_GREATER_THAN                     = 173,
+	SPIRV_OPCODE_U_GREATER_THAN_EQUAL               = 174,
+	SPIRV_OPCODE_S_GREATER_THAN_EQUAL               = 175,
+	SPIRV_OPCODE_U_LESS_THAN                        = 176,
+	SPIRV_OPCODE_S_LESS_THAN                        = 177,
+	SPIRV_OPCODE_U_LESS_THAN_EQUAL                  = 178,
+	SPIRV_OPCODE_S_LESS_THAN_EQUAL                  = 179,
+	SPIRV_OPCODE_F_ORD_EQUAL                        = 180,
+	SPIRV_OPCODE_F_ORD_NOT_EQUAL                    = 182,
+	SPIRV_OPCODE_F_ORD_LESS_THAN                    = 184,
+	SPIRV_OPCODE_F_ORD_GREATER_THAN                 = 186,
+	SPIRV_OPCODE_F_ORD_LESS_THAN_EQUAL              = 188,
+	SPIRV_OPCODE_F_ORD_GREATER_THAN_EQUAL           = 190,
+	SPIRV_OPCODE_SHIFT_RIGHT_LOGICAL                = 194,
+	SPIRV_OPCODE_SHIFT_LEFT_LOGICAL                 = 196,
+	SPIRV_OPCODE_BITWISE_OR                         = 197,
+	SPIRV_OPCODE_BITWISE_XOR                        = 198,
+	SPIRV_OPCODE_BITWISE_AND                        = 199,
+	SPIRV_OPCODE_DPDX                               = 207,
+	SPIRV_OPCODE_DPDY                               = 208,
+	SPIRV_OPCODE_CONTROL_BARRIER                    = 224,
+	SPIRV_OPCODE_MEMORY_BARRIER                     = 225,
+	SPIRV_OPCODE_ATOMIC_EXCHANGE                    = 229,
+	SPIRV_OPCODE_ATOMIC_COMPARE_EXCHANGE            = 230,
+	SPIRV_OPCODE_ATOMIC_I_ADD                       = 234,
+	SPIRV_OPCODE_ATOMIC_S_MIN                       = 236,
+	SPIRV_OPCODE_ATOMIC_U_MIN                       = 237,
+	SPIRV_OPCODE_ATOMIC_S_MAX                       = 238,
+	SPIRV_OPCODE_ATOMIC_U_MAX                       = 239,
+	SPIRV_OPCODE_ATOMIC_AND                         = 240,
+	SPIRV_OPCODE_ATOMIC_OR                          = 241,
+	SPIRV_OPCODE_ATOMIC_XOR                         = 242,
+	SPIRV_OPCODE_GROUP_NON_UNIFORM_ELECT            = 333,
+	SPIRV_OPCODE_GROUP_NON_UNIFORM_ALL              = 334,
+	SPIRV_OPCODE_GROUP_NON_UNIFORM_ANY              = 335,
+	SPIRV_OPCODE_GROUP_NON_UNIFORM_BROADCAST_FIRST  = 338,
+	SPIRV_OPCODE_GROUP_NON_UNIFORM_BALLOT           = 339,
+	SPIRV_OPCODE_GROUP_NON_UNIFORM_BALLOT_BIT_COUNT = 342,
+	SPIRV_OPCODE_GROUP_NON_UNIFORM_SHUFFLE          = 345,
+	SPIRV_OPCODE_GROUP_NON_UNIFORM_I_ADD            = 349,
+	SPIRV_OPCODE_GROUP_NON_UNIFORM_F_ADD            = 350,
+	SPIRV_OPCODE_GROUP_NON_UNIFORM_S_MIN            = 353,
+	SPIRV_OPCODE_GROUP_NON_UNIFORM_U_MIN            = 354,
+	SPIRV_OPCODE_GROUP_NON_UNIFORM_F_MIN            = 355,
+	SPIRV_OPCODE_GROUP_NON_UNIFORM_S_MAX            = 356,
+	SPIRV_OPCODE_GROUP_NON_UNIFORM_U_MAX            = 357,
+	SPIRV_OPCODE_GROUP_NON_UNIFORM_F_MAX            = 358,
+	SPIRV_OPCODE_LOOP_MERGE                         = 246,
+	SPIRV_OPCODE_SELECTION_MERGE                    = 247,
+	SPIRV_OPCODE_LABEL                              = 248,
+	SPIRV_OPCODE_BRANCH                             = 249,
+	SPIRV_OPCODE_BRANCH_CONDITIONAL                 = 250,
+	SPIRV_OPCODE_KILL                               = 252,
+	SPIRV_OPCODE_RETURN                             = 253,
+	SPIRV_OPCODE_RETURN_VALUE                       = 254,
+	SPIRV_OPCODE_EMIT_MESH_TASKS_EXT                = 5294,
+	SPIRV_OPCODE_SET_MESH_OUTPUTS_EXT               = 5295,
 } spirv_opcode;
 
 typedef enum spirv_glsl_std {
@@ -330,15 +406,35 @@ typedef enum memory_model { MEMORY_MODEL_SIMPLE = 0, MEMORY_MODEL_GLSL450 = 1 }
 
 typedef enum capability {
 	CAPABILITY_SHADER                             = 1,
+	CAPABILITY_FLOAT16                            = 9,
+	CAPABILITY_INT16                              = 22,
 	CAPABILITY_STORAGE_IMAGE_READ_WITHOUT_FORMAT  = 55,
 	CAPABILITY_STORAGE_IMAGE_WRITE_WITHOUT_FORMAT = 56,
+	CAPABILITY_GROUP_NON_UNIFORM                  = 61,
+	CAPABILITY_GROUP_NON_UNIFORM_VOTE             = 62,
+	CAPABILITY_GROUP_NON_UNIFORM_ARITHMETIC       = 63,
+	CAPABILITY_GROUP_NON_UNIFORM_BALLOT           = 64,
+	CAPABILITY_GROUP_NON_UNIFORM_SHUFFLE          = 65,
+	CAPABILITY_STORAGE_BUFFER_16BIT_ACCESS        = 4433,
+	CAPABILITY_UNIFORM_AND_STORAGE_16BIT_ACCESS   = 4434,
+	CAPABILITY_STORAGE_PUSH_CONSTANT_16           = 4435,
+	CAPABILITY_MESH_SHADING_EXT                   = 5283,
 } capability;
 
-typedef enum execution_model { EXECUTION_MODEL_VERTEX = 0, EXECUTION_MODEL_FRAGMENT = 4, EXECUTION_MODEL_GLCOMPUTE = 5 } execution_model;
+typedef enum execution_model {
+	EXECUTION_MODEL_VERTEX    = 0,
+	EXECUTION_MODEL_FRAGMENT  = 4,
+	EXECUTION_MODEL_GLCOMPUTE = 5,
+	EXECUTION_MODEL_TASK_EXT  = 5364,
+	EXECUTION_MODEL_MESH_EXT  = 5365,
+} execution_model;
 
 typedef enum decoration {
+	DECORATION_SPEC_ID        = 1,
 	DECORATION_BLOCK          = 2,
+	DECORATION_BUFFER_BLOCK   = 3,
 	DECORATION_COL_MAJOR      = 5,
+	DECORATION_ARRAY_STRIDE   = 6,
 	DECORATION_MATRIX_STRIDE  = 7,
 	DECORATION_BUILTIN        = 11,
 	DECORATION_LOCATION       = 30,
@@ -348,22 +444,48 @@ typedef enum decoration {
 } decoration;
 
 typedef enum builtin {
-	BUILTIN_POSITION             = 0,
-	BUILTIN_WORKGROUP_SIZE       = 25,
-	BUILTIN_WORKGROUP_ID         = 26,
-	BUILTIN_LOCAL_INVOCATION_ID  = 27,
-	BUILTIN_GLOBAL_INVOCATION_ID = 28,
-	BUILTIN_VERTEX_INDEX         = 42,
+	BUILTIN_POSITION                       = 0,
+	BUILTIN_WORKGROUP_SIZE                 = 25,
+	BUILTIN_WORKGROUP_ID                   = 26,
+	BUILTIN_LOCAL_INVOCATION_ID            = 27,
+	BUILTIN_GLOBAL_INVOCATION_ID           = 28,
+	BUILTIN_SUBGROUP_SIZE                  = 36,
+	BUILTIN_SUBGROUP_LOCAL_INVOCATION_ID   = 41,
+	BUILTIN_VERTEX_INDEX                   = 42,
+	BUILTIN_PRIMITIVE_TRIANGLE_INDICES_EXT = 5296,
 } builtin;
 
+typedef enum scope {
+	SCOPE_DEVICE    = 1,
+	SCOPE_WORKGROUP = 2,
+	SCOPE_SUBGROUP  = 3,
+} scope;
+
+typedef enum memory_semantics {
+	MEMORY_SEMANTICS_RELAXED          = 0x0,
+	MEMORY_SEMANTICS_ACQUIRE_RELEASE  = 0x8,
+	MEMORY_SEMANTICS_UNIFORM_MEMORY   = 0x40,
+	MEMORY_SEMANTICS_WORKGROUP_MEMORY = 0x100,
+	MEMORY_SEMANTICS_IMAGE_MEMORY     = 0x800,
+} memory_semantics;
+
+typedef enum group_operation {
+	GROUP_OPERATION_REDUCE         = 0,
+	GROUP_OPERATION_EXCLUSIVE_SCAN = 2,
+} group_operation;
+
 typedef enum storage_class {
-	STORAGE_CLASS_UNIFORM_CONSTANT = 0,
-	STORAGE_CLASS_INPUT            = 1,
-	STORAGE_CLASS_UNIFORM          = 2,
-	STORAGE_CLASS_OUTPUT           = 3,
-	STORAGE_CLASS_FUNCTION         = 7,
-	STORAGE_CLASS_PUSH_CONSTANT    = 9,
-	STORAGE_CLASS_NONE             = 9999
+	STORAGE_CLASS_UNIFORM_CONSTANT           = 0,
+	STORAGE_CLASS_INPUT                      = 1,
+	STORAGE_CLASS_UNIFORM                    = 2,
+	STORAGE_CLASS_OUTPUT                     = 3,
+	STORAGE_CLASS_WORKGROUP                  = 4,
+	STORAGE_CLASS_FUNCTION                   = 7,
+	STORAGE_CLASS_PUSH_CONSTANT              = 9,
+	STORAGE_CLASS_IMAGE                      = 11,
+	STORAGE_CLASS_STORAGE_BUFFER             = 12,
+	STORAGE_CLASS_TASK_PAYLOAD_WORKGROUP_EXT = 5402,
+	STORAGE_CLASS_NONE                       = 9999
 } storage_class;
 
 typedef enum selection_control {
@@ -381,8 +503,11 @@ typedef enum loop_control {
 typedef enum function_control { FUNCTION_CONTROL_NONE } function_control;
 
 typedef enum execution_mode {
-	EXECUTION_MODE_ORIGIN_UPPER_LEFT = 7,
-	EXECUTION_MODE_LOCAL_SIZE        = 17,
+	EXECUTION_MODE_ORIGIN_UPPER_LEFT     = 7,
+	EXECUTION_MODE_LOCAL_SIZE            = 17,
+	EXECUTION_MODE_OUTPUT_VERTICES       = 26,
+	EXECUTION_MODE_OUTPUT_PRIMITIVES_EXT = 5270,
+	EXECUTION_MODE_OUTPUT_TRIANGLES_EXT  = 5298,
 } execution_mode;
 
 typedef enum dim {
@@ -399,6 +524,8 @@ typedef enum image_format {
 	IMAGE_FORMAT_R32F        = 3,
 	IMAGE_FORMAT_RGBA8       = 4,
 	IMAGE_FORMAT_RGBA8_SNORM = 5,
+	IMAGE_FORMAT_R32I        = 24,
+	IMAGE_FORMAT_R32UI       = 33,
 } image_format;
 
 static uint32_t operands_buffer[4096];
@@ -418,8 +545,27 @@ static void write_magic_number(instructions_buffer *instructions) {
 	instructions->instructions[instructions->offset++] = 0x07230203;
 }
 
-static void write_version_number(instructions_buffer *instructions) {
-	instructions->instructions[instructions->offset++] = 0x00010000;
+// Float16 and Int16 follow the 16 bit types a module declares, the storage capabilities the buffers which contain them
+typedef struct sixteen_bit_usage {
+	bool floats;
+	bool ints;
+	bool storage_buffers;
+	bool uniform_buffers;
+	bool push_constants;
+} sixteen_bit_usage;
+
+static sixteen_bit_usage sixteen_bits;
+
+static void write_version_number(instructions_buffer *instructions, const capabilities *caps) {
+	bool sixteen_bit_storage = sixteen_bits.storage_buffers || sixteen_bits.uniform_buffers || sixteen_bits.push_constants;
+
+	// the GroupNonUniform instructions and the 16 bit storage capabilities arrived with SPIR-V 1.3, SPV_EXT_mesh_shader requires 1.4
+	if (caps->mesh_shading) {
+		instructions->instructions[instructions->offset++] = 0x00010400;
+	}
+	else {
+		instructions->instructions[instructions->offset++] = caps->wave_basic || sixteen_bit_storage ? 0x00010300 : 0x00010000;
+	}
 }
 
 static void write_generator_magic_number(instructions_buffer *instructions) {
@@ -470,6 +616,11 @@ static spirv_id write_op_ext_inst_import(instructions_buffer *instructions, cons
 	return result;
 }
 
+static void write_op_extension(instructions_buffer *instructions, const char *name) {
+	uint32_t name_length = write_string(operands_buffer, name);
+	write_instruction(instructions, 1 + name_length, SPIRV_OPCODE_EXTENSION, operands_buffer);
+}
+
 static void write_op_memory_model(instructions_buffer *instructions, uint32_t addressing_model, uint32_t memory_model) {
 	uint32_t args[2] = {addressing_model, memory_model};
 	write_instruction(instructions, 3, SPIRV_OPCODE_MEMORY_MODEL, args);
@@ -496,6 +647,11 @@ static void write_op_execution_mode(instructions_buffer *instructions, spirv_id
 	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_EXECUTION_MODE, operands);
 }
 
+static void write_op_execution_mode1(instructions_buffer *instructions, spirv_id entry_point, execution_mode mode, uint32_t param) {
+	uint32_t operands[] = {entry_point.id, (uint32_t)mode, param};
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_EXECUTION_MODE, operands);
+}
+
 static void write_op_execution_mode3(instructions_buffer *instructions, spirv_id entry_point, execution_mode mode, uint32_t param0, uint32_t param1,
                                      uint32_t param2) {
 	uint32_t operands[] = {entry_point.id, (uint32_t)mode, param0, param1, param2};
@@ -510,6 +666,44 @@ static void write_capabilities(instructions_buffer *instructions, const capabili
 	if (caps->image_write) {
 		write_capability(instructions, CAPABILITY_STORAGE_IMAGE_WRITE_WITHOUT_FORMAT);
 	}
+	if (caps->wave_basic) {
+		write_capability(instructions, CAPABILITY_GROUP_NON_UNIFORM);
+	}
+	if (caps->wave_vote) {
+		write_capability(instructions, CAPABILITY_GROUP_NON_UNIFORM_VOTE);
+	}
+	if (caps->wave_arithmetic) {
+		write_capability(instructions, CAPABILITY_GROUP_NON_UNIFORM_ARITHMETIC);
+	}
+	if (caps->wave_ballot) {
+		write_capability(instructions, CAPABILITY_GROUP_NON_UNIFORM_BALLOT);
+	}
+	if (caps->wave_shuffle) {
+		write_capability(instructions, CAPABILITY_GROUP_NON_UNIFORM_SHUFFLE);
+	}
+	if (caps->mesh_shading) {
+		write_capability(instructions, CAPABILITY_MESH_SHADING_EXT);
+		write_op_extension(instructions, "SPV_EXT_mesh_shader");
+	}
+}
+
+// The 16 bit types are only known once the functions have been written, their capabilities directly follow the header
+static void write_16bit_capabilities(instructions_buffer *instructions) {
+	if (sixteen_bits.floats) {
+		write_capability(instructions, CAPABILITY_FLOAT16);
+	}
+	if (sixteen_bits.ints) {
+		write_capability(instructions, CAPABILITY_INT16);
+	}
+	if (sixteen_bits.storage_buffers) {
+		write_capability(instructions, CAPABILITY_STORAGE_BUFFER_16BIT_ACCESS);
+	}
+	if (sixteen_bits.uniform_buffers) {
+		write_capability(instructions, CAPABILITY_UNIFORM_AND_STORAGE_16BIT_ACCESS);
+	}
+	if (sixteen_bits.push_constants) {
+		write_capability(instructions, CAPABILITY_STORAGE_PUSH_CONSTANT_16);
+	}
 }
 
 static spirv_id write_type_void(instructions_buffer *instructions) {
@@ -552,6 +746,21 @@ static spirv_id write_type_vector_preallocated(instructions_buffer *instructions
 	return vector_type;
 }
 
+static void write_type_float_preallocated(instructions_buffer *instructions, uint32_t width, spirv_id float_type) {
+	uint32_t operands[] = {float_type.id, width};
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_TYPE_FLOAT, operands);
+}
+
+static void write_type_int_preallocated(instructions_buffer *instructions, uint32_t width, bool signedness, spirv_id int_type) {
+	uint32_t operands[] = {int_type.id, width, signedness ? 1u : 0u};
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_TYPE_INT, operands);
+}
+
+static void write_type_matrix_preallocated(instructions_buffer *instructions, spirv_id column_type, uint32_t column_count, spirv_id matrix_type) {
+	uint32_t operands[] = {matrix_type.id, column_type.id, column_count};
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_TYPE_MATRIX, operands);
+}
+
 static spirv_id write_type_matrix(instructions_buffer *instructions, spirv_id column_type, uint32_t column_count) {
 	spirv_id matrix_type = allocate_index();
 
@@ -620,6 +829,14 @@ static spirv_id write_type_array(instructions_buffer *instructions, spirv_id ele
 	return array_type;
 }
 
+static spirv_id write_type_runtime_array(instructions_buffer *instructions, spirv_id element_type) {
+	spirv_id array_type = allocate_index();
+
+	uint32_t operands[] = {array_type.id, element_type.id};
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_TYPE_RUNTIME_ARRAY, operands);
+	return array_type;
+}
+
 static spirv_id write_type_pointer(instructions_buffer *instructions, storage_class storage, spirv_id type) {
 	spirv_id pointer_type = allocate_index();
 
@@ -659,6 +876,10 @@ static spirv_id spirv_imagecube_type;
 static spirv_id spirv_imagecube_pointer_type;
 static spirv_id spirv_readwrite_image_type;
 static spirv_id spirv_readwrite_image_pointer_type;
+static spirv_id spirv_uint_image_type;
+static spirv_id spirv_uint_image_pointer_type;
+static spirv_id spirv_int_image_type;
+static spirv_id spirv_int_image_pointer_type;
 static spirv_id spirv_sampled_image_type;
 static spirv_id spirv_sampled_image2darray_type;
 static spirv_id spirv_sampled_imagecube_type;
@@ -672,6 +893,11 @@ static spirv_id group_thread_id_variable;
 static spirv_id group_id_variable;
 static spirv_id work_group_size_variable;
 static spirv_id vertex_id_variable;
+static spirv_id wave_lane_index_variable;
+static spirv_id wave_lane_count_variable;
+
+// SPIR-V 1.4 dropped the BufferBlock decoration, buffers use the StorageBuffer storage class there
+static storage_class buffer_storage_class = STORAGE_CLASS_UNIFORM;
 
 typedef struct complex_type {
 	type_id  type;
@@ -807,6 +1033,13 @@ static void write_base_types(instructions_buffer *buffer) {
 
 	spirv_readwrite_image_pointer_type = allocate_index();
 
+	// the integer images are only written when an R32 texture is used
+	spirv_id no_image             = KONG_INIT_ZERO;
+	spirv_uint_image_type         = no_image;
+	spirv_uint_image_pointer_type = no_image;
+	spirv_int_image_type          = no_image;
+	spirv_int_image_pointer_type  = no_image;
+
 	spirv_sampled_image_type = write_type_sampled_image(buffer, spirv_image_type);
 
 	spirv_sampled_image2darray_type = write_type_sampled_image(buffer, spirv_image2darray_type);
@@ -826,6 +1059,64 @@ static void write_base_types(instructions_buffer *buffer) {
 	add_to_type_map(float4x4_id, spirv_float4x4_type, false, STORAGE_CLASS_NONE);
 }
 
+static bool is_referenced_type(type_id type) {
+	complex_type ct;
+	ct.type      = type;
+	ct.readwrite = false;
+	ct.storage   = (uint16_t)STORAGE_CLASS_NONE;
+
+	return hmgeti(type_map, ct) >= 0;
+}
+
+// Declares the 16 bit types the module referenced, which has to wait until the functions and the aggregate types have been written
+static void write_16bit_types(instructions_buffer *buffer) {
+	type_id scalars[]  = {half_id, short_id, ushort_id};
+	type_id vectors[]  = {half2_id, half3_id, half4_id, short2_id, short3_id, short4_id, ushort2_id, ushort3_id, ushort4_id};
+	type_id matrices[] = {half2x2_id, half3x3_id, half4x4_id};
+	type_id columns[]  = {half2_id, half3_id, half4_id};
+
+	// matrices need their columns and vectors their components
+	for (size_t i = 0; i < sizeof(matrices) / sizeof(matrices[0]); ++i) {
+		if (is_16bit_type(matrices[i]) && is_referenced_type(matrices[i])) {
+			convert_type_to_spirv_id(columns[i]);
+		}
+	}
+
+	for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); ++i) {
+		if (is_16bit_type(vectors[i]) && is_referenced_type(vectors[i])) {
+			convert_type_to_spirv_id(vector_base_type(vectors[i]));
+		}
+	}
+
+	for (size_t i = 0; i < sizeof(scalars) / sizeof(scalars[0]); ++i) {
+		if (!is_16bit_type(scalars[i]) || !is_referenced_type(scalars[i])) {
+			continue;
+		}
+
+		if (scalars[i] == half_id) {
+			write_type_float_preallocated(buffer, 16, convert_type_to_spirv_id(half_id));
+			sixteen_bits.floats = true;
+		}
+		else {
+			write_type_int_preallocated(buffer, 16, scalars[i] == short_id, convert_type_to_spirv_id(scalars[i]));
+			sixteen_bits.ints = true;
+		}
+	}
+
+	for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); ++i) {
+		if (is_16bit_type(vectors[i]) && is_referenced_type(vectors[i])) {
+			spirv_id component_type = convert_type_to_spirv_id(vector_base_type(vectors[i]));
+			write_type_vector_preallocated(buffer, component_type, vector_size(vectors[i]), convert_type_to_spirv_id(vectors[i]));
+		}
+	}
+
+	for (size_t i = 0; i < sizeof(matrices) / sizeof(matrices[0]); ++i) {
+		if (is_16bit_type(matrices[i]) && is_referenced_type(matrices[i])) {
+			write_type_matrix_preallocated(buffer, convert_type_to_spirv_id(columns[i]), vector_size(columns[i]), convert_type_to_spirv_id(matrices[i]));
+		}
+	}
+}
+
 static spirv_id get_int_constant(int value);
 
 typedef struct pointer_relation {
@@ -921,8 +1212,45 @@ static spirv_id write_constant_float(instructions_buffer *instructions, spirv_id
 }
 
 static spirv_id write_constant_bool(instructions_buffer *instructions, spirv_id value_id, bool value) {
-	uint32_t uint32_value = *(uint32_t *)&value;
-	return write_constant(instructions, spirv_bool_type, value_id, uint32_value);
+	// OpConstant only takes numerical types
+	uint32_t operands[] = {spirv_bool_type.id, value_id.id};
+	write_instruction(instructions, WORD_COUNT(operands), value ? SPIRV_OPCODE_CONSTANT_TRUE : SPIRV_OPCODE_CONSTANT_FALSE, operands);
+	return value_id;
+}
+
+// The value is only the default, pipelines can replace it via the SpecId
+static spirv_id write_spec_constant(instructions_buffer *instructions, global *g) {
+	debug_context context = KONG_INIT_ZERO;
+	check(!is_16bit_type(g->type), context, "16 bit specialization constants are not supported in SPIR-V");
+
+	spirv_id value_id = allocate_index();
+
+	switch (g->value.kind) {
+	case GLOBAL_VALUE_BOOL: {
+		uint32_t operands[] = {spirv_bool_type.id, value_id.id};
+		write_instruction(instructions, WORD_COUNT(operands),
+		                  g->value.value.b ? SPIRV_OPCODE_SPEC_CONSTANT_TRUE : SPIRV_OPCODE_SPEC_CONSTANT_FALSE, operands);
+		break;
+	}
+	case GLOBAL_VALUE_INT: {
+		uint32_t operands[] = {spirv_int_type.id, value_id.id, (uint32_t)g->value.value.ints[0]};
+		write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_SPEC_CONSTANT, operands);
+		break;
+	}
+	case GLOBAL_VALUE_UINT: {
+		uint32_t operands[] = {spirv_uint_type.id, value_id.id, g->value.value.uints[0]};
+		write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_SPEC_CONSTANT, operands);
+		break;
+	}
+	default: {
+		float    value      = g->value.value.floats[0];
+		uint32_t operands[] = {spirv_float_type.id, value_id.id, *(uint32_t *)&value};
+		write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_SPEC_CONSTANT, operands);
+		break;
+	}
+	}
+
+	return value_id;
 }
 
 static void write_constant_composite_preallocated3(instructions_buffer *instructions, spirv_id result_type, spirv_id result, spirv_id consituent0,
@@ -1119,6 +1447,73 @@ static spirv_id get_bool_constant(bool value) {
 	return index;
 }
 
+// 16 bit constants are keyed by the bits of their only word, the upper bits are zero or, for short, the extended sign
+static struct {
+	uint32_t key;
+	spirv_id value;
+} *half_constants = NULL, *short_constants = NULL, *ushort_constants = NULL;
+
+static uint16_t half_bits(float value) {
+	uint32_t bits     = *(uint32_t *)&value;
+	uint32_t sign     = (bits >> 16) & 0x8000;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	if (((bits >> 23) & 0xff) == 0xff) {
+		return (uint16_t)(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+	}
+
+	int32_t exponent = (int32_t)((bits >> 23) & 0xff) - 127 + 15;
+	if (exponent >= 31) {
+		return (uint16_t)(sign | 0x7c00);
+	}
+	if (exponent <= 0) {
+		if (exponent < -10) {
+			return (uint16_t)sign;
+		}
+		uint32_t shift = (uint32_t)(14 - exponent);
+		return (uint16_t)(sign | (((mantissa | 0x800000) + (1u << (shift - 1))) >> shift));
+	}
+
+	// a carry out of the rounded mantissa correctly increments the exponent
+	return (uint16_t)((sign | ((uint32_t)exponent << 10)) + ((mantissa + 0x1000) >> 13));
+}
+
+static spirv_id get_half_constant(float value) {
+	convert_type_to_spirv_id(half_id);
+
+	uint32_t key   = half_bits(value);
+	spirv_id index = hmget(half_constants, key);
+	if (index.id == 0) {
+		index = allocate_index();
+		hmput(half_constants, key, index);
+	}
+	return index;
+}
+
+static spirv_id get_short_constant(int value) {
+	convert_type_to_spirv_id(short_id);
+
+	uint32_t key   = (uint32_t)(int32_t)(int16_t)value;
+	spirv_id index = hmget(short_constants, key);
+	if (index.id == 0) {
+		index = allocate_index();
+		hmput(short_constants, key, index);
+	}
+	return index;
+}
+
+static spirv_id get_ushort_constant(int value) {
+	convert_type_to_spirv_id(ushort_id);
+
+	uint32_t key   = (uint16_t)value;
+	spirv_id index = hmget(ushort_constants, key);
+	if (index.id == 0) {
+		index = allocate_index();
+		hmput(ushort_constants, key, index);
+	}
+	return index;
+}
+
 static spirv_id write_op_access_chain(instructions_buffer *instructions, spirv_id result_type, spirv_id base, spirv_id *indices, uint16_t indices_size) {
 	spirv_id pointer = allocate_index();
 
@@ -1331,6 +1726,16 @@ static spirv_id write_op_i_sub(instructions_buffer *instructions, spirv_id type,
 	return result;
 }
 
+static spirv_id write_op_i_mul(instructions_buffer *instructions, spirv_id type, spirv_id operand1, spirv_id operand2) {
+	spirv_id result = allocate_index();
+
+	uint32_t operands[] = {type.id, result.id, operand1.id, operand2.id};
+
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_I_MUL, operands);
+
+	return result;
+}
+
 static spirv_id write_op_f_mul(instructions_buffer *instructions, spirv_id type, spirv_id operand1, spirv_id operand2) {
 	spirv_id result = allocate_index();
 
@@ -1351,6 +1756,26 @@ static spirv_id write_op_f_div(instructions_buffer *instructions, spirv_id type,
 	return result;
 }
 
+static spirv_id write_op_s_div(instructions_buffer *instructions, spirv_id type, spirv_id operand1, spirv_id operand2) {
+	spirv_id result = allocate_index();
+
+	uint32_t operands[] = {type.id, result.id, operand1.id, operand2.id};
+
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_S_DIV, operands);
+
+	return result;
+}
+
+static spirv_id write_op_u_div(instructions_buffer *instructions, spirv_id type, spirv_id operand1, spirv_id operand2) {
+	spirv_id result = allocate_index();
+
+	uint32_t operands[] = {type.id, result.id, operand1.id, operand2.id};
+
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_U_DIV, operands);
+
+	return result;
+}
+
 static spirv_id write_op_f_mod(instructions_buffer *instructions, spirv_id type, spirv_id operand1, spirv_id operand2) {
 	spirv_id result = allocate_index();
 
@@ -1431,6 +1856,36 @@ static spirv_id write_op_convert_f_to_u(instructions_buffer *instructions, spirv
 	return result;
 }
 
+static spirv_id write_op_f_convert(instructions_buffer *instructions, spirv_id result_type, spirv_id float_value) {
+	spirv_id result = allocate_index();
+
+	uint32_t operands[] = {result_type.id, result.id, float_value.id};
+
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_F_CONVERT, operands);
+
+	return result;
+}
+
+static spirv_id write_op_s_convert(instructions_buffer *instructions, spirv_id result_type, spirv_id signed_value) {
+	spirv_id result = allocate_index();
+
+	uint32_t operands[] = {result_type.id, result.id, signed_value.id};
+
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_S_CONVERT, operands);
+
+	return result;
+}
+
+static spirv_id write_op_u_convert(instructions_buffer *instructions, spirv_id result_type, spirv_id unsigned_value) {
+	spirv_id result = allocate_index();
+
+	uint32_t operands[] = {result_type.id, result.id, unsigned_value.id};
+
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_U_CONVERT, operands);
+
+	return result;
+}
+
 static spirv_id write_op_bitcast(instructions_buffer *instructions, spirv_id result_type, spirv_id operand) {
 	spirv_id result = allocate_index();
 
@@ -1483,6 +1938,75 @@ static spirv_id write_op_image_sample_explicit_lod(instructions_buffer *instruct
 	return result;
 }
 
+static spirv_id write_op_image_sample_bias(instructions_buffer *instructions, spirv_id result_type, spirv_id sampled_image, spirv_id coordinate,
+                                           spirv_id bias) {
+	spirv_id result = allocate_index();
+
+	uint32_t bias_operands = 0x1u;
+	uint32_t operands[]    = {result_type.id, result.id, sampled_image.id, coordinate.id, bias_operands, bias.id};
+
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_IMAGE_SAMPLE_IMPLICIT_LOD, operands);
+
+	return result;
+}
+
+static spirv_id write_op_image_sample_grad(instructions_buffer *instructions, spirv_id result_type, spirv_id sampled_image, spirv_id coordinate,
+                                           spirv_id dx, spirv_id dy) {
+	spirv_id result = allocate_index();
+
+	uint32_t grad_operands = 0x4u;
+	uint32_t operands[]    = {result_type.id, result.id, sampled_image.id, coordinate.id, grad_operands, dx.id, dy.id};
+
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_IMAGE_SAMPLE_EXPLICIT_LOD, operands);
+
+	return result;
+}
+
+static spirv_id write_op_image_sample_dref_implicit_lod(instructions_buffer *instructions, spirv_id result_type, spirv_id sampled_image, spirv_id coordinate,
+                                                        spirv_id dref) {
+	spirv_id result = allocate_index();
+
+	uint32_t operands[] = {result_type.id, result.id, sampled_image.id, coordinate.id, dref.id};
+
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_IMAGE_SAMPLE_DREF_IMPLICIT_LOD, operands);
+
+	return result;
+}
+
+static spirv_id write_op_image_sample_dref_explicit_lod(instructions_buffer *instructions, spirv_id result_type, spirv_id sampled_image, spirv_id coordinate,
+                                                        spirv_id dref, spirv_id lod) {
+	spirv_id result = allocate_index();
+
+	uint32_t lod_operands = 0x2u;
+	uint32_t operands[]   = {result_type.id, result.id, sampled_image.id, coordinate.id, dref.id, lod_operands, lod.id};
+
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_IMAGE_SAMPLE_DREF_EXPLICIT_LOD, operands);
+
+	return result;
+}
+
+static spirv_id write_op_image_fetch(instructions_buffer *instructions, spirv_id result_type, spirv_id image, spirv_id coordinate, spirv_id lod) {
+	spirv_id result = allocate_index();
+
+	uint32_t lod_operands = 0x2u;
+	uint32_t operands[]   = {result_type.id, result.id, image.id, coordinate.id, lod_operands, lod.id};
+
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_IMAGE_FETCH, operands);
+
+	return result;
+}
+
+static spirv_id write_op_image_gather(instructions_buffer *instructions, spirv_id result_type, spirv_id sampled_image, spirv_id coordinate,
+                                      spirv_id component) {
+	spirv_id result = allocate_index();
+
+	uint32_t operands[] = {result_type.id, result.id, sampled_image.id, coordinate.id, component.id};
+
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_IMAGE_GATHER, operands);
+
+	return result;
+}
+
 static spirv_id write_op_ext_inst(instructions_buffer *instructions, spirv_id result_type, spirv_id set, uint32_t instruction, spirv_id operand) {
 	spirv_id result = allocate_index();
 
@@ -1531,6 +2055,61 @@ static void write_op_image_write(instructions_buffer *instructions, spirv_id ima
 	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_IMAGE_WRITE, operands);
 }
 
+static spirv_id write_op_image_texel_pointer(instructions_buffer *instructions, spirv_id result_type, spirv_id image, spirv_id coordinate, spirv_id sample) {
+	spirv_id result = allocate_index();
+
+	uint32_t operands[] = {result_type.id, result.id, image.id, coordinate.id, sample.id};
+
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_IMAGE_TEXEL_POINTER, operands);
+
+	return result;
+}
+
+static spirv_id write_op_atomic(instructions_buffer *instructions, spirv_opcode o, spirv_id type, spirv_id pointer, scope memory, spirv_id value) {
+	spirv_id result = allocate_index();
+
+	uint32_t operands[] = {type.id, result.id, pointer.id, get_uint_constant(memory).id, get_uint_constant(MEMORY_SEMANTICS_RELAXED).id, value.id};
+
+	write_instruction(instructions, WORD_COUNT(operands), o, operands);
+
+	return result;
+}
+
+static spirv_id write_op_atomic_compare_exchange(instructions_buffer *instructions, spirv_id type, spirv_id pointer, scope memory, spirv_id value,
+                                                 spirv_id comparator) {
+	spirv_id result = allocate_index();
+
+	spirv_id relaxed    = get_uint_constant(MEMORY_SEMANTICS_RELAXED);
+	uint32_t operands[] = {type.id, result.id, pointer.id, get_uint_constant(memory).id, relaxed.id, relaxed.id, value.id, comparator.id};
+
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_ATOMIC_COMPARE_EXCHANGE, operands);
+
+	return result;
+}
+
+static spirv_opcode atomic_opcode(name_id func, type_id t) {
+	if (func == add_name("atomic_add")) {
+		return SPIRV_OPCODE_ATOMIC_I_ADD;
+	}
+	if (func == add_name("atomic_min")) {
+		return t == int_id ? SPIRV_OPCODE_ATOMIC_S_MIN : SPIRV_OPCODE_ATOMIC_U_MIN;
+	}
+	if (func == add_name("atomic_max")) {
+		return t == int_id ? SPIRV_OPCODE_ATOMIC_S_MAX : SPIRV_OPCODE_ATOMIC_U_MAX;
+	}
+	if (func == add_name("atomic_and")) {
+		return SPIRV_OPCODE_ATOMIC_AND;
+	}
+	if (func == add_name("atomic_or")) {
+		return SPIRV_OPCODE_ATOMIC_OR;
+	}
+	if (func == add_name("atomic_xor")) {
+		return SPIRV_OPCODE_ATOMIC_XOR;
+	}
+	assert(func == add_name("atomic_exchange"));
+	return SPIRV_OPCODE_ATOMIC_EXCHANGE;
+}
+
 static spirv_id write_op_variable(instructions_buffer *instructions, spirv_id result_type, storage_class storage) {
 	spirv_id result = allocate_index();
 
@@ -1684,11 +2263,96 @@ static spirv_id write_op_dot(instructions_buffer *instructions, spirv_id type, s
 	return result;
 }
 
-static spirv_id write_op_dpdx(instructions_buffer *instructions, spirv_id type, spirv_id operand) {
+static spirv_id write_op_group_non_uniform(instructions_buffer *instructions, spirv_opcode o, spirv_id type, spirv_id *arguments, uint16_t arguments_size) {
 	spirv_id result = allocate_index();
 
-	uint32_t operands[] = {type.id, result.id, operand.id};
-	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_DPDX, operands);
+	operands_buffer[0] = type.id;
+	operands_buffer[1] = result.id;
+	operands_buffer[2] = get_uint_constant(SCOPE_SUBGROUP).id;
+	for (uint16_t i = 0; i < arguments_size; ++i) {
+		operands_buffer[i + 3] = arguments[i].id;
+	}
+
+	write_instruction(instructions, 4 + arguments_size, o, operands_buffer);
+	return result;
+}
+
+static void write_op_control_barrier(instructions_buffer *instructions, scope execution, scope memory, uint32_t semantics) {
+	uint32_t operands[] = {get_uint_constant(execution).id, get_uint_constant(memory).id, get_uint_constant(semantics).id};
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_CONTROL_BARRIER, operands);
+}
+
+static void write_op_memory_barrier(instructions_buffer *instructions, scope memory, uint32_t semantics) {
+	uint32_t operands[] = {get_uint_constant(memory).id, get_uint_constant(semantics).id};
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_MEMORY_BARRIER, operands);
+}
+
+static spirv_id write_op_group_non_uniform_operation(instructions_buffer *instructions, spirv_opcode o, spirv_id type, group_operation operation,
+                                                     spirv_id value) {
+	spirv_id result = allocate_index();
+
+	uint32_t operands[] = {type.id, result.id, get_uint_constant(SCOPE_SUBGROUP).id, (uint32_t)operation, value.id};
+	write_instruction(instructions, WORD_COUNT(operands), o, operands);
+	return result;
+}
+
+// half, short and ushort use the instructions of float, int and uint
+static type_id arithmetic_base_type(type_id t) {
+	type_id base = vector_base_type(t);
+	if (base == half_id) {
+		return float_id;
+	}
+	if (base == short_id) {
+		return int_id;
+	}
+	if (base == ushort_id) {
+		return uint_id;
+	}
+	return base;
+}
+
+static spirv_id write_multiplication(instructions_buffer *instructions, type_id type, spirv_id operand1, spirv_id operand2) {
+	type_id base = arithmetic_base_type(type);
+	if (base == int_id || base == uint_id) {
+		return write_op_i_mul(instructions, convert_type_to_spirv_id(type), operand1, operand2);
+	}
+	return write_op_f_mul(instructions, convert_type_to_spirv_id(type), operand1, operand2);
+}
+
+static spirv_id write_division(instructions_buffer *instructions, type_id type, spirv_id operand1, spirv_id operand2) {
+	type_id base = arithmetic_base_type(type);
+	if (base == int_id) {
+		return write_op_s_div(instructions, convert_type_to_spirv_id(type), operand1, operand2);
+	}
+	if (base == uint_id) {
+		return write_op_u_div(instructions, convert_type_to_spirv_id(type), operand1, operand2);
+	}
+	return write_op_f_div(instructions, convert_type_to_spirv_id(type), operand1, operand2);
+}
+
+// Picks the float, signed or unsigned flavor of a GroupNonUniform arithmetic instruction
+static spirv_opcode group_non_uniform_opcode(type_id t, spirv_opcode float_opcode, spirv_opcode sint_opcode, spirv_opcode uint_opcode) {
+	type_id base = arithmetic_base_type(t);
+	if (base == float_id) {
+		return float_opcode;
+	}
+	if (base == int_id) {
+		return sint_opcode;
+	}
+	if (base == uint_id) {
+		return uint_opcode;
+	}
+
+	debug_context context = KONG_INIT_ZERO;
+	error(context, "Type unsupported for wave operations in SPIR-V");
+	return float_opcode;
+}
+
+static spirv_id write_op_dpdx(instructions_buffer *instructions, spirv_id type, spirv_id operand) {
+	spirv_id result = allocate_index();
+
+	uint32_t operands[] = {type.id, result.id, operand.id};
+	write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_DPDX, operands);
 	return result;
 }
 
@@ -1717,13 +2381,46 @@ static spirv_id convert_kong_index_to_spirv_id(uint64_t index) {
 static bool is_global_const(uint64_t index) {
 	for (global_id i = 0; get_global(i) != NULL; ++i) {
 		global *g = get_global(i);
-		if (g->var_index == index && g->type == float_id) {
+		if (g->var_index == index && global_is_scalar_constant(g)) {
 			return true;
 		}
 	}
 	return false;
 }
 
+static global *find_global_by_var_index(uint64_t index) {
+	for (global_id i = 0; get_global(i) != NULL && get_global(i)->type != NO_TYPE; ++i) {
+		if (get_global(i)->var_index == index) {
+			return get_global(i);
+		}
+	}
+	return NULL;
+}
+
+// Storage buffers wrap their runtime array in a struct
+static uint16_t prepend_buffer_member_index(spirv_id *indices, uint16_t indices_size) {
+	for (uint16_t i = indices_size; i > 0; --i) {
+		indices[i] = indices[i - 1];
+	}
+	indices[0] = get_int_constant(0);
+	return indices_size + 1;
+}
+
+// R32 textures become integer images, atomics can only work on those
+static bool is_integer_image(type_id t) {
+	return get_type(t)->tex_format == TEXTURE_FORMAT_R32_UINT || get_type(t)->tex_format == TEXTURE_FORMAT_R32_SINT;
+}
+
+static spirv_id readwrite_image_type(type_id t) {
+	if (get_type(t)->tex_format == TEXTURE_FORMAT_R32_UINT) {
+		return spirv_uint_image_type;
+	}
+	if (get_type(t)->tex_format == TEXTURE_FORMAT_R32_SINT) {
+		return spirv_int_image_type;
+	}
+	return spirv_readwrite_image_type;
+}
+
 static spirv_id get_var(instructions_buffer *instructions, variable param) {
 	spirv_id id = convert_kong_index_to_spirv_id(param.index);
 	if (param.kind != VARIABLE_INTERNAL && !is_global_const(param.index)) {
@@ -1749,6 +2446,165 @@ static size_t   input_vars_count = 0;
 static uint32_t vertex_parameter_indices[256];
 static uint32_t vertex_parameter_member_indices[256];
 
+static spirv_id mesh_triangles_variable = KONG_INIT_ZERO;
+static spirv_id task_payload_variable   = KONG_INIT_ZERO;
+
+// the mesh outputs are unsigned, signed values only need a bitcast
+static spirv_id get_unsigned_var(instructions_buffer *instructions, variable var) {
+	spirv_id id = get_var(instructions, var);
+	if (var.type.type == int_id) {
+		return write_op_bitcast(instructions, spirv_uint_type, id);
+	}
+	if (var.type.type == int3_id) {
+		return write_op_bitcast(instructions, spirv_uint3_type, id);
+	}
+	return id;
+}
+
+// copies member by member because the ids of whole structs are only assigned later on in write_types
+static void copy_struct(instructions_buffer *instructions, type_id t, spirv_id from, storage_class from_storage, spirv_id to, storage_class to_storage) {
+	type *s = get_type(t);
+
+	if (s->built_in) {
+		write_op_store(instructions, to, write_op_load(instructions, convert_type_to_spirv_id(t), from));
+		return;
+	}
+
+	for (size_t member_index = 0; member_index < s->members.size; ++member_index) {
+		type_id  member_type = s->members.m[member_index].type.type;
+		spirv_id index       = get_int_constant((int)member_index);
+
+		spirv_id from_pointer = write_op_access_chain(instructions, convert_pointer_type_to_spirv_id(member_type, from_storage), from, &index, 1);
+		spirv_id to_pointer   = write_op_access_chain(instructions, convert_pointer_type_to_spirv_id(member_type, to_storage), to, &index, 1);
+		write_op_store(instructions, to_pointer, write_op_load(instructions, convert_type_to_spirv_id(member_type), from_pointer));
+	}
+}
+
+static spirv_id texture_image_type(variable image_var, spirv_id *sampled_image_type) {
+	switch (get_type(image_var.type.type)->tex_kind) {
+	case TEXTURE_KIND_2D:
+		*sampled_image_type = spirv_sampled_image_type;
+		return spirv_image_type;
+	case TEXTURE_KIND_2D_ARRAY:
+		*sampled_image_type = spirv_sampled_image2darray_type;
+		return spirv_image2darray_type;
+	case TEXTURE_KIND_CUBE:
+		*sampled_image_type = spirv_sampled_imagecube_type;
+		return spirv_imagecube_type;
+	default: {
+		debug_context context = KONG_INIT_ZERO;
+		error(context, "Unsupported texture kind");
+		return spirv_image_type;
+	}
+	}
+}
+
+static spirv_id write_sampled_image(instructions_buffer *instructions, variable image_var, variable sampler_var) {
+	spirv_id sampled_image_type;
+	spirv_id image_type = texture_image_type(image_var, &sampled_image_type);
+
+	spirv_id image   = write_op_load(instructions, image_type, convert_kong_index_to_spirv_id(image_var.index));
+	spirv_id sampler = write_op_load(instructions, spirv_sampler_type, convert_kong_index_to_spirv_id(sampler_var.index));
+	return write_op_sampled_image(instructions, sampled_image_type, image, sampler);
+}
+
+// depth textures return a single float
+static spirv_id extract_depth(instructions_buffer *instructions, variable image_var, spirv_id texel) {
+	if (!is_depth(get_type(image_var.type.type)->tex_format)) {
+		return texel;
+	}
+
+	uint32_t index = 0;
+	return write_op_composite_extract(instructions, spirv_float_type, texel, &index, 1);
+}
+
+// The built-in math functions return the float or half type the typer picked for the call
+static spirv_id call_result_type(opcode *o) {
+	return convert_type_to_spirv_id(o->op_call.var.type.type);
+}
+
+// Converts between float, int and uint and between their 16 and 32 bit versions, the number of components stays the same
+static spirv_id write_conversion(instructions_buffer *instructions, type_id to, type_id from, spirv_id value) {
+	type_id to_base   = vector_base_type(to);
+	type_id from_base = vector_base_type(from);
+
+	if (to_base == from_base) {
+		return value;
+	}
+
+	spirv_id to_type      = convert_type_to_spirv_id(to);
+	bool     to_float     = arithmetic_base_type(to) == float_id;
+	bool     to_signed    = arithmetic_base_type(to) == int_id;
+	bool     from_float   = arithmetic_base_type(from) == float_id;
+	bool     from_signed  = arithmetic_base_type(from) == int_id;
+	bool     width_change = is_16bit_type(to) != is_16bit_type(from);
+
+	if (to_float && from_float) {
+		return write_op_f_convert(instructions, to_type, value);
+	}
+	if (to_float) {
+		return from_signed ? write_op_convert_s_to_f(instructions, to_type, value) : write_op_convert_u_to_f(instructions, to_type, value);
+	}
+	if (from_float) {
+		return to_signed ? write_op_convert_f_to_s(instructions, to_type, value) : write_op_convert_f_to_u(instructions, to_type, value);
+	}
+	if (width_change && from_signed) {
+		return write_op_s_convert(instructions, to_type, value);
+	}
+	if (width_change) {
+		// UConvert only creates unsigned values
+		type_id  unsigned_to = vector_to_size(is_16bit_type(to) ? ushort_id : uint_id, vector_size(to));
+		spirv_id converted   = write_op_u_convert(instructions, convert_type_to_spirv_id(unsigned_to), value);
+		return unsigned_to == to ? converted : write_op_bitcast(instructions, to_type, converted);
+	}
+	return write_op_bitcast(instructions, to_type, value);
+}
+
+// Constructors which create 16 bit values or take them as parameters
+static bool is_16bit_constructor(opcode *o) {
+	type_id constructed = find_type_by_name(o->op_call.func);
+	if (constructed == NO_TYPE || !(is_vector_or_scalar(constructed) || is_matrix(constructed))) {
+		return false;
+	}
+
+	if (is_16bit_type(constructed)) {
+		return true;
+	}
+
+	for (uint8_t i = 0; i < o->op_call.parameters_size; ++i) {
+		if (is_16bit_type(o->op_call.parameters[i].type.type)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static spirv_id write_16bit_constructor(instructions_buffer *instructions, opcode *o) {
+	type_id  constructed      = find_type_by_name(o->op_call.func);
+	spirv_id constructed_type = convert_type_to_spirv_id(constructed);
+
+	spirv_id constituents[4];
+	assert(o->op_call.parameters_size <= 4);
+
+	for (uint8_t i = 0; i < o->op_call.parameters_size; ++i) {
+		variable parameter = o->op_call.parameters[i];
+		constituents[i]    = get_var(instructions, parameter);
+
+		// matrix columns already have the type of the matrix
+		if (is_vector_or_scalar(constructed) && is_vector_or_scalar(parameter.type.type)) {
+			type_id converted = vector_to_size(vector_base_type(constructed), vector_size(parameter.type.type));
+			constituents[i]   = write_conversion(instructions, converted, parameter.type.type, constituents[i]);
+		}
+	}
+
+	if (o->op_call.parameters_size == 1 && is_vector_or_scalar(constructed) && vector_size(o->op_call.parameters[0].type.type) == vector_size(constructed)) {
+		return constituents[0];
+	}
+
+	return write_op_composite_construct(instructions, constructed_type, constituents, o->op_call.parameters_size);
+}
+
 static void write_function(instructions_buffer *instructions, function *f, spirv_id result_type, spirv_id fun_type, spirv_id fun_id, shader_stage stage,
                            bool main, type_id output) {
 	write_op_function_preallocated(instructions, result_type, FUNCTION_CONTROL_NONE, fun_type, fun_id);
@@ -1791,7 +2647,7 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 	spirv_id spirv_parameter_ids[256] = KONG_INIT_ZERO;
 	uint32_t spirv_parameter_ids_size = 0;
 	if (main) {
-		if (stage == SHADER_STAGE_FRAGMENT) {
+		if (stage == SHADER_STAGE_FRAGMENT || (stage == SHADER_STAGE_MESH && f->parameters_size > 0)) {
 			spirv_parameter_ids[0] = convert_kong_index_to_spirv_id(parameter_ids[0]);
 			write_op_variable_preallocated(instructions, convert_pointer_type_to_spirv_id(parameter_types[0], STORAGE_CLASS_FUNCTION), spirv_parameter_ids[0],
 			                               STORAGE_CLASS_FUNCTION);
@@ -1853,6 +2709,10 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 				write_op_store(instructions, pointer, loaded);
 			}
 		}
+		else if (stage == SHADER_STAGE_MESH && f->parameters_size > 0) {
+			copy_struct(instructions, parameter_types[0], task_payload_variable, STORAGE_CLASS_TASK_PAYLOAD_WORKGROUP_EXT, spirv_parameter_ids[0],
+			            STORAGE_CLASS_FUNCTION);
+		}
 	}
 	else {
 		for (uint8_t parameter_index = 0; parameter_index < f->parameters_size; ++parameter_index) {
@@ -1880,12 +2740,23 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 				assert(indices_size == 1);
 				assert(o->op_load_access_list.access_list[0].kind == ACCESS_ELEMENT);
 
-				spirv_id image = write_op_load(instructions, spirv_readwrite_image_type, convert_kong_index_to_spirv_id(o->op_load_access_list.from.index));
+				type_id  image_kong_type = o->op_load_access_list.from.type.type;
+				spirv_id image           = write_op_load(instructions, readwrite_image_type(image_kong_type),
+				                                         convert_kong_index_to_spirv_id(o->op_load_access_list.from.index));
 
 				variable coordinate_var = o->op_load_access_list.access_list[0].access_element.index;
 				spirv_id coordinate     = get_var(instructions, coordinate_var);
 
-				spirv_id value = write_op_image_read(instructions, spirv_float4_type, image, coordinate);
+				spirv_id value;
+				if (is_integer_image(image_kong_type)) {
+					type_id  element_type = o->op_load_access_list.to.type.type;
+					spirv_id texel        = write_op_image_read(instructions, element_type == uint_id ? spirv_uint4_type : spirv_int4_type, image, coordinate);
+					uint32_t channel      = 0;
+					value                 = write_op_composite_extract(instructions, convert_type_to_spirv_id(element_type), texel, &channel, 1);
+				}
+				else {
+					value = write_op_image_read(instructions, spirv_float4_type, image, coordinate);
+				}
 
 				hmput(index_map, o->op_load_access_list.to.index, value);
 			}
@@ -1943,9 +2814,9 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 				for (uint16_t i = 0; i < indices_size; ++i) {
 					switch (o->op_load_access_list.access_list[i].kind) {
 					case ACCESS_ELEMENT:
-						access_kinds[i]  = ACCESS_SWIZZLE;
+						access_kinds[i]  = s->array_size > 0 ? ACCESS_ELEMENT : ACCESS_SWIZZLE;
 						plain_indices[i] = 0; // unused
-						indices[i]       = convert_kong_index_to_spirv_id(o->op_load_access_list.access_list[i].access_element.index.index);
+						indices[i]       = get_var(instructions, o->op_load_access_list.access_list[i].access_element.index);
 						break;
 					case ACCESS_MEMBER: {
 						int  member_index = 0;
@@ -1990,18 +2861,27 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 					access_type = convert_pointer_type_to_spirv_id(access_kong_type, STORAGE_CLASS_FUNCTION);
 					break;
 				case VARIABLE_GLOBAL: {
-					bool root_constant = false;
+					storage_class storage = STORAGE_CLASS_UNIFORM;
 
 					for (global_id global_index = 0; get_global(global_index) != NULL && get_global(global_index)->type != NO_TYPE; ++global_index) {
 						global *g = get_global(global_index);
 
 						if (o->op_load_access_list.from.index == g->var_index) {
-							root_constant = find_attribute(&g->attributes, add_name("root_constants")) != NULL;
+							if (g->group_shared) {
+								storage = STORAGE_CLASS_WORKGROUP;
+							}
+							else if (find_attribute(&g->attributes, add_name("root_constants")) != NULL) {
+								storage = STORAGE_CLASS_PUSH_CONSTANT;
+							}
+							else if (global_is_buffer(g)) {
+								storage      = buffer_storage_class;
+								indices_size = prepend_buffer_member_index(indices, indices_size);
+							}
 							break;
 						}
 					}
 
-					access_type = convert_pointer_type_to_spirv_id(access_kong_type, root_constant ? STORAGE_CLASS_PUSH_CONSTANT : STORAGE_CLASS_UNIFORM);
+					access_type = convert_pointer_type_to_spirv_id(access_kong_type, storage);
 
 					break;
 				}
@@ -2019,12 +2899,20 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 			break;
 		}
 		case OPCODE_LOAD_FLOAT_CONSTANT: {
-			spirv_id id = get_float_constant(o->op_load_float_constant.number);
+			bool     half = is_16bit_type(o->op_load_float_constant.to.type.type);
+			spirv_id id   = half ? get_half_constant(o->op_load_float_constant.number) : get_float_constant(o->op_load_float_constant.number);
 			hmput(index_map, o->op_load_float_constant.to.index, id);
 			break;
 		}
 		case OPCODE_LOAD_INT_CONSTANT: {
-			spirv_id id = get_int_constant(o->op_load_int_constant.number);
+			type_id  to_type = o->op_load_int_constant.to.type.type;
+			spirv_id id;
+			if (is_16bit_type(to_type)) {
+				id = to_type == short_id ? get_short_constant(o->op_load_int_constant.number) : get_ushort_constant(o->op_load_int_constant.number);
+			}
+			else {
+				id = get_int_constant(o->op_load_int_constant.number);
+			}
 			hmput(index_map, o->op_load_int_constant.to.index, id);
 			break;
 		}
@@ -2033,6 +2921,52 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 			hmput(index_map, o->op_load_bool_constant.to.index, id);
 			break;
 		}
+		case OPCODE_ATOMIC: {
+			type_id  element_type       = o->op_atomic.var.type.type;
+			spirv_id spirv_element_type = convert_type_to_spirv_id(element_type);
+
+			global *g = find_global_by_var_index(o->op_atomic.to.index);
+			assert(g != NULL);
+
+			spirv_id pointer;
+			scope    memory = SCOPE_DEVICE;
+
+			if (is_texture(g->type)) {
+				spirv_id coordinate = get_var(instructions, o->op_atomic.index);
+				pointer = write_op_image_texel_pointer(instructions, convert_pointer_type_to_spirv_id(element_type, STORAGE_CLASS_IMAGE),
+				                                       convert_kong_index_to_spirv_id(o->op_atomic.to.index), coordinate, get_uint_constant(0));
+			}
+			else if (g->group_shared) {
+				spirv_id index = get_var(instructions, o->op_atomic.index);
+				pointer        = write_op_access_chain(instructions, convert_pointer_type_to_spirv_id(element_type, STORAGE_CLASS_WORKGROUP),
+				                                       convert_kong_index_to_spirv_id(o->op_atomic.to.index), &index, 1);
+				memory         = SCOPE_WORKGROUP;
+			}
+			else {
+				spirv_id indices[2] = {get_int_constant(0), get_var(instructions, o->op_atomic.index)};
+				pointer             = write_op_access_chain(instructions, convert_pointer_type_to_spirv_id(element_type, buffer_storage_class),
+				                                            convert_kong_index_to_spirv_id(o->op_atomic.to.index), indices, 2);
+			}
+
+			spirv_id values[2];
+			for (uint8_t i = 0; i < o->op_atomic.values_size; ++i) {
+				values[i] = get_var(instructions, o->op_atomic.values[i]);
+				if (o->op_atomic.values[i].type.type != element_type) {
+					values[i] = write_op_bitcast(instructions, spirv_element_type, values[i]);
+				}
+			}
+
+			spirv_id result;
+			if (o->op_atomic.func == add_name("atomic_compare_exchange")) {
+				result = write_op_atomic_compare_exchange(instructions, spirv_element_type, pointer, memory, values[1], values[0]);
+			}
+			else {
+				result = write_op_atomic(instructions, atomic_opcode(o->op_atomic.func, element_type), spirv_element_type, pointer, memory, values[0]);
+			}
+
+			hmput(index_map, o->op_atomic.var.index, result);
+			break;
+		}
 		case OPCODE_CALL: {
 			name_id func = o->op_call.func;
 
@@ -2041,75 +2975,87 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 			if (func == add_name("sample")) {
 				variable image_var = o->op_call.parameters[0];
 
-				spirv_id image_type;
-				spirv_id sampled_image_type;
-
-				if (get_type(image_var.type.type)->tex_kind != TEXTURE_KIND_NONE) {
-					if (get_type(image_var.type.type)->tex_kind == TEXTURE_KIND_2D) {
-						image_type         = spirv_image_type;
-						sampled_image_type = spirv_sampled_image_type;
-					}
-					else if (get_type(image_var.type.type)->tex_kind == TEXTURE_KIND_2D_ARRAY) {
-						image_type         = spirv_image2darray_type;
-						sampled_image_type = spirv_sampled_image2darray_type;
-					}
-					else if (get_type(image_var.type.type)->tex_kind == TEXTURE_KIND_CUBE) {
-						image_type         = spirv_imagecube_type;
-						sampled_image_type = spirv_sampled_imagecube_type;
-					}
-					else {
-						// TODO
-						assert(false);
-					}
-				}
-
-				spirv_id image         = write_op_load(instructions, image_type, convert_kong_index_to_spirv_id(image_var.index));
-				spirv_id sampler       = write_op_load(instructions, spirv_sampler_type, convert_kong_index_to_spirv_id(o->op_call.parameters[1].index));
-				spirv_id sampled_image = write_op_sampled_image(instructions, sampled_image_type, image, sampler);
+				spirv_id sampled_image = write_sampled_image(instructions, image_var, o->op_call.parameters[1]);
 				spirv_id coordinate    = get_var(instructions, o->op_call.parameters[2]);
 
 				spirv_id id = write_op_image_sample_implicit_lod(instructions, spirv_float4_type, sampled_image, coordinate);
+				id          = extract_depth(instructions, image_var, id);
 
-				if (is_depth(get_type(image_var.type.type)->tex_format)) {
-					uint32_t index = 0;
+				hmput(index_map, o->op_call.var.index, id);
+			}
+			else if (func == add_name("sample_lod")) {
+				variable image_var = o->op_call.parameters[0];
 
-					id = write_op_composite_extract(instructions, spirv_float_type, id, &index, 1);
-				}
+				spirv_id sampled_image = write_sampled_image(instructions, image_var, o->op_call.parameters[1]);
+				spirv_id coordinate    = get_var(instructions, o->op_call.parameters[2]);
+				spirv_id lod           = get_var(instructions, o->op_call.parameters[3]);
 
+				spirv_id id = write_op_image_sample_explicit_lod(instructions, spirv_float4_type, sampled_image, coordinate, lod);
 				hmput(index_map, o->op_call.var.index, id);
 			}
-			else if (func == add_name("sample_lod")) {
+			else if (func == add_name("load")) {
 				variable image_var = o->op_call.parameters[0];
 
-				spirv_id image_type;
+				debug_context context = KONG_INIT_ZERO;
+				check(get_type(image_var.type.type)->tex_kind != TEXTURE_KIND_CUBE, context, "load does not support cube textures");
+
 				spirv_id sampled_image_type;
+				spirv_id image_type = texture_image_type(image_var, &sampled_image_type);
+				spirv_id image      = write_op_load(instructions, image_type, convert_kong_index_to_spirv_id(image_var.index));
+				spirv_id coordinate = get_var(instructions, o->op_call.parameters[1]);
+				spirv_id lod        = get_var(instructions, o->op_call.parameters[2]);
 
-				if (get_type(image_var.type.type)->tex_kind != TEXTURE_KIND_NONE) {
-					if (get_type(image_var.type.type)->tex_kind == TEXTURE_KIND_2D) {
-						image_type         = spirv_image_type;
-						sampled_image_type = spirv_sampled_image_type;
-					}
-					else if (get_type(image_var.type.type)->tex_kind == TEXTURE_KIND_2D_ARRAY) {
-						image_type         = spirv_image2darray_type;
-						sampled_image_type = spirv_sampled_image2darray_type;
-					}
-					else if (get_type(image_var.type.type)->tex_kind == TEXTURE_KIND_CUBE) {
-						image_type         = spirv_imagecube_type;
-						sampled_image_type = spirv_sampled_imagecube_type;
-					}
-					else {
-						// TODO
-						assert(false);
-					}
-				}
+				spirv_id id = write_op_image_fetch(instructions, spirv_float4_type, image, coordinate, lod);
+				id          = extract_depth(instructions, image_var, id);
+				hmput(index_map, o->op_call.var.index, id);
+			}
+			else if (is_gather_function(func)) {
+				spirv_id sampled_image = write_sampled_image(instructions, o->op_call.parameters[0], o->op_call.parameters[1]);
+				spirv_id coordinate    = get_var(instructions, o->op_call.parameters[2]);
+
+				spirv_id id = write_op_image_gather(instructions, spirv_float4_type, sampled_image, coordinate, get_int_constant(gather_component(func)));
+				hmput(index_map, o->op_call.var.index, id);
+			}
+			else if (func == add_name("sample_grad")) {
+				variable image_var = o->op_call.parameters[0];
 
-				spirv_id image         = write_op_load(instructions, image_type, convert_kong_index_to_spirv_id(image_var.index));
-				spirv_id sampler       = write_op_load(instructions, spirv_sampler_type, convert_kong_index_to_spirv_id(o->op_call.parameters[1].index));
-				spirv_id sampled_image = write_op_sampled_image(instructions, sampled_image_type, image, sampler);
+				spirv_id sampled_image = write_sampled_image(instructions, image_var, o->op_call.parameters[1]);
 				spirv_id coordinate    = get_var(instructions, o->op_call.parameters[2]);
-				spirv_id lod           = get_var(instructions, o->op_call.parameters[3]);
+				spirv_id dx            = get_var(instructions, o->op_call.parameters[3]);
+				spirv_id dy            = get_var(instructions, o->op_call.parameters[4]);
 
-				spirv_id id = write_op_image_sample_explicit_lod(instructions, spirv_float4_type, sampled_image, coordinate, lod);
+				spirv_id id = write_op_image_sample_grad(instructions, spirv_float4_type, sampled_image, coordinate, dx, dy);
+				id          = extract_depth(instructions, image_var, id);
+				hmput(index_map, o->op_call.var.index, id);
+			}
+			else if (func == add_name("sample_bias")) {
+				variable image_var = o->op_call.parameters[0];
+
+				spirv_id sampled_image = write_sampled_image(instructions, image_var, o->op_call.parameters[1]);
+				spirv_id coordinate    = get_var(instructions, o->op_call.parameters[2]);
+				spirv_id bias          = get_var(instructions, o->op_call.parameters[3]);
+
+				spirv_id id = write_op_image_sample_bias(instructions, spirv_float4_type, sampled_image, coordinate, bias);
+				id          = extract_depth(instructions, image_var, id);
+				hmput(index_map, o->op_call.var.index, id);
+			}
+			else if (func == add_name("sample_compare")) {
+				spirv_id sampled_image = write_sampled_image(instructions, o->op_call.parameters[0], o->op_call.parameters[1]);
+				spirv_id coordinate    = get_var(instructions, o->op_call.parameters[2]);
+				spirv_id dref          = get_var(instructions, o->op_call.parameters[3]);
+
+				// implicit levels need the derivatives of fragment shaders
+				spirv_id id;
+				if (stage == SHADER_STAGE_FRAGMENT) {
+					id = write_op_image_sample_dref_implicit_lod(instructions, spirv_float_type, sampled_image, coordinate, dref);
+				}
+				else {
+					id = write_op_image_sample_dref_explicit_lod(instructions, spirv_float_type, sampled_image, coordinate, dref, get_float_constant(0.0f));
+				}
+				hmput(index_map, o->op_call.var.index, id);
+			}
+			else if (is_16bit_constructor(o)) {
+				spirv_id id = write_16bit_constructor(instructions, o);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("float")) {
@@ -2287,159 +3233,309 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 				spirv_id id = write_op_load(instructions, convert_type_to_spirv_id(uint_id), vertex_id_variable);
 				hmput(index_map, o->op_call.var.index, id);
 			}
+			else if (func == add_name("wave_lane_index")) {
+				spirv_id id = write_op_load(instructions, spirv_uint_type, wave_lane_index_variable);
+				hmput(index_map, o->op_call.var.index, id);
+			}
+			else if (func == add_name("wave_lane_count")) {
+				spirv_id id = write_op_load(instructions, spirv_uint_type, wave_lane_count_variable);
+				hmput(index_map, o->op_call.var.index, id);
+			}
+			else if (func == add_name("wave_is_first_lane")) {
+				spirv_id id = write_op_group_non_uniform(instructions, SPIRV_OPCODE_GROUP_NON_UNIFORM_ELECT, spirv_bool_type, NULL, 0);
+				hmput(index_map, o->op_call.var.index, id);
+			}
+			else if (func == add_name("wave_all_true") || func == add_name("wave_any_true") || func == add_name("wave_ballot") ||
+			         func == add_name("wave_read_first")) {
+				spirv_opcode opcode = SPIRV_OPCODE_GROUP_NON_UNIFORM_ALL;
+				if (func == add_name("wave_any_true")) {
+					opcode = SPIRV_OPCODE_GROUP_NON_UNIFORM_ANY;
+				}
+				else if (func == add_name("wave_ballot")) {
+					opcode = SPIRV_OPCODE_GROUP_NON_UNIFORM_BALLOT;
+				}
+				else if (func == add_name("wave_read_first")) {
+					opcode = SPIRV_OPCODE_GROUP_NON_UNIFORM_BROADCAST_FIRST;
+				}
+
+				spirv_id operand = get_var(instructions, o->op_call.parameters[0]);
+				spirv_id id      = write_op_group_non_uniform(instructions, opcode, convert_type_to_spirv_id(o->op_call.var.type.type), &operand, 1);
+				hmput(index_map, o->op_call.var.index, id);
+			}
+			else if (func == add_name("wave_count_bits")) {
+				spirv_id operand = get_var(instructions, o->op_call.parameters[0]);
+				spirv_id ballot  = write_op_group_non_uniform(instructions, SPIRV_OPCODE_GROUP_NON_UNIFORM_BALLOT, spirv_uint4_type, &operand, 1);
+				spirv_id id      = write_op_group_non_uniform_operation(instructions, SPIRV_OPCODE_GROUP_NON_UNIFORM_BALLOT_BIT_COUNT, spirv_uint_type,
+				                                                        GROUP_OPERATION_REDUCE, ballot);
+				hmput(index_map, o->op_call.var.index, id);
+			}
+			else if (func == add_name("wave_read_lane")) {
+				spirv_id arguments[2];
+				arguments[0] = get_var(instructions, o->op_call.parameters[0]);
+				arguments[1] = get_var(instructions, o->op_call.parameters[1]);
+				if (o->op_call.parameters[1].type.type == int_id) {
+					// the lane has to be unsigned
+					arguments[1] = write_op_bitcast(instructions, spirv_uint_type, arguments[1]);
+				}
+				spirv_id type = convert_type_to_spirv_id(o->op_call.var.type.type);
+				spirv_id id   = write_op_group_non_uniform(instructions, SPIRV_OPCODE_GROUP_NON_UNIFORM_SHUFFLE, type, arguments, 2);
+				hmput(index_map, o->op_call.var.index, id);
+			}
+			else if (func == add_name("wave_sum") || func == add_name("wave_prefix_sum")) {
+				type_id         t         = o->op_call.var.type.type;
+				spirv_opcode    opcode    = group_non_uniform_opcode(t, SPIRV_OPCODE_GROUP_NON_UNIFORM_F_ADD, SPIRV_OPCODE_GROUP_NON_UNIFORM_I_ADD,
+				                                                     SPIRV_OPCODE_GROUP_NON_UNIFORM_I_ADD);
+				group_operation operation = func == add_name("wave_sum") ? GROUP_OPERATION_REDUCE : GROUP_OPERATION_EXCLUSIVE_SCAN;
+				spirv_id        operand   = get_var(instructions, o->op_call.parameters[0]);
+				spirv_id        id        = write_op_group_non_uniform_operation(instructions, opcode, convert_type_to_spirv_id(t), operation, operand);
+				hmput(index_map, o->op_call.var.index, id);
+			}
+			else if (func == add_name("wave_min")) {
+				type_id      t       = o->op_call.var.type.type;
+				spirv_opcode opcode  = group_non_uniform_opcode(t, SPIRV_OPCODE_GROUP_NON_UNIFORM_F_MIN, SPIRV_OPCODE_GROUP_NON_UNIFORM_S_MIN,
+				                                                SPIRV_OPCODE_GROUP_NON_UNIFORM_U_MIN);
+				spirv_id     operand = get_var(instructions, o->op_call.parameters[0]);
+				spirv_id     id      = write_op_group_non_uniform_operation(instructions, opcode, convert_type_to_spirv_id(t), GROUP_OPERATION_REDUCE, operand);
+				hmput(index_map, o->op_call.var.index, id);
+			}
+			else if (func == add_name("wave_max")) {
+				type_id      t       = o->op_call.var.type.type;
+				spirv_opcode opcode  = group_non_uniform_opcode(t, SPIRV_OPCODE_GROUP_NON_UNIFORM_F_MAX, SPIRV_OPCODE_GROUP_NON_UNIFORM_S_MAX,
+				                                                SPIRV_OPCODE_GROUP_NON_UNIFORM_U_MAX);
+				spirv_id     operand = get_var(instructions, o->op_call.parameters[0]);
+				spirv_id     id      = write_op_group_non_uniform_operation(instructions, opcode, convert_type_to_spirv_id(t), GROUP_OPERATION_REDUCE, operand);
+				hmput(index_map, o->op_call.var.index, id);
+			}
+			else if (func == add_name("group_barrier")) {
+				write_op_control_barrier(instructions, SCOPE_WORKGROUP, SCOPE_WORKGROUP, MEMORY_SEMANTICS_ACQUIRE_RELEASE | MEMORY_SEMANTICS_WORKGROUP_MEMORY);
+			}
+			else if (func == add_name("group_memory_barrier")) {
+				write_op_memory_barrier(instructions, SCOPE_WORKGROUP, MEMORY_SEMANTICS_ACQUIRE_RELEASE | MEMORY_SEMANTICS_WORKGROUP_MEMORY);
+			}
+			else if (func == add_name("device_barrier")) {
+				write_op_control_barrier(instructions, SCOPE_WORKGROUP, SCOPE_DEVICE,
+				                         MEMORY_SEMANTICS_ACQUIRE_RELEASE | MEMORY_SEMANTICS_UNIFORM_MEMORY | MEMORY_SEMANTICS_IMAGE_MEMORY);
+			}
+			else if (func == add_name("device_memory_barrier")) {
+				write_op_memory_barrier(instructions, SCOPE_DEVICE,
+				                        MEMORY_SEMANTICS_ACQUIRE_RELEASE | MEMORY_SEMANTICS_UNIFORM_MEMORY | MEMORY_SEMANTICS_IMAGE_MEMORY);
+			}
+			else if (func == add_name("dispatch_mesh")) {
+				check(stage == SHADER_STAGE_AMPLIFICATION, context, "dispatch_mesh can only be called in amplification shaders");
+
+				variable payload = o->op_call.parameters[3];
+				copy_struct(instructions, payload.type.type, convert_kong_index_to_spirv_id(payload.index), STORAGE_CLASS_FUNCTION, task_payload_variable,
+				            STORAGE_CLASS_TASK_PAYLOAD_WORKGROUP_EXT);
+
+				spirv_id x = get_unsigned_var(instructions, o->op_call.parameters[0]);
+				spirv_id y = get_unsigned_var(instructions, o->op_call.parameters[1]);
+				spirv_id z = get_unsigned_var(instructions, o->op_call.parameters[2]);
+
+				uint32_t operands[] = {x.id, y.id, z.id, task_payload_variable.id};
+				write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_EMIT_MESH_TASKS_EXT, operands);
+
+				// terminates the invocation like a discard
+				ends_with_return                      = true;
+				next_block_branch_id[nested_if_count] = 0;
+			}
+			else if (func == add_name("set_mesh_output_counts")) {
+				check(stage == SHADER_STAGE_MESH, context, "set_mesh_output_counts can only be called in mesh shaders");
+
+				spirv_id vertex_count    = get_unsigned_var(instructions, o->op_call.parameters[0]);
+				spirv_id primitive_count = get_unsigned_var(instructions, o->op_call.parameters[1]);
+
+				uint32_t operands[] = {vertex_count.id, primitive_count.id};
+				write_instruction(instructions, WORD_COUNT(operands), SPIRV_OPCODE_SET_MESH_OUTPUTS_EXT, operands);
+			}
+			else if (func == add_name("set_mesh_triangle")) {
+				check(stage == SHADER_STAGE_MESH, context, "set_mesh_triangle can only be called in mesh shaders");
+
+				spirv_id index        = get_var(instructions, o->op_call.parameters[0]);
+				spirv_id pointer_type = convert_pointer_type_to_spirv_id(uint3_id, STORAGE_CLASS_OUTPUT);
+				spirv_id pointer      = write_op_access_chain(instructions, pointer_type, mesh_triangles_variable, &index, 1);
+				write_op_store(instructions, pointer, get_unsigned_var(instructions, o->op_call.parameters[1]));
+			}
+			else if (func == add_name("set_mesh_vertex")) {
+				check(stage == SHADER_STAGE_MESH, context, "set_mesh_vertex can only be called in mesh shaders");
+
+				spirv_id index  = get_var(instructions, o->op_call.parameters[0]);
+				spirv_id vertex = convert_kong_index_to_spirv_id(o->op_call.parameters[1].index);
+
+				type *vertex_type = get_type(o->op_call.parameters[1].type.type);
+
+				for (size_t member_index = 0; member_index < vertex_type->members.size; ++member_index) {
+					type_id  member_type    = vertex_type->members.m[member_index].type.type;
+					spirv_id member         = get_int_constant((int)member_index);
+					spirv_id member_pointer = write_op_access_chain(instructions, convert_pointer_type_to_spirv_id(member_type, STORAGE_CLASS_FUNCTION), vertex,
+					                                                &member, 1);
+					spirv_id value          = write_op_load(instructions, convert_type_to_spirv_id(member_type), member_pointer);
+
+					spirv_id output_pointer_type = convert_pointer_type_to_spirv_id(member_type, STORAGE_CLASS_OUTPUT);
+					spirv_id output_pointer;
+					if (member_index == 0) {
+						// position
+						spirv_id indices[2] = {index, get_int_constant(0)};
+						output_pointer      = write_op_access_chain(instructions, output_pointer_type, per_vertex_var, indices, 2);
+					}
+					else {
+						output_pointer = write_op_access_chain(instructions, output_pointer_type, output_vars[member_index], &index, 1);
+					}
+					write_op_store(instructions, output_pointer, value);
+				}
+			}
 			else if (func == add_name("dot")) {
 				spirv_id operand1 = get_var(instructions, o->op_call.parameters[0]);
 				spirv_id operand2 = get_var(instructions, o->op_call.parameters[1]);
-				spirv_id id       = write_op_dot(instructions, spirv_float_type, operand1, operand2);
+				spirv_id id       = write_op_dot(instructions, call_result_type(o), operand1, operand2);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("ddx")) {
 				spirv_id operand = get_var(instructions, o->op_call.parameters[0]);
-				spirv_id id      = write_op_dpdx(instructions, spirv_float_type, operand);
+				spirv_id id      = write_op_dpdx(instructions, call_result_type(o), operand);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("ddy")) {
 				spirv_id operand = get_var(instructions, o->op_call.parameters[0]);
-				spirv_id id      = write_op_dpdy(instructions, spirv_float_type, operand);
+				spirv_id id      = write_op_dpdy(instructions, call_result_type(o), operand);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("round")) {
 				spirv_id operand = get_var(instructions, o->op_call.parameters[0]);
-				spirv_id id      = write_op_ext_inst(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_ROUND, operand);
+				spirv_id id      = write_op_ext_inst(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_ROUND, operand);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("floor")) {
 				spirv_id operand = get_var(instructions, o->op_call.parameters[0]);
-				spirv_id id      = write_op_ext_inst(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_FLOOR, operand);
+				spirv_id id      = write_op_ext_inst(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_FLOOR, operand);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("sin")) {
 				spirv_id operand = get_var(instructions, o->op_call.parameters[0]);
-				spirv_id id      = write_op_ext_inst(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_SIN, operand);
+				spirv_id id      = write_op_ext_inst(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_SIN, operand);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("cos")) {
 				spirv_id operand = get_var(instructions, o->op_call.parameters[0]);
-				spirv_id id      = write_op_ext_inst(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_COS, operand);
+				spirv_id id      = write_op_ext_inst(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_COS, operand);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("length")) {
 				spirv_id operand = get_var(instructions, o->op_call.parameters[0]);
-				spirv_id id      = write_op_ext_inst(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_LENGTH, operand);
+				spirv_id id      = write_op_ext_inst(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_LENGTH, operand);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("abs")) {
 				spirv_id operand = get_var(instructions, o->op_call.parameters[0]);
-				spirv_id id      = write_op_ext_inst(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_FABS, operand);
+				spirv_id id      = write_op_ext_inst(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_FABS, operand);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("ceil")) {
 				spirv_id operand = get_var(instructions, o->op_call.parameters[0]);
-				spirv_id id      = write_op_ext_inst(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_CEIL, operand);
+				spirv_id id      = write_op_ext_inst(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_CEIL, operand);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("frac")) {
 				spirv_id operand = get_var(instructions, o->op_call.parameters[0]);
-				spirv_id id      = write_op_ext_inst(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_FRACT, operand);
+				spirv_id id      = write_op_ext_inst(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_FRACT, operand);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("asin")) {
 				spirv_id operand = get_var(instructions, o->op_call.parameters[0]);
-				spirv_id id      = write_op_ext_inst(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_ASIN, operand);
+				spirv_id id      = write_op_ext_inst(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_ASIN, operand);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("acos")) {
 				spirv_id operand = get_var(instructions, o->op_call.parameters[0]);
-				spirv_id id      = write_op_ext_inst(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_ACOS, operand);
+				spirv_id id      = write_op_ext_inst(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_ACOS, operand);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("atan")) {
 				spirv_id operand = get_var(instructions, o->op_call.parameters[0]);
-				spirv_id id      = write_op_ext_inst(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_ATAN, operand);
+				spirv_id id      = write_op_ext_inst(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_ATAN, operand);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("atan2")) {
 				spirv_id operand1 = get_var(instructions, o->op_call.parameters[0]);
 				spirv_id operand2 = get_var(instructions, o->op_call.parameters[1]);
-				spirv_id id       = write_op_ext_inst2(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_ATAN2, operand1, operand2);
+				spirv_id id       = write_op_ext_inst2(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_ATAN2, operand1, operand2);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("pow")) {
 				spirv_id operand1 = get_var(instructions, o->op_call.parameters[0]);
 				spirv_id operand2 = get_var(instructions, o->op_call.parameters[1]);
-				spirv_id id       = write_op_ext_inst2(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_POW, operand1, operand2);
+				spirv_id id       = write_op_ext_inst2(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_POW, operand1, operand2);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("sqrt")) {
 				spirv_id operand = get_var(instructions, o->op_call.parameters[0]);
-				spirv_id id      = write_op_ext_inst(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_SQRT, operand);
+				spirv_id id      = write_op_ext_inst(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_SQRT, operand);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("rsqrt")) {
 				spirv_id operand = get_var(instructions, o->op_call.parameters[0]);
-				spirv_id id      = write_op_ext_inst(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_INVERSE_SQRT, operand);
+				spirv_id id      = write_op_ext_inst(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_INVERSE_SQRT, operand);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("min")) {
 				spirv_id operand1 = get_var(instructions, o->op_call.parameters[0]);
 				spirv_id operand2 = get_var(instructions, o->op_call.parameters[1]);
-				spirv_id id       = write_op_ext_inst2(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_FMIN, operand1, operand2);
+				spirv_id id       = write_op_ext_inst2(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_FMIN, operand1, operand2);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("max")) {
 				spirv_id operand1 = get_var(instructions, o->op_call.parameters[0]);
 				spirv_id operand2 = get_var(instructions, o->op_call.parameters[1]);
-				spirv_id id       = write_op_ext_inst2(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_FMAX, operand1, operand2);
+				spirv_id id       = write_op_ext_inst2(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_FMAX, operand1, operand2);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("clamp")) {
 				spirv_id operand1 = get_var(instructions, o->op_call.parameters[0]);
 				spirv_id operand2 = get_var(instructions, o->op_call.parameters[1]);
 				spirv_id operand3 = get_var(instructions, o->op_call.parameters[2]);
-				spirv_id id       = write_op_ext_inst3(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_FCLAMP, operand1, operand2, operand3);
+				spirv_id id       = write_op_ext_inst3(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_FCLAMP, operand1, operand2, operand3);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("lerp")) {
 				spirv_id operand1 = get_var(instructions, o->op_call.parameters[0]);
 				spirv_id operand2 = get_var(instructions, o->op_call.parameters[1]);
 				spirv_id operand3 = get_var(instructions, o->op_call.parameters[2]);
-				spirv_id id       = write_op_ext_inst3(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_FMIX, operand1, operand2, operand3);
+				spirv_id id       = write_op_ext_inst3(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_FMIX, operand1, operand2, operand3);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("step")) {
 				spirv_id operand1 = get_var(instructions, o->op_call.parameters[0]);
 				spirv_id operand2 = get_var(instructions, o->op_call.parameters[1]);
-				spirv_id id       = write_op_ext_inst2(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_STEP, operand1, operand2);
+				spirv_id id       = write_op_ext_inst2(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_STEP, operand1, operand2);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("smoothstep")) {
 				spirv_id operand1 = get_var(instructions, o->op_call.parameters[0]);
 				spirv_id operand2 = get_var(instructions, o->op_call.parameters[1]);
 				spirv_id operand3 = get_var(instructions, o->op_call.parameters[2]);
-				spirv_id id       = write_op_ext_inst3(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_SMOOTHSTEP, operand1, operand2, operand3);
+				spirv_id id       = write_op_ext_inst3(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_SMOOTHSTEP, operand1, operand2, operand3);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("distance")) {
 				spirv_id operand1 = get_var(instructions, o->op_call.parameters[0]);
 				spirv_id operand2 = get_var(instructions, o->op_call.parameters[1]);
-				spirv_id id       = write_op_ext_inst2(instructions, spirv_float_type, glsl_import, SPIRV_GLSL_STD_DISTANCE, operand1, operand2);
+				spirv_id id       = write_op_ext_inst2(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_DISTANCE, operand1, operand2);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("cross")) {
 				spirv_id operand1 = get_var(instructions, o->op_call.parameters[0]);
 				spirv_id operand2 = get_var(instructions, o->op_call.parameters[1]);
-				spirv_id id       = write_op_ext_inst2(instructions, spirv_float3_type, glsl_import, SPIRV_GLSL_STD_CROSS, operand1, operand2);
+				spirv_id id       = write_op_ext_inst2(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_CROSS, operand1, operand2);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("normalize")) {
 				spirv_id operand = get_var(instructions, o->op_call.parameters[0]);
-				spirv_id id      = write_op_ext_inst(instructions, spirv_float3_type, glsl_import, SPIRV_GLSL_STD_NORMALIZE, operand);
+				spirv_id id      = write_op_ext_inst(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_NORMALIZE, operand);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else if (func == add_name("reflect")) {
 				spirv_id operand1 = get_var(instructions, o->op_call.parameters[0]);
 				spirv_id operand2 = get_var(instructions, o->op_call.parameters[1]);
-				spirv_id id       = write_op_ext_inst2(instructions, spirv_float3_type, glsl_import, SPIRV_GLSL_STD_REFLECT, operand1, operand2);
+				spirv_id id       = write_op_ext_inst2(instructions, call_result_type(o), glsl_import, SPIRV_GLSL_STD_REFLECT, operand1, operand2);
 				hmput(index_map, o->op_call.var.index, id);
 			}
 			else {
@@ -2482,7 +3578,8 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 				assert(indices_size == 1);
 				assert(o->op_store_access_list.access_list[0].kind == ACCESS_ELEMENT);
 
-				spirv_id image = write_op_load(instructions, spirv_readwrite_image_type, convert_kong_index_to_spirv_id(o->op_store_access_list.to.index));
+				spirv_id image = write_op_load(instructions, readwrite_image_type(o->op_store_access_list.to.type.type),
+				                               convert_kong_index_to_spirv_id(o->op_store_access_list.to.index));
 
 				variable coordinate_var = o->op_store_access_list.access_list[0].access_element.index;
 				spirv_id coordinate     = get_var(instructions, coordinate_var);
@@ -2497,7 +3594,7 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 						access_kinds[i]  = ACCESS_ELEMENT;
 						plain_indices[i] = 0; // unused
 
-						indices[i] = convert_kong_index_to_spirv_id(o->op_store_access_list.access_list[i].access_element.index.index);
+						indices[i] = get_var(instructions, o->op_store_access_list.access_list[i].access_element.index);
 
 						break;
 					case ACCESS_MEMBER: {
@@ -2544,9 +3641,28 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 				case VARIABLE_LOCAL:
 					access_type = convert_pointer_type_to_spirv_id(access_kong_type, STORAGE_CLASS_FUNCTION);
 					break;
-				case VARIABLE_GLOBAL:
-					access_type = convert_pointer_type_to_spirv_id(access_kong_type, STORAGE_CLASS_OUTPUT);
+				case VARIABLE_GLOBAL: {
+					storage_class storage = STORAGE_CLASS_OUTPUT;
+
+					for (global_id global_index = 0; get_global(global_index) != NULL && get_global(global_index)->type != NO_TYPE; ++global_index) {
+						global *g = get_global(global_index);
+
+						if (o->op_store_access_list.to.index == g->var_index) {
+							if (g->group_shared) {
+								storage = STORAGE_CLASS_WORKGROUP;
+							}
+							else if (global_is_buffer(g)) {
+								storage      = buffer_storage_class;
+								indices_size = prepend_buffer_member_index(indices, indices_size);
+							}
+							break;
+						}
+					}
+
+					access_type = convert_pointer_type_to_spirv_id(access_kong_type, storage);
+
 					break;
+				}
 				case VARIABLE_INTERNAL:
 					assert(false);
 					break;
@@ -2565,26 +3681,26 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 					spirv_id from   = get_var(instructions, o->op_store_access_list.from);
 
 					if (o->type == OPCODE_ADD_AND_STORE_ACCESS_LIST) {
-						if (vector_base_type(access_kong_type) == float_id) {
+						if (arithmetic_base_type(access_kong_type) == float_id) {
 							result = write_op_f_add(instructions, convert_type_to_spirv_id(access_kong_type), loaded, from);
 						}
-						else if (vector_base_type(access_kong_type) == int_id || vector_base_type(access_kong_type) == uint_id) {
+						else if (arithmetic_base_type(access_kong_type) == int_id || arithmetic_base_type(access_kong_type) == uint_id) {
 							result = write_op_i_add(instructions, convert_type_to_spirv_id(access_kong_type), loaded, from);
 						}
 					}
 					else if (o->type == OPCODE_SUB_AND_STORE_ACCESS_LIST) {
-						if (vector_base_type(access_kong_type) == float_id) {
+						if (arithmetic_base_type(access_kong_type) == float_id) {
 							result = write_op_f_sub(instructions, convert_type_to_spirv_id(access_kong_type), loaded, from);
 						}
-						else if (vector_base_type(access_kong_type) == int_id || vector_base_type(access_kong_type) == uint_id) {
+						else if (arithmetic_base_type(access_kong_type) == int_id || arithmetic_base_type(access_kong_type) == uint_id) {
 							result = write_op_i_sub(instructions, convert_type_to_spirv_id(access_kong_type), loaded, from);
 						}
 					}
 					else if (o->type == OPCODE_MULTIPLY_AND_STORE_ACCESS_LIST) {
-						result = write_op_f_mul(instructions, convert_type_to_spirv_id(access_kong_type), loaded, from);
+						result = write_multiplication(instructions, access_kong_type, loaded, from);
 					}
 					else if (o->type == OPCODE_DIVIDE_AND_STORE_ACCESS_LIST) {
-						result = write_op_f_div(instructions, convert_type_to_spirv_id(access_kong_type), loaded, from);
+						result = write_division(instructions, access_kong_type, loaded, from);
 					}
 				}
 
@@ -2648,11 +3764,11 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 		case OPCODE_NEGATE: {
 			spirv_id from = get_var(instructions, o->op_negate.from);
 
-			if (vector_base_type(o->op_negate.from.type.type) == float_id) {
+			if (arithmetic_base_type(o->op_negate.from.type.type) == float_id) {
 				spirv_id result = write_op_f_negate(instructions, convert_type_to_spirv_id(o->op_negate.to.type.type), from);
 				hmput(index_map, o->op_negate.to.index, result);
 			}
-			else if (vector_base_type(o->op_negate.from.type.type) == int_id || vector_base_type(o->op_negate.from.type.type) == uint_id) {
+			else if (arithmetic_base_type(o->op_negate.from.type.type) == int_id || arithmetic_base_type(o->op_negate.from.type.type) == uint_id) {
 				spirv_id result = write_op_s_negate(instructions, convert_type_to_spirv_id(o->op_negate.to.type.type), from);
 				hmput(index_map, o->op_negate.to.index, result);
 			}
@@ -2674,29 +3790,29 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 
 			switch (o->type) {
 			case OPCODE_ADD_AND_STORE_VARIABLE: {
-				if (vector_base_type(o->op_store_var.to.type.type) == float_id) {
+				if (arithmetic_base_type(o->op_store_var.to.type.type) == float_id) {
 					result = write_op_f_add(instructions, convert_type_to_spirv_id(o->op_store_var.to.type.type), to, from);
 				}
-				else if (vector_base_type(o->op_store_var.to.type.type) == int_id || vector_base_type(o->op_store_var.to.type.type) == uint_id) {
+				else if (arithmetic_base_type(o->op_store_var.to.type.type) == int_id || arithmetic_base_type(o->op_store_var.to.type.type) == uint_id) {
 					result = write_op_i_add(instructions, convert_type_to_spirv_id(o->op_store_var.to.type.type), to, from);
 				}
 				break;
 			}
 			case OPCODE_SUB_AND_STORE_VARIABLE: {
-				if (vector_base_type(o->op_store_var.to.type.type) == float_id) {
+				if (arithmetic_base_type(o->op_store_var.to.type.type) == float_id) {
 					result = write_op_f_sub(instructions, convert_type_to_spirv_id(o->op_store_var.to.type.type), to, from);
 				}
-				else if (vector_base_type(o->op_store_var.to.type.type) == int_id || vector_base_type(o->op_store_var.to.type.type) == uint_id) {
+				else if (arithmetic_base_type(o->op_store_var.to.type.type) == int_id || arithmetic_base_type(o->op_store_var.to.type.type) == uint_id) {
 					result = write_op_i_sub(instructions, convert_type_to_spirv_id(o->op_store_var.to.type.type), to, from);
 				}
 				break;
 			}
 			case OPCODE_MULTIPLY_AND_STORE_VARIABLE: {
-				result = write_op_f_mul(instructions, convert_type_to_spirv_id(o->op_store_var.to.type.type), to, from);
+				result = write_multiplication(instructions, o->op_store_var.to.type.type, to, from);
 				break;
 			}
 			case OPCODE_DIVIDE_AND_STORE_VARIABLE: {
-				result = write_op_f_div(instructions, convert_type_to_spirv_id(o->op_store_var.to.type.type), to, from);
+				result = write_division(instructions, o->op_store_var.to.type.type, to, from);
 				break;
 			}
 			default:
@@ -2789,13 +3905,13 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 
 			spirv_id result;
 
-			if (vector_base_type(o->op_binary.left.type.type) == float_id) {
+			if (arithmetic_base_type(o->op_binary.left.type.type) == float_id) {
 				result = write_op_f_ord_less_than(instructions, spirv_bool_type, left, right);
 			}
-			else if (vector_base_type(o->op_binary.left.type.type) == int_id) {
+			else if (arithmetic_base_type(o->op_binary.left.type.type) == int_id) {
 				result = write_op_s_less_than(instructions, spirv_bool_type, left, right);
 			}
-			else if (vector_base_type(o->op_binary.left.type.type) == uint_id) {
+			else if (arithmetic_base_type(o->op_binary.left.type.type) == uint_id) {
 				result = write_op_u_less_than(instructions, spirv_bool_type, left, right);
 			}
 			else {
@@ -2814,13 +3930,13 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 
 			spirv_id result;
 
-			if (vector_base_type(o->op_binary.left.type.type) == float_id) {
+			if (arithmetic_base_type(o->op_binary.left.type.type) == float_id) {
 				result = write_op_f_ord_less_than_equal(instructions, spirv_bool_type, left, right);
 			}
-			else if (vector_base_type(o->op_binary.left.type.type) == int_id) {
+			else if (arithmetic_base_type(o->op_binary.left.type.type) == int_id) {
 				result = write_op_s_less_than_equal(instructions, spirv_bool_type, left, right);
 			}
-			else if (vector_base_type(o->op_binary.left.type.type) == uint_id) {
+			else if (arithmetic_base_type(o->op_binary.left.type.type) == uint_id) {
 				result = write_op_u_less_than_equal(instructions, spirv_bool_type, left, right);
 			}
 			else {
@@ -2839,13 +3955,13 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 
 			spirv_id result;
 
-			if (vector_base_type(o->op_binary.left.type.type) == float_id) {
+			if (arithmetic_base_type(o->op_binary.left.type.type) == float_id) {
 				result = write_op_f_ord_greater_than(instructions, spirv_bool_type, left, right);
 			}
-			else if (vector_base_type(o->op_binary.left.type.type) == int_id) {
+			else if (arithmetic_base_type(o->op_binary.left.type.type) == int_id) {
 				result = write_op_s_greater_than(instructions, spirv_bool_type, left, right);
 			}
-			else if (vector_base_type(o->op_binary.left.type.type) == uint_id) {
+			else if (arithmetic_base_type(o->op_binary.left.type.type) == uint_id) {
 				result = write_op_u_greater_than(instructions, spirv_bool_type, left, right);
 			}
 			else {
@@ -2864,13 +3980,13 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 
 			spirv_id result;
 
-			if (vector_base_type(o->op_binary.left.type.type) == float_id) {
+			if (arithmetic_base_type(o->op_binary.left.type.type) == float_id) {
 				result = write_op_f_ord_greater_than_equal(instructions, spirv_bool_type, left, right);
 			}
-			else if (vector_base_type(o->op_binary.left.type.type) == int_id) {
+			else if (arithmetic_base_type(o->op_binary.left.type.type) == int_id) {
 				result = write_op_s_greater_than_equal(instructions, spirv_bool_type, left, right);
 			}
-			else if (vector_base_type(o->op_binary.left.type.type) == uint_id) {
+			else if (arithmetic_base_type(o->op_binary.left.type.type) == uint_id) {
 				result = write_op_u_greater_than_equal(instructions, spirv_bool_type, left, right);
 			}
 			else {
@@ -2885,11 +4001,11 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 			spirv_id left  = get_var(instructions, o->op_binary.left);
 			spirv_id right = get_var(instructions, o->op_binary.right);
 
-			if (vector_base_type(o->op_binary.result.type.type) == float_id) {
+			if (arithmetic_base_type(o->op_binary.result.type.type) == float_id) {
 				spirv_id result = write_op_f_add(instructions, convert_type_to_spirv_id(o->op_binary.result.type.type), left, right);
 				hmput(index_map, o->op_binary.result.index, result);
 			}
-			else if (vector_base_type(o->op_binary.result.type.type) == int_id || vector_base_type(o->op_binary.result.type.type) == uint_id) {
+			else if (arithmetic_base_type(o->op_binary.result.type.type) == int_id || arithmetic_base_type(o->op_binary.result.type.type) == uint_id) {
 				spirv_id result = write_op_i_add(instructions, convert_type_to_spirv_id(o->op_binary.result.type.type), left, right);
 				hmput(index_map, o->op_binary.result.index, result);
 			}
@@ -2903,13 +4019,13 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 			spirv_id left        = get_var(instructions, o->op_binary.left);
 			spirv_id right       = get_var(instructions, o->op_binary.right);
 			type_id  result_type = o->op_binary.result.type.type;
+			bool     vector      = is_vector_or_scalar(result_type);
 
-			if (result_type == int_id || result_type == int2_id || result_type == int3_id || result_type == int4_id || result_type == uint_id ||
-			    result_type == uint2_id || result_type == uint3_id || result_type == uint4_id) {
+			if (vector && (arithmetic_base_type(result_type) == int_id || arithmetic_base_type(result_type) == uint_id)) {
 				spirv_id result = write_op_i_sub(instructions, convert_type_to_spirv_id(result_type), left, right);
 				hmput(index_map, o->op_binary.result.index, result);
 			}
-			else if (result_type == float_id || result_type == float2_id || result_type == float3_id || result_type == float4_id) {
+			else if (vector && arithmetic_base_type(result_type) == float_id) {
 				spirv_id result = write_op_f_sub(instructions, convert_type_to_spirv_id(result_type), left, right);
 				hmput(index_map, o->op_binary.result.index, result);
 			}
@@ -2933,7 +4049,7 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 				result = write_op_vector_times_matrix(instructions, convert_type_to_spirv_id(o->op_binary.result.type.type), left, right);
 			}
 			else {
-				result = write_op_f_mul(instructions, convert_type_to_spirv_id(o->op_binary.result.type.type), left, right);
+				result = write_multiplication(instructions, o->op_binary.result.type.type, left, right);
 			}
 
 			hmput(index_map, o->op_binary.result.index, result);
@@ -2943,7 +4059,7 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 		case OPCODE_DIVIDE: {
 			spirv_id left   = get_var(instructions, o->op_binary.left);
 			spirv_id right  = get_var(instructions, o->op_binary.right);
-			spirv_id result = write_op_f_div(instructions, convert_type_to_spirv_id(o->op_binary.result.type.type), left, right);
+			spirv_id result = write_division(instructions, o->op_binary.result.type.type, left, right);
 
 			hmput(index_map, o->op_binary.result.index, result);
 
@@ -2962,11 +4078,11 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 			spirv_id left  = get_var(instructions, o->op_binary.left);
 			spirv_id right = get_var(instructions, o->op_binary.right);
 
-			if (vector_base_type(o->op_binary.left.type.type) == float_id) {
+			if (arithmetic_base_type(o->op_binary.left.type.type) == float_id) {
 				spirv_id result = write_op_f_ord_equal(instructions, spirv_bool_type, left, right);
 				hmput(index_map, o->op_binary.result.index, result);
 			}
-			else if (vector_base_type(o->op_binary.left.type.type) == int_id || vector_base_type(o->op_binary.left.type.type) == uint_id) {
+			else if (arithmetic_base_type(o->op_binary.left.type.type) == int_id || arithmetic_base_type(o->op_binary.left.type.type) == uint_id) {
 				spirv_id result = write_op_i_equal(instructions, spirv_bool_type, left, right);
 				hmput(index_map, o->op_binary.result.index, result);
 			}
@@ -2977,11 +4093,11 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 			spirv_id left  = get_var(instructions, o->op_binary.left);
 			spirv_id right = get_var(instructions, o->op_binary.right);
 
-			if (vector_base_type(o->op_binary.left.type.type) == float_id) {
+			if (arithmetic_base_type(o->op_binary.left.type.type) == float_id) {
 				spirv_id result = write_op_f_ord_not_equal(instructions, spirv_bool_type, left, right);
 				hmput(index_map, o->op_binary.result.index, result);
 			}
-			else if (vector_base_type(o->op_binary.left.type.type) == int_id || vector_base_type(o->op_binary.left.type.type) == uint_id) {
+			else if (arithmetic_base_type(o->op_binary.left.type.type) == int_id || arithmetic_base_type(o->op_binary.left.type.type) == uint_id) {
 				spirv_id result = write_op_i_not_equal(instructions, spirv_bool_type, left, right);
 				hmput(index_map, o->op_binary.result.index, result);
 			}
@@ -3009,7 +4125,15 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 			write_op_branch(instructions, while_start_label);
 			write_op_label_preallocated(instructions, while_start_label);
 
-			write_op_loop_merge(instructions, while_end_label, while_continue_label, LOOP_CONTROL_NONE);
+			loop_control control = LOOP_CONTROL_NONE;
+			if (o->op_while_start.hint == LOOP_HINT_UNROLL) {
+				control = LOOP_CONTROL_UNROLL;
+			}
+			else if (o->op_while_start.hint == LOOP_HINT_LOOP) {
+				control = LOOP_CONTROL_DONT_UNROLL;
+			}
+
+			write_op_loop_merge(instructions, while_end_label, while_continue_label, control);
 
 			spirv_id loop_start_id = allocate_index();
 			write_op_branch(instructions, loop_start_id);
@@ -3063,7 +4187,8 @@ static void write_function(instructions_buffer *instructions, function *f, spirv
 
 	if (!ends_with_return) {
 		if (main) {
-			assert(stage == SHADER_STAGE_COMPUTE);
+			check(stage != SHADER_STAGE_AMPLIFICATION, context, "Amplification shaders have to end with a call to dispatch_mesh");
+			assert(stage == SHADER_STAGE_COMPUTE || stage == SHADER_STAGE_MESH);
 		}
 		write_op_return(instructions);
 	}
@@ -3167,7 +4292,22 @@ static void write_constants(instructions_buffer *instructions) {
 	for (size_t i = 0; i < size; ++i) {
 		write_constant_bool(instructions, bool_constants[i].value, bool_constants[i].key);
 	}
-}
+
+	size = hmlenu(half_constants);
+	for (size_t i = 0; i < size; ++i) {
+		write_constant(instructions, convert_type_to_spirv_id(half_id), half_constants[i].value, half_constants[i].key);
+	}
+
+	size = hmlenu(short_constants);
+	for (size_t i = 0; i < size; ++i) {
+		write_constant(instructions, convert_type_to_spirv_id(short_id), short_constants[i].value, short_constants[i].key);
+	}
+
+	size = hmlenu(ushort_constants);
+	for (size_t i = 0; i < size; ++i) {
+		write_constant(instructions, convert_type_to_spirv_id(ushort_id), ushort_constants[i].value, ushort_constants[i].key);
+	}
+}
 
 static void assign_bindings(uint32_t *bindings, function *shader) {
 	descriptor_set_group *set_group = get_descriptor_set_group(shader->descriptor_set_group_index);
@@ -3241,33 +4381,40 @@ static void assign_bindings(uint32_t *bindings, function *shader) {
 	}
 }
 
-static uint32_t member_size(type_id member_type) {
-	if (member_type == float_id || member_type == int_id || member_type == uint_id) {
-		return 4;
-	}
-	if (member_type == float2_id || member_type == int2_id || member_type == uint2_id) {
-		return 8;
-	}
-	if (member_type == float3_id || member_type == int3_id || member_type == uint3_id) {
-		return 16;
-	}
-	if (member_type == float4_id || member_type == int4_id || member_type == uint4_id) {
-		return 16;
+// Several buffers can share one of the argument structs, it is only written once per shader
+static void write_indirect_args_type(instructions_buffer *decorations, instructions_buffer *aggregate_types_block, type_id args) {
+	complex_type ct = {
+	    .type      = args,
+	    .readwrite = false,
+	    .storage   = (uint16_t)STORAGE_CLASS_NONE,
+	};
+	if (hmget(type_map, ct).id != 0) {
+		return;
 	}
-	if (member_type == float3x3_id) {
-		return 48;
+
+	type *t = get_type(args);
+
+	spirv_id member_types[MAX_MEMBERS];
+	for (size_t j = 0; j < t->members.size; ++j) {
+		member_types[j] = convert_type_to_spirv_id(t->members.m[j].type.type);
 	}
-	if (member_type == float4x4_id) {
-		return 64;
+
+	spirv_id struct_type = write_type_struct(aggregate_types_block, member_types, (uint16_t)t->members.size);
+	for (size_t j = 0; j < t->members.size; ++j) {
+		write_op_member_decorate_value(decorations, struct_type, (uint32_t)j, DECORATION_OFFSET, (uint32_t)j * 4);
 	}
-	return 0;
+
+	add_to_type_map(args, struct_type, false, STORAGE_CLASS_NONE);
 }
 
-static uint32_t member_padding(uint32_t offset, uint32_t size) {
-	if (size > 16) {
-		size = 16;
+static bool has_16bit_members(type_id id) {
+	type *t = get_type(id);
+	for (size_t i = 0; i < t->members.size; ++i) {
+		if (is_16bit_type(t->members.m[i].type.type)) {
+			return true;
+		}
 	}
-	return (size - (offset % size)) % size;
+	return false;
 }
 
 static void write_globals(instructions_buffer *decorations, instructions_buffer *aggregate_types_block, instructions_buffer *global_vars_block, function *main,
@@ -3306,7 +4453,14 @@ static void write_globals(instructions_buffer *decorations, instructions_buffer
 		bool    readable  = globals.readable[i];
 		bool    writable  = globals.writable[i];
 
-		if (base_type == sampler_type_id) {
+		if (g->group_shared) {
+			spirv_id array_type = write_type_array(aggregate_types_block, convert_type_to_spirv_id(base_type), get_int_constant(t->array_size));
+			add_to_type_map(g->type, array_type, false, STORAGE_CLASS_NONE);
+
+			write_op_variable_preallocated(global_vars_block, convert_pointer_type_to_spirv_id(g->type, STORAGE_CLASS_WORKGROUP),
+			                               convert_kong_index_to_spirv_id(g->var_index), STORAGE_CLASS_WORKGROUP);
+		}
+		else if (base_type == sampler_type_id) {
 			add_to_type_map(g->type, spirv_sampler_type, false, STORAGE_CLASS_NONE);
 			add_to_type_map(g->type, spirv_sampler_pointer_type, false, STORAGE_CLASS_UNIFORM_CONSTANT);
 
@@ -3324,7 +4478,22 @@ static void write_globals(instructions_buffer *decorations, instructions_buffer
 				else {
 					spirv_id image_pointer_type;
 
-					if (readable || writable) {
+					if (is_integer_image(g->type)) {
+						bool      unsigned_image        = get_type(g->type)->tex_format == TEXTURE_FORMAT_R32_UINT;
+						spirv_id *integer_image         = unsigned_image ? &spirv_uint_image_type : &spirv_int_image_type;
+						spirv_id *integer_image_pointer = unsigned_image ? &spirv_uint_image_pointer_type : &spirv_int_image_pointer_type;
+
+						if (integer_image->id == 0) {
+							*integer_image = write_type_image(aggregate_types_block, unsigned_image ? spirv_uint_type : spirv_int_type, DIM_2D, 0, 0, 0, 2,
+							                                  unsigned_image ? IMAGE_FORMAT_R32UI : IMAGE_FORMAT_R32I);
+							*integer_image_pointer = allocate_index();
+						}
+
+						readable = writable = true;
+						add_to_type_map(g->type, *integer_image, true, STORAGE_CLASS_NONE);
+						image_pointer_type = *integer_image_pointer;
+					}
+					else if (readable || writable) {
 						add_to_type_map(g->type, spirv_readwrite_image_type, true, STORAGE_CLASS_NONE);
 						image_pointer_type = spirv_readwrite_image_pointer_type;
 					}
@@ -3396,8 +4565,55 @@ static void write_globals(instructions_buffer *decorations, instructions_buffer
 		else if (base_type == bvh_type_id) {
 			assert(false);
 		}
-		else if (base_type == float_id) {
-			spirv_id id = get_float_constant(g->value.value.floats[0]);
+		else if (global_is_buffer(g)) {
+			if (is_indirect_args(base_type)) {
+				write_indirect_args_type(decorations, aggregate_types_block, base_type);
+			}
+
+			if (is_16bit_type(base_type) || has_16bit_members(base_type)) {
+				sixteen_bits.storage_buffers = true;
+			}
+
+			spirv_id runtime_array_type = write_type_runtime_array(aggregate_types_block, convert_type_to_spirv_id(base_type));
+			write_op_decorate_value(decorations, runtime_array_type, DECORATION_ARRAY_STRIDE, array_stride(base_type, LAYOUT_RULES_STD430));
+
+			spirv_id struct_type = write_type_struct(aggregate_types_block, &runtime_array_type, 1);
+			write_op_member_decorate_value(decorations, struct_type, 0, DECORATION_OFFSET, 0);
+			write_op_decorate(decorations, struct_type, buffer_storage_class == STORAGE_CLASS_STORAGE_BUFFER ? DECORATION_BLOCK : DECORATION_BUFFER_BLOCK);
+
+			add_to_type_map(g->type, struct_type, false, STORAGE_CLASS_NONE);
+
+			spirv_id struct_pointer_type = allocate_index();
+			add_to_type_map(g->type, struct_pointer_type, false, buffer_storage_class);
+
+			spirv_id spirv_var_id = convert_kong_index_to_spirv_id(g->var_index);
+			write_op_variable_preallocated(global_vars_block, struct_pointer_type, spirv_var_id, buffer_storage_class);
+
+			write_op_decorate_value(decorations, spirv_var_id, DECORATION_DESCRIPTOR_SET, 0);
+			write_op_decorate_value(decorations, spirv_var_id, DECORATION_BINDING, binding);
+		}
+		else if (g->specialization) {
+			spirv_id id = write_spec_constant(global_vars_block, g);
+			write_op_decorate_value(decorations, id, DECORATION_SPEC_ID, g->specialization_id);
+			hmput(index_map, g->var_index, id);
+		}
+		else if (global_is_scalar_constant(g)) {
+			spirv_id id;
+			switch (g->value.kind) {
+			case GLOBAL_VALUE_BOOL:
+				id = get_bool_constant(g->value.value.b);
+				break;
+			case GLOBAL_VALUE_INT:
+				id = g->type == short_id && is_16bit_type(short_id) ? get_short_constant(g->value.value.ints[0]) : get_int_constant(g->value.value.ints[0]);
+				break;
+			case GLOBAL_VALUE_UINT:
+				id = g->type == ushort_id && is_16bit_type(ushort_id) ? get_ushort_constant((int)g->value.value.uints[0])
+				                                                      : get_uint_constant(g->value.value.uints[0]);
+				break;
+			default:
+				id = g->type == half_id && is_16bit_type(half_id) ? get_half_constant(g->value.value.floats[0]) : get_float_constant(g->value.value.floats[0]);
+				break;
+			}
 			hmput(index_map, g->var_index, id);
 		}
 		else if (base_type == float2_id) {
@@ -3416,6 +4632,15 @@ static void write_globals(instructions_buffer *decorations, instructions_buffer
 
 			type *t = get_type(g->type);
 
+			if (has_16bit_members(g->type)) {
+				if (root_constant) {
+					sixteen_bits.push_constants = true;
+				}
+				else {
+					sixteen_bits.uniform_buffers = true;
+				}
+			}
+
 			spirv_id member_types[256];
 			uint16_t member_types_size = 0;
 			for (size_t j = 0; j < t->members.size; ++j) {
@@ -3433,14 +4658,13 @@ static void write_globals(instructions_buffer *decorations, instructions_buffer
 
 			spirv_id struct_type = write_type_struct(aggregate_types_block, member_types, member_types_size);
 
-			uint32_t offset = 0;
+			static struct_layout layout;
+			layout_struct(g->type, api_layout_rules(API_VULKAN, root_constant), &layout);
+
 			for (uint32_t j = 0; j < (uint32_t)t->members.size; ++j) {
 				type_id member_type = t->members.m[j].type.type;
 
-				uint32_t size = member_size(member_type);
-				offset += member_padding(offset, size);
-				write_op_member_decorate_value(decorations, struct_type, j, DECORATION_OFFSET, offset);
-				offset += size;
+				write_op_member_decorate_value(decorations, struct_type, j, DECORATION_OFFSET, layout.offsets[j]);
 
 				if (member_type == float3x3_id) {
 					write_op_member_decorate(decorations, struct_type, j, DECORATION_COL_MAJOR);
@@ -3494,6 +4718,18 @@ static void write_globals(instructions_buffer *decorations, instructions_buffer
 		write_op_decorate_value(decorations, vertex_id_variable, DECORATION_BUILTIN, BUILTIN_VERTEX_INDEX);
 	}
 
+	if (main->used_builtins.wave_lane_index) {
+		write_op_variable_preallocated(global_vars_block, convert_pointer_type_to_spirv_id(uint_id, STORAGE_CLASS_INPUT), wave_lane_index_variable,
+		                               STORAGE_CLASS_INPUT);
+		write_op_decorate_value(decorations, wave_lane_index_variable, DECORATION_BUILTIN, BUILTIN_SUBGROUP_LOCAL_INVOCATION_ID);
+	}
+
+	if (main->used_builtins.wave_lane_count) {
+		write_op_variable_preallocated(global_vars_block, convert_pointer_type_to_spirv_id(uint_id, STORAGE_CLASS_INPUT), wave_lane_count_variable,
+		                               STORAGE_CLASS_INPUT);
+		write_op_decorate_value(decorations, wave_lane_count_variable, DECORATION_BUILTIN, BUILTIN_SUBGROUP_SIZE);
+	}
+
 	if (stage == SHADER_STAGE_COMPUTE) {
 		write_op_decorate_value(decorations, work_group_size_variable, DECORATION_BUILTIN, BUILTIN_WORKGROUP_SIZE);
 	}
@@ -3540,17 +4776,83 @@ static void init_float_constants(void) {
 	}
 }
 
+static void init_16bit_constants(void) {
+	hmfree(half_constants);
+	hmfree(short_constants);
+	hmfree(ushort_constants);
+
+	sixteen_bit_usage no_usage = KONG_INIT_ZERO;
+	sixteen_bits               = no_usage;
+}
+
 void init_maps(void) {
 	init_index_map();
 	init_type_map();
 	init_function_map();
 	init_int_constants();
 	init_float_constants();
+	init_16bit_constants();
+}
+
+static size_t add_workgroup_builtin_interfaces(function *main, spirv_id *interfaces, size_t interfaces_count) {
+	if (main->used_builtins.dispatch_thread_id) {
+		dispatch_thread_id_variable = allocate_index();
+
+		interfaces[interfaces_count] = dispatch_thread_id_variable;
+		interfaces_count += 1;
+	}
+
+	if (main->used_builtins.group_thread_id) {
+		group_thread_id_variable = allocate_index();
+
+		interfaces[interfaces_count] = group_thread_id_variable;
+		interfaces_count += 1;
+	}
+
+	if (main->used_builtins.group_id) {
+		group_id_variable = allocate_index();
+
+		interfaces[interfaces_count] = group_id_variable;
+		interfaces_count += 1;
+	}
+
+	if (main->used_builtins.wave_lane_index) {
+		wave_lane_index_variable = allocate_index();
+
+		interfaces[interfaces_count] = wave_lane_index_variable;
+		interfaces_count += 1;
+	}
+
+	if (main->used_builtins.wave_lane_count) {
+		wave_lane_count_variable = allocate_index();
+
+		interfaces[interfaces_count] = wave_lane_count_variable;
+		interfaces_count += 1;
+	}
+
+	return interfaces_count;
+}
+
+// SPIR-V 1.4 wants every global variable in the entry point's interface, not only the inputs and outputs
+static size_t add_global_interfaces(function *main, spirv_id *interfaces, size_t interfaces_count) {
+	global_array globals = KONG_INIT_ZERO;
+	find_referenced_globals(main, &globals);
+
+	for (size_t i = 0; i < globals.size; ++i) {
+		global *g = get_global(globals.globals[i]);
+		if (!g->specialization && !global_is_scalar_constant(g)) {
+			interfaces[interfaces_count] = convert_kong_index_to_spirv_id(g->var_index);
+			interfaces_count += 1;
+		}
+	}
+
+	return interfaces_count;
 }
 
 static void spirv_export_vertex(char *directory, function *main, bool debug) {
 	next_index = 1;
 	init_maps();
+	buffer_storage_class = STORAGE_CLASS_UNIFORM;
 
 	find_used_builtins(main);
 	find_used_capabilities(main);
@@ -3588,6 +4890,8 @@ static void spirv_export_vertex(char *directory, function *main, bool debug) {
 
 	debug_context context = KONG_INIT_ZERO;
 	check(vertex_output != NO_TYPE, context, "vertex output missing");
+	check(!main->used_builtins.wave_lane_index && !main->used_builtins.wave_lane_count, context,
+	      "wave_lane_index and wave_lane_count are only supported in compute shaders in SPIR-V");
 
 	write_capabilities(&decorations, &main->used_capabilities);
 	glsl_import = write_op_ext_inst_import(&decorations, "GLSL.std.450");
@@ -3700,17 +5004,19 @@ static void spirv_export_vertex(char *directory, function *main, bool debug) {
 	write_functions(&instructions, main, entry_point, SHADER_STAGE_VERTEX, vertex_output);
 
 	write_types(&aggregate_types, main);
+	write_16bit_types(&base_types);
 
 	// header
 	write_magic_number(&header);
-	write_version_number(&header);
+	write_version_number(&header, &main->used_capabilities);
 	write_generator_magic_number(&header);
 	write_bound(&header);
 	write_instruction_schema(&header);
+	write_16bit_capabilities(&header);
 
 	write_constants(&constants);
 
-	char *name = get_name(main->name);
+	char *name = shader_name(main);
 
 	char filename[512];
 	sprintf(filename, "kong_%s", name);
@@ -3724,6 +5030,7 @@ static void spirv_export_vertex(char *directory, function *main, bool debug) {
 static void spirv_export_fragment(char *directory, function *main, bool debug) {
 	next_index = 1;
 	init_maps();
+	buffer_storage_class = STORAGE_CLASS_UNIFORM;
 
 	find_used_builtins(main);
 	find_used_capabilities(main);
@@ -3763,6 +5070,8 @@ static void spirv_export_fragment(char *directory, function *main, bool debug) {
 	debug_context context = KONG_INIT_ZERO;
 	check(pixel_input != NO_TYPE, context, "fragment input missing");
 	check(pixel_output != NO_TYPE, context, "fragment output missing");
+	check(!main->used_builtins.wave_lane_index && !main->used_builtins.wave_lane_count, context,
+	      "wave_lane_index and wave_lane_count are only supported in compute shaders in SPIR-V");
 
 	write_capabilities(&decorations, &main->used_capabilities);
 	glsl_import = write_op_ext_inst_import(&decorations, "GLSL.std.450");
@@ -3845,17 +5154,19 @@ static void spirv_export_fragment(char *directory, function *main, bool debug) {
 	write_functions(&instructions, main, entry_point, SHADER_STAGE_FRAGMENT, NO_TYPE);
 
 	write_types(&aggregate_types, main);
+	write_16bit_types(&base_types);
 
 	// header
 	write_magic_number(&header);
-	write_version_number(&header);
+	write_version_number(&header, &main->used_capabilities);
 	write_generator_magic_number(&header);
 	write_bound(&header);
 	write_instruction_schema(&header);
+	write_16bit_capabilities(&header);
 
 	write_constants(&constants);
 
-	char *name = get_name(main->name);
+	char *name = shader_name(main);
 
 	char filename[512];
 	sprintf(filename, "kong_%s", name);
@@ -3869,6 +5180,7 @@ static void spirv_export_fragment(char *directory, function *main, bool debug) {
 static void spirv_export_compute(char *directory, function *main, bool debug) {
 	next_index = 1;
 	init_maps();
+	buffer_storage_class = STORAGE_CLASS_UNIFORM;
 
 	find_used_builtins(main);
 	find_used_capabilities(main);
@@ -3917,26 +5229,7 @@ static void spirv_export_compute(char *directory, function *main, bool debug) {
 	spirv_id interfaces[256];
 	size_t   interfaces_count = 0;
 
-	if (main->used_builtins.dispatch_thread_id) {
-		dispatch_thread_id_variable = allocate_index();
-
-		interfaces[interfaces_count] = dispatch_thread_id_variable;
-		interfaces_count += 1;
-	}
-
-	if (main->used_builtins.group_thread_id) {
-		group_thread_id_variable = allocate_index();
-
-		interfaces[interfaces_count] = group_thread_id_variable;
-		interfaces_count += 1;
-	}
-
-	if (main->used_builtins.group_id) {
-		group_id_variable = allocate_index();
-
-		interfaces[interfaces_count] = group_id_variable;
-		interfaces_count += 1;
-	}
+	interfaces_count = add_workgroup_builtin_interfaces(main, interfaces, interfaces_count);
 
 	write_op_entry_point(&decorations, EXECUTION_MODEL_GLCOMPUTE, entry_point, "main", interfaces, (uint16_t)interfaces_count);
 
@@ -3957,6 +5250,7 @@ static void spirv_export_compute(char *directory, function *main, bool debug) {
 	write_functions(&instructions, main, entry_point, SHADER_STAGE_COMPUTE, NO_TYPE);
 
 	write_types(&aggregate_types, main);
+	write_16bit_types(&base_types);
 
 	spirv_id work_group_x = get_uint_constant((uint32_t)threads_attribute->parameters[0]);
 	spirv_id work_group_y = get_uint_constant((uint32_t)threads_attribute->parameters[1]);
@@ -3964,16 +5258,294 @@ static void spirv_export_compute(char *directory, function *main, bool debug) {
 
 	// header
 	write_magic_number(&header);
-	write_version_number(&header);
+	write_version_number(&header, &main->used_capabilities);
 	write_generator_magic_number(&header);
 	write_bound(&header);
 	write_instruction_schema(&header);
+	write_16bit_capabilities(&header);
 
 	write_constants(&constants);
 
 	write_constant_composite_preallocated3(&constants, spirv_uint3_type, work_group_size_variable, work_group_x, work_group_y, work_group_z);
 
-	char *name = get_name(main->name);
+	char *name = shader_name(main);
+
+	char filename[512];
+	sprintf(filename, "kong_%s", name);
+
+	char var_name[256];
+	sprintf(var_name, "%s_code", name);
+
+	write_bytecode(directory, filename, var_name, &header, &decorations, &base_types, &constants, &aggregate_types, &global_vars, &instructions, debug);
+}
+
+static void spirv_export_amplification(char *directory, function *main, bool debug) {
+	next_index = 1;
+	init_maps();
+	buffer_storage_class = STORAGE_CLASS_STORAGE_BUFFER;
+
+	find_used_builtins(main);
+	find_used_capabilities(main);
+
+	instructions_buffer header = {
+	    .instructions = (uint32_t *)calloc(1024 * 1024, 1),
+	};
+
+	instructions_buffer decorations = {
+	    .instructions = (uint32_t *)calloc(1024 * 1024, 1),
+	};
+
+	instructions_buffer base_types = {
+	    .instructions = (uint32_t *)calloc(1024 * 1024, 1),
+	};
+
+	instructions_buffer constants = {
+	    .instructions = (uint32_t *)calloc(1024 * 1024, 1),
+	};
+
+	instructions_buffer aggregate_types = {
+	    .instructions = (uint32_t *)calloc(1024 * 1024, 1),
+	};
+
+	instructions_buffer global_vars = {
+	    .instructions = (uint32_t *)calloc(1024 * 1024, 1),
+	};
+
+	instructions_buffer instructions = {
+	    .instructions = (uint32_t *)calloc(1024 * 1024, 1),
+	};
+
+	assert(main->parameters_size == 0);
+
+	type_id payload_type = find_mesh_payload_type(main);
+
+	debug_context context = KONG_INIT_ZERO;
+	check(payload_type != NO_TYPE, context, "Amplification shaders have to end with a call to dispatch_mesh");
+
+	attribute *threads_attribute = find_attribute(&main->attributes, add_name("threads"));
+	if (threads_attribute == NULL || threads_attribute->paramters_count != 3) {
+		error(context, "Amplification function requires a threads attribute with three parameters");
+	}
+
+	capabilities caps = main->used_capabilities;
+	caps.mesh_shading = true;
+
+	write_capabilities(&decorations, &caps);
+	glsl_import = write_op_ext_inst_import(&decorations, "GLSL.std.450");
+	write_op_memory_model(&decorations, ADDRESSING_MODEL_LOGICAL, MEMORY_MODEL_GLSL450);
+
+	spirv_id entry_point = allocate_index();
+
+	input_vars_count  = 0;
+	output_vars_count = 0;
+
+	task_payload_variable = allocate_index();
+
+	spirv_id interfaces[256];
+	size_t   interfaces_count = 0;
+
+	interfaces[interfaces_count] = task_payload_variable;
+	interfaces_count += 1;
+
+	interfaces_count = add_workgroup_builtin_interfaces(main, interfaces, interfaces_count);
+	interfaces_count = add_global_interfaces(main, interfaces, interfaces_count);
+
+	write_op_entry_point(&decorations, EXECUTION_MODEL_TASK_EXT, entry_point, "main", interfaces, (uint16_t)interfaces_count);
+
+	assert(threads_attribute != NULL);
+	write_op_execution_mode3(&decorations, entry_point, EXECUTION_MODE_LOCAL_SIZE, (uint32_t)threads_attribute->parameters[0],
+	                         (uint32_t)threads_attribute->parameters[1], (uint32_t)threads_attribute->parameters[2]);
+
+	write_base_types(&base_types);
+
+	write_globals(&decorations, &aggregate_types, &global_vars, main, SHADER_STAGE_AMPLIFICATION);
+
+	write_op_variable_preallocated(&instructions, convert_pointer_type_to_spirv_id(payload_type, STORAGE_CLASS_TASK_PAYLOAD_WORKGROUP_EXT),
+	                               task_payload_variable, STORAGE_CLASS_TASK_PAYLOAD_WORKGROUP_EXT);
+
+	write_functions(&instructions, main, entry_point, SHADER_STAGE_AMPLIFICATION, NO_TYPE);
+
+	write_types(&aggregate_types, main);
+	write_16bit_types(&base_types);
+
+	// header
+	write_magic_number(&header);
+	write_version_number(&header, &caps);
+	write_generator_magic_number(&header);
+	write_bound(&header);
+	write_instruction_schema(&header);
+	write_16bit_capabilities(&header);
+
+	write_constants(&constants);
+
+	char *name = shader_name(main);
+
+	char filename[512];
+	sprintf(filename, "kong_%s", name);
+
+	char var_name[256];
+	sprintf(var_name, "%s_code", name);
+
+	write_bytecode(directory, filename, var_name, &header, &decorations, &base_types, &constants, &aggregate_types, &global_vars, &instructions, debug);
+}
+
+static void spirv_export_mesh(char *directory, function *main, bool debug) {
+	next_index = 1;
+	init_maps();
+	buffer_storage_class = STORAGE_CLASS_STORAGE_BUFFER;
+
+	find_used_builtins(main);
+	find_used_capabilities(main);
+
+	instructions_buffer header = {
+	    .instructions = (uint32_t *)calloc(1024 * 1024, 1),
+	};
+
+	instructions_buffer decorations = {
+	    .instructions = (uint32_t *)calloc(1024 * 1024, 1),
+	};
+
+	instructions_buffer base_types = {
+	    .instructions = (uint32_t *)calloc(1024 * 1024, 1),
+	};
+
+	instructions_buffer constants = {
+	    .instructions = (uint32_t *)calloc(1024 * 1024, 1),
+	};
+
+	instructions_buffer aggregate_types = {
+	    .instructions = (uint32_t *)calloc(1024 * 1024, 1),
+	};
+
+	instructions_buffer global_vars = {
+	    .instructions = (uint32_t *)calloc(1024 * 1024, 1),
+	};
+
+	instructions_buffer instructions = {
+	    .instructions = (uint32_t *)calloc(1024 * 1024, 1),
+	};
+
+	debug_context context = KONG_INIT_ZERO;
+	check(main->parameters_size <= 1, context, "Mesh functions can only take the amplification payload as a parameter");
+
+	attribute *threads_attribute = find_attribute(&main->attributes, add_name("threads"));
+	if (threads_attribute == NULL || threads_attribute->paramters_count != 3) {
+		error(context, "Mesh function requires a threads attribute with three parameters");
+	}
+
+	attribute *tris_attribute = find_attribute(&main->attributes, add_name("tris"));
+	if (tris_attribute == NULL || tris_attribute->paramters_count != 1) {
+		error(context, "Mesh function requires a tris attribute with one parameter");
+	}
+
+	attribute *vertices_attribute = find_attribute(&main->attributes, add_name("vertices"));
+	if (vertices_attribute == NULL || vertices_attribute->paramters_count != 2) {
+		error(context, "Mesh function requires a vertices attribute with two parameters");
+	}
+
+	assert(threads_attribute != NULL && tris_attribute != NULL && vertices_attribute != NULL);
+	uint32_t max_vertices  = (uint32_t)vertices_attribute->parameters[0];
+	uint32_t max_triangles = (uint32_t)tris_attribute->parameters[0];
+	type    *output        = get_type((type_id)vertices_attribute->parameters[1]);
+
+	capabilities caps = main->used_capabilities;
+	caps.mesh_shading = true;
+
+	write_capabilities(&decorations, &caps);
+	glsl_import = write_op_ext_inst_import(&decorations, "GLSL.std.450");
+	write_op_memory_model(&decorations, ADDRESSING_MODEL_LOGICAL, MEMORY_MODEL_GLSL450);
+
+	spirv_id entry_point = allocate_index();
+
+	input_vars_count = 0;
+
+	output_vars_count = output->members.size;
+	for (size_t output_var_index = 0; output_var_index < output_vars_count; ++output_var_index) {
+		output_vars[output_var_index] = allocate_index();
+	}
+	per_vertex_var = output_vars[0];
+
+	mesh_triangles_variable = allocate_index();
+
+	spirv_id interfaces[256];
+	size_t   interfaces_count = 0;
+
+	for (size_t output_var_index = 0; output_var_index < output_vars_count; ++output_var_index) {
+		interfaces[interfaces_count] = output_vars[output_var_index];
+		interfaces_count += 1;
+	}
+
+	interfaces[interfaces_count] = mesh_triangles_variable;
+	interfaces_count += 1;
+
+	if (main->parameters_size > 0) {
+		task_payload_variable        = allocate_index();
+		interfaces[interfaces_count] = task_payload_variable;
+		interfaces_count += 1;
+	}
+
+	interfaces_count = add_workgroup_builtin_interfaces(main, interfaces, interfaces_count);
+	interfaces_count = add_global_interfaces(main, interfaces, interfaces_count);
+
+	write_op_entry_point(&decorations, EXECUTION_MODEL_MESH_EXT, entry_point, "main", interfaces, (uint16_t)interfaces_count);
+
+	write_op_execution_mode3(&decorations, entry_point, EXECUTION_MODE_LOCAL_SIZE, (uint32_t)threads_attribute->parameters[0],
+	                         (uint32_t)threads_attribute->parameters[1], (uint32_t)threads_attribute->parameters[2]);
+	write_op_execution_mode1(&decorations, entry_point, EXECUTION_MODE_OUTPUT_VERTICES, max_vertices);
+	write_op_execution_mode1(&decorations, entry_point, EXECUTION_MODE_OUTPUT_PRIMITIVES_EXT, max_triangles);
+	write_op_execution_mode(&decorations, entry_point, EXECUTION_MODE_OUTPUT_TRIANGLES_EXT);
+
+	write_base_types(&base_types);
+
+	write_globals(&decorations, &aggregate_types, &global_vars, main, SHADER_STAGE_MESH);
+
+	// the vertex outputs of a mesh shader are arrays with one element per vertex
+	spirv_id vertices_size = get_int_constant((int)max_vertices);
+
+	spirv_id types[]       = {spirv_float4_type};
+	spirv_id output_struct = write_type_struct(&aggregate_types, types, 1);
+	write_vertex_output_decorations(&decorations, output_struct, output_vars, (uint32_t)output_vars_count);
+
+	spirv_id output_array_type = write_type_array(&aggregate_types, output_struct, vertices_size);
+	write_op_variable_preallocated(&instructions, write_type_pointer(&aggregate_types, STORAGE_CLASS_OUTPUT, output_array_type), per_vertex_var,
+	                               STORAGE_CLASS_OUTPUT);
+
+	// special handling for the first one (position) via per_vertex_var
+	for (size_t i = 1; i < output_vars_count; ++i) {
+		type_id member_type = output->members.m[i].type.type;
+		check(member_type == float2_id || member_type == float3_id || member_type == float4_id, context, "Type unsupported for mesh output in SPIR-V");
+
+		spirv_id array_type = write_type_array(&aggregate_types, convert_type_to_spirv_id(member_type), vertices_size);
+		write_op_variable_preallocated(&instructions, write_type_pointer(&aggregate_types, STORAGE_CLASS_OUTPUT, array_type), output_vars[i],
+		                               STORAGE_CLASS_OUTPUT);
+	}
+
+	spirv_id triangles_type = write_type_array(&aggregate_types, spirv_uint3_type, get_int_constant((int)max_triangles));
+	write_op_variable_preallocated(&instructions, write_type_pointer(&aggregate_types, STORAGE_CLASS_OUTPUT, triangles_type), mesh_triangles_variable,
+	                               STORAGE_CLASS_OUTPUT);
+	write_op_decorate_value(&decorations, mesh_triangles_variable, DECORATION_BUILTIN, BUILTIN_PRIMITIVE_TRIANGLE_INDICES_EXT);
+
+	if (main->parameters_size > 0) {
+		write_op_variable_preallocated(&instructions, convert_pointer_type_to_spirv_id(main->parameter_types[0].type, STORAGE_CLASS_TASK_PAYLOAD_WORKGROUP_EXT),
+		                               task_payload_variable, STORAGE_CLASS_TASK_PAYLOAD_WORKGROUP_EXT);
+	}
+
+	write_functions(&instructions, main, entry_point, SHADER_STAGE_MESH, NO_TYPE);
+
+	write_types(&aggregate_types, main);
+	write_16bit_types(&base_types);
+
+	// header
+	write_magic_number(&header);
+	write_version_number(&header, &caps);
+	write_generator_magic_number(&header);
+	write_bound(&header);
+	write_instruction_schema(&header);
+	write_16bit_capabilities(&header);
+
+	write_constants(&constants);
+
+	char *name = shader_name(main);
 
 	char filename[512];
 	sprintf(filename, "kong_%s", name);
@@ -3994,31 +5566,53 @@ void spirv_export(char *directory, bool debug) {
 	function *compute_shaders[256];
 	size_t    compute_shaders_size = 0;
 
+	function *amplification_shaders[256];
+	size_t    amplification_shaders_size = 0;
+
+	function *mesh_shaders[256];
+	size_t    mesh_shaders_size = 0;
+
 	for (type_id i = 0; get_type(i) != NULL; ++i) {
 		type *t = get_type(i);
 		if (!t->built_in && has_attribute(&t->attributes, add_name("pipe"))) {
-			name_id vertex_shader_name   = NO_NAME;
-			name_id fragment_shader_name = NO_NAME;
+			name_id vertex_shader_name        = NO_NAME;
+			name_id amplification_shader_name = NO_NAME;
+			name_id mesh_shader_name          = NO_NAME;
+			name_id fragment_shader_name      = NO_NAME;
 
 			for (size_t j = 0; j < t->members.size; ++j) {
 				if (t->members.m[j].name == add_name("vertex")) {
 					vertex_shader_name = t->members.m[j].value.identifier;
 				}
+				else if (t->members.m[j].name == add_name("amplification")) {
+					amplification_shader_name = t->members.m[j].value.identifier;
+				}
+				else if (t->members.m[j].name == add_name("mesh")) {
+					mesh_shader_name = t->members.m[j].value.identifier;
+				}
 				else if (t->members.m[j].name == add_name("fragment")) {
 					fragment_shader_name = t->members.m[j].value.identifier;
 				}
 			}
 
 			debug_context context = KONG_INIT_ZERO;
-			check(vertex_shader_name != NO_NAME, context, "vertex shader missing");
+			check(vertex_shader_name != NO_NAME || mesh_shader_name != NO_NAME, context, "vertex or mesh shader missing");
 			check(fragment_shader_name != NO_NAME, context, "fragment shader missing");
 
 			for (function_id i = 0; get_function(i) != NULL; ++i) {
 				function *f = get_function(i);
-				if (f->name == vertex_shader_name) {
+				if (vertex_shader_name != NO_NAME && f->name == vertex_shader_name) {
 					vertex_shaders[vertex_shaders_size] = f;
 					vertex_shaders_size += 1;
 				}
+				else if (amplification_shader_name != NO_NAME && f->name == amplification_shader_name) {
+					amplification_shaders[amplification_shaders_size] = f;
+					amplification_shaders_size += 1;
+				}
+				else if (mesh_shader_name != NO_NAME && f->name == mesh_shader_name) {
+					mesh_shaders[mesh_shaders_size] = f;
+					mesh_shaders_size += 1;
+				}
 				else if (f->name == fragment_shader_name) {
 					fragment_shaders[fragment_shaders_size] = f;
 					fragment_shaders_size += 1;
@@ -4037,16 +5631,51 @@ void spirv_export(char *directory, bool debug) {
 
 	for (size_t i = 0; i < vertex_shaders_size; ++i) {
 		input_vars_count = 0;
+		if (!shader_needs_export(vertex_shaders[i])) {
+			continue;
+		}
+		stats_begin("spirv_export_vertex %s", get_name(vertex_shaders[i]->name));
 		spirv_export_vertex(directory, vertex_shaders[i], debug);
+		stats_end();
+	}
+
+	for (size_t i = 0; i < amplification_shaders_size; ++i) {
+		input_vars_count = 0;
+		if (!shader_needs_export(amplification_shaders[i])) {
+			continue;
+		}
+		stats_begin("spirv_export_amplification %s", get_name(amplification_shaders[i]->name));
+		spirv_export_amplification(directory, amplification_shaders[i], debug);
+		stats_end();
+	}
+
+	for (size_t i = 0; i < mesh_shaders_size; ++i) {
+		input_vars_count = 0;
+		if (!shader_needs_export(mesh_shaders[i])) {
+			continue;
+		}
+		stats_begin("spirv_export_mesh %s", get_name(mesh_shaders[i]->name));
+		spirv_export_mesh(directory, mesh_shaders[i], debug);
+		stats_end();
 	}
 
 	for (size_t i = 0; i < fragment_shaders_size; ++i) {
 		input_vars_count = 0;
+		if (!shader_needs_export(fragment_shaders[i])) {
+			continue;
+		}
+		stats_begin("spirv_export_fragment %s", get_name(fragment_shaders[i]->name));
 		spirv_export_fragment(directory, fragment_shaders[i], debug);
+		stats_end();
 	}
 
 	for (size_t i = 0; i < compute_shaders_size; ++i) {
 		input_vars_count = 0;
+		if (!shader_needs_export(compute_shaders[i])) {
+			continue;
+		}
+		stats_begin("spirv_export_compute %s", get_name(compute_shaders[i]->name));
 		spirv_export_compute(directory, compute_shaders[i], debug);
+		stats_end();
 	}
 }
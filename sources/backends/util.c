@@ -15,6 +15,27 @@ void indent(char *code, size_t *offset, int indentation) {
 	*offset += sprintf(&code[*offset], "%s", str);
 }
 
+void write_global_value(char *code, size_t *offset, global *g) {
+	switch (g->value.kind) {
+	case GLOBAL_VALUE_FLOAT:
+		*offset += sprintf(&code[*offset], "%f", g->value.value.floats[0]);
+		break;
+	case GLOBAL_VALUE_INT:
+		*offset += sprintf(&code[*offset], "%i", g->value.value.ints[0]);
+		break;
+	case GLOBAL_VALUE_UINT:
+		*offset += sprintf(&code[*offset], "%uu", g->value.value.uints[0]);
+		break;
+	case GLOBAL_VALUE_BOOL:
+		*offset += sprintf(&code[*offset], "%s", g->value.value.b ? "true" : "false");
+		break;
+	default: {
+		debug_context context = KONG_INIT_ZERO;
+		error(context, "Global %s has no scalar value", get_name(g->name));
+	}
+	}
+}
+
 uint32_t base_type_size(type_id type) {
 	if (type == float_id) {
 		return 4;
@@ -66,13 +87,38 @@ uint32_t base_type_size(type_id type) {
 	return 1;
 }
 
-uint32_t struct_size(type_id id) {
-	uint32_t size = 0;
-	type    *t    = get_type(id);
-	for (size_t member_index = 0; member_index < t->members.size; ++member_index) {
-		size += base_type_size(t->members.m[member_index].type.type);
+void write_file_if_changed(const char *filename, const char *data, size_t size) {
+	FILE *file = fopen(filename, "rb");
+
+	if (file != NULL) {
+		fseek(file, 0, SEEK_END);
+		size_t old_size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+
+		bool unchanged = false;
+
+		if (old_size == size) {
+			char *old_data = (char *)malloc(size + 1);
+			if (old_data != NULL) {
+				unchanged = fread(old_data, 1, size, file) == size && memcmp(old_data, data, size) == 0;
+				free(old_data);
+			}
+		}
+
+		fclose(file);
+
+		if (unchanged) {
+			return;
+		}
 	}
-	return size;
+
+	file = fopen(filename, "wb");
+
+	debug_context context = KONG_INIT_ZERO;
+	check(file != NULL, context, "Could not open %s for writing", filename);
+
+	fwrite(data, 1, size, file);
+	fclose(file);
 }
 
 #ifdef _WIN32
@@ -179,3 +225,42 @@ bool execute_sync(const char *command, uint32_t *exit_code) {
 	return true;
 #endif
 }
+
+FILE *open_output(const char *filename) {
+	char temp_filename[1024];
+	snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", filename);
+
+	FILE *output = fopen(temp_filename, "wb");
+
+	debug_context context = KONG_INIT_ZERO;
+	check(output != NULL, context, "Could not open %s for writing", temp_filename);
+
+	return output;
+}
+
+void close_output_if_changed(FILE *output, const char *filename) {
+	fclose(output);
+
+	char temp_filename[1024];
+	snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", filename);
+
+	FILE *file = fopen(temp_filename, "rb");
+
+	debug_context context = KONG_INIT_ZERO;
+	check(file != NULL, context, "Could not open %s for reading", temp_filename);
+
+	fseek(file, 0, SEEK_END);
+	size_t size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	char *data = (char *)malloc(size + 1);
+	check(data != NULL, context, "Could not allocate %zu bytes for %s", size, temp_filename);
+	size_t read = fread(data, 1, size, file);
+	fclose(file);
+	check(read == size, context, "Could not read %s", temp_filename);
+
+	write_file_if_changed(filename, data, size);
+
+	free(data);
+	remove(temp_filename);
+}
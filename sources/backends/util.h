@@ -1,9 +1,11 @@
 #ifndef KONG_UTIL_HEADER
 #define KONG_UTIL_HEADER
 
+#include "../globals.h"
 #include "../types.h"
 
 #include <stdint.h>
+#include <stdio.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -13,10 +15,17 @@ void indent(char *code, size_t *offset, int indentation);
 
 uint32_t base_type_size(type_id type);
 
-uint32_t struct_size(type_id id);
+// Writes the value of a bool, int, uint or float const as a literal all shader languages and C understand
+void write_global_value(char *code, size_t *offset, global *g);
 
 bool execute_sync(const char *command, uint32_t *exit_code);
 
+void write_file_if_changed(const char *filename, const char *data, size_t size);
+
+// Opens a temporary file which close_output_if_changed moves to filename unless filename already has the same contents
+FILE *open_output(const char *filename);
+void  close_output_if_changed(FILE *output, const char *filename);
+
 #ifdef __cplusplus
 }
 #endif
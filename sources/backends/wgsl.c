@@ -6,8 +6,11 @@
 #include "../functions.h"
 #include "../global.h"
 #include "../parser.h"
+#include "../permutations.h"
 #include "../shader_stage.h"
+#include "../stats.h"
 #include "../types.h"
+#include "blobs.h"
 #include "cstyle.h"
 #include "d3d11.h"
 #include "util.h"
@@ -89,6 +92,27 @@ static const char *type_string(type_id type) {
 	if (type == float4x4_id) {
 		return "mat4x4<f32>";
 	}
+	if (type == half_id) {
+		return "f16";
+	}
+	if (type == half2_id) {
+		return "vec2<f16>";
+	}
+	if (type == half3_id) {
+		return "vec3<f16>";
+	}
+	if (type == half4_id) {
+		return "vec4<f16>";
+	}
+	if (type == half2x2_id) {
+		return "mat2x2<f16>";
+	}
+	if (type == half3x3_id) {
+		return "mat3x3<f16>";
+	}
+	if (type == half4x4_id) {
+		return "mat4x4<f16>";
+	}
 	return get_name(get_type(type)->name);
 }
 
@@ -96,6 +120,21 @@ static const char *type_string(type_id type) {
 //	return get_name(func);
 // }
 
+static const char *wave_function_string(name_id func) {
+	static const char *wave_functions[][2] = {
+	    {"wave_is_first_lane", "subgroupElect"}, {"wave_all_true", "subgroupAll"},            {"wave_any_true", "subgroupAny"},
+	    {"wave_ballot", "subgroupBallot"},       {"wave_sum", "subgroupAdd"},                 {"wave_min", "subgroupMin"},
+	    {"wave_max", "subgroupMax"},             {"wave_prefix_sum", "subgroupExclusiveAdd"}, {"wave_read_first", "subgroupBroadcastFirst"},
+	    {"wave_read_lane", "subgroupShuffle"},
+	};
+	for (size_t wave_function_index = 0; wave_function_index < sizeof(wave_functions) / sizeof(wave_functions[0]); ++wave_function_index) {
+		if (func == add_name(wave_functions[wave_function_index][0])) {
+			return wave_functions[wave_function_index][1];
+		}
+	}
+	return get_name(func);
+}
+
 static void write_code(char *wgsl, char *directory, const char *filename, const char *name, bool framebuffer_texture_format) {
 	char full_filename[512];
 
@@ -116,10 +155,21 @@ static void write_code(char *wgsl, char *directory, const char *filename, const
 		FILE *file = fopen(full_filename, "wb");
 		fprintf(file, "#include \"%s.h\"\n\n", filename);
 
-		fprintf(file, "const char *%s = \"", name);
-
 		size_t length = strlen(wgsl);
 
+		if (get_blob_mode() != BLOB_MODE_STRINGS) {
+			write_blob_definition(file, "const char *", name, (const uint8_t *)wgsl, length, true);
+
+			fprintf(file, "bool %s_uses_framebuffer_texture_format = %s;\n\n", name, framebuffer_texture_format ? "true" : "false");
+
+			fprintf(file, "/*\n%s*/\n", wgsl);
+
+			fclose(file);
+			return;
+		}
+
+		fprintf(file, "const char *%s = \"", name);
+
 		for (size_t i = 0; i < length; ++i) {
 			if (wgsl[i] == '\n') {
 				fprintf(file, "\\n");
@@ -195,6 +245,20 @@ static void add_found_type(type_id t, type_id *types, size_t *types_size) {
 }
 
 static void write_types(char *wgsl, size_t *offset, shader_stage stage, type_id inputs[64], size_t inputs_count, type_id output, function *main) {
+	find_used_capabilities(main);
+
+	// only native with --16bit-types native, the device has to support shader-f16
+	if (is_16bit_type(half_id)) {
+		*offset += sprintf(&wgsl[*offset], "enable f16;\n");
+	}
+	// the device has to support the subgroups feature
+	if (main->used_capabilities.wave_basic) {
+		*offset += sprintf(&wgsl[*offset], "enable subgroups;\n");
+	}
+	if (is_16bit_type(half_id) || main->used_capabilities.wave_basic) {
+		*offset += sprintf(&wgsl[*offset], "\n");
+	}
+
 	type_id types[256];
 	size_t  types_size = 0;
 	find_referenced_types(main, types, &types_size);
@@ -275,6 +339,21 @@ static void write_types(char *wgsl, size_t *offset, shader_stage stage, type_id
 	}
 }
 
+// WGSL only converts the single argument of a constructor, when several arguments are passed
+// an f16 in a vec4<f32> or an i32 in a vec2<u32> has to be converted explicitly
+static void write_constructor_parameter(char *code, size_t *offset, type_id constructed, variable parameter) {
+	type_id parameter_type = parameter.type.type;
+
+	if (constructed != NO_TYPE && is_vector_or_scalar(constructed) && is_vector_or_scalar(parameter_type) &&
+	    vector_base_type(parameter_type) != vector_base_type(constructed)) {
+		type_id converted = vector_to_size(vector_base_type(constructed), vector_size(parameter_type));
+		*offset += sprintf(&code[*offset], "%s(_%" PRIu64 ")", type_string(converted), parameter.index);
+	}
+	else {
+		*offset += sprintf(&code[*offset], "_%" PRIu64, parameter.index);
+	}
+}
+
 static void format_to_string(texture_format format, char *str) {
 	switch (format) {
 	case TEXTURE_FORMAT_FRAMEBUFFER:
@@ -301,8 +380,22 @@ static void write_globals(char *wgsl, size_t *offset, function *main, bool *fram
 		global *g         = get_global(referenced_globals.globals[i]);
 		type   *t         = get_type(g->type);
 		type_id base_type = t->array_size > 0 ? t->base : g->type;
-		if (base_type == float_id) {
-			*offset += sprintf(&wgsl[*offset], "const _%" PRIu64 ": f32 = %f;\n\n", g->var_index, g->value.value.floats[0]);
+		if (g->group_shared && global_has_usage(referenced_globals.globals[i], GLOBAL_USAGE_ATOMIC)) {
+			*offset +=
+			    sprintf(&wgsl[*offset], "var<workgroup> _%" PRIu64 ": array<atomic<%s>, %u>;\n\n", g->var_index, type_string(base_type), t->array_size);
+		}
+		else if (g->group_shared) {
+			*offset += sprintf(&wgsl[*offset], "var<workgroup> _%" PRIu64 ": array<%s, %u>;\n\n", g->var_index, type_string(base_type), t->array_size);
+		}
+		else if (g->specialization) {
+			*offset += sprintf(&wgsl[*offset], "@id(%u) override _%" PRIu64 ": %s = ", g->specialization_id, g->var_index, type_string(g->type));
+			write_global_value(wgsl, offset, g);
+			*offset += sprintf(&wgsl[*offset], ";\n\n");
+		}
+		else if (global_is_scalar_constant(g)) {
+			*offset += sprintf(&wgsl[*offset], "const _%" PRIu64 ": %s = ", g->var_index, type_string(g->type));
+			write_global_value(wgsl, offset, g);
+			*offset += sprintf(&wgsl[*offset], ";\n\n");
 		}
 	}
 
@@ -338,7 +431,8 @@ static void write_globals(char *wgsl, size_t *offset, function *main, bool *fram
 			if (base_type == sampler_type_id) {
 				if (referenced) {
 					*offset +=
-					    sprintf(&wgsl[*offset], "@group(%zu) @binding(%u) var _set%zu_%" PRIu64 ": sampler;\n\n", set_index, binding, set_index, g->var_index);
+					    sprintf(&wgsl[*offset], "@group(%zu) @binding(%u) var _set%zu_%" PRIu64 ": %s;\n\n", set_index, binding, set_index, g->var_index,
+					            (g->usage & GLOBAL_USAGE_SAMPLE_COMPARE) != 0 ? "sampler_comparison" : "sampler");
 				}
 				binding += 1;
 			}
@@ -493,6 +587,41 @@ static small_string get_var(variable var, function *f, function *main) {
 	return name;
 }
 
+// Group shared arrays which are used with atomics can only be accessed via atomic functions
+static bool is_atomic_group_shared(variable var) {
+	for (global_id i = 0; get_global(i) != NULL && get_global(i)->type != NO_TYPE; ++i) {
+		global *g = get_global(i);
+		if (g->var_index == var.index) {
+			return g->group_shared && global_has_usage(i, GLOBAL_USAGE_ATOMIC);
+		}
+	}
+	return false;
+}
+
+static const char *atomic_function_string(name_id func) {
+	static const char *atomic_functions[][2] = {
+	    {"atomic_add", "atomicAdd"}, {"atomic_min", "atomicMin"}, {"atomic_max", "atomicMax"},           {"atomic_and", "atomicAnd"},
+	    {"atomic_or", "atomicOr"},   {"atomic_xor", "atomicXor"}, {"atomic_exchange", "atomicExchange"},
+	};
+	for (size_t atomic_function_index = 0; atomic_function_index < sizeof(atomic_functions) / sizeof(atomic_functions[0]); ++atomic_function_index) {
+		if (func == add_name(atomic_functions[atomic_function_index][0])) {
+			return atomic_functions[atomic_function_index][1];
+		}
+	}
+	assert(false);
+	return NULL;
+}
+
+// array layers are passed as a separate parameter
+static void texture_coords(char *coords, variable tex, variable coord, function *f, function *main) {
+	if (get_type(tex.type.type)->tex_kind == TEXTURE_KIND_2D_ARRAY) {
+		sprintf(coords, "%s.xy, u32(%s.z)", get_var(coord, f, main).str, get_var(coord, f, main).str);
+	}
+	else {
+		sprintf(coords, "%s", get_var(coord, f, main).str);
+	}
+}
+
 static void write_functions(char *code, size_t *offset, shader_stage stage, function *main) {
 	function *functions[256];
 	size_t    functions_size = 0;
@@ -527,6 +656,10 @@ static void write_functions(char *code, size_t *offset, shader_stage stage, func
 		}
 
 		if (f == main) {
+			find_used_builtins(f);
+			check(stage == SHADER_STAGE_COMPUTE || (!f->used_builtins.wave_lane_index && !f->used_builtins.wave_lane_count), context,
+			      "wave_lane_index and wave_lane_count are only supported in compute shaders in WGSL");
+
 			if (stage == SHADER_STAGE_VERTEX) {
 				*offset += sprintf(&code[*offset], "@vertex fn main(");
 				for (uint8_t parameter_index = 0; parameter_index < f->parameters_size; ++parameter_index) {
@@ -589,8 +722,15 @@ static void write_functions(char *code, size_t *offset, shader_stage stage, func
 				*offset += sprintf(&code[*offset],
 				                   "@compute @workgroup_size(%u, %u, %u) fn main(@builtin(local_invocation_id) _kong_group_thread_id: vec3<u32>, "
 				                   "@builtin(workgroup_id) _kong_group_id: vec3<u32>, @builtin(global_invocation_id) _kong_dispatch_thread_id: vec3<u32>, "
-				                   "@builtin(num_workgroups) _kong_threads_count: vec3<u32>, @builtin(local_invocation_index) _kong_group_index: u32) {\n",
+				                   "@builtin(num_workgroups) _kong_threads_count: vec3<u32>, @builtin(local_invocation_index) _kong_group_index: u32",
 				                   (uint32_t)threads->parameters[0], (uint32_t)threads->parameters[1], (uint32_t)threads->parameters[2]);
+				if (f->used_builtins.wave_lane_index) {
+					*offset += sprintf(&code[*offset], ", @builtin(subgroup_invocation_id) _kong_wave_lane_index: u32");
+				}
+				if (f->used_builtins.wave_lane_count) {
+					*offset += sprintf(&code[*offset], ", @builtin(subgroup_size) _kong_wave_lane_count: u32");
+				}
+				*offset += sprintf(&code[*offset], ") {\n");
 			}
 		}
 		else {
@@ -643,6 +783,13 @@ static void write_functions(char *code, size_t *offset, shader_stage stage, func
 					            get_var(o->op_load_access_list.access_list[0].access_element.index, f, main).str,
 					            get_var(o->op_load_access_list.access_list[0].access_element.index, f, main).str);
 				}
+				else if (is_atomic_group_shared(o->op_load_access_list.from)) {
+					assert(o->op_load_access_list.access_list_size == 1);
+
+					*offset += sprintf(&code[*offset], "var %s: %s = atomicLoad(&%s[_%" PRIu64 "]);\n", get_var(o->op_load_access_list.to, f, main).str,
+					                   type_string(o->op_load_access_list.to.type.type), get_var(o->op_load_access_list.from, f, main).str,
+					                   o->op_load_access_list.access_list[0].access_element.index.index);
+				}
 				else {
 					*offset += sprintf(&code[*offset], "var %s: %s = %s", get_var(o->op_load_access_list.to, f, main).str,
 					                   type_string(o->op_load_access_list.to.type.type), get_var(o->op_load_access_list.from, f, main).str);
@@ -697,6 +844,15 @@ static void write_functions(char *code, size_t *offset, shader_stage stage, func
 					                   get_var(o->op_store_access_list.to, f, main).str, o->op_store_access_list.access_list[0].access_element.index.index,
 					                   o->op_store_access_list.access_list[0].access_element.index.index, o->op_store_access_list.from.index);
 				}
+				else if (is_atomic_group_shared(o->op_store_access_list.to)) {
+					debug_context context = KONG_INIT_ZERO;
+					check(o->type == OPCODE_STORE_ACCESS_LIST, context, "Group shared arrays which are used with atomics only support plain assignments");
+					assert(o->op_store_access_list.access_list_size == 1);
+
+					*offset += sprintf(&code[*offset], "atomicStore(&%s[_%" PRIu64 "], %s(_%" PRIu64 "));\n", get_var(o->op_store_access_list.to, f, main).str,
+					                   o->op_store_access_list.access_list[0].access_element.index.index,
+					                   type_string(o->op_store_access_list.access_list[0].type), o->op_store_access_list.from.index);
+				}
 				else {
 					*offset += sprintf(&code[*offset], "%s", get_var(o->op_store_access_list.to, f, main).str);
 
@@ -935,6 +1091,90 @@ static void write_functions(char *code, size_t *offset, shader_stage stage, func
 					                   get_var(o->op_call.parameters[1], f, main).str, get_var(o->op_call.parameters[2], f, main).str,
 					                   get_var(o->op_call.parameters[3], f, main).str);
 				}
+				else if (o->op_call.func == add_name("load")) {
+					check(o->op_call.parameters_size == 3, context, "load requires three arguments");
+					indent(code, offset, indentation);
+
+					variable tex   = o->op_call.parameters[0];
+					variable coord = o->op_call.parameters[1];
+					variable level = o->op_call.parameters[2];
+
+					texture_kind kind = get_type(tex.type.type)->tex_kind;
+					check(kind != TEXTURE_KIND_CUBE, context, "load does not support cube textures");
+
+					if (kind == TEXTURE_KIND_2D_ARRAY) {
+						*offset += sprintf(&code[*offset], "var %s: %s = textureLoad(%s, vec2<i32>(%s.xy), i32(%s.z), i32(%s));\n",
+						                   get_var(o->op_call.var, f, main).str, type_string(o->op_call.var.type.type), get_var(tex, f, main).str,
+						                   get_var(coord, f, main).str, get_var(coord, f, main).str, get_var(level, f, main).str);
+					}
+					else {
+						*offset += sprintf(&code[*offset], "var %s: %s = textureLoad(%s, vec2<i32>(%s), i32(%s));\n", get_var(o->op_call.var, f, main).str,
+						                   type_string(o->op_call.var.type.type), get_var(tex, f, main).str, get_var(coord, f, main).str,
+						                   get_var(level, f, main).str);
+					}
+				}
+				else if (is_gather_function(o->op_call.func)) {
+					check(o->op_call.parameters_size == 3, context, "%s requires three arguments", get_name(o->op_call.func));
+					indent(code, offset, indentation);
+
+					variable tex = o->op_call.parameters[0];
+
+					char coords[256];
+					texture_coords(coords, tex, o->op_call.parameters[2], f, main);
+
+					// depth textures only have one component to gather
+					if (is_depth(get_type(tex.type.type)->tex_format)) {
+						check(gather_component(o->op_call.func) == 0, context, "%s is not supported for depth textures", get_name(o->op_call.func));
+						*offset += sprintf(&code[*offset], "var %s: %s = textureGather(%s, %s, %s);\n", get_var(o->op_call.var, f, main).str,
+						                   type_string(o->op_call.var.type.type), get_var(tex, f, main).str, get_var(o->op_call.parameters[1], f, main).str,
+						                   coords);
+					}
+					else {
+						*offset += sprintf(&code[*offset], "var %s: %s = textureGather(%i, %s, %s, %s);\n", get_var(o->op_call.var, f, main).str,
+						                   type_string(o->op_call.var.type.type), gather_component(o->op_call.func), get_var(tex, f, main).str,
+						                   get_var(o->op_call.parameters[1], f, main).str, coords);
+					}
+				}
+				else if (o->op_call.func == add_name("sample_grad")) {
+					check(o->op_call.parameters_size == 5, context, "sample_grad requires five arguments");
+					check(!is_depth(get_type(o->op_call.parameters[0].type.type)->tex_format), context, "sample_grad is not supported for depth textures");
+					indent(code, offset, indentation);
+
+					char coords[256];
+					texture_coords(coords, o->op_call.parameters[0], o->op_call.parameters[2], f, main);
+
+					*offset += sprintf(&code[*offset], "var %s: %s = textureSampleGrad(%s, %s, %s, %s, %s);\n", get_var(o->op_call.var, f, main).str,
+					                   type_string(o->op_call.var.type.type), get_var(o->op_call.parameters[0], f, main).str,
+					                   get_var(o->op_call.parameters[1], f, main).str, coords, get_var(o->op_call.parameters[3], f, main).str,
+					                   get_var(o->op_call.parameters[4], f, main).str);
+				}
+				else if (o->op_call.func == add_name("sample_bias")) {
+					check(o->op_call.parameters_size == 4, context, "sample_bias requires four arguments");
+					check(!is_depth(get_type(o->op_call.parameters[0].type.type)->tex_format), context, "sample_bias is not supported for depth textures");
+					check(stage == SHADER_STAGE_FRAGMENT, context, "sample_bias can only be used in fragment shaders");
+					indent(code, offset, indentation);
+
+					char coords[256];
+					texture_coords(coords, o->op_call.parameters[0], o->op_call.parameters[2], f, main);
+
+					*offset += sprintf(&code[*offset], "var %s: %s = textureSampleBias(%s, %s, %s, %s);\n", get_var(o->op_call.var, f, main).str,
+					                   type_string(o->op_call.var.type.type), get_var(o->op_call.parameters[0], f, main).str,
+					                   get_var(o->op_call.parameters[1], f, main).str, coords, get_var(o->op_call.parameters[3], f, main).str);
+				}
+				else if (o->op_call.func == add_name("sample_compare")) {
+					check(o->op_call.parameters_size == 4, context, "sample_compare requires four arguments");
+					check(get_type(o->op_call.parameters[0].type.type)->tex_kind == TEXTURE_KIND_2D, context,
+					      "sample_compare only supports 2D textures in WGSL");
+					indent(code, offset, indentation);
+
+					// only fragment shaders have the derivatives to pick a mip level
+					const char *compare = stage == SHADER_STAGE_FRAGMENT ? "textureSampleCompare" : "textureSampleCompareLevel";
+
+					*offset += sprintf(&code[*offset], "var %s: %s = %s(%s, %s, %s, %s);\n", get_var(o->op_call.var, f, main).str,
+					                   type_string(o->op_call.var.type.type), compare, get_var(o->op_call.parameters[0], f, main).str,
+					                   get_var(o->op_call.parameters[1], f, main).str, get_var(o->op_call.parameters[2], f, main).str,
+					                   get_var(o->op_call.parameters[3], f, main).str);
+				}
 				else if (o->op_call.func == add_name("group_id")) {
 					check(o->op_call.parameters_size == 0, context, "group_id can not have a parameter");
 					indent(code, offset, indentation);
@@ -963,6 +1203,34 @@ static void write_functions(char *code, size_t *offset, shader_stage stage, func
 					*offset +=
 					    sprintf(&code[*offset], "var _%" PRIu64 ": %s = i32(_kong_vertex_id);\n", o->op_call.var.index, type_string(o->op_call.var.type.type));
 				}
+				else if (o->op_call.func == add_name("wave_lane_index")) {
+					check(o->op_call.parameters_size == 0, context, "wave_lane_index can not have a parameter");
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "var _%" PRIu64 ": %s = _kong_wave_lane_index;\n", o->op_call.var.index,
+					                   type_string(o->op_call.var.type.type));
+				}
+				else if (o->op_call.func == add_name("wave_lane_count")) {
+					check(o->op_call.parameters_size == 0, context, "wave_lane_count can not have a parameter");
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "var _%" PRIu64 ": %s = _kong_wave_lane_count;\n", o->op_call.var.index,
+					                   type_string(o->op_call.var.type.type));
+				}
+				else if (o->op_call.func == add_name("wave_count_bits")) {
+					check(o->op_call.parameters_size == 1, context, "wave_count_bits requires one parameter");
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "var _%" PRIu64 ": %s = dot(countOneBits(subgroupBallot(_%" PRIu64 ")), vec4<u32>(1u));\n",
+					                   o->op_call.var.index, type_string(o->op_call.var.type.type), o->op_call.parameters[0].index);
+				}
+				else if (o->op_call.func == add_name("group_barrier") || o->op_call.func == add_name("group_memory_barrier")) {
+					check(o->op_call.parameters_size == 0, context, "%s can not have a parameter", get_name(o->op_call.func));
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "workgroupBarrier();\n");
+				}
+				else if (o->op_call.func == add_name("device_barrier") || o->op_call.func == add_name("device_memory_barrier")) {
+					check(o->op_call.parameters_size == 0, context, "%s can not have a parameter", get_name(o->op_call.func));
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "storageBarrier();\n");
+				}
 				else if (o->op_call.func == add_name("lerp")) {
 					*offset += sprintf(&code[*offset], "var _%" PRIu64 ": %s = mix(_%" PRIu64 ", _%" PRIu64 ", _%" PRIu64 ");\n", o->op_call.var.index,
 					                   type_string(o->op_call.var.type.type), o->op_call.parameters[0].index, o->op_call.parameters[1].index,
@@ -1024,19 +1292,65 @@ static void write_functions(char *code, size_t *offset, shader_stage stage, func
 					else if (func_name_id == add_name("uint4")) {
 						func_name = "vec4<u32>";
 					}
+					else if (is_16bit_type(find_type_by_name(func_name_id))) {
+						func_name = type_string(find_type_by_name(func_name_id));
+					}
+					else {
+						func_name = wave_function_string(func_name_id);
+					}
 
 					indent(code, offset, indentation);
-					*offset += sprintf(&code[*offset], "var _%" PRIu64 ": %s = %s(", o->op_call.var.index, type_string(o->op_call.var.type.type), func_name);
-					if (o->op_call.parameters_size > 0) {
-						*offset += sprintf(&code[*offset], "_%" PRIu64, o->op_call.parameters[0].index);
-						for (uint8_t i = 1; i < o->op_call.parameters_size; ++i) {
-							*offset += sprintf(&code[*offset], ", _%" PRIu64, o->op_call.parameters[i].index);
+					if (o->op_call.var.type.type == void_id) {
+						*offset += sprintf(&code[*offset], "%s(", func_name);
+					}
+					else {
+						*offset +=
+						    sprintf(&code[*offset], "var _%" PRIu64 ": %s = %s(", o->op_call.var.index, type_string(o->op_call.var.type.type), func_name);
+					}
+					type_id constructed = o->op_call.parameters_size > 1 ? find_type_by_name(func_name_id) : NO_TYPE;
+					for (uint8_t i = 0; i < o->op_call.parameters_size; ++i) {
+						if (i > 0) {
+							*offset += sprintf(&code[*offset], ", ");
 						}
+						write_constructor_parameter(code, offset, constructed, o->op_call.parameters[i]);
 					}
 					*offset += sprintf(&code[*offset], ");\n");
 				}
 				break;
 			}
+			case OPCODE_ATOMIC: {
+				debug_context context = KONG_INIT_ZERO;
+				check(is_atomic_group_shared(o->op_atomic.to), context, "WGSL atomics are only supported on group shared arrays");
+
+				const char  *element_type = type_string(o->op_atomic.var.type.type);
+				small_string result       = get_var(o->op_atomic.var, f, main);
+				small_string to           = get_var(o->op_atomic.to, f, main);
+				uint64_t     element      = o->op_atomic.index.index;
+				uint64_t     value        = o->op_atomic.values[0].index;
+
+				indent(code, offset, indentation);
+				if (o->op_atomic.func == add_name("atomic_compare_exchange")) {
+					// the weak version can fail spuriously
+					*offset += sprintf(&code[*offset], "var %s: %s;\n", result.str, element_type);
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "loop {\n");
+					indent(code, offset, indentation + 1);
+					*offset += sprintf(&code[*offset], "let %s_result = atomicCompareExchangeWeak(&%s[_%" PRIu64 "], %s(_%" PRIu64 "), %s(_%" PRIu64 "));\n",
+					                   result.str, to.str, element, element_type, value, element_type, o->op_atomic.values[1].index);
+					indent(code, offset, indentation + 1);
+					*offset += sprintf(&code[*offset], "%s = %s_result.old_value;\n", result.str, result.str);
+					indent(code, offset, indentation + 1);
+					*offset += sprintf(&code[*offset], "if (%s_result.exchanged || %s != %s(_%" PRIu64 ")) { break; }\n", result.str, result.str, element_type,
+					                   value);
+					indent(code, offset, indentation);
+					*offset += sprintf(&code[*offset], "}\n");
+				}
+				else {
+					*offset += sprintf(&code[*offset], "var %s: %s = %s(&%s[_%" PRIu64 "], %s(_%" PRIu64 "));\n", result.str, element_type,
+					                   atomic_function_string(o->op_atomic.func), to.str, element, element_type, value);
+				}
+				break;
+			}
 			case OPCODE_NEGATE: {
 				indent(code, offset, indentation);
 				*offset += sprintf(&code[*offset], "var _%" PRIu64 ": %s = -_%" PRIu64 ";\n", o->op_negate.to.index, type_string(o->op_negate.to.type.type),
@@ -1083,7 +1397,7 @@ static void wgsl_export_vertex(char *directory, function *main) {
 
 	write_functions(wgsl, &offset, SHADER_STAGE_VERTEX, main);
 
-	char *name = get_name(main->name);
+	char *name = shader_name(main);
 
 	char filename[512];
 	sprintf(filename, "kong_%s", name);
@@ -1113,7 +1427,7 @@ static void wgsl_export_fragment(char *directory, function *main) {
 
 	write_functions(wgsl, &offset, SHADER_STAGE_FRAGMENT, main);
 
-	char *name = get_name(main->name);
+	char *name = shader_name(main);
 
 	char filename[512];
 	sprintf(filename, "kong_%s", name);
@@ -1138,7 +1452,7 @@ static void wgsl_export_compute(char *directory, function *main) {
 
 	write_functions(wgsl, &offset, SHADER_STAGE_COMPUTE, main);
 
-	char *name = get_name(main->name);
+	char *name = shader_name(main);
 
 	char filename[512];
 	sprintf(filename, "kong_%s", name);
@@ -1206,14 +1520,29 @@ void wgsl_export(char *directory) {
 	}
 
 	for (size_t i = 0; i < vertex_functions_size; ++i) {
+		if (!shader_needs_export(get_function(vertex_functions[i]))) {
+			continue;
+		}
+		stats_begin("wgsl_export_vertex %s", get_name(get_function(vertex_functions[i])->name));
 		wgsl_export_vertex(directory, get_function(vertex_functions[i]));
+		stats_end();
 	}
 
 	for (size_t i = 0; i < fragment_functions_size; ++i) {
+		if (!shader_needs_export(get_function(fragment_functions[i]))) {
+			continue;
+		}
+		stats_begin("wgsl_export_fragment %s", get_name(get_function(fragment_functions[i])->name));
 		wgsl_export_fragment(directory, get_function(fragment_functions[i]));
+		stats_end();
 	}
 
 	for (size_t i = 0; i < compute_functions_size; ++i) {
+		if (!shader_needs_export(get_function(compute_functions[i]))) {
+			continue;
+		}
+		stats_begin("wgsl_export_compute %s", get_name(get_function(compute_functions[i])->name));
 		wgsl_export_compute(directory, get_function(compute_functions[i]));
+		stats_end();
 	}
 }
@@ -94,6 +94,20 @@ variable allocate_variable(type_ref type, variable_kind kind) {
 	return v;
 }
 
+uint64_t allocated_variables_count(void) {
+	return next_variable_id - 1;
+}
+
+void reset_allocated_variables(uint64_t count) {
+	next_variable_id = count + 1;
+}
+
+uint64_t allocate_block_id(void) {
+	uint64_t id = next_variable_id;
+	++next_variable_id;
+	return id;
+}
+
 opcode *emit_op(opcodes *code, opcode *o) {
 	assert(code->size + o->size < OPCODES_SIZE);
 
@@ -437,7 +451,7 @@ variable emit_expression(opcodes *code, block *parent, expression *e) {
 	case EXPRESSION_FLOAT: {
 		type_ref t;
 		init_type_ref(&t, NO_NAME);
-		t.type     = float_id;
+		t.type     = is_16bit_type(e->type.type) ? e->type.type : float_id;
 		variable v = allocate_variable(t, VARIABLE_INTERNAL);
 
 		opcode o;
@@ -452,7 +466,7 @@ variable emit_expression(opcodes *code, block *parent, expression *e) {
 	case EXPRESSION_INT: {
 		type_ref t;
 		init_type_ref(&t, NO_NAME);
-		t.type     = int_id;
+		t.type     = is_16bit_type(e->type.type) ? e->type.type : int_id;
 		variable v = allocate_variable(t, VARIABLE_INTERNAL);
 
 		opcode o;
@@ -478,6 +492,27 @@ variable emit_expression(opcodes *code, block *parent, expression *e) {
 		t.type     = e->type.type;
 		variable v = allocate_variable(t, VARIABLE_INTERNAL);
 
+		if (is_atomic_function(e->call.func_name)) {
+			expression *target = e->call.parameters.e[0];
+
+			opcode o;
+			o.type            = OPCODE_ATOMIC;
+			o.size            = OP_SIZE(o, op_atomic);
+			o.op_atomic.func  = e->call.func_name;
+			o.op_atomic.var   = v;
+			o.op_atomic.index = emit_expression(code, parent, target->element.element_index);
+			o.op_atomic.to    = emit_expression(code, parent, target->element.of);
+
+			for (size_t i = 1; i < e->call.parameters.size; ++i) {
+				o.op_atomic.values[i - 1] = emit_expression(code, parent, e->call.parameters.e[i]);
+			}
+			o.op_atomic.values_size = (uint8_t)(e->call.parameters.size - 1);
+
+			emit_op(code, &o);
+
+			return v;
+		}
+
 		opcode o;
 		o.type         = OPCODE_CALL;
 		o.size         = OP_SIZE(o, op_call);
@@ -721,11 +756,13 @@ static block_ids emit_statement(opcodes *code, block *parent, statement *stateme
 
 		{
 			opcode o;
-			o.type                       = OPCODE_WHILE_START;
-			o.op_while_start.start_id    = start_id;
-			o.op_while_start.continue_id = continue_id;
-			o.op_while_start.end_id      = end_id;
-			o.size                       = OP_SIZE(o, op_while_start);
+			o.type                        = OPCODE_WHILE_START;
+			o.op_while_start.start_id     = start_id;
+			o.op_while_start.continue_id  = continue_id;
+			o.op_while_start.end_id       = end_id;
+			o.op_while_start.hint         = statement->whiley.hint;
+			o.op_while_start.unroll_count = statement->whiley.unroll_count;
+			o.size                        = OP_SIZE(o, op_while_start);
 			emit_op(code, &o);
 		}
 
@@ -766,11 +803,13 @@ static block_ids emit_statement(opcodes *code, block *parent, statement *stateme
 
 		{
 			opcode o;
-			o.type                       = OPCODE_WHILE_START;
-			o.op_while_start.start_id    = start_id;
-			o.op_while_start.continue_id = continue_id;
-			o.op_while_start.end_id      = end_id;
-			o.size                       = OP_SIZE(o, op_while_start);
+			o.type                        = OPCODE_WHILE_START;
+			o.op_while_start.start_id     = start_id;
+			o.op_while_start.continue_id  = continue_id;
+			o.op_while_start.end_id       = end_id;
+			o.op_while_start.hint         = statement->whiley.hint;
+			o.op_while_start.unroll_count = statement->whiley.unroll_count;
+			o.size                        = OP_SIZE(o, op_while_start);
 			emit_op(code, &o);
 		}
 
@@ -61,6 +61,7 @@ typedef enum opcode_type {
 	OPCODE_RETURN,
 	OPCODE_DISCARD,
 	OPCODE_CALL,
+	OPCODE_ATOMIC,
 	OPCODE_MULTIPLY,
 	OPCODE_DIVIDE,
 	OPCODE_MOD,
@@ -88,6 +89,14 @@ typedef enum opcode_type {
 	OPCODE_BLOCK_END
 } opcode_type;
 
+typedef enum loop_hint {
+	LOOP_HINT_NONE,
+	// #[unroll] or #[unroll(count)]
+	LOOP_HINT_UNROLL,
+	// #[loop]
+	LOOP_HINT_LOOP,
+} loop_hint;
+
 typedef struct opcode {
 	opcode_type type;
 	uint32_t    size;
@@ -143,6 +152,14 @@ typedef struct opcode {
 			variable parameters[64];
 			uint8_t  parameters_size;
 		} op_call;
+		struct {
+			variable var;
+			name_id  func;
+			variable to;
+			variable index;
+			variable values[2];
+			uint8_t  values_size;
+		} op_atomic;
 		struct {
 			variable right;
 			variable left;
@@ -154,9 +171,11 @@ typedef struct opcode {
 			uint64_t end_id;
 		} op_if;
 		struct {
-			uint64_t start_id;
-			uint64_t continue_id;
-			uint64_t end_id;
+			uint64_t  start_id;
+			uint64_t  continue_id;
+			uint64_t  end_id;
+			loop_hint hint;
+			uint32_t  unroll_count;
 		} op_while_start;
 		struct {
 			uint64_t start_id;
@@ -193,6 +212,13 @@ void compile_function_block(opcodes *code, struct statement *block);
 
 variable allocate_variable(type_ref type, variable_kind kind);
 
+uint64_t allocated_variables_count(void);
+
+// Forgets all variables and block ids which were allocated after count variables
+void reset_allocated_variables(uint64_t count);
+
+uint64_t allocate_block_id(void);
+
 #define OP_SIZE(op, opmember) offsetof(opcode, opmember) + sizeof(op.opmember)
 
 #ifdef __cplusplus
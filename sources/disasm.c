@@ -113,6 +113,20 @@ static void write_functions(void) {
 				kong_log(LOG_LEVEL_INFO, "$%zu = CALL %s(%s)", o->op_call.var.index, get_name(o->op_call.func), parameters);
 				break;
 			}
+			case OPCODE_ATOMIC: {
+				char values[256];
+				int  offset = 0;
+
+				values[0] = 0;
+
+				for (int i = 0; i < o->op_atomic.values_size; ++i) {
+					offset += sprintf(&values[offset], ", $%" PRIu64, o->op_atomic.values[i].index);
+				}
+
+				kong_log(LOG_LEVEL_INFO, "$%zu = ATOMIC %s($%zu[$%zu]%s)", o->op_atomic.var.index, get_name(o->op_atomic.func), o->op_atomic.to.index,
+				         o->op_atomic.index.index, values);
+				break;
+			}
 			case OPCODE_VAR:
 				break;
 			case OPCODE_NOT:
@@ -11,6 +11,24 @@ static function   *functions           = NULL;
 static function_id functions_size      = 1024;
 static function_id next_function_index = 0;
 
+static void add_func_void(const char *name) {
+	function_id func = add_function(add_name(name));
+	function   *f    = get_function(func);
+	init_type_ref(&f->return_type, add_name("void"));
+	f->return_type.type = find_type_by_ref(&f->return_type);
+	f->parameters_size  = 0;
+	f->block            = NULL;
+}
+
+static void add_func_float4(const char *name) {
+	function_id func = add_function(add_name(name));
+	function   *f    = get_function(func);
+	init_type_ref(&f->return_type, add_name("float4"));
+	f->return_type.type = find_type_by_ref(&f->return_type);
+	f->parameters_size  = 0;
+	f->block            = NULL;
+}
+
 static void add_func_int(const char *name) {
 	function_id func = add_function(add_name(name));
 	function   *f    = get_function(func);
@@ -211,6 +229,100 @@ static void add_func_void_uint_uint(const char *name) {
 	f->block = NULL;
 }
 
+static void add_func_uint_uint_uint(const char *name) {
+	function_id func = add_function(add_name(name));
+	function   *f    = get_function(func);
+
+	init_type_ref(&f->return_type, add_name("uint"));
+	f->return_type.type = find_type_by_ref(&f->return_type);
+
+	f->parameter_names[0] = add_name("a");
+	f->parameter_names[1] = add_name("b");
+	for (int i = 0; i < 2; ++i) {
+		init_type_ref(&f->parameter_types[i], add_name("uint"));
+		f->parameter_types[i].type = find_type_by_ref(&f->parameter_types[i]);
+	}
+	f->parameters_size = 2;
+
+	f->block = NULL;
+}
+
+static void add_func_uint_uint_uint_uint(const char *name) {
+	function_id func = add_function(add_name(name));
+	function   *f    = get_function(func);
+
+	init_type_ref(&f->return_type, add_name("uint"));
+	f->return_type.type = find_type_by_ref(&f->return_type);
+
+	f->parameter_names[0] = add_name("a");
+	f->parameter_names[1] = add_name("b");
+	f->parameter_names[2] = add_name("c");
+	for (int i = 0; i < 3; ++i) {
+		init_type_ref(&f->parameter_types[i], add_name("uint"));
+		f->parameter_types[i].type = find_type_by_ref(&f->parameter_types[i]);
+	}
+	f->parameters_size = 3;
+
+	f->block = NULL;
+}
+
+static void add_func_bool(const char *name) {
+	function_id func = add_function(add_name(name));
+	function   *f    = get_function(func);
+	init_type_ref(&f->return_type, add_name("bool"));
+	f->return_type.type = find_type_by_ref(&f->return_type);
+	f->parameters_size  = 0;
+	f->block            = NULL;
+}
+
+static void add_func_type_bool(const char *name, const char *return_type) {
+	function_id func = add_function(add_name(name));
+	function   *f    = get_function(func);
+	init_type_ref(&f->return_type, add_name(return_type));
+	f->return_type.type   = find_type_by_ref(&f->return_type);
+	f->parameter_names[0] = add_name("a");
+	init_type_ref(&f->parameter_types[0], add_name("bool"));
+	f->parameter_types[0].type = find_type_by_ref(&f->parameter_types[0]);
+	f->parameters_size         = 1;
+	f->block                   = NULL;
+}
+
+static void add_func_float_float_uint(const char *name) {
+	function_id func = add_function(add_name(name));
+	function   *f    = get_function(func);
+	init_type_ref(&f->return_type, add_name("float"));
+	f->return_type.type = find_type_by_ref(&f->return_type);
+
+	f->parameter_names[0] = add_name("a");
+	init_type_ref(&f->parameter_types[0], add_name("float"));
+	f->parameter_types[0].type = find_type_by_ref(&f->parameter_types[0]);
+
+	f->parameter_names[1] = add_name("b");
+	init_type_ref(&f->parameter_types[1], add_name("uint"));
+	f->parameter_types[1].type = find_type_by_ref(&f->parameter_types[1]);
+
+	f->parameters_size = 2;
+	f->block           = NULL;
+}
+
+static void add_constructor(const char *name, const char *parameter_type, uint8_t parameters_size) {
+	static const char *parameter_names[] = {"x", "y", "z", "w"};
+
+	function_id func = add_function(add_name(name));
+	function   *f    = get_function(func);
+	init_type_ref(&f->return_type, add_name(name));
+	f->return_type.type = find_type_by_ref(&f->return_type);
+
+	for (uint8_t parameter_index = 0; parameter_index < parameters_size; ++parameter_index) {
+		f->parameter_names[parameter_index] = add_name(parameter_names[parameter_index]);
+		init_type_ref(&f->parameter_types[parameter_index], add_name(parameter_type));
+		f->parameter_types[parameter_index].type = find_type_by_ref(&f->parameter_types[parameter_index]);
+	}
+	f->parameters_size = parameters_size;
+
+	f->block = NULL;
+}
+
 void functions_init(void) {
 	function     *new_functions = (function *)realloc(functions, functions_size * sizeof(function));
 	debug_context context       = KONG_INIT_ZERO;
@@ -242,6 +354,17 @@ void functions_init(void) {
 		f->block                   = NULL;
 	}
 
+	// the typer returns a float instead for depth textures and for sample_compare
+	add_func_float4("load");
+	add_func_float4("gather");
+	add_func_float4("gather_red");
+	add_func_float4("gather_green");
+	add_func_float4("gather_blue");
+	add_func_float4("gather_alpha");
+	add_func_float4("sample_grad");
+	add_func_float4("sample_bias");
+	add_func_float4("sample_compare");
+
 	{
 		function_id func = add_function(add_name("float"));
 		function   *f    = get_function(func);
@@ -644,6 +767,28 @@ void functions_init(void) {
 		f->block = NULL;
 	}
 
+	// without native 16 bit types the names are aliases and the calls go to the 32 bit constructors
+	if (is_16bit_type(half_id)) {
+		add_constructor("half", "half", 1);
+		add_constructor("half2", "half", 2);
+		add_constructor("half3", "half", 3);
+		add_constructor("half4", "half", 4);
+		add_constructor("half2x2", "half2", 2);
+		add_constructor("half3x3", "half3", 3);
+		add_constructor("half4x4", "half4", 4);
+	}
+
+	if (is_16bit_type(short_id)) {
+		add_constructor("short", "short", 1);
+		add_constructor("short2", "short", 2);
+		add_constructor("short3", "short", 3);
+		add_constructor("short4", "short", 4);
+		add_constructor("ushort", "ushort", 1);
+		add_constructor("ushort2", "ushort", 2);
+		add_constructor("ushort3", "ushort", 3);
+		add_constructor("ushort4", "ushort", 4);
+	}
+
 	{
 		function_id func = add_function(add_name("trace_ray"));
 		function   *f    = get_function(func);
@@ -744,6 +889,36 @@ void functions_init(void) {
 	add_func_float_float("ddx");
 	add_func_float_float("ddy");
 
+	// the float versions are placeholders, the typer passes the parameter type through
+	add_func_uint("wave_lane_index");
+	add_func_uint("wave_lane_count");
+	add_func_bool("wave_is_first_lane");
+	add_func_type_bool("wave_all_true", "bool");
+	add_func_type_bool("wave_any_true", "bool");
+	add_func_type_bool("wave_ballot", "uint4");
+	add_func_type_bool("wave_count_bits", "uint");
+	add_func_float_float("wave_sum");
+	add_func_float_float("wave_min");
+	add_func_float_float("wave_max");
+	add_func_float_float("wave_prefix_sum");
+	add_func_float_float("wave_read_first");
+	add_func_float_float_uint("wave_read_lane");
+
+	add_func_void("group_barrier");
+	add_func_void("group_memory_barrier");
+	add_func_void("device_barrier");
+	add_func_void("device_memory_barrier");
+
+	// the uint versions are placeholders, the typer passes the element type through
+	add_func_uint_uint_uint("atomic_add");
+	add_func_uint_uint_uint("atomic_min");
+	add_func_uint_uint_uint("atomic_max");
+	add_func_uint_uint_uint("atomic_and");
+	add_func_uint_uint_uint("atomic_or");
+	add_func_uint_uint_uint("atomic_xor");
+	add_func_uint_uint_uint("atomic_exchange");
+	add_func_uint_uint_uint_uint("atomic_compare_exchange");
+
 	add_func_void_uint_uint("set_mesh_output_counts");
 
 	{
@@ -832,3 +1007,32 @@ function *get_function(function_id function) {
 	}
 	return &functions[function];
 }
+
+bool is_texture_function(name_id name) {
+	return name == add_name("sample") || name == add_name("sample_lod") || name == add_name("sample_grad") || name == add_name("sample_bias") ||
+	       name == add_name("sample_compare") || name == add_name("load") || is_gather_function(name);
+}
+
+bool is_gather_function(name_id name) {
+	return name == add_name("gather") || name == add_name("gather_red") || name == add_name("gather_green") || name == add_name("gather_blue") ||
+	       name == add_name("gather_alpha");
+}
+
+uint32_t gather_component(name_id name) {
+	if (name == add_name("gather_green")) {
+		return 1;
+	}
+	if (name == add_name("gather_blue")) {
+		return 2;
+	}
+	if (name == add_name("gather_alpha")) {
+		return 3;
+	}
+	return 0;
+}
+
+bool is_atomic_function(name_id name) {
+	return name == add_name("atomic_add") || name == add_name("atomic_min") || name == add_name("atomic_max") || name == add_name("atomic_and") ||
+	       name == add_name("atomic_or") || name == add_name("atomic_xor") || name == add_name("atomic_exchange") ||
+	       name == add_name("atomic_compare_exchange");
+}
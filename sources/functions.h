@@ -21,12 +21,25 @@ typedef struct builtins {
 	bool group_thread_id;
 	bool group_id;
 	bool vertex_id;
+	bool wave_lane_index;
+	bool wave_lane_count;
 } builtins;
 
 typedef struct capabilities {
 	bool capabilities_analyzed;
 	bool image_read;
 	bool image_write;
+	bool wave_basic;
+	bool wave_vote;
+	bool wave_ballot;
+	bool wave_arithmetic;
+	bool wave_shuffle;
+	bool group_shared;
+	bool barriers;
+	bool atomics;
+	bool texture_gather;
+	bool texture_gather_component;
+	bool mesh_shading;
 } capabilities;
 
 typedef struct function {
@@ -55,6 +68,16 @@ function_id find_function(name_id name);
 
 function *get_function(function_id function);
 
+// Built-ins which read the texture in their first parameter, all but load take a sampler second
+bool is_texture_function(name_id name);
+
+bool is_gather_function(name_id name);
+
+// The component gather_red, gather_green, gather_blue and gather_alpha read, gather reads the first one
+uint32_t gather_component(name_id name);
+
+bool is_atomic_function(name_id name);
+
 #ifdef __cplusplus
 }
 #endif
@@ -4,10 +4,14 @@
 #include "global.h"
 
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 
 static global    globals[1024];
 static global_id globals_size = 0;
 
+static uint32_t specializations_size = 0;
+
 void globals_init(void) {
 	global_value int_value;
 	int_value.kind = GLOBAL_VALUE_INT;
@@ -159,35 +163,101 @@ void globals_init(void) {
 }
 
 global_id add_global(type_id type, attribute_list attributes, name_id name) {
-	uint32_t index            = globals_size;
-	globals[index].name       = name;
-	globals[index].type       = type;
-	globals[index].var_index  = 0;
-	globals[index].value.kind = GLOBAL_VALUE_NONE;
-	globals[index].attributes = attributes;
-	globals[index].sets_count = 0;
-	globals[index].usage      = 0;
+	uint32_t index              = globals_size;
+	globals[index].name         = name;
+	globals[index].type         = type;
+	globals[index].var_index    = 0;
+	globals[index].value.kind   = GLOBAL_VALUE_NONE;
+	globals[index].attributes   = attributes;
+	globals[index].sets_count   = 0;
+	globals[index].usage        = 0;
+	globals[index].group_shared = false;
+
+	globals[index].specialization    = false;
+	globals[index].specialization_id = 0;
+
 	globals_size += 1;
 	return index;
 }
 
 global_id add_global_with_value(type_id type, attribute_list attributes, name_id name, global_value value) {
-	uint32_t index            = globals_size;
-	globals[index].name       = name;
-	globals[index].type       = type;
-	globals[index].var_index  = 0;
-	globals[index].value      = value;
-	globals[index].attributes = attributes;
-	globals[index].sets_count = 0;
-	globals[index].usage      = 0;
+	uint32_t index              = globals_size;
+	globals[index].name         = name;
+	globals[index].type         = type;
+	globals[index].var_index    = 0;
+	globals[index].value        = value;
+	globals[index].attributes   = attributes;
+	globals[index].sets_count   = 0;
+	globals[index].usage        = 0;
+	globals[index].group_shared = false;
+
+	globals[index].specialization    = has_attribute(&attributes, add_name("specialize"));
+	globals[index].specialization_id = globals[index].specialization ? specializations_size++ : 0;
+
 	globals_size += 1;
 	return index;
 }
 
+global_id add_group_shared_global(type_id type, attribute_list attributes, name_id name) {
+	global_id index             = add_global(type, attributes, name);
+	globals[index].group_shared = true;
+	return index;
+}
+
 bool global_has_usage(global_id g, global_usage usage) {
 	return (get_global(g)->usage & usage) == usage;
 }
 
+bool global_is_buffer(global *g) {
+	type *t = get_type(g->type);
+	return !g->group_shared && t->built_in && t->array_size > 0 && !is_texture(t->base) && !is_sampler(t->base) && t->base != bvh_type_id;
+}
+
+bool global_is_bindless(global *g) {
+	return get_type(g->type)->array_size == UINT32_MAX && has_attribute(&g->attributes, add_name("bindless"));
+}
+
+bool global_is_scalar_constant(global *g) {
+	return g->value.kind == GLOBAL_VALUE_FLOAT || g->value.kind == GLOBAL_VALUE_INT || g->value.kind == GLOBAL_VALUE_UINT ||
+	       g->value.kind == GLOBAL_VALUE_BOOL;
+}
+
+void specialize_global(name_id name, const char *value) {
+	debug_context context = KONG_INIT_ZERO;
+
+	global *g = find_global(name);
+	check(g != NULL && g->specialization, context, "%s is not a #[specialize] const", get_name(name));
+
+	char *end = NULL;
+
+	switch (g->value.kind) {
+	case GLOBAL_VALUE_FLOAT:
+		g->value.value.floats[0] = strtof(value, &end);
+		break;
+	case GLOBAL_VALUE_INT:
+		g->value.value.ints[0] = (int)strtol(value, &end, 0);
+		break;
+	case GLOBAL_VALUE_UINT:
+		g->value.value.uints[0] = (unsigned)strtoul(value, &end, 0);
+		break;
+	case GLOBAL_VALUE_BOOL:
+		check(strcmp(value, "true") == 0 || strcmp(value, "false") == 0, context, "%s requires true or false", get_name(name));
+		g->value.value.b = strcmp(value, "true") == 0;
+		return;
+	default:
+		error(context, "%s can not be specialized", get_name(name));
+		return;
+	}
+
+	check(end != value && *end == 0, context, "%s is not a valid value for %s", value, get_name(name));
+}
+
+void bake_specializations(void) {
+	for (global_id i = 0; i < globals_size; ++i) {
+		globals[i].specialization = false;
+	}
+}
+
 global *find_global(name_id name) {
 	for (uint32_t i = 0; i < globals_size; ++i) {
 		if (globals[i].name == name) {
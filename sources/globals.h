@@ -45,6 +45,8 @@ typedef enum global_usage {
 	GLOBAL_USAGE_TEXTURE_WRITE  = 0x00000004,
 	GLOBAL_USAGE_BUFFER_WRITE   = 0x00000008,
 	GLOBAL_USAGE_SAMPLE_DEPTH   = 0x00000010,
+	GLOBAL_USAGE_ATOMIC         = 0x00000020,
+	GLOBAL_USAGE_SAMPLE_COMPARE = 0x00000040,
 } global_usage;
 
 typedef struct global {
@@ -56,6 +58,11 @@ typedef struct global {
 	struct descriptor_set *sets[64];
 	size_t                 sets_count;
 	uint32_t               usage;
+	// declared with a top level var, one instance per compute workgroup
+	bool                   group_shared;
+	// declared with #[specialize], pipelines can replace the value when they are created
+	bool                   specialization;
+	uint32_t               specialization_id;
 } global;
 
 typedef struct global_array {
@@ -69,12 +76,28 @@ void globals_init(void);
 
 global_id add_global(type_id type, attribute_list attributes, name_id name);
 global_id add_global_with_value(type_id type, attribute_list attributes, name_id name, global_value value);
+global_id add_group_shared_global(type_id type, attribute_list attributes, name_id name);
 bool      global_has_usage(global_id g, global_usage usage);
 
 global *find_global(name_id name);
 
 global *get_global(global_id id);
 
+// A const T[] which lives in a storage buffer
+bool global_is_buffer(global *g);
+
+// A #[bindless] tex2d[] which shaders index with handles into the global descriptor heap
+bool global_is_bindless(global *g);
+
+// A bool, int, uint or float const with a value
+bool global_is_scalar_constant(global *g);
+
+// Overrides the value of a #[specialize] const, value is parsed according to the type of the const
+void specialize_global(name_id name, const char *value);
+
+// Turns all #[specialize] consts into regular consts which keep their current values
+void bake_specializations(void);
+
 void assign_global_var(global_id id, uint64_t var_index);
 
 #ifdef __cplusplus
@@ -34,8 +34,9 @@ struct hash_map {
 };
 
 static inline uint64_t hash(int key) {
-	uint64_t primary   = key % HASH_MAP_SIZE;
-	uint8_t  secondary = key % HASH_MAP_SIZE;
+	// negative keys like int constants would index before the buckets otherwise
+	uint64_t primary   = (uint32_t)key % HASH_MAP_SIZE;
+	uint8_t  secondary = (uint32_t)key % HASH_MAP_SIZE;
 	return primary | ((uint64_t)secondary << 56);
 }
 
@@ -1,12 +1,15 @@
 #include "kore3.h"
 
 #include "../analyzer.h"
+#include "../backends/blobs.h"
+#include "../backends/layout.h"
 #include "../backends/util.h"
 #include "../compiler.h"
 #include "../errors.h"
 #include "../functions.h"
 #include "../global.h"
 #include "../parser.h"
+#include "../permutations.h"
 #include "../sets.h"
 #include "../types.h"
 
@@ -179,6 +182,199 @@ static const char *structure_type(type_id type, api_kind api) {
 	return "UNKNOWN";
 }
 
+static uint32_t vertex_components(member *m) {
+	type_id type = m->type.type;
+	if (type == float_id) {
+		return 1;
+	}
+	if (type == float2_id) {
+		return 2;
+	}
+	if (type == float3_id) {
+		return 3;
+	}
+	if (type == float4_id) {
+		return 4;
+	}
+	debug_context context = KONG_INIT_ZERO;
+	error(context, "Packed vertex member %s has to be a float type", get_name(m->name));
+	return 0;
+}
+
+// 8 and 16 bit vertex formats only exist with two or four components
+static uint32_t packed_components(member *m) {
+	return vertex_components(m) <= 2 ? 2 : 4;
+}
+
+static uint32_t vertex_member_size(member *m) {
+	switch (m->format) {
+	case MEMBER_FORMAT_UNORM8:
+	case MEMBER_FORMAT_SNORM8:
+		return packed_components(m);
+	case MEMBER_FORMAT_UNORM16:
+	case MEMBER_FORMAT_SNORM16:
+	case MEMBER_FORMAT_HALF:
+		return packed_components(m) * 2;
+	case MEMBER_FORMAT_RGB10A2:
+		return 4;
+	default:
+		return base_type_size(m->type.type);
+	}
+}
+
+static uint32_t vertex_stride(type *t) {
+	uint32_t stride = 0;
+	for (size_t member_index = 0; member_index < t->members.size; ++member_index) {
+		stride += vertex_member_size(&t->members.m[member_index]);
+	}
+	// vertex strides have to be a multiple of four, only two component 8 bit members can break that
+	return (stride + 3) & ~3u;
+}
+
+static bool has_packed_vertex_members(type *t) {
+	for (size_t member_index = 0; member_index < t->members.size; ++member_index) {
+		if (t->members.m[member_index].format != MEMBER_FORMAT_DEFAULT) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static const char *vertex_member_format(member *m, api_kind api, const char *api_caps) {
+	static char format[128];
+	const char *name = NULL;
+
+	switch (m->format) {
+	case MEMBER_FORMAT_UNORM8:
+		name = "UNORM8";
+		break;
+	case MEMBER_FORMAT_SNORM8:
+		name = "SNORM8";
+		break;
+	case MEMBER_FORMAT_UNORM16:
+		name = "UNORM16";
+		break;
+	case MEMBER_FORMAT_SNORM16:
+		name = "SNORM16";
+		break;
+	case MEMBER_FORMAT_HALF:
+		name = "FLOAT16";
+		break;
+	case MEMBER_FORMAT_RGB10A2: {
+		debug_context context = KONG_INIT_ZERO;
+		check(vertex_components(m) >= 3, context, "rgb10a2 vertex member %s has to be a float3 or float4", get_name(m->name));
+		sprintf(format, "KORE_%s_VERTEX_FORMAT_UNORM10_10_10_2", api_caps);
+		return format;
+	}
+	default:
+		return structure_type(m->type.type, api);
+	}
+
+	sprintf(format, "KORE_%s_VERTEX_FORMAT_%sX%u", api_caps, name, packed_components(m));
+	return format;
+}
+
+// 16 bit members which the shaders read with 16 bits are filled using kong_pack_half and plain 16 bit integers
+static void write_buffer_member(FILE *output, type_id type, name_id name, layout_rules rules) {
+	type = storage_type(type, rules);
+
+	if (is_16bit_type(type) && is_vector_or_scalar(type)) {
+		const char *c_type = vector_base_type(type) == short_id ? "int16_t" : "uint16_t";
+		if (vector_size(type) == 1) {
+			fprintf(output, "\t%s %s;\n", c_type, get_name(name));
+		}
+		else {
+			fprintf(output, "\t%s %s[%u];\n", c_type, get_name(name), vector_size(type));
+		}
+	}
+	else {
+		fprintf(output, "\t%s %s;\n", type_string(type), get_name(name));
+	}
+}
+
+static void write_vertex_member(FILE *output, member *m) {
+	switch (m->format) {
+	case MEMBER_FORMAT_UNORM8:
+		fprintf(output, "\tuint8_t %s[%u];\n", get_name(m->name), packed_components(m));
+		break;
+	case MEMBER_FORMAT_SNORM8:
+		fprintf(output, "\tint8_t %s[%u];\n", get_name(m->name), packed_components(m));
+		break;
+	case MEMBER_FORMAT_UNORM16:
+	case MEMBER_FORMAT_HALF:
+		fprintf(output, "\tuint16_t %s[%u];\n", get_name(m->name), packed_components(m));
+		break;
+	case MEMBER_FORMAT_SNORM16:
+		fprintf(output, "\tint16_t %s[%u];\n", get_name(m->name), packed_components(m));
+		break;
+	case MEMBER_FORMAT_RGB10A2:
+		fprintf(output, "\tuint32_t %s;\n", get_name(m->name));
+		break;
+	default:
+		fprintf(output, "\t%s %s;\n", type_string(m->type.type), get_name(m->name));
+		break;
+	}
+}
+
+static void write_vertex_packing(FILE *output) {
+	fprintf(output, "static inline uint32_t kong_pack_unorm(float value, uint32_t max) {\n");
+	fprintf(output, "\tvalue = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);\n");
+	fprintf(output, "\treturn (uint32_t)(value * (float)max + 0.5f);\n");
+	fprintf(output, "}\n\n");
+
+	fprintf(output, "static inline int32_t kong_pack_snorm(float value, int32_t max) {\n");
+	fprintf(output, "\tvalue = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);\n");
+	fprintf(output, "\treturn (int32_t)(value * (float)max + (value < 0.0f ? -0.5f : 0.5f));\n");
+	fprintf(output, "}\n\n");
+
+	fprintf(output, "static inline uint8_t kong_pack_unorm8(float value) {\n");
+	fprintf(output, "\treturn (uint8_t)kong_pack_unorm(value, 255);\n");
+	fprintf(output, "}\n\n");
+
+	fprintf(output, "static inline int8_t kong_pack_snorm8(float value) {\n");
+	fprintf(output, "\treturn (int8_t)kong_pack_snorm(value, 127);\n");
+	fprintf(output, "}\n\n");
+
+	fprintf(output, "static inline uint16_t kong_pack_unorm16(float value) {\n");
+	fprintf(output, "\treturn (uint16_t)kong_pack_unorm(value, 65535);\n");
+	fprintf(output, "}\n\n");
+
+	fprintf(output, "static inline int16_t kong_pack_snorm16(float value) {\n");
+	fprintf(output, "\treturn (int16_t)kong_pack_snorm(value, 32767);\n");
+	fprintf(output, "}\n\n");
+
+	fprintf(output, "static inline uint16_t kong_pack_half(float value) {\n");
+	fprintf(output, "\tunion {\n");
+	fprintf(output, "\t\tfloat f;\n");
+	fprintf(output, "\t\tuint32_t u;\n");
+	fprintf(output, "\t} bits;\n");
+	fprintf(output, "\tbits.f = value;\n\n");
+	fprintf(output, "\tuint32_t sign = (bits.u >> 16) & 0x8000;\n");
+	fprintf(output, "\tuint32_t mantissa = bits.u & 0x7fffff;\n");
+	fprintf(output, "\tif (((bits.u >> 23) & 0xff) == 0xff) {\n");
+	fprintf(output, "\t\treturn (uint16_t)(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));\n");
+	fprintf(output, "\t}\n\n");
+	fprintf(output, "\tint32_t exponent = (int32_t)((bits.u >> 23) & 0xff) - 127 + 15;\n");
+	fprintf(output, "\tif (exponent >= 31) {\n");
+	fprintf(output, "\t\treturn (uint16_t)(sign | 0x7c00);\n");
+	fprintf(output, "\t}\n");
+	fprintf(output, "\tif (exponent <= 0) {\n");
+	fprintf(output, "\t\tif (exponent < -10) {\n");
+	fprintf(output, "\t\t\treturn (uint16_t)sign;\n");
+	fprintf(output, "\t\t}\n");
+	fprintf(output, "\t\tuint32_t shift = (uint32_t)(14 - exponent);\n");
+	fprintf(output, "\t\treturn (uint16_t)(sign | (((mantissa | 0x800000) + (1u << (shift - 1))) >> shift));\n");
+	fprintf(output, "\t}\n\n");
+	fprintf(output, "\t// a rounding carry into the exponent still gives the right result\n");
+	fprintf(output, "\treturn (uint16_t)((sign | ((uint32_t)exponent << 10) | (mantissa >> 13)) + ((mantissa >> 12) & 1));\n");
+	fprintf(output, "}\n\n");
+
+	fprintf(output, "static inline uint32_t kong_pack_rgb10a2(float r, float g, float b, float a) {\n");
+	fprintf(output, "\treturn kong_pack_unorm(r, 1023) | (kong_pack_unorm(g, 1023) << 10) | (kong_pack_unorm(b, 1023) << 20) |\n");
+	fprintf(output, "\t       (kong_pack_unorm(a, 3) << 30);\n");
+	fprintf(output, "}\n\n");
+}
+
 static const char *convert_compare_mode(int mode) {
 	switch (mode) {
 	case 0:
@@ -603,6 +799,884 @@ static void format_to_string_wgsl(texture_format format, char *str) {
 
 static int global_register_indices[512];
 
+#define MAX_PIPELINES 1024
+
+// A pipeline object of a pipe, compute shader or ray pipe, permutations which produce different code get objects of their own
+typedef struct pipeline_object {
+	name_id   name;
+	type     *pipe;
+	function *compute;
+	type     *ray_pipe;
+	uint32_t  permutation;
+} pipeline_object;
+
+static uint32_t pipeline_permutations_count(void) {
+	return permutations_count() > 1 ? permutations_count() : 1;
+}
+
+static name_id permutation_name(name_id name, uint32_t permutation) {
+	if (permutation == 0) {
+		return name;
+	}
+
+	char buffer[512];
+	sprintf(buffer, "%s_p%u", get_name(name), permutation);
+	return add_name(buffer);
+}
+
+// Name of the code of a shader in a permutation, see write_permutation_includes
+static name_id shader_code_name(name_id shader, uint32_t permutation) {
+	if (shader == NO_NAME) {
+		return NO_NAME;
+	}
+
+	function_id f = find_function(shader);
+	assert(f != NO_FUNCTION);
+	return permutation_name(shader, shader_permutation(get_function(f), permutation));
+}
+
+// The first permutation which produces the same code for all shaders of a pipe or for a compute shader
+static uint32_t pipeline_permutation(type *pipe, function *compute, uint32_t permutation) {
+	if (compute != NULL) {
+		return shader_permutation(compute, permutation);
+	}
+
+	for (uint32_t earlier = 0; earlier < permutation; ++earlier) {
+		bool same = true;
+		for (size_t j = 0; j < pipe->members.size && same; ++j) {
+			if (pipe->members.m[j].value.kind == TOKEN_IDENTIFIER) {
+				function_id f = find_function(pipe->members.m[j].value.identifier);
+				if (f != NO_FUNCTION && shader_permutation(get_function(f), earlier) != shader_permutation(get_function(f), permutation)) {
+					same = false;
+				}
+			}
+		}
+		if (same) {
+			return earlier;
+		}
+	}
+
+	return permutation;
+}
+
+// Pipelines are set per permutation when there is more than one
+static const char *permutation_parameter(void) {
+	return permutations_count() > 1 ? ", uint32_t permutation" : "";
+}
+
+static const char *permutation_argument(void) {
+	return permutations_count() > 1 ? ", permutation" : "";
+}
+
+static void add_pipeline(pipeline_object *pipelines, size_t *pipelines_count, name_id name, type *pipe, function *compute, type *ray_pipe) {
+	for (uint32_t permutation = 0; permutation < pipeline_permutations_count(); ++permutation) {
+		if (ray_pipe == NULL && pipeline_permutation(pipe, compute, permutation) != permutation) {
+			continue;
+		}
+
+		assert(*pipelines_count < MAX_PIPELINES);
+		pipeline_object *pipeline = &pipelines[*pipelines_count];
+		pipeline->name            = permutation_name(name, permutation);
+		pipeline->pipe            = pipe;
+		pipeline->compute         = compute;
+		pipeline->ray_pipe        = ray_pipe;
+		pipeline->permutation     = permutation;
+		*pipelines_count += 1;
+
+		if (ray_pipe != NULL) {
+			// ray pipelines are not compiled per permutation
+			break;
+		}
+	}
+}
+
+// Render pipelines, compute shaders and ray pipelines in the order of the kong_pipeline enum
+static size_t collect_pipelines(pipeline_object *pipelines) {
+	size_t pipelines_count = 0;
+
+	for (type_id i = 0; get_type(i) != NULL; ++i) {
+		type *t = get_type(i);
+		if (!t->built_in && has_attribute(&t->attributes, add_name("pipe"))) {
+			add_pipeline(pipelines, &pipelines_count, t->name, t, NULL, NULL);
+		}
+	}
+
+	for (function_id i = 0; get_function(i) != NULL; ++i) {
+		function *f = get_function(i);
+		if (has_attribute(&f->attributes, add_name("compute"))) {
+			add_pipeline(pipelines, &pipelines_count, f->name, NULL, f, NULL);
+		}
+	}
+
+	for (type_id i = 0; get_type(i) != NULL; ++i) {
+		type *t = get_type(i);
+		if (!t->built_in && has_attribute(&t->attributes, add_name("raypipe"))) {
+			add_pipeline(pipelines, &pipelines_count, t->name, NULL, NULL, t);
+		}
+	}
+
+	return pipelines_count;
+}
+
+static bool has_indexed_globals(descriptor_set *set) {
+	for (size_t global_index = 0; global_index < set->globals.size; ++global_index) {
+		global *g = get_global(set->globals.globals[global_index]);
+		if (!get_type(g->type)->built_in && has_attribute(&g->attributes, add_name("indexed"))) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool same_descriptor_sets(descriptor_set_group *a, descriptor_set_group *b) {
+	if (a->size != b->size) {
+		return false;
+	}
+	for (size_t set_index = 0; set_index < a->size; ++set_index) {
+		if (a->values[set_index] != b->values[set_index]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Vulkan and WebGPU keep bound sets when the next pipeline of the same kind uses the same sets,
+// the other APIs are treated as if every pipeline object had its own layout
+static void write_pipeline_layouts(FILE *output, api_kind api, pipeline_object *pipelines, size_t pipelines_count) {
+	static descriptor_set_group *groups[MAX_PIPELINES];
+	static int                   kinds[MAX_PIPELINES];
+
+	for (size_t pipeline_index = 0; pipeline_index < pipelines_count; ++pipeline_index) {
+		pipeline_object *pipeline = &pipelines[pipeline_index];
+		if (pipeline->pipe != NULL) {
+			groups[pipeline_index] = find_descriptor_set_group_for_pipe_type(pipeline->pipe);
+			kinds[pipeline_index]  = 0;
+		}
+		else if (pipeline->compute != NULL) {
+			groups[pipeline_index] = find_descriptor_set_group_for_function(pipeline->compute);
+			kinds[pipeline_index]  = 1;
+		}
+		else {
+			groups[pipeline_index] = find_descriptor_set_group_for_pipe_type(pipeline->ray_pipe);
+			kinds[pipeline_index]  = 2;
+		}
+	}
+
+	fprintf(output, "static const uint32_t kong_pipeline_layouts[KONG_PIPELINES_COUNT + 1] = {");
+	for (size_t pipeline_index = 0; pipeline_index < pipelines_count; ++pipeline_index) {
+		size_t layout = pipeline_index;
+		if (api == API_VULKAN || api == API_WEBGPU) {
+			for (size_t other_index = 0; other_index < pipeline_index; ++other_index) {
+				if (kinds[other_index] == kinds[pipeline_index] && same_descriptor_sets(groups[other_index], groups[pipeline_index])) {
+					layout = other_index;
+					break;
+				}
+			}
+		}
+		fprintf(output, "%zu, ", layout + 1);
+	}
+	fprintf(output, "0};\n\n");
+}
+
+static void write_pipeline_id(FILE *output, name_id pipeline) {
+	char upper_name[256];
+	to_upper(get_name(pipeline), upper_name);
+	fprintf(output, "KONG_PIPELINE_%s", upper_name);
+}
+
+// kong_<name>_pipeline points every permutation at the pipeline object which was created for its code
+static void write_permutation_pipelines(FILE *output, type *pipe, function *compute) {
+	name_id name = pipe != NULL ? pipe->name : compute->name;
+
+	fprintf(output, "kong_pipeline kong_%s_pipeline(uint32_t permutation) {\n", get_name(name));
+	fprintf(output, "\tstatic const kong_pipeline pipelines[KONG_PERMUTATIONS_COUNT] = {");
+	for (uint32_t permutation = 0; permutation < permutations_count(); ++permutation) {
+		if (permutation > 0) {
+			fprintf(output, ", ");
+		}
+		write_pipeline_id(output, permutation_name(name, pipeline_permutation(pipe, compute, permutation)));
+	}
+	fprintf(output, "};\n");
+	fprintf(output, "\tassert(permutation < KONG_PERMUTATIONS_COUNT);\n");
+	fprintf(output, "\treturn pipelines[permutation];\n");
+	fprintf(output, "}\n\n");
+}
+
+// Starts a kong_set_* function, which ensures the pipeline object of the permutation and finds it
+static void write_pipeline_selection(FILE *output, const char *object_type, type *pipe, function *compute) {
+	name_id name = pipe != NULL ? pipe->name : compute->name;
+
+	if (permutations_count() > 1) {
+		fprintf(output, "\tstatic %s *const objects[KONG_PERMUTATIONS_COUNT] = {", object_type);
+		for (uint32_t permutation = 0; permutation < permutations_count(); ++permutation) {
+			fprintf(output, "%s&%s", permutation > 0 ? ", " : "", get_name(permutation_name(name, pipeline_permutation(pipe, compute, permutation))));
+		}
+		fprintf(output, "};\n");
+		fprintf(output, "\tkong_pipeline pipeline = kong_%s_pipeline(permutation);\n", get_name(name));
+		fprintf(output, "\tkong_ensure_pipeline(pipeline);\n");
+	}
+	else {
+		fprintf(output, "\tkong_ensure_pipeline(");
+		write_pipeline_id(output, name);
+		fprintf(output, ");\n");
+	}
+}
+
+static const char *pipeline_object_reference(name_id name) {
+	static char reference[512];
+	if (permutations_count() > 1) {
+		return "objects[permutation]";
+	}
+	sprintf(reference, "&%s", get_name(name));
+	return reference;
+}
+
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t size) {
+	const uint8_t *bytes = (const uint8_t *)data;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static uint64_t hash_uint(uint64_t hash, uint64_t value) {
+	for (int i = 0; i < 8; ++i) {
+		uint8_t byte = (uint8_t)(value >> (i * 8));
+		hash         = hash_bytes(hash, &byte, 1);
+	}
+	return hash;
+}
+
+static uint64_t hash_name(uint64_t hash, name_id name) {
+	const char *string = name == NO_NAME ? "" : get_name(name);
+	return hash_bytes(hash, string, strlen(string) + 1);
+}
+
+static uint64_t hash_type(uint64_t hash, type_id id) {
+	type *t = get_type(id);
+	hash    = hash_name(hash, t->name);
+	hash    = hash_uint(hash, t->array_size);
+	if (t->array_size > 0) {
+		hash = hash_type(hash, t->base);
+	}
+	if (!t->built_in) {
+		for (size_t member_index = 0; member_index < t->members.size; ++member_index) {
+			hash = hash_name(hash, t->members.m[member_index].name);
+			hash = hash_type(hash, t->members.m[member_index].type.type);
+			hash = hash_uint(hash, t->members.m[member_index].format);
+		}
+	}
+	return hash;
+}
+
+static uint64_t hash_descriptor_set_group(uint64_t hash, descriptor_set_group *group) {
+	for (size_t set_index = 0; set_index < group->size; ++set_index) {
+		descriptor_set *set = group->values[set_index];
+		hash                = hash_name(hash, set->name);
+		for (size_t global_index = 0; global_index < set->globals.size; ++global_index) {
+			global *g = get_global(set->globals.globals[global_index]);
+			hash      = hash_name(hash, g->name);
+			hash      = hash_type(hash, g->type);
+			hash      = hash_uint(hash, set->globals.readable[global_index]);
+			hash      = hash_uint(hash, set->globals.writable[global_index]);
+		}
+	}
+	return hash;
+}
+
+// Everything the integration feeds into a pipeline except for the shader code which is only known at runtime
+static uint64_t pipeline_state_hash(api_kind api, type *pipe, function *compute) {
+	uint64_t hash = hash_uint(0xcbf29ce484222325ull, api);
+
+	if (pipe != NULL) {
+		hash = hash_name(hash, pipe->name);
+		for (size_t j = 0; j < pipe->members.size; ++j) {
+			member *m = &pipe->members.m[j];
+			hash      = hash_name(hash, m->name);
+			hash      = hash_uint(hash, m->value.kind);
+			if (m->value.kind == TOKEN_IDENTIFIER) {
+				hash = hash_name(hash, m->value.identifier);
+			}
+			else if (m->value.kind == TOKEN_BOOLEAN) {
+				hash = hash_uint(hash, m->value.boolean);
+			}
+			else if (m->value.kind == TOKEN_FLOAT || m->value.kind == TOKEN_INT) {
+				hash = hash_bytes(hash, &m->value.number, sizeof(m->value.number));
+			}
+
+			if (m->name == add_name("vertex")) {
+				for (function_id i = 0; get_function(i) != NULL; ++i) {
+					function *f = get_function(i);
+					if (f->name == m->value.identifier) {
+						for (size_t parameter_index = 0; parameter_index < f->parameters_size; ++parameter_index) {
+							hash = hash_type(hash, f->parameter_types[parameter_index].type);
+							hash = hash_name(hash, f->parameter_attributes[parameter_index]);
+						}
+						break;
+					}
+				}
+			}
+		}
+		hash = hash_descriptor_set_group(hash, find_descriptor_set_group_for_pipe_type(pipe));
+	}
+	else {
+		hash                         = hash_name(hash, compute->name);
+		attribute *threads_attribute = find_attribute(&compute->attributes, add_name("threads"));
+		if (threads_attribute != NULL) {
+			for (uint32_t parameter_index = 0; parameter_index < threads_attribute->paramters_count; ++parameter_index) {
+				hash = hash_bytes(hash, &threads_attribute->parameters[parameter_index], sizeof(threads_attribute->parameters[parameter_index]));
+			}
+		}
+		hash = hash_descriptor_set_group(hash, find_descriptor_set_group_for_function(compute));
+	}
+
+	return hash;
+}
+
+static bool uses_framebuffer_format(type *pipe) {
+	for (size_t j = 0; j < pipe->members.size; ++j) {
+		member *m = &pipe->members.m[j];
+		if (strncmp(get_name(m->name), "format", 6) == 0 && m->value.kind == TOKEN_IDENTIFIER &&
+		    strcmp(get_name(m->value.identifier), "framebuffer_format") == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void write_pipeline_hash_function(FILE *output, api_kind api, name_id pipeline, uint64_t state_hash, name_id *shaders, size_t shaders_count,
+                                         bool framebuffer_format) {
+	fprintf(output, "static uint64_t kong_hash_%s_pipeline(void) {\n", get_name(pipeline));
+	fprintf(output, "\tuint64_t hash = 0x%016" PRIx64 "ull;\n", state_hash);
+	// Metal pipelines reference functions in the metallib by name
+	if (api != API_METAL && api != API_KOMPJUTA) {
+		for (size_t shader_index = 0; shader_index < shaders_count; ++shader_index) {
+			if (shaders[shader_index] != NO_NAME) {
+				fprintf(output, "\thash = kong_hash_bytes(hash, %s_code, %s_code_size);\n", get_name(shaders[shader_index]), get_name(shaders[shader_index]));
+			}
+		}
+	}
+	if (framebuffer_format) {
+		fprintf(output, "\tkore_gpu_texture_format framebuffer_format = kore_gpu_device_framebuffer_format(kong_device);\n");
+		fprintf(output, "\thash = kong_hash_bytes(hash, &framebuffer_format, sizeof(framebuffer_format));\n");
+	}
+	fprintf(output, "\treturn hash;\n");
+	fprintf(output, "}\n\n");
+}
+
+static void write_pipeline_cache(FILE *output, pipeline_object *pipelines, size_t pipelines_count) {
+	fprintf(output, "\nstatic kong_pipeline_cache_hooks kong_cache_hooks = KONG_INIT_ZERO;\n\n");
+
+	fprintf(output, "void kong_set_pipeline_cache_hooks(const kong_pipeline_cache_hooks *hooks) {\n");
+	fprintf(output, "\tkong_cache_hooks = *hooks;\n");
+	fprintf(output, "}\n\n");
+
+	if (pipelines_count > 0) {
+		fprintf(output, "static uint64_t (*const kong_pipeline_hashers[KONG_PIPELINES_COUNT])(void) = {\n");
+		for (size_t pipeline_index = 0; pipeline_index < pipelines_count; ++pipeline_index) {
+			fprintf(output, "\tkong_hash_%s_pipeline,\n", get_name(pipelines[pipeline_index].name));
+		}
+		fprintf(output, "};\n\n");
+
+		fprintf(output, "uint64_t kong_pipeline_hash(kong_pipeline pipeline) {\n");
+		if (blobs_need_init()) {
+			fprintf(output, "\t// the pipeline cache can be loaded before kong_init\n");
+			fprintf(output, "\tkong_blobs_init();\n");
+		}
+		fprintf(output, "\treturn kong_pipeline_hashers[pipeline]();\n");
+		fprintf(output, "}\n\n");
+	}
+	else {
+		fprintf(output, "uint64_t kong_pipeline_hash(kong_pipeline pipeline) {\n");
+		fprintf(output, "\t(void)pipeline;\n");
+		fprintf(output, "\treturn 0;\n");
+		fprintf(output, "}\n\n");
+	}
+
+	fprintf(output, "#define KONG_PIPELINE_CACHE_MAGIC 0x474e4f4bu\n");
+	fprintf(output, "#define KONG_PIPELINE_CACHE_VERSION 1u\n\n");
+
+	fprintf(output, "static void kong_cache_write(uint8_t *data, size_t size, size_t *offset, const void *value, size_t value_size) {\n");
+	fprintf(output, "\tif (data != NULL && *offset + value_size <= size) {\n");
+	fprintf(output, "\t\tmemcpy(&data[*offset], value, value_size);\n");
+	fprintf(output, "\t}\n");
+	fprintf(output, "\t*offset += value_size;\n");
+	fprintf(output, "}\n\n");
+
+	fprintf(output, "static bool kong_cache_read(const uint8_t *data, size_t size, size_t *offset, void *value, size_t value_size) {\n");
+	fprintf(output, "\tif (*offset + value_size > size) {\n");
+	fprintf(output, "\t\treturn false;\n");
+	fprintf(output, "\t}\n");
+	fprintf(output, "\tmemcpy(value, &data[*offset], value_size);\n");
+	fprintf(output, "\t*offset += value_size;\n");
+	fprintf(output, "\treturn true;\n");
+	fprintf(output, "}\n\n");
+
+	// the set of created pipelines can grow on the kong_init_async workers, the size and the entries come from one snapshot
+	fprintf(output, "static size_t kong_write_pipeline_cache(const bool *created, void *data, size_t size) {\n");
+	fprintf(output, "\tuint8_t *bytes = (uint8_t *)data;\n");
+	fprintf(output, "\tsize_t offset = 0;\n\n");
+	fprintf(output, "\tuint32_t magic = KONG_PIPELINE_CACHE_MAGIC;\n");
+	fprintf(output, "\tuint32_t version = KONG_PIPELINE_CACHE_VERSION;\n");
+	fprintf(output, "\tuint32_t count = 0;\n");
+	if (pipelines_count > 0) {
+		fprintf(output, "\tfor (size_t pipeline = 0; pipeline < KONG_PIPELINES_COUNT; ++pipeline) {\n");
+		fprintf(output, "\t\tif (created[pipeline]) {\n");
+		fprintf(output, "\t\t\tcount += 1;\n");
+		fprintf(output, "\t\t}\n");
+		fprintf(output, "\t}\n");
+	}
+	else {
+		fprintf(output, "\t(void)created;\n");
+	}
+	fprintf(output, "\tkong_cache_write(bytes, size, &offset, &magic, sizeof(magic));\n");
+	fprintf(output, "\tkong_cache_write(bytes, size, &offset, &version, sizeof(version));\n");
+	fprintf(output, "\tkong_cache_write(bytes, size, &offset, &count, sizeof(count));\n");
+	if (pipelines_count > 0) {
+		fprintf(output, "\n\tfor (size_t pipeline = 0; pipeline < KONG_PIPELINES_COUNT; ++pipeline) {\n");
+		fprintf(output, "\t\tif (!created[pipeline]) {\n");
+		fprintf(output, "\t\t\tcontinue;\n");
+		fprintf(output, "\t\t}\n\n");
+		fprintf(output, "\t\tuint64_t hash = kong_pipeline_hash((kong_pipeline)pipeline);\n");
+		fprintf(output, "\t\tuint64_t data_size = 0;\n");
+		fprintf(output, "\t\tif (kong_cache_hooks.save != NULL) {\n");
+		fprintf(output, "\t\t\tdata_size = kong_cache_hooks.save((kong_pipeline)pipeline, NULL, 0, kong_cache_hooks.user_data);\n");
+		fprintf(output, "\t\t}\n");
+		fprintf(output, "\t\tkong_cache_write(bytes, size, &offset, &hash, sizeof(hash));\n");
+		fprintf(output, "\t\tkong_cache_write(bytes, size, &offset, &data_size, sizeof(data_size));\n");
+		fprintf(output, "\t\tif (data_size > 0 && bytes != NULL && offset + data_size <= size) {\n");
+		fprintf(output, "\t\t\tkong_cache_hooks.save((kong_pipeline)pipeline, &bytes[offset], (size_t)data_size, kong_cache_hooks.user_data);\n");
+		fprintf(output, "\t\t}\n");
+		fprintf(output, "\t\toffset += (size_t)data_size;\n");
+		fprintf(output, "\t}\n");
+	}
+	fprintf(output, "\n\treturn offset;\n");
+	fprintf(output, "}\n\n");
+
+	fprintf(output, "static void kong_snapshot_created_pipelines(bool *created) {\n");
+	if (pipelines_count > 0) {
+		fprintf(output, "\tfor (size_t pipeline = 0; pipeline < KONG_PIPELINES_COUNT; ++pipeline) {\n");
+		fprintf(output, "\t\tcreated[pipeline] = kong_pipeline_created(pipeline);\n");
+		fprintf(output, "\t}\n");
+	}
+	else {
+		fprintf(output, "\t(void)created;\n");
+	}
+	fprintf(output, "}\n\n");
+
+	fprintf(output, "size_t kong_save_pipeline_cache(void *data, size_t size) {\n");
+	fprintf(output, "\tbool created[KONG_PIPELINES_COUNT + 1];\n");
+	fprintf(output, "\tkong_snapshot_created_pipelines(created);\n");
+	fprintf(output, "\treturn kong_write_pipeline_cache(created, data, size);\n");
+	fprintf(output, "}\n\n");
+
+	fprintf(output, "size_t kong_load_pipeline_cache(kore_gpu_device *device, const void *data, size_t size, kong_pipeline *pipelines) {\n");
+	fprintf(output, "\t// The hashes of pipelines which render to the framebuffer depend on its format\n");
+	fprintf(output, "\tkong_device = device;\n\n");
+	fprintf(output, "\tconst uint8_t *bytes = (const uint8_t *)data;\n");
+	fprintf(output, "\tsize_t offset = 0;\n\n");
+	fprintf(output, "\tuint32_t magic = 0;\n");
+	fprintf(output, "\tuint32_t version = 0;\n");
+	fprintf(output, "\tuint32_t count = 0;\n");
+	fprintf(output, "\tif (!kong_cache_read(bytes, size, &offset, &magic, sizeof(magic)) || magic != KONG_PIPELINE_CACHE_MAGIC ||\n");
+	fprintf(output, "\t    !kong_cache_read(bytes, size, &offset, &version, sizeof(version)) || version != KONG_PIPELINE_CACHE_VERSION ||\n");
+	fprintf(output, "\t    !kong_cache_read(bytes, size, &offset, &count, sizeof(count))) {\n");
+	fprintf(output, "\t\treturn 0;\n");
+	fprintf(output, "\t}\n\n");
+	fprintf(output, "\tsize_t matches = 0;\n");
+	if (pipelines_count > 0) {
+		fprintf(output, "\tuint64_t hashes[KONG_PIPELINES_COUNT];\n");
+		fprintf(output, "\tbool matched[KONG_PIPELINES_COUNT];\n");
+		fprintf(output, "\tfor (size_t pipeline = 0; pipeline < KONG_PIPELINES_COUNT; ++pipeline) {\n");
+		fprintf(output, "\t\thashes[pipeline] = kong_pipeline_hash((kong_pipeline)pipeline);\n");
+		fprintf(output, "\t\tmatched[pipeline] = false;\n");
+		fprintf(output, "\t}\n\n");
+	}
+	fprintf(output, "\tfor (uint32_t entry = 0; entry < count && matches < KONG_PIPELINES_COUNT; ++entry) {\n");
+	fprintf(output, "\t\tuint64_t hash = 0;\n");
+	fprintf(output, "\t\tuint64_t data_size = 0;\n");
+	fprintf(output, "\t\tif (!kong_cache_read(bytes, size, &offset, &hash, sizeof(hash)) ||\n");
+	fprintf(output, "\t\t    !kong_cache_read(bytes, size, &offset, &data_size, sizeof(data_size)) || data_size > size - offset) {\n");
+	fprintf(output, "\t\t\tbreak;\n");
+	fprintf(output, "\t\t}\n\n");
+	if (pipelines_count > 0) {
+		fprintf(output, "\t\t// Entries of pipelines that changed since the cache was saved do not match any hash and are dropped,\n");
+		fprintf(output, "\t\t// pipelines with identical state share a hash and take the matching entries one after another\n");
+		fprintf(output, "\t\tfor (size_t pipeline = 0; pipeline < KONG_PIPELINES_COUNT; ++pipeline) {\n");
+		fprintf(output, "\t\t\tif (!matched[pipeline] && hashes[pipeline] == hash) {\n");
+		fprintf(output, "\t\t\t\tmatched[pipeline] = true;\n");
+		fprintf(output, "\t\t\t\tif (data_size > 0 && kong_cache_hooks.load != NULL) {\n");
+		fprintf(output, "\t\t\t\t\tkong_cache_hooks.load((kong_pipeline)pipeline, &bytes[offset], (size_t)data_size, kong_cache_hooks.user_data);\n");
+		fprintf(output, "\t\t\t\t}\n");
+		fprintf(output, "\t\t\t\tif (pipelines != NULL) {\n");
+		fprintf(output, "\t\t\t\t\tpipelines[matches] = (kong_pipeline)pipeline;\n");
+		fprintf(output, "\t\t\t\t}\n");
+		fprintf(output, "\t\t\t\tmatches += 1;\n");
+		fprintf(output, "\t\t\t\tbreak;\n");
+		fprintf(output, "\t\t\t}\n");
+		fprintf(output, "\t\t}\n\n");
+	}
+	else {
+		fprintf(output, "\t\t(void)pipelines;\n");
+	}
+	fprintf(output, "\t\toffset += (size_t)data_size;\n");
+	fprintf(output, "\t}\n\n");
+	fprintf(output, "\treturn matches;\n");
+	fprintf(output, "}\n\n");
+
+	fprintf(output, "bool kong_save_pipeline_cache_file(const char *path) {\n");
+	fprintf(output, "\tbool created[KONG_PIPELINES_COUNT + 1];\n");
+	fprintf(output, "\tkong_snapshot_created_pipelines(created);\n\n");
+	fprintf(output, "\tsize_t size = kong_write_pipeline_cache(created, NULL, 0);\n");
+	fprintf(output, "\tvoid *data = malloc(size);\n");
+	fprintf(output, "\tif (data == NULL) {\n");
+	fprintf(output, "\t\treturn false;\n");
+	fprintf(output, "\t}\n");
+	fprintf(output, "\tkong_write_pipeline_cache(created, data, size);\n\n");
+	fprintf(output, "\tFILE *file = fopen(path, \"wb\");\n");
+	fprintf(output, "\tif (file == NULL) {\n");
+	fprintf(output, "\t\tfree(data);\n");
+	fprintf(output, "\t\treturn false;\n");
+	fprintf(output, "\t}\n");
+	fprintf(output, "\tbool written = fwrite(data, 1, size, file) == size;\n");
+	fprintf(output, "\tfclose(file);\n");
+	fprintf(output, "\tfree(data);\n");
+	fprintf(output, "\treturn written;\n");
+	fprintf(output, "}\n\n");
+
+	fprintf(output, "size_t kong_load_pipeline_cache_file(kore_gpu_device *device, const char *path, kong_pipeline *pipelines) {\n");
+	fprintf(output, "\tFILE *file = fopen(path, \"rb\");\n");
+	fprintf(output, "\tif (file == NULL) {\n");
+	fprintf(output, "\t\treturn 0;\n");
+	fprintf(output, "\t}\n");
+	fprintf(output, "\tfseek(file, 0, SEEK_END);\n");
+	fprintf(output, "\tlong size = ftell(file);\n");
+	fprintf(output, "\tfseek(file, 0, SEEK_SET);\n");
+	fprintf(output, "\tvoid *data = size > 0 ? malloc((size_t)size) : NULL;\n");
+	fprintf(output, "\tif (data == NULL) {\n");
+	fprintf(output, "\t\tfclose(file);\n");
+	fprintf(output, "\t\treturn 0;\n");
+	fprintf(output, "\t}\n");
+	fprintf(output, "\tsize_t read = fread(data, 1, (size_t)size, file);\n");
+	fprintf(output, "\tfclose(file);\n\n");
+	fprintf(output, "\tsize_t matches = read == (size_t)size ? kong_load_pipeline_cache(device, data, (size_t)size, pipelines) : 0;\n");
+	fprintf(output, "\tfree(data);\n");
+	fprintf(output, "\treturn matches;\n");
+	fprintf(output, "}\n");
+}
+
+static void write_pipeline_creation(FILE *output, api_kind api, pipeline_object *pipelines, size_t pipelines_count, bool threaded) {
+	if (pipelines_count > 0) {
+		fprintf(output, "static void (*const kong_pipeline_creators[KONG_PIPELINES_COUNT])(void) = {\n");
+		for (size_t pipeline_index = 0; pipeline_index < pipelines_count; ++pipeline_index) {
+			fprintf(output, "\tkong_create_%s_pipeline,\n", get_name(pipelines[pipeline_index].name));
+		}
+		fprintf(output, "};\n\n");
+
+		fprintf(output, "static bool kong_pipelines_created[KONG_PIPELINES_COUNT];\n");
+		if (threaded) {
+			fprintf(output, "static kore_mutex kong_pipeline_mutexes[KONG_PIPELINES_COUNT];\n");
+		}
+		fprintf(output, "\n");
+
+		if (threaded) {
+			fprintf(output, "// Set by kong_init_async before its workers start\n");
+			fprintf(output, "static bool kong_pipelines_async = false;\n\n");
+
+			// kong_init creates every pipeline up front on its own thread, only lazy and async creation can race
+			fprintf(output, "static bool kong_pipelines_locked(void) {\n");
+			fprintf(output, "#ifdef KONG_LAZY_PIPELINES\n");
+			fprintf(output, "\treturn true;\n");
+			fprintf(output, "#else\n");
+			fprintf(output, "\treturn kong_pipelines_async;\n");
+			fprintf(output, "#endif\n");
+			fprintf(output, "}\n\n");
+
+			// the flags are written by the worker threads, a check without the mutex could see a flag before the pipeline itself
+			fprintf(output, "static bool kong_pipeline_created(size_t pipeline) {\n");
+			fprintf(output, "\tif (!kong_pipelines_locked()) {\n");
+			fprintf(output, "\t\treturn kong_pipelines_created[pipeline];\n");
+			fprintf(output, "\t}\n\n");
+			fprintf(output, "\tkore_mutex_lock(&kong_pipeline_mutexes[pipeline]);\n");
+			fprintf(output, "\tbool created = kong_pipelines_created[pipeline];\n");
+			fprintf(output, "\tkore_mutex_unlock(&kong_pipeline_mutexes[pipeline]);\n");
+			fprintf(output, "\treturn created;\n");
+			fprintf(output, "}\n\n");
+
+			fprintf(output, "static void kong_ensure_pipeline(kong_pipeline pipeline) {\n");
+			fprintf(output, "\tif (!kong_pipelines_locked()) {\n");
+			fprintf(output, "\t\tif (!kong_pipelines_created[pipeline]) {\n");
+			fprintf(output, "\t\t\tkong_pipeline_creators[pipeline]();\n");
+			fprintf(output, "\t\t\tkong_pipelines_created[pipeline] = true;\n");
+			fprintf(output, "\t\t}\n");
+			fprintf(output, "\t\treturn;\n");
+			fprintf(output, "\t}\n\n");
+			fprintf(output, "\tkore_mutex_lock(&kong_pipeline_mutexes[pipeline]);\n");
+			fprintf(output, "\tif (!kong_pipelines_created[pipeline]) {\n");
+			fprintf(output, "\t\tkong_pipeline_creators[pipeline]();\n");
+			fprintf(output, "\t\tkong_pipelines_created[pipeline] = true;\n");
+			fprintf(output, "\t}\n");
+			fprintf(output, "\tkore_mutex_unlock(&kong_pipeline_mutexes[pipeline]);\n");
+			fprintf(output, "}\n\n");
+		}
+		else {
+			fprintf(output, "static bool kong_pipeline_created(size_t pipeline) {\n");
+			fprintf(output, "\treturn kong_pipelines_created[pipeline];\n");
+			fprintf(output, "}\n\n");
+
+			fprintf(output, "static void kong_ensure_pipeline(kong_pipeline pipeline) {\n");
+			fprintf(output, "\tif (kong_pipelines_created[pipeline]) {\n");
+			fprintf(output, "\t\treturn;\n");
+			fprintf(output, "\t}\n\n");
+			fprintf(output, "\tkong_pipeline_creators[pipeline]();\n");
+			fprintf(output, "\tkong_pipelines_created[pipeline] = true;\n");
+			fprintf(output, "}\n\n");
+		}
+	}
+
+	if (threaded) {
+		fprintf(output, "static kore_thread kong_pipeline_threads[KONG_MAX_PIPELINE_THREADS];\n");
+		fprintf(output, "static uint32_t kong_pipeline_threads_count = 0;\n");
+		fprintf(output, "static kore_mutex kong_pipeline_queue_mutex;\n");
+		fprintf(output, "static kong_pipeline kong_pipeline_queue[KONG_PIPELINES_COUNT];\n");
+		fprintf(output, "static size_t kong_pipeline_queue_count = 0;\n");
+		fprintf(output, "static size_t kong_pipeline_queue_next = 0;\n");
+		fprintf(output, "static size_t kong_pipeline_queue_done = 0;\n\n");
+	}
+
+	fprintf(output, "static void kong_prepare(kore_gpu_device *device) {\n");
+	fprintf(output, "\tkong_device = device;\n");
+	if (blobs_need_init()) {
+		fprintf(output, "\tkong_blobs_init();\n");
+	}
+	if (threaded) {
+		fprintf(output, "\n\tfor (size_t pipeline = 0; pipeline < KONG_PIPELINES_COUNT; ++pipeline) {\n");
+		fprintf(output, "\t\tkore_mutex_init(&kong_pipeline_mutexes[pipeline]);\n");
+		fprintf(output, "\t}\n");
+		fprintf(output, "\tkore_mutex_init(&kong_pipeline_queue_mutex);\n");
+	}
+	if (api == API_VULKAN) {
+		fprintf(output, "\n\tcreate_descriptor_set_layouts(device);\n");
+	}
+	else if (api == API_WEBGPU) {
+		fprintf(output, "\n\tcreate_bind_group_layouts(device);\n");
+	}
+	fprintf(output, "}\n\n");
+
+	fprintf(output, "void kong_init(kore_gpu_device *device) {\n");
+	fprintf(output, "\tkong_prepare(device);\n");
+	if (pipelines_count > 0) {
+		fprintf(output, "\n#ifndef KONG_LAZY_PIPELINES\n");
+		fprintf(output, "\tfor (size_t pipeline = 0; pipeline < KONG_PIPELINES_COUNT; ++pipeline) {\n");
+		fprintf(output, "\t\tkong_ensure_pipeline((kong_pipeline)pipeline);\n");
+		fprintf(output, "\t}\n");
+		fprintf(output, "#endif\n");
+	}
+	fprintf(output, "}\n\n");
+
+	fprintf(output, "void kong_prewarm_pipelines(const kong_pipeline *pipelines, size_t pipelines_count) {\n");
+	if (pipelines_count > 0) {
+		fprintf(output, "\tfor (size_t index = 0; index < pipelines_count; ++index) {\n");
+		fprintf(output, "\t\tkong_ensure_pipeline(pipelines[index]);\n");
+		fprintf(output, "\t}\n");
+	}
+	else {
+		fprintf(output, "\t(void)pipelines;\n");
+		fprintf(output, "\t(void)pipelines_count;\n");
+	}
+	fprintf(output, "}\n\n");
+
+	if (!threaded) {
+		fprintf(output, "void kong_init_async(kore_gpu_device *device, const kong_pipeline *pipelines, size_t pipelines_count, uint32_t threads_count) {\n");
+		fprintf(output, "\t(void)threads_count;\n\n");
+		fprintf(output, "\tif (pipelines == NULL) {\n");
+		fprintf(output, "\t\tkong_init(device);\n");
+		fprintf(output, "\t}\n");
+		fprintf(output, "\telse {\n");
+		fprintf(output, "\t\tkong_prepare(device);\n");
+		fprintf(output, "\t\tkong_prewarm_pipelines(pipelines, pipelines_count);\n");
+		fprintf(output, "\t}\n");
+		fprintf(output, "}\n\n");
+
+		fprintf(output, "bool kong_pipelines_ready(void) {\n");
+		fprintf(output, "\treturn true;\n");
+		fprintf(output, "}\n\n");
+
+		fprintf(output, "void kong_wait_for_pipelines(void) {}\n");
+		return;
+	}
+
+	fprintf(output, "static void kong_pipeline_worker(void *parameter) {\n");
+	fprintf(output, "\t(void)parameter;\n\n");
+	fprintf(output, "\tfor (;;) {\n");
+	fprintf(output, "\t\tkore_mutex_lock(&kong_pipeline_queue_mutex);\n");
+	fprintf(output, "\t\tif (kong_pipeline_queue_next >= kong_pipeline_queue_count) {\n");
+	fprintf(output, "\t\t\tkore_mutex_unlock(&kong_pipeline_queue_mutex);\n");
+	fprintf(output, "\t\t\treturn;\n");
+	fprintf(output, "\t\t}\n");
+	fprintf(output, "\t\tkong_pipeline pipeline = kong_pipeline_queue[kong_pipeline_queue_next];\n");
+	fprintf(output, "\t\tkong_pipeline_queue_next += 1;\n");
+	fprintf(output, "\t\tkore_mutex_unlock(&kong_pipeline_queue_mutex);\n\n");
+	fprintf(output, "\t\tkong_ensure_pipeline(pipeline);\n\n");
+	fprintf(output, "\t\tkore_mutex_lock(&kong_pipeline_queue_mutex);\n");
+	fprintf(output, "\t\tkong_pipeline_queue_done += 1;\n");
+	fprintf(output, "\t\tkore_mutex_unlock(&kong_pipeline_queue_mutex);\n");
+	fprintf(output, "\t}\n");
+	fprintf(output, "}\n\n");
+
+	fprintf(output, "void kong_init_async(kore_gpu_device *device, const kong_pipeline *pipelines, size_t pipelines_count, uint32_t threads_count) {\n");
+	fprintf(output, "\tkong_prepare(device);\n\n");
+	fprintf(output, "\tkong_pipelines_async = true;\n\n");
+	fprintf(output, "\tkong_pipeline_queue_count = 0;\n");
+	fprintf(output, "\tkong_pipeline_queue_next = 0;\n");
+	fprintf(output, "\tkong_pipeline_queue_done = 0;\n\n");
+	fprintf(output, "\tif (pipelines == NULL) {\n");
+	fprintf(output, "\t\tfor (size_t pipeline = 0; pipeline < KONG_PIPELINES_COUNT; ++pipeline) {\n");
+	fprintf(output, "\t\t\tkong_pipeline_queue[kong_pipeline_queue_count++] = (kong_pipeline)pipeline;\n");
+	fprintf(output, "\t\t}\n");
+	fprintf(output, "\t}\n");
+	fprintf(output, "\telse {\n");
+	fprintf(output, "\t\tfor (size_t index = 0; index < pipelines_count && kong_pipeline_queue_count < KONG_PIPELINES_COUNT; ++index) {\n");
+	fprintf(output, "\t\t\tkong_pipeline_queue[kong_pipeline_queue_count++] = pipelines[index];\n");
+	fprintf(output, "\t\t}\n");
+	fprintf(output, "\t}\n\n");
+	fprintf(output, "\tif (threads_count > KONG_MAX_PIPELINE_THREADS) {\n");
+	fprintf(output, "\t\tthreads_count = KONG_MAX_PIPELINE_THREADS;\n");
+	fprintf(output, "\t}\n");
+	fprintf(output, "\tif (threads_count > kong_pipeline_queue_count) {\n");
+	fprintf(output, "\t\tthreads_count = (uint32_t)kong_pipeline_queue_count;\n");
+	fprintf(output, "\t}\n\n");
+	fprintf(output, "\tkong_pipeline_threads_count = threads_count;\n");
+	fprintf(output, "\tfor (uint32_t thread_index = 0; thread_index < threads_count; ++thread_index) {\n");
+	fprintf(output, "\t\tkore_thread_init(&kong_pipeline_threads[thread_index], kong_pipeline_worker, NULL);\n");
+	fprintf(output, "\t}\n\n");
+	fprintf(output, "\tif (threads_count == 0) {\n");
+	fprintf(output, "\t\tkong_pipeline_worker(NULL);\n");
+	fprintf(output, "\t}\n");
+	fprintf(output, "}\n\n");
+
+	fprintf(output, "bool kong_pipelines_ready(void) {\n");
+	fprintf(output, "\tkore_mutex_lock(&kong_pipeline_queue_mutex);\n");
+	fprintf(output, "\tbool ready = kong_pipeline_queue_done == kong_pipeline_queue_count;\n");
+	fprintf(output, "\tkore_mutex_unlock(&kong_pipeline_queue_mutex);\n");
+	fprintf(output, "\treturn ready;\n");
+	fprintf(output, "}\n\n");
+
+	fprintf(output, "void kong_wait_for_pipelines(void) {\n");
+	fprintf(output, "\tfor (uint32_t thread_index = 0; thread_index < kong_pipeline_threads_count; ++thread_index) {\n");
+	fprintf(output, "\t\tkore_thread_wait_and_destroy(&kong_pipeline_threads[thread_index]);\n");
+	fprintf(output, "\t}\n");
+	fprintf(output, "\tkong_pipeline_threads_count = 0;\n");
+	fprintf(output, "}\n");
+}
+
+static void write_texture_array_prepare(FILE *output, const char *api_short, global *g) {
+	fprintf(output, "\tfor (size_t index = 0; index < set->%s_count; ++index) {\n", get_name(g->name));
+	fprintf(output, "\t\tkore_%s_descriptor_set_prepare_srv_texture(list, &set->%s[index]);\n", api_short, get_name(g->name));
+	fprintf(output, "\t}\n");
+}
+
+static bool is_root_constants_global(global *g) {
+	for (size_t set_index = 0; set_index < g->sets_count; ++set_index) {
+		if (g->sets[set_index]->name == add_name("root_constants")) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Buffers of the same argument struct share its typedef and helpers
+static bool is_first_indirect_args_buffer(global_id id) {
+	global *g = get_global(id);
+	if (!global_is_buffer(g) || !is_indirect_args(get_type(g->type)->base)) {
+		return false;
+	}
+
+	for (global_id i = 0; i < id; ++i) {
+		if (global_is_buffer(get_global(i)) && get_type(get_global(i)->type)->base == get_type(g->type)->base) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool indirect_args_used(type_id args) {
+	for (global_id i = 0; get_global(i) != NULL && get_global(i)->type != NO_TYPE; ++i) {
+		if (global_is_buffer(get_global(i)) && get_type(get_global(i)->type)->base == args) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static uint32_t global_struct_size(global *g, api_kind api) {
+	type_id base_type = get_type(g->type)->array_size > 0 ? get_type(g->type)->base : g->type;
+	return struct_size(base_type, api_layout_rules(api, is_root_constants_global(g)));
+}
+
+#define MAX_SHADERS 256
+
+static void add_shader(function **shaders, bool *vertex, size_t *shaders_count, function *f, bool is_vertex) {
+	for (size_t i = 0; i < *shaders_count; ++i) {
+		if (shaders[i] == f) {
+			return;
+		}
+	}
+
+	assert(*shaders_count < MAX_SHADERS);
+	shaders[*shaders_count] = f;
+	vertex[*shaders_count]  = is_vertex;
+	*shaders_count += 1;
+}
+
+// Vertex, fragment and compute shaders which kong.c includes
+static size_t collect_shaders(function **shaders, bool *vertex) {
+	size_t shaders_count = 0;
+
+	for (type_id i = 0; get_type(i) != NULL; ++i) {
+		type *t = get_type(i);
+		if (!t->built_in && has_attribute(&t->attributes, add_name("pipe"))) {
+			for (size_t j = 0; j < t->members.size; ++j) {
+				bool is_vertex = t->members.m[j].name == add_name("vertex");
+				if ((is_vertex || t->members.m[j].name == add_name("fragment")) && t->members.m[j].value.kind == TOKEN_IDENTIFIER) {
+					function_id f = find_function(t->members.m[j].value.identifier);
+					if (f != NO_FUNCTION) {
+						add_shader(shaders, vertex, &shaders_count, get_function(f), is_vertex);
+					}
+				}
+			}
+		}
+	}
+
+	for (function_id i = 0; get_function(i) != NULL; ++i) {
+		function *f = get_function(i);
+		if (has_attribute(&f->attributes, add_name("compute"))) {
+			add_shader(shaders, vertex, &shaders_count, f, false);
+		}
+	}
+
+	return shaders_count;
+}
+
+static void write_permutation_includes(FILE *output, api_kind api) {
+	function *shaders[MAX_SHADERS];
+	bool      vertex[MAX_SHADERS];
+	size_t    shaders_count = collect_shaders(shaders, vertex);
+
+	for (size_t i = 0; i < shaders_count; ++i) {
+		for (uint32_t permutation = 1; permutation < permutations_count(); ++permutation) {
+			if (shader_permutation(shaders[i], permutation) == permutation) {
+				fprintf(output, "#include \"kong_%s_p%u.h\"\n", get_name(shaders[i]->name), permutation);
+				if (api == API_OPENGL && vertex[i]) {
+					fprintf(output, "#include \"kong_%s_p%u_flip.h\"\n", get_name(shaders[i]->name), permutation);
+				}
+			}
+		}
+	}
+}
+
 void kore3_export(char *directory, api_kind api) {
 	for (function_id i = 0; get_function(i) != NULL; ++i) {
 		function *f = get_function(i);
@@ -655,6 +1729,12 @@ void kore3_export(char *directory, api_kind api) {
 		break;
 	}
 
+	static pipeline_object pipelines[MAX_PIPELINES];
+	size_t                 pipelines_count = collect_pipelines(pipelines);
+
+	// OpenGL contexts are bound to one thread and WebGPU has no threads to spare
+	bool threaded_pipelines = pipelines_count > 0 && (api == API_DIRECT3D12 || api == API_VULKAN || api == API_METAL);
+
 	if (api == API_WEBGPU) {
 		int binding_index = 0;
 
@@ -754,7 +1834,7 @@ void kore3_export(char *directory, api_kind api) {
 		char filename[512];
 		sprintf(filename, "%s/%s", directory, "kong.h");
 
-		FILE *output = fopen(filename, "wb");
+		FILE *output = open_output(filename);
 
 		fprintf(output, "#ifndef KONG_INTEGRATION_HEADER\n");
 		fprintf(output, "#define KONG_INTEGRATION_HEADER\n\n");
@@ -765,6 +1845,7 @@ void kore3_export(char *directory, api_kind api) {
 		fprintf(output, "#include <kore3/%s/pipeline_structs.h>\n", api_long);
 		fprintf(output, "#include <kore3/math/matrix.h>\n");
 		fprintf(output, "#include <kore3/math/vector.h>\n\n");
+		fprintf(output, "#include <stdbool.h>\n\n");
 
 		fprintf(output, "#ifdef __cplusplus\n");
 		fprintf(output, "extern \"C\" {\n");
@@ -780,7 +1861,83 @@ void kore3_export(char *directory, api_kind api) {
 		fprintf(output, "#define KONG_PACK __attribute__((packed))\n");
 		fprintf(output, "#endif\n");
 
-		fprintf(output, "\nvoid kong_init(kore_gpu_device *device);\n\n");
+		fprintf(output, "\n// Frames a ring allocator can keep in flight before their slots are reused\n");
+		fprintf(output, "#ifndef KONG_RING_MAX_FRAMES\n");
+		fprintf(output, "#define KONG_RING_MAX_FRAMES 4\n");
+		fprintf(output, "#endif\n");
+
+		fprintf(output, "\n// Upper limit for the worker threads of kong_init_async\n");
+		fprintf(output, "#ifndef KONG_MAX_PIPELINE_THREADS\n");
+		fprintf(output, "#define KONG_MAX_PIPELINE_THREADS 8\n");
+		fprintf(output, "#endif\n");
+
+		fprintf(output, "\ntypedef enum kong_pipeline {\n");
+		for (size_t pipeline_index = 0; pipeline_index < pipelines_count; ++pipeline_index) {
+			fprintf(output, "\t");
+			write_pipeline_id(output, pipelines[pipeline_index].name);
+			fprintf(output, ",\n");
+		}
+		fprintf(output, "\tKONG_PIPELINES_COUNT\n");
+		fprintf(output, "} kong_pipeline;\n");
+
+		bool specializations = false;
+		for (global_id i = 0; get_global(i) != NULL; ++i) {
+			specializations = specializations || get_global(i)->specialization;
+		}
+
+		if (specializations) {
+			fprintf(output, "\n// SPIR-V SpecIds, Metal function constant indices and WGSL override ids of the #[specialize] consts,\n");
+			fprintf(output, "// Direct3D and OpenGL always use the declared values unless kong runs with --specialize\n");
+			fprintf(output, "typedef enum kong_specialization {\n");
+			for (global_id i = 0; get_global(i) != NULL; ++i) {
+				global *g = get_global(i);
+				if (g->specialization) {
+					fprintf(output, "\tKONG_SPECIALIZATION_%s = %u,\n", get_name(g->name), g->specialization_id);
+				}
+			}
+			fprintf(output, "} kong_specialization;\n");
+		}
+
+		if (permutations_count() > 1) {
+			fprintf(output, "\n// Shaders were compiled for every --permutation, identical ones share their code and pipeline objects.\n");
+			fprintf(output, "// Pipelines are set with the index of a permutation in the order of the --permutation parameters.\n");
+			fprintf(output, "#define KONG_PERMUTATIONS_COUNT %u\n", permutations_count());
+		}
+
+		fprintf(output, "\n// Creates all pipelines unless kong.c is compiled with KONG_LAZY_PIPELINES,\n");
+		fprintf(output, "// then every pipeline is created when it is set for the first time\n");
+		fprintf(output, "void kong_init(kore_gpu_device *device);\n\n");
+
+		fprintf(output, "// Creates the given pipelines right away so setting them later on does not stall\n");
+		fprintf(output, "void kong_prewarm_pipelines(const kong_pipeline *pipelines, size_t pipelines_count);\n\n");
+
+		fprintf(output, "// Replaces kong_init and creates the given pipelines (all of them for NULL) on up to threads_count worker threads,\n");
+		fprintf(output, "// kong_wait_for_pipelines has to be called once to release the threads\n");
+		fprintf(output, "void kong_init_async(kore_gpu_device *device, const kong_pipeline *pipelines, size_t pipelines_count, uint32_t threads_count);\n");
+		fprintf(output, "bool kong_pipelines_ready(void);\n");
+		fprintf(output, "void kong_wait_for_pipelines(void);\n\n");
+
+		fprintf(output, "// Stays the same across launches as long as the shader code and the pipeline state do not change\n");
+		fprintf(output, "uint64_t kong_pipeline_hash(kong_pipeline pipeline);\n\n");
+
+		fprintf(output, "typedef struct kong_pipeline_cache_hooks {\n");
+		fprintf(output, "\t// Returns the size of the driver data of a created pipeline and copies it to data unless data is NULL\n");
+		fprintf(output, "\tsize_t (*save)(kong_pipeline pipeline, void *data, size_t size, void *user_data);\n");
+		fprintf(output, "\t// Receives the cached driver data of a pipeline whose hash still matches\n");
+		fprintf(output, "\tvoid (*load)(kong_pipeline pipeline, const void *data, size_t size, void *user_data);\n");
+		fprintf(output, "\tvoid *user_data;\n");
+		fprintf(output, "} kong_pipeline_cache_hooks;\n\n");
+
+		fprintf(output, "void kong_set_pipeline_cache_hooks(const kong_pipeline_cache_hooks *hooks);\n\n");
+
+		fprintf(output, "// Writes the hashes of all created pipelines plus their driver data into data when size suffices, returns the required size\n");
+		fprintf(output, "size_t kong_save_pipeline_cache(void *data, size_t size);\n");
+		fprintf(output, "// Call before kong_init, returns the number of cached pipelines that still match and lists each of them once in pipelines\n");
+		fprintf(output, "// (KONG_PIPELINES_COUNT entries at most) so they can be passed to kong_init_async or kong_prewarm_pipelines\n");
+		fprintf(output, "size_t kong_load_pipeline_cache(kore_gpu_device *device, const void *data, size_t size, kong_pipeline *pipelines);\n\n");
+
+		fprintf(output, "bool kong_save_pipeline_cache_file(const char *path);\n");
+		fprintf(output, "size_t kong_load_pipeline_cache_file(kore_gpu_device *device, const char *path, kong_pipeline *pipelines);\n\n");
 
 		for (global_id i = 0; get_global(i) != NULL && get_global(i)->type != NO_TYPE; ++i) {
 			global *g = get_global(i);
@@ -790,6 +1947,19 @@ void kore3_export(char *directory, api_kind api) {
 			if (is_texture(g->type)) {
 				fprintf(output, "uint32_t %s_texture_usage_flags(void);\n", get_name(g->name));
 			}
+			else if (is_first_indirect_args_buffer(i)) {
+				type *t = get_type(base_type);
+
+				fprintf(output, "typedef struct %s {\n", get_name(t->name));
+				for (size_t j = 0; j < t->members.size; ++j) {
+					fprintf(output, "\t%s %s;\n", type_string(t->members.m[j].type.type), get_name(t->members.m[j].name));
+				}
+				fprintf(output, "} %s;\n\n", get_name(t->name));
+
+				fprintf(output, "uint32_t %s_buffer_usage_flags(void);\n", get_name(t->name));
+				fprintf(output, "void %s_buffer_create(kore_gpu_device *device, kore_gpu_buffer *buffer, uint32_t count);\n", get_name(t->name));
+				fprintf(output, "void %s_buffer_destroy(kore_gpu_buffer *buffer);\n\n", get_name(t->name));
+			}
 			else if (!get_type(base_type)->built_in) {
 				type *t = get_type(base_type);
 
@@ -802,33 +1972,28 @@ void kore3_export(char *directory, api_kind api) {
 					strcat(name, "_type");
 				}
 
+				layout_rules         rules = api_layout_rules(api, is_root_constants_global(g));
+				static struct_layout layout;
+				layout_struct(base_type, rules, &layout);
+
+				// Explicit padding keeps every member at the offset the shaders read it from
 				fprintf(output, "typedef struct %s {\n", name);
 				for (size_t j = 0; j < t->members.size; ++j) {
-					fprintf(output, "\t%s %s;\n", type_string(t->members.m[j].type.type), get_name(t->members.m[j].name));
-					if (t->members.m[j].type.type == float3x3_id) {
-						fprintf(output, "\tfloat pad%zu[3];\n", j);
-					}
-					else if (t->members.m[j].type.type == float_id) {
-						fprintf(output, "\tfloat pad%zu[3];\n", j);
-					}
-					else if (t->members.m[j].type.type == float2_id) {
-						fprintf(output, "\tfloat pad%zu[2];\n", j);
+					write_buffer_member(output, t->members.m[j].type.type, t->members.m[j].name, rules);
+
+					uint32_t end     = layout.offsets[j] + c_member_size(t->members.m[j].type.type, rules);
+					uint32_t next    = j + 1 < t->members.size ? layout.offsets[j + 1] : layout.size;
+					uint32_t padding = next - end;
+					if (padding % 4 != 0) {
+						fprintf(output, "\tuint16_t pad%zu[%u];\n", j, padding / 2);
 					}
-					else if (t->members.m[j].type.type == float3_id) {
-						fprintf(output, "\tfloat pad%zu[1];\n", j);
+					else if (padding > 0) {
+						fprintf(output, "\tfloat pad%zu[%u];\n", j, padding / 4);
 					}
 				}
 				fprintf(output, "} %s;\n\n", name);
 
-				bool is_root_constant = false;
-				for (size_t set_index = 0; set_index < g->sets_count; ++set_index) {
-					if (g->sets[set_index]->name == add_name("root_constants")) {
-						is_root_constant = true;
-						break;
-					}
-				}
-
-				if (is_root_constant) {
+				if (is_root_constants_global(g)) {
 					fprintf(output, "void kong_set_root_constants_%s(kore_gpu_command_list *list, %s *constants);\n", get_name(g->name), name);
 				}
 				else {
@@ -837,7 +2002,32 @@ void kore3_export(char *directory, api_kind api) {
 					fprintf(output, "void %s_buffer_destroy(kore_gpu_buffer *buffer);\n", name);
 					fprintf(output, "%s *%s_buffer_lock(kore_gpu_buffer *buffer, uint32_t index, uint32_t count);\n", name, name);
 					fprintf(output, "%s *%s_buffer_try_to_lock(kore_gpu_buffer *buffer, uint32_t index, uint32_t count);\n", name, name);
-					fprintf(output, "void %s_buffer_unlock(kore_gpu_buffer *buffer);\n", name);
+					fprintf(output, "void %s_buffer_unlock(kore_gpu_buffer *buffer);\n\n", name);
+
+					fprintf(output, "typedef struct %s_ring {\n", name);
+					fprintf(output, "\tkore_gpu_buffer buffer;\n");
+					fprintf(output, "\tuint32_t count;\n");
+					fprintf(output, "\tuint64_t allocated;\n");
+					fprintf(output, "\tuint64_t retired;\n");
+					fprintf(output, "\tuint64_t frame;\n");
+					fprintf(output, "\tuint64_t frames[KONG_RING_MAX_FRAMES];\n");
+					fprintf(output, "\tuint64_t frame_ends[KONG_RING_MAX_FRAMES];\n");
+					fprintf(output, "\tuint32_t frames_count;\n");
+					fprintf(output, "\tuint8_t *mapped;\n");
+					fprintf(output, "\tuint64_t mapped_start;\n");
+					fprintf(output, "\tuint64_t mapped_end;\n");
+					fprintf(output, "} %s_ring;\n\n", name);
+
+					fprintf(output, "void %s_ring_create(kore_gpu_device *device, %s_ring *ring, uint32_t count);\n", name, name);
+					fprintf(output, "void %s_ring_destroy(%s_ring *ring);\n", name, name);
+					fprintf(output, "// Slots allocated in frames up to completed_frame are free again\n");
+					fprintf(output, "void %s_ring_begin_frame(%s_ring *ring, uint64_t frame, uint64_t completed_frame);\n", name, name);
+					fprintf(output, "// The first allocation after a flush maps all free slots at once, following allocations bump through that mapping.\n");
+					fprintf(output, "// Returns NULL when the mapped slots ran out, offset is the byte offset of the data in ring->buffer that\n");
+					fprintf(output, "// kong_set_descriptor_set_*_offsets take for #[indexed] globals. The pointer stays valid until the next flush.\n");
+					fprintf(output, "%s *%s_ring_allocate(%s_ring *ring, uint32_t *offset);\n", name, name, name);
+					fprintf(output, "// Unmaps the allocations, call before executing the command list that uses them\n");
+					fprintf(output, "void %s_ring_flush(%s_ring *ring);\n", name, name);
 				}
 			}
 		}
@@ -906,7 +2096,8 @@ void kore3_export(char *directory, api_kind api) {
 			fprintf(output, "} %s_parameters;\n\n", get_name(set->name));
 
 			fprintf(output, "typedef struct %s_set {\n", get_name(set->name));
-			fprintf(output, "\tkore_%s_descriptor_set set;\n\n", api_short);
+			fprintf(output, "\tkore_%s_descriptor_set set;\n", api_short);
+			fprintf(output, "\tuint32_t version;\n\n");
 
 			for (size_t global_index = 0; global_index < set->globals.size; ++global_index) {
 				global *g = get_global(set->globals.globals[global_index]);
@@ -944,21 +2135,52 @@ void kore3_export(char *directory, api_kind api) {
 
 			fprintf(output, "void kong_destroy_%s_set(%s_set *set);\n", get_name(set->name), get_name(set->name));
 
-			fprintf(output, "void kong_set_descriptor_set_%s(kore_gpu_command_list *list, %s_set *set", get_name(set->name), get_name(set->name));
+			fprintf(output, "void kong_set_descriptor_set_%s(kore_gpu_command_list *list, %s_set *set", get_name(set->name), get_name(set->name));
+			for (size_t global_index = 0; global_index < set->globals.size; ++global_index) {
+				global *g = get_global(set->globals.globals[global_index]);
+
+				if (!get_type(g->type)->built_in) {
+					if (has_attribute(&g->attributes, add_name("indexed"))) {
+						fprintf(output, ", uint32_t %s_index", get_name(g->name));
+					}
+				}
+			}
+			fprintf(output, ");\n");
+
+			if (has_indexed_globals(set)) {
+				fprintf(output, "// Takes byte offsets for the #[indexed] globals instead of indices, for example the ones ring allocations return\n");
+				fprintf(output, "void kong_set_descriptor_set_%s_offsets(kore_gpu_command_list *list, %s_set *set", get_name(set->name), get_name(set->name));
+				for (size_t global_index = 0; global_index < set->globals.size; ++global_index) {
+					global *g = get_global(set->globals.globals[global_index]);
+					if (!get_type(g->type)->built_in && has_attribute(&g->attributes, add_name("indexed"))) {
+						fprintf(output, ", uint32_t %s_offset", get_name(g->name));
+					}
+				}
+				fprintf(output, ");\n");
+			}
+			fprintf(output, "\n");
+
 			for (size_t global_index = 0; global_index < set->globals.size; ++global_index) {
 				global *g = get_global(set->globals.globals[global_index]);
-
-				if (!get_type(g->type)->built_in) {
-					if (has_attribute(&g->attributes, add_name("indexed"))) {
-						fprintf(output, ", uint32_t %s_index", get_name(g->name));
-					}
+				if (global_is_bindless(g)) {
+					fprintf(output, "// O(1). A handle stays valid as long as set->version does not change, kong_update_%s_set bumps it\n",
+					        get_name(set->name));
+					fprintf(output, "// because it can move the textures to another descriptor allocation. Only texture arrays can be bindless,\n");
+					fprintf(output, "// buffers and samplers are still bound through their set.\n");
+					fprintf(output, "uint32_t kong_%s_%s_handle(const %s_set *set, uint32_t index);\n", get_name(set->name), get_name(g->name),
+					        get_name(set->name));
+					fprintf(output, "// Binding the set does not touch the textures. This transitions all of them for sampling on list in O(n),\n");
+					fprintf(output, "// call it after creating or updating the set and after any of the textures was written to.\n");
+					fprintf(output, "void kong_prepare_%s_%s(kore_gpu_command_list *list, %s_set *set);\n\n", get_name(set->name), get_name(g->name),
+					        get_name(set->name));
 				}
 			}
-			fprintf(output, ");\n\n");
 
 			char upper_set_name[256];
 			to_upper(get_name(set->name), upper_set_name);
 
+			size_t updates_count = 0;
+
 			fprintf(output, "typedef struct %s_set_update {\n", get_name(set->name));
 			fprintf(output, "\tenum {\n");
 			for (size_t global_index = 0; global_index < set->globals.size; ++global_index) {
@@ -968,18 +2190,26 @@ void kore3_export(char *directory, api_kind api) {
 
 				if (!get_type(g->type)->built_in) {
 					fprintf(output, "\t\t%s_SET_UPDATE_%s,\n", upper_set_name, upper_definition_name);
+					updates_count += 1;
 				}
 				else if (g->type == bvh_type_id) {
 					fprintf(output, "\t\t%s_SET_UPDATE_%s,\n", upper_set_name, upper_definition_name);
+					updates_count += 1;
 				}
 				else if (is_texture(g->type)) {
 					// type *t = get_type(get_global(d.global)->type);
 					fprintf(output, "\t\t%s_SET_UPDATE_%s,\n", upper_set_name, upper_definition_name);
+					updates_count += 1;
 				}
 				else if (is_sampler(g->type)) {
 					fprintf(output, "\t\t%s_SET_UPDATE_%s,\n", upper_set_name, upper_definition_name);
+					updates_count += 1;
 				}
 			}
+			// C does not allow empty enums and unions
+			if (updates_count == 0) {
+				fprintf(output, "\t\t%s_SET_UPDATE_NONE,\n", upper_set_name);
+			}
 			fprintf(output, "\t} kind;\n");
 
 			fprintf(output, "\tunion {\n");
@@ -1009,6 +2239,9 @@ void kore3_export(char *directory, api_kind api) {
 					fprintf(output, "\t\tkore_gpu_sampler *%s;\n", get_name(g->name));
 				}
 			}
+			if (updates_count == 0) {
+				fprintf(output, "\t\tvoid *none;\n");
+			}
 			fprintf(output, "\t};\n");
 
 			fprintf(output, "} %s_set_update;\n\n", get_name(set->name));
@@ -1017,14 +2250,70 @@ void kore3_export(char *directory, api_kind api) {
 			        get_name(set->name));
 		}
 
+		fprintf(output, "\n// Optional bind cache for one command list, kong_set_descriptor_set_*_cached skip binds that would not change anything\n");
+		fprintf(output, "// and take byte offsets for #[indexed] globals like kong_set_descriptor_set_*_offsets.\n");
+		fprintf(output, "// Reset it when the list starts recording or when it used resources of a bound set differently, for example as render targets,\n");
+		fprintf(output, "// and pass every pipeline set on the list to kong_descriptor_cache_set_pipeline.\n");
+		fprintf(output, "typedef struct kong_descriptor_cache {\n");
+		fprintf(output, "\tuint32_t layout;\n");
+		for (size_t set_index = 0; set_index < sets_count; ++set_index) {
+			descriptor_set *set = sets[set_index];
+
+			if (set->name == add_name("root_constants")) {
+				continue;
+			}
+
+			fprintf(output, "\t%s_set *%s;\n", get_name(set->name), get_name(set->name));
+			fprintf(output, "\tuint32_t %s_version;\n", get_name(set->name));
+			for (size_t global_index = 0; global_index < set->globals.size; ++global_index) {
+				global *g = get_global(set->globals.globals[global_index]);
+				if (!get_type(g->type)->built_in && has_attribute(&g->attributes, add_name("indexed"))) {
+					fprintf(output, "\tuint32_t %s_%s_offset;\n", get_name(set->name), get_name(g->name));
+				}
+			}
+		}
+		fprintf(output, "} kong_descriptor_cache;\n\n");
+
+		fprintf(output, "void kong_reset_descriptor_cache(kong_descriptor_cache *cache);\n");
+		fprintf(output, "void kong_descriptor_cache_set_pipeline(kong_descriptor_cache *cache, kong_pipeline pipeline);\n");
+		for (size_t set_index = 0; set_index < sets_count; ++set_index) {
+			descriptor_set *set = sets[set_index];
+
+			if (set->name == add_name("root_constants")) {
+				continue;
+			}
+
+			fprintf(output, "void kong_set_descriptor_set_%s_cached(kong_descriptor_cache *cache, kore_gpu_command_list *list, %s_set *set",
+			        get_name(set->name), get_name(set->name));
+			for (size_t global_index = 0; global_index < set->globals.size; ++global_index) {
+				global *g = get_global(set->globals.globals[global_index]);
+				if (!get_type(g->type)->built_in && has_attribute(&g->attributes, add_name("indexed"))) {
+					fprintf(output, ", uint32_t %s_offset", get_name(g->name));
+				}
+			}
+			fprintf(output, ");\n");
+		}
+
 		fprintf(output, "\n");
 
+		for (size_t i = 0; i < vertex_inputs_size; ++i) {
+			if (has_packed_vertex_members(get_type(vertex_inputs[i]))) {
+				write_vertex_packing(output);
+				break;
+			}
+		}
+
 		for (size_t i = 0; i < vertex_inputs_size; ++i) {
 			type *t = get_type(vertex_inputs[i]);
 
 			fprintf(output, "KONG_PACK_START\ntypedef struct KONG_PACK %s {\n", get_name(t->name));
+			uint32_t size = 0;
 			for (size_t j = 0; j < t->members.size; ++j) {
-				fprintf(output, "\t%s %s;\n", type_string(t->members.m[j].type.type), get_name(t->members.m[j].name));
+				write_vertex_member(output, &t->members.m[j]);
+				size += vertex_member_size(&t->members.m[j]);
+			}
+			if (vertex_stride(t) > size) {
+				fprintf(output, "\tuint8_t _kong_padding[%u];\n", vertex_stride(t) - size);
 			}
 			fprintf(output, "} %s;\nKONG_PACK_END\n\n", get_name(t->name));
 
@@ -1045,14 +2334,50 @@ void kore3_export(char *directory, api_kind api) {
 		for (type_id i = 0; get_type(i) != NULL; ++i) {
 			type *t = get_type(i);
 			if (!t->built_in && has_attribute(&t->attributes, add_name("pipe"))) {
-				fprintf(output, "void kong_set_render_pipeline_%s(kore_gpu_command_list *list);\n\n", get_name(t->name));
+				if (permutations_count() > 1) {
+					fprintf(output, "// The pipeline which kong_set_render_pipeline_%s sets for a permutation,\n", get_name(t->name));
+					fprintf(output, "// for kong_init_async and kong_prewarm_pipelines\n");
+					fprintf(output, "kong_pipeline kong_%s_pipeline(uint32_t permutation);\n", get_name(t->name));
+				}
+				fprintf(output, "void kong_set_render_pipeline_%s(kore_gpu_command_list *list%s);\n\n", get_name(t->name), permutation_parameter());
 			}
 		}
 
 		for (function_id i = 0; get_function(i) != NULL; ++i) {
 			function *f = get_function(i);
 			if (has_attribute(&f->attributes, add_name("compute"))) {
-				fprintf(output, "void kong_set_compute_shader_%s(kore_gpu_command_list *list);\n\n", get_name(f->name));
+				if (permutations_count() > 1) {
+					fprintf(output, "// The pipeline which kong_set_compute_shader_%s sets for a permutation,\n", get_name(f->name));
+					fprintf(output, "// for kong_init_async and kong_prewarm_pipelines\n");
+					fprintf(output, "kong_pipeline kong_%s_pipeline(uint32_t permutation);\n", get_name(f->name));
+				}
+				fprintf(output, "void kong_set_compute_shader_%s(kore_gpu_command_list *list%s);\n\n", get_name(f->name), permutation_parameter());
+			}
+		}
+
+		for (type_id i = 0; get_type(i) != NULL; ++i) {
+			type *t = get_type(i);
+			if (!t->built_in && has_attribute(&t->attributes, add_name("pipe"))) {
+				// Sets the pipeline and draws count times from the arguments starting at index
+				if (indirect_args_used(draw_indirect_args_type_id)) {
+					fprintf(output, "void kong_draw_indirect_%s(kore_gpu_command_list *list%s, kore_gpu_buffer *args, uint32_t index, uint32_t count);\n\n",
+					        get_name(t->name), permutation_parameter());
+				}
+				if (indirect_args_used(draw_indexed_indirect_args_type_id)) {
+					fprintf(output,
+					        "void kong_draw_indexed_indirect_%s(kore_gpu_command_list *list%s, kore_gpu_buffer *args, uint32_t index, uint32_t count);\n\n",
+					        get_name(t->name), permutation_parameter());
+				}
+			}
+		}
+
+		if (indirect_args_used(dispatch_indirect_args_type_id)) {
+			for (function_id i = 0; get_function(i) != NULL; ++i) {
+				function *f = get_function(i);
+				if (has_attribute(&f->attributes, add_name("compute"))) {
+					fprintf(output, "void kong_dispatch_indirect_%s(kore_gpu_command_list *list%s, kore_gpu_buffer *args, uint32_t index);\n\n",
+					        get_name(f->name), permutation_parameter());
+				}
 			}
 		}
 
@@ -1069,7 +2394,7 @@ void kore3_export(char *directory, api_kind api) {
 
 		fprintf(output, "#endif\n");
 
-		fclose(output);
+		close_output_if_changed(output, filename);
 	}
 
 	{
@@ -1081,10 +2406,14 @@ void kore3_export(char *directory, api_kind api) {
 			sprintf(filename, "%s/%s", directory, "kong.c");
 		}
 
-		FILE *output = fopen(filename, "wb");
+		FILE *output = open_output(filename);
 
 		fprintf(output, "#include \"kong.h\"\n\n");
 
+		if (blobs_need_init()) {
+			fprintf(output, "#include \"kong_blobs.h\"\n\n");
+		}
+
 		if (api == API_METAL) {
 			// Code is added directly to the Xcode project instead
 		}
@@ -1115,6 +2444,10 @@ void kore3_export(char *directory, api_kind api) {
 					fprintf(output, "#include \"kong_%s.h\"\n", get_name(f->name));
 				}
 			}
+
+			if (permutations_count() > 1) {
+				write_permutation_includes(output, api);
+			}
 		}
 
 		fprintf(output, "\n#include <kore3/%s/buffer_functions.h>\n", api_long);
@@ -1124,8 +2457,14 @@ void kore3_export(char *directory, api_kind api) {
 		fprintf(output, "#include <kore3/%s/pipeline_functions.h>\n", api_long);
 		fprintf(output, "#include <kore3/%s/texture_functions.h>\n", api_long);
 		fprintf(output, "#include <kore3/util/align.h>\n\n");
+		if (threaded_pipelines) {
+			fprintf(output, "#include <kore3/threads/mutex.h>\n");
+			fprintf(output, "#include <kore3/threads/thread.h>\n\n");
+		}
 		fprintf(output, "#include <assert.h>\n");
-		fprintf(output, "#include <stdlib.h>\n\n");
+		fprintf(output, "#include <stdio.h>\n");
+		fprintf(output, "#include <stdlib.h>\n");
+		fprintf(output, "#include <string.h>\n\n");
 
 		fprintf(output, "#ifdef __cplusplus\n");
 		fprintf(output, "#define KONG_INIT_ZERO {}\n");
@@ -1178,6 +2517,23 @@ void kore3_export(char *directory, api_kind api) {
 			fprintf(output, "static uint32_t root_constants_table_index = UINT32_MAX;\n\n");
 		}
 
+		if (pipelines_count > 0) {
+			fprintf(output, "static void kong_ensure_pipeline(kong_pipeline pipeline);\n\n");
+		}
+
+		write_pipeline_layouts(output, api, pipelines, pipelines_count);
+
+		fprintf(output, "void kong_reset_descriptor_cache(kong_descriptor_cache *cache) {\n");
+		fprintf(output, "\tmemset(cache, 0, sizeof(*cache));\n");
+		fprintf(output, "}\n\n");
+
+		fprintf(output, "void kong_descriptor_cache_set_pipeline(kong_descriptor_cache *cache, kong_pipeline pipeline) {\n");
+		fprintf(output, "\tif (cache->layout != kong_pipeline_layouts[pipeline]) {\n");
+		fprintf(output, "\t\tkong_reset_descriptor_cache(cache);\n");
+		fprintf(output, "\t\tcache->layout = kong_pipeline_layouts[pipeline];\n");
+		fprintf(output, "\t}\n");
+		fprintf(output, "}\n\n");
+
 		for (size_t set_index = 0; set_index < sets_count; ++set_index) {
 			descriptor_set *set = sets[set_index];
 			if (api == API_METAL) {
@@ -1198,7 +2554,11 @@ void kore3_export(char *directory, api_kind api) {
 		for (type_id i = 0; get_type(i) != NULL; ++i) {
 			type *t = get_type(i);
 			if (!t->built_in && has_attribute(&t->attributes, add_name("pipe"))) {
-				fprintf(output, "static kore_%s_render_pipeline %s;\n\n", api_short, get_name(t->name));
+				for (size_t pipeline_index = 0; pipeline_index < pipelines_count; ++pipeline_index) {
+					if (pipelines[pipeline_index].pipe == t) {
+						fprintf(output, "static kore_%s_render_pipeline %s;\n\n", api_short, get_name(pipelines[pipeline_index].name));
+					}
+				}
 
 				name_id vertex_shader_name   = NO_NAME;
 				name_id fragment_shader_name = NO_NAME;
@@ -1225,6 +2585,10 @@ void kore3_export(char *directory, api_kind api) {
 					if (t->members.m[j].name == add_name("vertex")) {
 						vertex_shader_name = t->members.m[j].value.identifier;
 					}
+					if (t->members.m[j].name == add_name("mesh") && vertex_shader_name == NO_NAME) {
+						// the mesh shader takes the place of the vertex shader
+						vertex_shader_name = t->members.m[j].value.identifier;
+					}
 					if (t->members.m[j].name == add_name("fragment")) {
 						fragment_shader_name = t->members.m[j].value.identifier;
 					}
@@ -1265,26 +2629,57 @@ void kore3_export(char *directory, api_kind api) {
 						else if (g->type == float_id) {
 						}
 						else {
-							fprintf(output, "static uint32_t %s_%" PRIu64 "_uniform_block_index;\n", get_name(t->name), g->var_index);
+							for (size_t pipeline_index = 0; pipeline_index < pipelines_count; ++pipeline_index) {
+								if (pipelines[pipeline_index].pipe == t) {
+									fprintf(output, "static uint32_t %s_%" PRIu64 "_uniform_block_index;\n", get_name(pipelines[pipeline_index].name),
+									        g->var_index);
+								}
+							}
 						}
 					}
 				}
 
-				fprintf(output, "void kong_set_render_pipeline_%s(kore_gpu_command_list *list) {\n", get_name(t->name));
-				fprintf(output, "\tkore_%s_command_list_set_render_pipeline(list, &%s);\n", api_short, get_name(t->name));
+				if (permutations_count() > 1) {
+					write_permutation_pipelines(output, t, NULL);
+				}
+
+				char object_type[256];
+				sprintf(object_type, "kore_%s_render_pipeline", api_short);
+
+				fprintf(output, "void kong_set_render_pipeline_%s(kore_gpu_command_list *list%s) {\n", get_name(t->name), permutation_parameter());
+				write_pipeline_selection(output, object_type, t, NULL);
+				fprintf(output, "\tkore_%s_command_list_set_render_pipeline(list, %s);\n", api_short, pipeline_object_reference(t->name));
 
 				if (api == API_OPENGL) {
-					for (uint32_t i = 0; i < globals.size; ++i) {
-						global *g = get_global(globals.globals[i]);
-						if (g->type == sampler_type_id) {
+					for (size_t pipeline_index = 0; pipeline_index < pipelines_count; ++pipeline_index) {
+						if (pipelines[pipeline_index].pipe != t) {
+							continue;
 						}
-						else if (is_texture(g->type)) {
+
+						const char *indentation = "\t";
+						if (permutations_count() > 1) {
+							indentation = "\t\t";
+							fprintf(output, "\tif (pipeline == ");
+							write_pipeline_id(output, pipelines[pipeline_index].name);
+							fprintf(output, ") {\n");
 						}
-						else if (g->type == float_id) {
+
+						for (uint32_t i = 0; i < globals.size; ++i) {
+							global *g = get_global(globals.globals[i]);
+							if (g->type == sampler_type_id) {
+							}
+							else if (is_texture(g->type)) {
+							}
+							else if (g->type == float_id) {
+							}
+							else {
+								fprintf(output, "%s_%" PRIu64 "_uniform_block_index = %s_%" PRIu64 "_uniform_block_index;\n%s", indentation, g->var_index,
+								        get_name(pipelines[pipeline_index].name), g->var_index, permutations_count() > 1 ? "" : "\n");
+							}
 						}
-						else {
-							fprintf(output, "\t_%" PRIu64 "_uniform_block_index = %s_%" PRIu64 "_uniform_block_index;\n\n", g->var_index, get_name(t->name),
-							        g->var_index);
+
+						if (permutations_count() > 1) {
+							fprintf(output, "\t}\n");
 						}
 					}
 				}
@@ -1322,6 +2717,9 @@ void kore3_export(char *directory, api_kind api) {
 			if (!t->built_in && has_attribute(&t->attributes, add_name("raypipe"))) {
 				fprintf(output, "static kore_%s_ray_pipeline %s;\n\n", api_short, get_name(t->name));
 				fprintf(output, "void kong_set_ray_pipeline_%s(kore_gpu_command_list *list) {\n", get_name(t->name));
+				fprintf(output, "\tkong_ensure_pipeline(");
+				write_pipeline_id(output, t->name);
+				fprintf(output, ");\n");
 				fprintf(output, "\tkore_d3d12_command_list_set_ray_pipeline(list, &%s);\n", get_name(t->name));
 
 				descriptor_set_group *group = find_descriptor_set_group_for_pipe_type(t);
@@ -1384,6 +2782,24 @@ void kore3_export(char *directory, api_kind api) {
 				fprintf(output, "\treturn usage;\n");
 				fprintf(output, "}\n\n");
 			}
+			else if (is_first_indirect_args_buffer(i)) {
+				const char *args_name = get_name(get_type(base_type)->name);
+
+				fprintf(output, "uint32_t %s_buffer_usage_flags(void) {\n", args_name);
+				fprintf(output, "\treturn KORE_GPU_BUFFER_USAGE_READ_WRITE | KORE_GPU_BUFFER_USAGE_INDIRECT;\n");
+				fprintf(output, "}\n\n");
+
+				fprintf(output, "void %s_buffer_create(kore_gpu_device *device, kore_gpu_buffer *buffer, uint32_t count) {\n", args_name);
+				fprintf(output, "\tkore_gpu_buffer_parameters parameters;\n");
+				fprintf(output, "\tparameters.size = sizeof(%s) * count;\n", args_name);
+				fprintf(output, "\tparameters.usage_flags = KORE_GPU_BUFFER_USAGE_CPU_WRITE | %s_buffer_usage_flags();\n", args_name);
+				fprintf(output, "\tkore_gpu_device_create_buffer(device, &parameters, buffer);\n");
+				fprintf(output, "}\n\n");
+
+				fprintf(output, "void %s_buffer_destroy(kore_gpu_buffer *buffer) {\n", args_name);
+				fprintf(output, "\tkore_gpu_buffer_destroy(buffer);\n");
+				fprintf(output, "}\n\n");
+			}
 			else if (!get_type(base_type)->built_in) {
 				type *t = get_type(g->type);
 
@@ -1396,16 +2812,7 @@ void kore3_export(char *directory, api_kind api) {
 					strcat(type_name, "_type");
 				}
 
-				bool is_root_constant = false;
-
-				for (size_t set_index = 0; set_index < g->sets_count; ++set_index) {
-					if (g->sets[set_index]->name == add_name("root_constants")) {
-						is_root_constant = true;
-						break;
-					}
-				}
-
-				if (is_root_constant) {
+				if (is_root_constants_global(g)) {
 					root_constants_global = g;
 					strcpy(root_constants_type_name, type_name);
 				}
@@ -1433,7 +2840,7 @@ void kore3_export(char *directory, api_kind api) {
 
 					fprintf(output, "void %s_buffer_create(kore_gpu_device *device, kore_gpu_buffer *buffer, uint32_t count) {\n", type_name);
 					fprintf(output, "\tkore_gpu_buffer_parameters parameters;\n");
-					fprintf(output, "\tparameters.size = align_pow2(%i, 256) * count;\n", struct_size(g->type));
+					fprintf(output, "\tparameters.size = align_pow2(%i, 256) * count;\n", global_struct_size(g, api));
 					fprintf(output, "\tparameters.usage_flags = KORE_GPU_BUFFER_USAGE_CPU_WRITE | %s_buffer_usage_flags();\n", type_name);
 					fprintf(output, "\tkore_gpu_device_create_buffer(device, &parameters, buffer);\n");
 					fprintf(output, "}\n\n");
@@ -1457,8 +2864,6 @@ void kore3_export(char *directory, api_kind api) {
 					        type_name, type_name, type_name);
 					fprintf(output, "}\n\n");
 
-					fprintf(output, "void %s_buffer_unlock(kore_gpu_buffer *buffer) {\n", type_name);
-
 					bool has_matrices = false;
 					for (size_t j = 0; j < t->members.size; ++j) {
 						if (t->members.m[j].type.type == float4x4_id || t->members.m[j].type.type == float3x3_id) {
@@ -1468,7 +2873,7 @@ void kore3_export(char *directory, api_kind api) {
 					}
 
 					if (has_matrices) {
-						fprintf(output, "\t%s *data = (%s *)buffer->%s.locked_data;\n", type_name, type_name, api_short);
+						fprintf(output, "static void %s_convert_matrices(%s *data) {\n", type_name, type_name);
 						// adjust matrices
 						for (size_t j = 0; j < t->members.size; ++j) {
 							if (t->members.m[j].type.type == float4x4_id && (api != API_METAL && api != API_VULKAN && api != API_WEBGPU && api != API_OPENGL)) {
@@ -1508,14 +2913,101 @@ void kore3_export(char *directory, api_kind api) {
 								fprintf(output, "\t\tm_data[8] = m.m[6];\n");
 								fprintf(output, "\t\tm_data[9] = m.m[7];\n");
 								fprintf(output, "\t\tm_data[10] = m.m[8];\n");
-								fprintf(output, "\t\tm_data[11] = 0.0f;\n");
+								// HLSL packs the next member right behind the third column
 								fprintf(output, "\t}\n");
 							}
 						}
+						fprintf(output, "}\n\n");
 					}
 
+					fprintf(output, "void %s_buffer_unlock(kore_gpu_buffer *buffer) {\n", type_name);
+					if (has_matrices) {
+						fprintf(output, "\t%s_convert_matrices((%s *)buffer->%s.locked_data);\n", type_name, type_name, api_short);
+					}
 					fprintf(output, "\tkore_gpu_buffer_unlock(buffer);\n");
 					fprintf(output, "}\n\n");
+
+					fprintf(output, "void %s_ring_create(kore_gpu_device *device, %s_ring *ring, uint32_t count) {\n", type_name, type_name);
+					fprintf(output, "\tmemset(ring, 0, sizeof(*ring));\n");
+					fprintf(output, "\t%s_buffer_create(device, &ring->buffer, count);\n", type_name);
+					fprintf(output, "\tring->count = count;\n");
+					fprintf(output, "}\n\n");
+
+					fprintf(output, "void %s_ring_destroy(%s_ring *ring) {\n", type_name, type_name);
+					fprintf(output, "\t%s_ring_flush(ring);\n", type_name);
+					fprintf(output, "\t%s_buffer_destroy(&ring->buffer);\n", type_name);
+					fprintf(output, "}\n\n");
+
+					fprintf(output, "void %s_ring_begin_frame(%s_ring *ring, uint64_t frame, uint64_t completed_frame) {\n", type_name, type_name);
+					fprintf(output, "\tif (ring->frames_count == KONG_RING_MAX_FRAMES) {\n");
+					fprintf(output, "\t\tring->frames[KONG_RING_MAX_FRAMES - 1] = ring->frame;\n");
+					fprintf(output, "\t\tring->frame_ends[KONG_RING_MAX_FRAMES - 1] = ring->allocated;\n");
+					fprintf(output, "\t}\n");
+					fprintf(output, "\telse {\n");
+					fprintf(output, "\t\tring->frames[ring->frames_count] = ring->frame;\n");
+					fprintf(output, "\t\tring->frame_ends[ring->frames_count] = ring->allocated;\n");
+					fprintf(output, "\t\tring->frames_count += 1;\n");
+					fprintf(output, "\t}\n\n");
+					fprintf(output, "\tuint32_t retired_frames = 0;\n");
+					fprintf(output, "\twhile (retired_frames < ring->frames_count && ring->frames[retired_frames] <= completed_frame) {\n");
+					fprintf(output, "\t\tring->retired = ring->frame_ends[retired_frames];\n");
+					fprintf(output, "\t\tretired_frames += 1;\n");
+					fprintf(output, "\t}\n");
+					fprintf(output, "\tfor (uint32_t frame_index = retired_frames; frame_index < ring->frames_count; ++frame_index) {\n");
+					fprintf(output, "\t\tring->frames[frame_index - retired_frames] = ring->frames[frame_index];\n");
+					fprintf(output, "\t\tring->frame_ends[frame_index - retired_frames] = ring->frame_ends[frame_index];\n");
+					fprintf(output, "\t}\n");
+					fprintf(output, "\tring->frames_count -= retired_frames;\n\n");
+					fprintf(output, "\tring->frame = frame;\n");
+					fprintf(output, "}\n\n");
+
+					fprintf(output, "%s *%s_ring_allocate(%s_ring *ring, uint32_t *offset) {\n", type_name, type_name, type_name);
+					fprintf(output, "\tif (ring->mapped == NULL) {\n");
+					fprintf(output, "\t\tuint32_t first = (uint32_t)(ring->allocated %% ring->count);\n");
+					fprintf(output, "\t\tuint32_t slots = (uint32_t)(ring->count - (ring->allocated - ring->retired));\n");
+					fprintf(output, "\t\tif (first + slots > ring->count) {\n");
+					fprintf(output, "\t\t\t// the free slots wrap around, only the larger part is mapped so the mapping stays in one piece\n");
+					fprintf(output, "\t\t\tuint32_t tail = ring->count - first;\n");
+					fprintf(output, "\t\t\tif (slots - tail > tail) {\n");
+					fprintf(output, "\t\t\t\tring->allocated += tail;\n");
+					fprintf(output, "\t\t\t\tfirst = 0;\n");
+					fprintf(output, "\t\t\t\tslots -= tail;\n");
+					fprintf(output, "\t\t\t}\n");
+					fprintf(output, "\t\t\telse {\n");
+					fprintf(output, "\t\t\t\tslots = tail;\n");
+					fprintf(output, "\t\t\t}\n");
+					fprintf(output, "\t\t}\n");
+					fprintf(output, "\t\tif (slots == 0) {\n");
+					fprintf(output, "\t\t\treturn NULL;\n");
+					fprintf(output, "\t\t}\n\n");
+					fprintf(output, "\t\t// the slots still in flight stay unmapped\n");
+					fprintf(output, "\t\tring->mapped = (uint8_t *)%s_buffer_lock(&ring->buffer, first, slots);\n", type_name);
+					fprintf(output, "\t\tring->mapped_start = ring->allocated;\n");
+					fprintf(output, "\t\tring->mapped_end = ring->allocated + slots;\n");
+					fprintf(output, "\t}\n\n");
+					fprintf(output, "\tif (ring->allocated == ring->mapped_end) {\n");
+					fprintf(output, "\t\treturn NULL;\n");
+					fprintf(output, "\t}\n\n");
+					fprintf(output, "\tuint32_t stride = (uint32_t)align_pow2((int)sizeof(%s), 256);\n", type_name);
+					fprintf(output, "\t%s *data = (%s *)(ring->mapped + (ring->allocated - ring->mapped_start) * stride);\n", type_name, type_name);
+					fprintf(output, "\t*offset = (uint32_t)(ring->allocated %% ring->count) * stride;\n");
+					fprintf(output, "\tring->allocated += 1;\n");
+					fprintf(output, "\treturn data;\n");
+					fprintf(output, "}\n\n");
+
+					fprintf(output, "void %s_ring_flush(%s_ring *ring) {\n", type_name, type_name);
+					fprintf(output, "\tif (ring->mapped == NULL) {\n");
+					fprintf(output, "\t\treturn;\n");
+					fprintf(output, "\t}\n\n");
+					if (has_matrices) {
+						fprintf(output, "\tuint32_t stride = (uint32_t)align_pow2((int)sizeof(%s), 256);\n", type_name);
+						fprintf(output, "\tfor (uint64_t slot = ring->mapped_start; slot < ring->allocated; ++slot) {\n");
+						fprintf(output, "\t\t%s_convert_matrices((%s *)(ring->mapped + (slot - ring->mapped_start) * stride));\n", type_name, type_name);
+						fprintf(output, "\t}\n");
+					}
+					fprintf(output, "\tkore_gpu_buffer_unlock(&ring->buffer);\n");
+					fprintf(output, "\tring->mapped = NULL;\n");
+					fprintf(output, "}\n\n");
 				}
 			}
 		}
@@ -1536,14 +3028,14 @@ void kore3_export(char *directory, api_kind api) {
 					fprintf(output,
 					        "\tkore_%s_command_list_set_root_constants(list, %s_vertex_table_index, %s_fragment_table_index, %s_compute_table_index, "
 					        "constants, %i);\n",
-					        api_short, get_name(set->name), get_name(set->name), get_name(set->name), struct_size(root_constants_global->type));
+					        api_short, get_name(set->name), get_name(set->name), get_name(set->name), global_struct_size(root_constants_global, api));
 				}
 				else if (api == API_VULKAN) {
-					fprintf(output, "\tkore_%s_command_list_set_root_constants(list, constants, %i);\n", api_short, struct_size(root_constants_global->type));
+					fprintf(output, "\tkore_%s_command_list_set_root_constants(list, constants, %i);\n", api_short, global_struct_size(root_constants_global, api));
 				}
 				else {
 					fprintf(output, "\tkore_%s_command_list_set_root_constants(list, %s_table_index, constants, %i);\n", api_short, get_name(set->name),
-					        struct_size(root_constants_global->type));
+					        global_struct_size(root_constants_global, api));
 				}
 				fprintf(output, "}\n\n");
 
@@ -1810,7 +3302,7 @@ void kore3_export(char *directory, api_kind api) {
 			        if (!get_type(g->type)->built_in) {
 			            if (has_attribute(&g->attributes, add_name("indexed"))) {
 			                fprintf(output, "\tkore_%s_descriptor_set_set_dynamic_uniform_buffer_descriptor(device, &set->set, parameters->%s, %u, %zu);\n",
-			                        api_short, get_name(g->name), struct_size(g->type), other_index);
+			                        api_short, get_name(g->name), global_struct_size(g, api), other_index);
 			            }
 			            else {
 			                fprintf(output, "\tkore_%s_descriptor_set_set_uniform_buffer_descriptor(device, &set->set, parameters->%s, %zu);\n", api_short,
@@ -1944,7 +3436,7 @@ void kore3_export(char *directory, api_kind api) {
 			            fprintf(output, "\t\t\t.binding = %zu,\n", index);
 			            fprintf(output, "\t\t\t.buffer  = parameters->%s->webgpu.buffer,\n", get_name(g->name));
 			            fprintf(output, "\t\t\t.offset  = 0,\n");
-			            fprintf(output, "\t\t\t.size    = align_pow2(%u, 256),\n", struct_size(g->type));
+			            fprintf(output, "\t\t\t.size    = align_pow2(%u, 256),\n", global_struct_size(g, api));
 			            fprintf(output, "\t\t},\n");
 
 			            index += 1;
@@ -1996,6 +3488,7 @@ void kore3_export(char *directory, api_kind api) {
 
 			fprintf(output, "void kong_create_%s_set(kore_gpu_device *device, const %s_parameters *parameters, %s_set *set) {\n", get_name(set->name),
 			        get_name(set->name), get_name(set->name));
+			fprintf(output, "\tset->version = 0;\n\n");
 
 			if (api == API_DIRECT3D12) {
 				size_t other_count    = 0;
@@ -2240,7 +3733,7 @@ void kore3_export(char *directory, api_kind api) {
 					if (!get_type(g->type)->built_in) {
 						if (has_attribute(&g->attributes, add_name("indexed"))) {
 							fprintf(output, "\tkore_%s_descriptor_set_set_dynamic_uniform_buffer_descriptor(device, &set->set, parameters->%s, %u, %zu);\n",
-							        api_short, get_name(g->name), struct_size(g->type), other_index);
+							        api_short, get_name(g->name), global_struct_size(g, api), other_index);
 						}
 						else {
 							fprintf(output, "\tkore_%s_descriptor_set_set_uniform_buffer_descriptor(device, &set->set, parameters->%s, %zu);\n", api_short,
@@ -2375,7 +3868,7 @@ void kore3_export(char *directory, api_kind api) {
 						fprintf(output, "\t\t\t.binding = %zu,\n", index);
 						fprintf(output, "\t\t\t.buffer  = parameters->%s->webgpu.buffer,\n", get_name(g->name));
 						fprintf(output, "\t\t\t.offset  = 0,\n");
-						fprintf(output, "\t\t\t.size    = align_pow2(%u, 256),\n", struct_size(g->type));
+						fprintf(output, "\t\t\t.size    = align_pow2(%u, 256),\n", global_struct_size(g, api));
 						fprintf(output, "\t\t},\n");
 
 						index += 1;
@@ -2686,15 +4179,41 @@ void kore3_export(char *directory, api_kind api) {
 				fprintf(output, "\t}\n");
 			}
 
+			fprintf(output, "\n\tset->version += 1;\n");
+
 			fprintf(output, "}\n\n");
 
-			fprintf(output, "void kong_set_descriptor_set_%s(kore_gpu_command_list *list, %s_set *set", get_name(set->name), get_name(set->name));
+			// handles index the descriptor heap through the allocation the set currently uses
+			for (size_t global_index = 0; global_index < set->globals.size; ++global_index) {
+				global *g = get_global(set->globals.globals[global_index]);
+				if (global_is_bindless(g)) {
+					fprintf(output, "uint32_t kong_%s_%s_handle(const %s_set *set, uint32_t index) {\n", get_name(set->name), get_name(g->name),
+					        get_name(set->name));
+					fprintf(output, "\tassert(index < set->%s_count);\n", get_name(g->name));
+					fprintf(output, "\treturn set->set.allocations[set->set.current_allocation_index].bindless_descriptor_allocation.offset + index;\n");
+					fprintf(output, "}\n\n");
+
+					fprintf(output, "void kong_prepare_%s_%s(kore_gpu_command_list *list, %s_set *set) {\n", get_name(set->name), get_name(g->name),
+					        get_name(set->name));
+					write_texture_array_prepare(output, api_short, g);
+					fprintf(output, "}\n\n");
+				}
+			}
+
+			bool indexed = has_indexed_globals(set);
+
+			if (indexed) {
+				fprintf(output, "void kong_set_descriptor_set_%s_offsets(kore_gpu_command_list *list, %s_set *set", get_name(set->name), get_name(set->name));
+			}
+			else {
+				fprintf(output, "void kong_set_descriptor_set_%s(kore_gpu_command_list *list, %s_set *set", get_name(set->name), get_name(set->name));
+			}
 			for (size_t global_index = 0; global_index < set->globals.size; ++global_index) {
 				global *g = get_global(set->globals.globals[global_index]);
 
 				if (!get_type(g->type)->built_in) {
 					if (has_attribute(&g->attributes, add_name("indexed"))) {
-						fprintf(output, ", uint32_t %s_index", get_name(g->name));
+						fprintf(output, ", uint32_t %s_offset", get_name(g->name));
 					}
 				}
 			}
@@ -2707,10 +4226,8 @@ void kore3_export(char *directory, api_kind api) {
 
 					if (!get_type(g->type)->built_in) {
 						if (has_attribute(&g->attributes, add_name("indexed"))) {
-							fprintf(output,
-							        "\tkore_%s_descriptor_set_prepare_cbv_buffer(list, set->%s, %s_index * align_pow2((int)%i, 256), "
-							        "align_pow2((int)%i, 256));\n",
-							        api_short, get_name(g->name), get_name(g->name), struct_size(g->type), struct_size(g->type));
+							fprintf(output, "\tkore_%s_descriptor_set_prepare_cbv_buffer(list, set->%s, %s_offset, align_pow2((int)%i, 256));\n", api_short,
+							        get_name(g->name), get_name(g->name), global_struct_size(g, api));
 						}
 						else {
 							fprintf(output, "\tkore_%s_descriptor_set_prepare_cbv_buffer(list, set->%s, 0, UINT32_MAX);\n", api_short, get_name(g->name));
@@ -2718,10 +4235,11 @@ void kore3_export(char *directory, api_kind api) {
 					}
 					else if (is_texture(g->type)) {
 						type *t = get_type(g->type);
-						if (t->array_size == UINT32_MAX) {
-							fprintf(output, "\tfor (size_t index = 0; index < set->%s_count; ++index) {\n", get_name(g->name));
-							fprintf(output, "\t\tkore_%s_descriptor_set_prepare_srv_texture(list, &set->%s[index]);\n", api_short, get_name(g->name));
-							fprintf(output, "\t}\n");
+						if (global_is_bindless(g)) {
+							// prepared by kong_prepare_<set>_<global> instead, binding stays independent of the array size
+						}
+						else if (t->array_size == UINT32_MAX) {
+							write_texture_array_prepare(output, api_short, g);
 						}
 						else {
 							if (writable) {
@@ -2734,10 +4252,8 @@ void kore3_export(char *directory, api_kind api) {
 					}
 					else if (!is_sampler(g->type) && g->type != bvh_type_id) {
 						if (has_attribute(&g->attributes, add_name("indexed"))) {
-							fprintf(output,
-							        "\tkore_%s_descriptor_set_prepare_cbv_buffer(list, set->%s, %s_index * align_pow2((int)%i, 256), "
-							        "align_pow2((int)%i, 256));\n",
-							        api_short, get_name(g->name), get_name(g->name), struct_size(g->type), struct_size(g->type));
+							fprintf(output, "\tkore_%s_descriptor_set_prepare_cbv_buffer(list, set->%s, %s_offset, align_pow2((int)%i, 256));\n", api_short,
+							        get_name(g->name), get_name(g->name), global_struct_size(g, api));
 						}
 						else {
 							fprintf(output, "\tkore_%s_descriptor_set_prepare_uav_buffer(list, set->%s, 0, UINT32_MAX);\n", api_short, get_name(g->name));
@@ -2755,10 +4271,8 @@ void kore3_export(char *directory, api_kind api) {
 
 					if (!get_type(g->type)->built_in) {
 						if (has_attribute(&g->attributes, add_name("indexed"))) {
-							fprintf(output,
-							        "\tkore_%s_descriptor_set_prepare_buffer(list, set->%s, %s_index * align_pow2((int)%i, 256), "
-							        "align_pow2((int)%i, 256));\n",
-							        api_short, get_name(g->name), get_name(g->name), struct_size(g->type), struct_size(g->type));
+							fprintf(output, "\tkore_%s_descriptor_set_prepare_buffer(list, set->%s, %s_offset, align_pow2((int)%i, 256));\n", api_short,
+							        get_name(g->name), get_name(g->name), global_struct_size(g, api));
 						}
 						else {
 							fprintf(output, "\tkore_%s_descriptor_set_prepare_buffer(list, set->%s, 0, UINT32_MAX);\n", api_short, get_name(g->name));
@@ -2767,9 +4281,7 @@ void kore3_export(char *directory, api_kind api) {
 					else if (is_texture(g->type)) {
 						type *t = get_type(g->type);
 						if (t->array_size == UINT32_MAX) {
-							fprintf(output, "\tfor (size_t index = 0; index < set->%s_count; ++index) {\n", get_name(g->name));
-							fprintf(output, "\t\tkore_%s_descriptor_set_prepare_srv_texture(list, &set->%s[index]);\n", api_short, get_name(g->name));
-							fprintf(output, "\t}\n");
+							write_texture_array_prepare(output, api_short, g);
 						}
 						else {
 							if (writable) {
@@ -2782,10 +4294,8 @@ void kore3_export(char *directory, api_kind api) {
 					}
 					else if (!is_sampler(g->type) && g->type != bvh_type_id) {
 						if (has_attribute(&g->attributes, add_name("indexed"))) {
-							fprintf(output,
-							        "\tkore_%s_descriptor_set_prepare_cbv_buffer(list, set->%s, %s_index * align_pow2((int)%i, 256), "
-							        "align_pow2((int)%i, 256));\n",
-							        api_short, get_name(g->name), get_name(g->name), struct_size(g->type), struct_size(g->type));
+							fprintf(output, "\tkore_%s_descriptor_set_prepare_cbv_buffer(list, set->%s, %s_offset, align_pow2((int)%i, 256));\n", api_short,
+							        get_name(g->name), get_name(g->name), global_struct_size(g, api));
 						}
 						else {
 							fprintf(output, "\tkore_%s_descriptor_set_prepare_uav_buffer(list, set->%s, 0, UINT32_MAX);\n", api_short, get_name(g->name));
@@ -2800,10 +4310,8 @@ void kore3_export(char *directory, api_kind api) {
 
 					if (!get_type(g->type)->built_in) {
 						if (has_attribute(&g->attributes, add_name("indexed"))) {
-							fprintf(output,
-							        "\tkore_%s_descriptor_set_prepare_buffer(list, set->%s, %s_index * align_pow2((int)%i, 256), "
-							        "align_pow2((int)%i, 256));\n",
-							        api_short, get_name(g->name), get_name(g->name), struct_size(g->type), struct_size(g->type));
+							fprintf(output, "\tkore_%s_descriptor_set_prepare_buffer(list, set->%s, %s_offset, align_pow2((int)%i, 256));\n", api_short,
+							        get_name(g->name), get_name(g->name), global_struct_size(g, api));
 						}
 						else {
 							fprintf(output, "\tkore_%s_descriptor_set_prepare_buffer(list, set->%s, 0, UINT32_MAX);\n", api_short, get_name(g->name));
@@ -2812,9 +4320,7 @@ void kore3_export(char *directory, api_kind api) {
 					else if (is_texture(g->type)) {
 						type *t = get_type(g->type);
 						if (t->array_size == UINT32_MAX) {
-							fprintf(output, "\tfor (size_t index = 0; index < set->%s_count; ++index) {\n", get_name(g->name));
-							fprintf(output, "\t\tkore_%s_descriptor_set_prepare_srv_texture(list, &set->%s[index]);\n", api_short, get_name(g->name));
-							fprintf(output, "\t}\n");
+							write_texture_array_prepare(output, api_short, g);
 						}
 						else {
 							if (writable) {
@@ -2853,24 +4359,21 @@ void kore3_export(char *directory, api_kind api) {
 					if (!get_type(g->type)->built_in) {
 						if (has_attribute(&g->attributes, add_name("indexed"))) {
 							fprintf(output,
-							        "\tkore_opengl_command_list_set_uniform_buffer(list, set->%s, _%" PRIu64
-							        "_uniform_block_index, %s_index * align_pow2((int)%i, 256), "
+							        "\tkore_opengl_command_list_set_uniform_buffer(list, set->%s, _%" PRIu64 "_uniform_block_index, %s_offset, "
 							        "align_pow2((int)%i, 256));\n",
-							        get_name(g->name), g->var_index, get_name(g->name), struct_size(g->type), struct_size(g->type));
+							        get_name(g->name), g->var_index, get_name(g->name), global_struct_size(g, api));
 						}
 						else {
 							fprintf(output,
 							        "\tkore_opengl_command_list_set_uniform_buffer(list, set->%s, _%" PRIu64
 							        "_uniform_block_index, 0, align_pow2((int)%i, 256));\n",
-							        get_name(g->name), g->var_index, struct_size(g->type));
+							        get_name(g->name), g->var_index, global_struct_size(g, api));
 						}
 					}
 					else if (is_texture(g->type)) {
 						type *t = get_type(g->type);
 						if (t->array_size == UINT32_MAX) {
-							fprintf(output, "\tfor (size_t index = 0; index < set->%s_count; ++index) {\n", get_name(g->name));
-							fprintf(output, "\t\tkore_%s_descriptor_set_prepare_srv_texture(list, &set->%s[index]);\n", api_short, get_name(g->name));
-							fprintf(output, "\t}\n");
+							write_texture_array_prepare(output, api_short, g);
 						}
 						else {
 							if (writable) {
@@ -2923,9 +4426,8 @@ void kore3_export(char *directory, api_kind api) {
 						if (!get_type(g->type)->built_in) {
 							if (has_attribute(&g->attributes, add_name("indexed"))) {
 								fprintf(output, "\tdynamic_buffers[%i] = set->%s;\n", dynamic_index, get_name(g->name));
-								fprintf(output, "\tdynamic_offsets[%i] = %s_index * align_pow2((int)%i, 256);\n", dynamic_index, get_name(g->name),
-								        struct_size(g->type));
-								fprintf(output, "\tdynamic_sizes[%i] = align_pow2((int)%i, 256);\n", dynamic_index, struct_size(g->type));
+								fprintf(output, "\tdynamic_offsets[%i] = %s_offset;\n", dynamic_index, get_name(g->name));
+								fprintf(output, "\tdynamic_sizes[%i] = align_pow2((int)%i, 256);\n", dynamic_index, global_struct_size(g, api));
 								dynamic_index += 1;
 							}
 						}
@@ -2977,6 +4479,63 @@ void kore3_export(char *directory, api_kind api) {
 				}
 				fprintf(output, "}\n\n");
 			}
+
+			if (indexed) {
+				fprintf(output, "void kong_set_descriptor_set_%s(kore_gpu_command_list *list, %s_set *set", get_name(set->name), get_name(set->name));
+				for (size_t global_index = 0; global_index < set->globals.size; ++global_index) {
+					global *g = get_global(set->globals.globals[global_index]);
+					if (!get_type(g->type)->built_in && has_attribute(&g->attributes, add_name("indexed"))) {
+						fprintf(output, ", uint32_t %s_index", get_name(g->name));
+					}
+				}
+				fprintf(output, ") {\n");
+				fprintf(output, "\tkong_set_descriptor_set_%s_offsets(list, set", get_name(set->name));
+				for (size_t global_index = 0; global_index < set->globals.size; ++global_index) {
+					global *g = get_global(set->globals.globals[global_index]);
+					if (!get_type(g->type)->built_in && has_attribute(&g->attributes, add_name("indexed"))) {
+						fprintf(output, ", %s_index * align_pow2((int)%i, 256)", get_name(g->name), global_struct_size(g, api));
+					}
+				}
+				fprintf(output, ");\n");
+				fprintf(output, "}\n\n");
+			}
+
+			fprintf(output, "void kong_set_descriptor_set_%s_cached(kong_descriptor_cache *cache, kore_gpu_command_list *list, %s_set *set",
+			        get_name(set->name), get_name(set->name));
+			for (size_t global_index = 0; global_index < set->globals.size; ++global_index) {
+				global *g = get_global(set->globals.globals[global_index]);
+				if (!get_type(g->type)->built_in && has_attribute(&g->attributes, add_name("indexed"))) {
+					fprintf(output, ", uint32_t %s_offset", get_name(g->name));
+				}
+			}
+			fprintf(output, ") {\n");
+			fprintf(output, "\tif (cache->%s == set && cache->%s_version == set->version", get_name(set->name), get_name(set->name));
+			for (size_t global_index = 0; global_index < set->globals.size; ++global_index) {
+				global *g = get_global(set->globals.globals[global_index]);
+				if (!get_type(g->type)->built_in && has_attribute(&g->attributes, add_name("indexed"))) {
+					fprintf(output, " && cache->%s_%s_offset == %s_offset", get_name(set->name), get_name(g->name), get_name(g->name));
+				}
+			}
+			fprintf(output, ") {\n");
+			fprintf(output, "\t\treturn;\n");
+			fprintf(output, "\t}\n\n");
+			fprintf(output, "\tcache->%s = set;\n", get_name(set->name));
+			fprintf(output, "\tcache->%s_version = set->version;\n", get_name(set->name));
+			for (size_t global_index = 0; global_index < set->globals.size; ++global_index) {
+				global *g = get_global(set->globals.globals[global_index]);
+				if (!get_type(g->type)->built_in && has_attribute(&g->attributes, add_name("indexed"))) {
+					fprintf(output, "\tcache->%s_%s_offset = %s_offset;\n", get_name(set->name), get_name(g->name), get_name(g->name));
+				}
+			}
+			fprintf(output, "\n\tkong_set_descriptor_set_%s%s(list, set", get_name(set->name), indexed ? "_offsets" : "");
+			for (size_t global_index = 0; global_index < set->globals.size; ++global_index) {
+				global *g = get_global(set->globals.globals[global_index]);
+				if (!get_type(g->type)->built_in && has_attribute(&g->attributes, add_name("indexed"))) {
+					fprintf(output, ", %s_offset", get_name(g->name));
+				}
+			}
+			fprintf(output, ");\n");
+			fprintf(output, "}\n\n");
 		}
 
 		if (api != API_METAL && api != API_OPENGL) {
@@ -2997,8 +4556,21 @@ void kore3_export(char *directory, api_kind api) {
 		for (function_id i = 0; get_function(i) != NULL; ++i) {
 			function *f = get_function(i);
 			if (has_attribute(&f->attributes, add_name("compute"))) {
-				fprintf(output, "static kore_%s_compute_pipeline %s;\n", api_short, get_name(f->name));
-				fprintf(output, "void kong_set_compute_shader_%s(kore_gpu_command_list *list) {\n", get_name(f->name));
+				for (size_t pipeline_index = 0; pipeline_index < pipelines_count; ++pipeline_index) {
+					if (pipelines[pipeline_index].compute == f) {
+						fprintf(output, "static kore_%s_compute_pipeline %s;\n", api_short, get_name(pipelines[pipeline_index].name));
+					}
+				}
+
+				if (permutations_count() > 1) {
+					write_permutation_pipelines(output, NULL, f);
+				}
+
+				char object_type[256];
+				sprintf(object_type, "kore_%s_compute_pipeline", api_short);
+
+				fprintf(output, "void kong_set_compute_shader_%s(kore_gpu_command_list *list%s) {\n", get_name(f->name), permutation_parameter());
+				write_pipeline_selection(output, object_type, NULL, f);
 				if (api == API_METAL) {
 					attribute *threads_attribute = find_attribute(&f->attributes, add_name("threads"));
 					if (threads_attribute == NULL || threads_attribute->paramters_count != 3) {
@@ -3006,11 +4578,11 @@ void kore3_export(char *directory, api_kind api) {
 						error(context, "Compute function requires a threads attribute with three parameters");
 					}
 
-					fprintf(output, "\tkore_%s_command_list_set_compute_pipeline(list, &%s, %u, %u, %u);\n", api_short, get_name(f->name),
+					fprintf(output, "\tkore_%s_command_list_set_compute_pipeline(list, %s, %u, %u, %u);\n", api_short, pipeline_object_reference(f->name),
 					        (uint32_t)threads_attribute->parameters[0], (uint32_t)threads_attribute->parameters[1], (uint32_t)threads_attribute->parameters[2]);
 				}
 				else {
-					fprintf(output, "\tkore_%s_command_list_set_compute_pipeline(list, &%s);\n", api_short, get_name(f->name));
+					fprintf(output, "\tkore_%s_command_list_set_compute_pipeline(list, %s);\n", api_short, pipeline_object_reference(f->name));
 				}
 
 				descriptor_set_group *group = find_descriptor_set_group_for_function(f);
@@ -3038,6 +4610,41 @@ void kore3_export(char *directory, api_kind api) {
 			}
 		}
 
+		for (type_id i = 0; get_type(i) != NULL; ++i) {
+			type *t = get_type(i);
+			if (!t->built_in && has_attribute(&t->attributes, add_name("pipe"))) {
+				if (indirect_args_used(draw_indirect_args_type_id)) {
+					fprintf(output, "void kong_draw_indirect_%s(kore_gpu_command_list *list%s, kore_gpu_buffer *args, uint32_t index, uint32_t count) {\n",
+					        get_name(t->name), permutation_parameter());
+					fprintf(output, "\tkong_set_render_pipeline_%s(list%s);\n", get_name(t->name), permutation_argument());
+					fprintf(output, "\tkore_gpu_command_list_draw_indirect(list, args, index * sizeof(draw_indirect_args), count, NULL, 0);\n");
+					fprintf(output, "}\n\n");
+				}
+				if (indirect_args_used(draw_indexed_indirect_args_type_id)) {
+					fprintf(output,
+					        "void kong_draw_indexed_indirect_%s(kore_gpu_command_list *list%s, kore_gpu_buffer *args, uint32_t index, uint32_t count) {\n",
+					        get_name(t->name), permutation_parameter());
+					fprintf(output, "\tkong_set_render_pipeline_%s(list%s);\n", get_name(t->name), permutation_argument());
+					fprintf(output,
+					        "\tkore_gpu_command_list_draw_indexed_indirect(list, args, index * sizeof(draw_indexed_indirect_args), count, NULL, 0);\n");
+					fprintf(output, "}\n\n");
+				}
+			}
+		}
+
+		if (indirect_args_used(dispatch_indirect_args_type_id)) {
+			for (function_id i = 0; get_function(i) != NULL; ++i) {
+				function *f = get_function(i);
+				if (has_attribute(&f->attributes, add_name("compute"))) {
+					fprintf(output, "void kong_dispatch_indirect_%s(kore_gpu_command_list *list%s, kore_gpu_buffer *args, uint32_t index) {\n",
+					        get_name(f->name), permutation_parameter());
+					fprintf(output, "\tkong_set_compute_shader_%s(list%s);\n", get_name(f->name), permutation_argument());
+					fprintf(output, "\tkore_gpu_command_list_compute_indirect(list, args, index * sizeof(dispatch_indirect_args));\n");
+					fprintf(output, "}\n\n");
+				}
+			}
+		}
+
 		if (api == API_OPENGL) {
 			fprintf(output, "\nuint32_t kore_opengl_find_uniform_block_index(unsigned program, const char *name);\n");
 		}
@@ -3060,18 +4667,25 @@ void kore3_export(char *directory, api_kind api) {
 			fprintf(output, "\nvoid create_bind_group_layouts(kore_gpu_device *device);\n");
 		}
 
-		fprintf(output, "\nvoid kong_init(kore_gpu_device *device) {\n");
+		fprintf(output, "\nstatic kore_gpu_device *kong_device = NULL;\n\n");
 
-		if (api == API_VULKAN) {
-			fprintf(output, "\tcreate_descriptor_set_layouts(device);\n\n");
-		}
-		else if (api == API_WEBGPU) {
-			fprintf(output, "\tcreate_bind_group_layouts(device);\n\n");
-		}
+		fprintf(output, "static uint64_t kong_hash_bytes(uint64_t hash, const void *data, size_t size) {\n");
+		fprintf(output, "\tconst uint8_t *bytes = (const uint8_t *)data;\n");
+		fprintf(output, "\tfor (size_t index = 0; index < size; ++index) {\n");
+		fprintf(output, "\t\thash ^= bytes[index];\n");
+		fprintf(output, "\t\thash *= 0x100000001b3ull;\n");
+		fprintf(output, "\t}\n");
+		fprintf(output, "\treturn hash;\n");
+		fprintf(output, "}\n\n");
 
-		for (type_id i = 0; get_type(i) != NULL; ++i) {
-			type *t = get_type(i);
-			if (!t->built_in && has_attribute(&t->attributes, add_name("pipe"))) {
+		for (size_t pipeline_index = 0; pipeline_index < pipelines_count; ++pipeline_index) {
+			type *t = pipelines[pipeline_index].pipe;
+			if (t != NULL) {
+				name_id  pipeline    = pipelines[pipeline_index].name;
+				uint32_t permutation = pipelines[pipeline_index].permutation;
+
+				fprintf(output, "static void kong_create_%s_pipeline(void) {\n", get_name(pipeline));
+				fprintf(output, "\tkore_gpu_device *device = kong_device;\n\n");
 				fprintf(output, "\tkore_%s_render_pipeline_parameters %s_parameters = KONG_INIT_ZERO;\n\n", api_short, get_name(t->name));
 
 				name_id vertex_shader_name        = NO_NAME;
@@ -3088,6 +4702,7 @@ void kore3_export(char *directory, api_kind api) {
 
 				for (size_t j = 0; j < t->members.size; ++j) {
 					if (t->members.m[j].name == add_name("vertex")) {
+						name_id code = shader_code_name(t->members.m[j].value.identifier, permutation);
 						if (api == API_KOMPJUTA) {
 							fprintf(output, "\t%s_parameters.vertex.shader.function = vs_%s;\n", get_name(t->name), get_name(t->members.m[j].value.identifier));
 						}
@@ -3099,20 +4714,15 @@ void kore3_export(char *directory, api_kind api) {
 							fprintf(output,
 							        "\t%s_parameters.vertex.shader.data = kore_webgpu_prepare_shader(device, %s_code, %s_code_size, "
 							        "%s_code_uses_framebuffer_texture_format);\n",
-							        get_name(t->name), get_name(t->members.m[j].value.identifier), get_name(t->members.m[j].value.identifier),
-							        get_name(t->members.m[j].value.identifier));
-							fprintf(output, "\t%s_parameters.vertex.shader.size = %s_code_size;\n\n", get_name(t->name),
-							        get_name(t->members.m[j].value.identifier));
+							        get_name(t->name), get_name(code), get_name(code), get_name(code));
+							fprintf(output, "\t%s_parameters.vertex.shader.size = %s_code_size;\n\n", get_name(t->name), get_name(code));
 						}
 						else {
-							fprintf(output, "\t%s_parameters.vertex.shader.data = %s_code;\n", get_name(t->name), get_name(t->members.m[j].value.identifier));
-							fprintf(output, "\t%s_parameters.vertex.shader.size = %s_code_size;\n\n", get_name(t->name),
-							        get_name(t->members.m[j].value.identifier));
+							fprintf(output, "\t%s_parameters.vertex.shader.data = %s_code;\n", get_name(t->name), get_name(code));
+							fprintf(output, "\t%s_parameters.vertex.shader.size = %s_code_size;\n\n", get_name(t->name), get_name(code));
 							if (api == API_OPENGL) {
-								fprintf(output, "\t%s_parameters.vertex.shader.flip_data = %s_flip_code;\n", get_name(t->name),
-								        get_name(t->members.m[j].value.identifier));
-								fprintf(output, "\t%s_parameters.vertex.shader.flip_size = %s_flip_code_size;\n\n", get_name(t->name),
-								        get_name(t->members.m[j].value.identifier));
+								fprintf(output, "\t%s_parameters.vertex.shader.flip_data = %s_flip_code;\n", get_name(t->name), get_name(code));
+								fprintf(output, "\t%s_parameters.vertex.shader.flip_size = %s_flip_code_size;\n\n", get_name(t->name), get_name(code));
 							}
 						}
 						vertex_shader_name = t->members.m[j].value.identifier;
@@ -3124,6 +4734,7 @@ void kore3_export(char *directory, api_kind api) {
 						mesh_shader_name = t->members.m[j].value.identifier;
 					}
 					else if (t->members.m[j].name == add_name("fragment")) {
+						name_id code = shader_code_name(t->members.m[j].value.identifier, permutation);
 						if (api == API_KOMPJUTA) {
 							fprintf(output, "\t%s_parameters.fragment.shader.function = fs_%s;\n", get_name(t->name),
 							        get_name(t->members.m[j].value.identifier));
@@ -3136,15 +4747,12 @@ void kore3_export(char *directory, api_kind api) {
 							fprintf(output,
 							        "\t%s_parameters.fragment.shader.data = kore_webgpu_prepare_shader(device, %s_code, %s_code_size, "
 							        "%s_code_uses_framebuffer_texture_format);\n",
-							        get_name(t->name), get_name(t->members.m[j].value.identifier), get_name(t->members.m[j].value.identifier),
-							        get_name(t->members.m[j].value.identifier));
-							fprintf(output, "\t%s_parameters.fragment.shader.size = %s_code_size;\n\n", get_name(t->name),
-							        get_name(t->members.m[j].value.identifier));
+							        get_name(t->name), get_name(code), get_name(code), get_name(code));
+							fprintf(output, "\t%s_parameters.fragment.shader.size = %s_code_size;\n\n", get_name(t->name), get_name(code));
 						}
 						else {
-							fprintf(output, "\t%s_parameters.fragment.shader.data = %s_code;\n", get_name(t->name), get_name(t->members.m[j].value.identifier));
-							fprintf(output, "\t%s_parameters.fragment.shader.size = %s_code_size;\n\n", get_name(t->name),
-							        get_name(t->members.m[j].value.identifier));
+							fprintf(output, "\t%s_parameters.fragment.shader.data = %s_code;\n", get_name(t->name), get_name(code));
+							fprintf(output, "\t%s_parameters.fragment.shader.size = %s_code_size;\n\n", get_name(t->name), get_name(code));
 							if (api == API_OPENGL) {
 								fprintf(output, "\t%s_parameters.fragment.shader.flip_data = NULL;\n", get_name(t->name));
 								fprintf(output, "\t%s_parameters.fragment.shader.flip_size = 0;\n\n", get_name(t->name));
@@ -3261,7 +4869,7 @@ void kore3_export(char *directory, api_kind api) {
 
 						for (size_t j = 0; j < vertex_type->members.size; ++j) {
 							fprintf(output, "\t%s_parameters.vertex.buffers[%zu].attributes[%zu].format = %s;\n", get_name(t->name), input_index, j,
-							        structure_type(vertex_type->members.m[j].type.type, api));
+							        vertex_member_format(&vertex_type->members.m[j], api, api_caps));
 							fprintf(output, "\t%s_parameters.vertex.buffers[%zu].attributes[%zu].offset = %zu;\n", get_name(t->name), input_index, j, offset);
 							if (api == API_OPENGL) {
 								fprintf(output, "\t%s_parameters.vertex.buffers[%zu].attributes[%zu].name = \"%s_%s\";\n", get_name(t->name), input_index, j,
@@ -3272,12 +4880,13 @@ void kore3_export(char *directory, api_kind api) {
 								        j, location);
 							}
 
-							offset += base_type_size(vertex_type->members.m[j].type.type);
+							offset += vertex_member_size(&vertex_type->members.m[j]);
 							location += 1;
 						}
 						fprintf(output, "\t%s_parameters.vertex.buffers[%zu].attributes_count = %zu;\n", get_name(t->name), input_index,
 						        vertex_type->members.size);
-						fprintf(output, "\t%s_parameters.vertex.buffers[%zu].array_stride = %zu;\n", get_name(t->name), input_index, offset);
+						fprintf(output, "\t%s_parameters.vertex.buffers[%zu].array_stride = %u;\n", get_name(t->name), input_index,
+						        vertex_stride(vertex_type));
 
 						char step_mode[64];
 						if (instanced[input_index]) {
@@ -3445,7 +5054,7 @@ void kore3_export(char *directory, api_kind api) {
 
 					if (group->size == 0) {
 						fprintf(output, "\t\tkore_%s_render_pipeline_init(&device->%s, &%s, &%s_parameters, NULL, 0, 0);\n", api_short, api_short,
-						        get_name(t->name), get_name(t->name));
+						        get_name(pipeline), get_name(t->name));
 					}
 					else {
 						size_t root_constants_size = 0;
@@ -3464,7 +5073,7 @@ void kore3_export(char *directory, api_kind api) {
 							if (group->values[i]->name == add_name("root_constants")) {
 								for (size_t global_index = 0; global_index < group->values[i]->globals.size; ++global_index) {
 									global *g = get_global(group->values[i]->globals.globals[global_index]);
-									root_constants_size += struct_size(g->type);
+									root_constants_size += global_struct_size(g, api);
 								}
 
 								continue;
@@ -3475,7 +5084,7 @@ void kore3_export(char *directory, api_kind api) {
 						}
 
 						fprintf(output, "\t\tkore_%s_render_pipeline_init(&device->%s, &%s, &%s_parameters, layouts, %zu, %zu);\n", api_short, api_short,
-						        get_name(t->name), get_name(t->name), group_size, root_constants_size);
+						        get_name(pipeline), get_name(t->name), group_size, root_constants_size);
 					}
 
 					fprintf(output, "\t}\n");
@@ -3486,7 +5095,7 @@ void kore3_export(char *directory, api_kind api) {
 					fprintf(output, "\t{\n");
 
 					if (group->size == 0) {
-						fprintf(output, "\t\tkore_webgpu_render_pipeline_init(&device->webgpu, &%s, &%s_parameters, NULL, 0);\n", get_name(t->name),
+						fprintf(output, "\t\tkore_webgpu_render_pipeline_init(&device->webgpu, &%s, &%s_parameters, NULL, 0);\n", get_name(pipeline),
 						        get_name(t->name));
 					}
 					else {
@@ -3497,14 +5106,14 @@ void kore3_export(char *directory, api_kind api) {
 							fprintf(output, "\t\tlayouts[%zu] = %s_set_layout;\n", layout_index, get_name(group->values[layout_index]->name));
 						}
 
-						fprintf(output, "\t\tkore_webgpu_render_pipeline_init(&device->webgpu, &%s, &%s_parameters, layouts, %zu);\n", get_name(t->name),
+						fprintf(output, "\t\tkore_webgpu_render_pipeline_init(&device->webgpu, &%s, &%s_parameters, layouts, %zu);\n", get_name(pipeline),
 						        get_name(t->name), group->size);
 					}
 
 					fprintf(output, "\t}\n");
 				}
 				else {
-					fprintf(output, "\tkore_%s_render_pipeline_init(&device->%s, &%s, &%s_parameters);\n\n", api_short, api_short, get_name(t->name),
+					fprintf(output, "\tkore_%s_render_pipeline_init(&device->%s, &%s, &%s_parameters);\n\n", api_short, api_short, get_name(pipeline),
 					        get_name(t->name));
 				}
 
@@ -3524,16 +5133,26 @@ void kore3_export(char *directory, api_kind api) {
 						}
 						else {
 							fprintf(output, "\t%s_%" PRIu64 "_uniform_block_index = kore_opengl_find_uniform_block_index(%s.program, \"_%" PRIu64 "\");\n\n",
-							        get_name(t->name), g->var_index, get_name(t->name), g->var_index);
+							        get_name(pipeline), g->var_index, get_name(pipeline), g->var_index);
 						}
 					}
 				}
+
+				fprintf(output, "}\n\n");
+
+				name_id shaders[] = {shader_code_name(vertex_shader_name, permutation), shader_code_name(fragment_shader_name, permutation)};
+				write_pipeline_hash_function(output, api, pipeline, pipeline_state_hash(api, t, NULL), shaders, 2, uses_framebuffer_format(t));
 			}
 		}
 
-		for (function_id i = 0; get_function(i) != NULL; ++i) {
-			function *f = get_function(i);
-			if (has_attribute(&f->attributes, add_name("compute"))) {
+		for (size_t pipeline_index = 0; pipeline_index < pipelines_count; ++pipeline_index) {
+			function *f = pipelines[pipeline_index].compute;
+			if (f != NULL) {
+				name_id pipeline = pipelines[pipeline_index].name;
+				name_id code     = shader_code_name(f->name, pipelines[pipeline_index].permutation);
+
+				fprintf(output, "static void kong_create_%s_pipeline(void) {\n", get_name(pipeline));
+				fprintf(output, "\tkore_gpu_device *device = kong_device;\n\n");
 				fprintf(output, "\tkore_%s_compute_pipeline_parameters %s_parameters;\n", api_short, get_name(f->name));
 				if (api == API_METAL) {
 					fprintf(output, "\t%s_parameters.shader.function_name = \"%s\";\n", get_name(f->name), get_name(f->name));
@@ -3542,12 +5161,12 @@ void kore3_export(char *directory, api_kind api) {
 					fprintf(output,
 					        "\t%s_parameters.shader.data = kore_webgpu_prepare_shader(device, %s_code, %s_code_size, "
 					        "%s_code_uses_framebuffer_texture_format);\n",
-					        get_name(f->name), get_name(f->name), get_name(f->name), get_name(f->name));
-					fprintf(output, "\t%s_parameters.shader.size = %s_code_size;\n", get_name(f->name), get_name(f->name));
+					        get_name(f->name), get_name(code), get_name(code), get_name(code));
+					fprintf(output, "\t%s_parameters.shader.size = %s_code_size;\n", get_name(f->name), get_name(code));
 				}
 				else {
-					fprintf(output, "\t%s_parameters.shader.data = %s_code;\n", get_name(f->name), get_name(f->name));
-					fprintf(output, "\t%s_parameters.shader.size = %s_code_size;\n", get_name(f->name), get_name(f->name));
+					fprintf(output, "\t%s_parameters.shader.data = %s_code;\n", get_name(f->name), get_name(code));
+					fprintf(output, "\t%s_parameters.shader.size = %s_code_size;\n", get_name(f->name), get_name(code));
 				}
 				if (api == API_VULKAN) {
 					descriptor_set_group *group = find_descriptor_set_group_for_function(f);
@@ -3556,7 +5175,7 @@ void kore3_export(char *directory, api_kind api) {
 
 					if (group->size == 0) {
 						fprintf(output, "\t\tkore_%s_compute_pipeline_init(&device->%s, &%s, &%s_parameters, NULL, 0, 0);\n", api_short, api_short,
-						        get_name(f->name), get_name(f->name));
+						        get_name(pipeline), get_name(f->name));
 					}
 					else {
 						size_t root_constants_size = 0;
@@ -3575,7 +5194,7 @@ void kore3_export(char *directory, api_kind api) {
 							if (group->values[i]->name == add_name("root_constants")) {
 								for (size_t global_index = 0; global_index < group->values[i]->globals.size; ++global_index) {
 									global *g = get_global(group->values[i]->globals.globals[global_index]);
-									root_constants_size += struct_size(g->type);
+									root_constants_size += global_struct_size(g, api);
 								}
 
 								continue;
@@ -3586,7 +5205,7 @@ void kore3_export(char *directory, api_kind api) {
 						}
 
 						fprintf(output, "\t\tkore_%s_compute_pipeline_init(&device->%s, &%s, &%s_parameters, layouts, %zu, %zu);\n", api_short, api_short,
-						        get_name(f->name), get_name(f->name), group_size, root_constants_size);
+						        get_name(pipeline), get_name(f->name), group_size, root_constants_size);
 					}
 
 					fprintf(output, "\t}\n");
@@ -3597,7 +5216,7 @@ void kore3_export(char *directory, api_kind api) {
 					fprintf(output, "\t{\n");
 
 					if (group->size == 0) {
-						fprintf(output, "\t\tkore_webgpu_render_pipeline_init(&device->webgpu, &%s, &%s_parameters, NULL, 0);\n", get_name(f->name),
+						fprintf(output, "\t\tkore_webgpu_render_pipeline_init(&device->webgpu, &%s, &%s_parameters, NULL, 0);\n", get_name(pipeline),
 						        get_name(f->name));
 					}
 					else {
@@ -3607,22 +5226,28 @@ void kore3_export(char *directory, api_kind api) {
 							fprintf(output, "\t\tlayouts[%zu] = %s_set_layout;\n", layout_index, get_name(group->values[layout_index]->name));
 						}
 
-						fprintf(output, "\t\tkore_webgpu_compute_pipeline_init(&device->webgpu, &%s, &%s_parameters, layouts, %zu);\n", get_name(f->name),
+						fprintf(output, "\t\tkore_webgpu_compute_pipeline_init(&device->webgpu, &%s, &%s_parameters, layouts, %zu);\n", get_name(pipeline),
 						        get_name(f->name), group->size);
 					}
 
 					fprintf(output, "\t}\n");
 				}
 				else {
-					fprintf(output, "\tkore_%s_compute_pipeline_init(&device->%s, &%s, &%s_parameters);\n", api_short, api_short, get_name(f->name),
+					fprintf(output, "\tkore_%s_compute_pipeline_init(&device->%s, &%s, &%s_parameters);\n", api_short, api_short, get_name(pipeline),
 					        get_name(f->name));
 				}
+
+				fprintf(output, "}\n\n");
+
+				write_pipeline_hash_function(output, api, pipeline, pipeline_state_hash(api, NULL, f), &code, 1, false);
 			}
 		}
 
-		for (type_id i = 0; get_type(i) != NULL; ++i) {
-			type *t = get_type(i);
-			if (!t->built_in && has_attribute(&t->attributes, add_name("raypipe"))) {
+		for (size_t pipeline_index = 0; pipeline_index < pipelines_count; ++pipeline_index) {
+			type *t = pipelines[pipeline_index].ray_pipe;
+			if (t != NULL) {
+				fprintf(output, "static void kong_create_%s_pipeline(void) {\n", get_name(t->name));
+				fprintf(output, "\tkore_gpu_device *device = kong_device;\n\n");
 				fprintf(output, "\tkore_%s_ray_pipeline_parameters %s_parameters = KONG_INIT_ZERO;\n\n", api_short, get_name(t->name));
 
 				name_id gen_shader_name          = NO_NAME;
@@ -3666,21 +5291,26 @@ void kore3_export(char *directory, api_kind api) {
 					fprintf(output, "\t%s_parameters.any_shader_name = \"%s\";\n", get_name(t->name), get_name(any_shader_name));
 				}
 
-				fprintf(output, "\n\tkore_%s_ray_pipeline_init(device, &%s, &%s_parameters, kong_create_%s_root_signature(device));\n\n", api_short,
+				fprintf(output, "\n\tkore_%s_ray_pipeline_init(device, &%s, &%s_parameters, kong_create_%s_root_signature(device));\n", api_short,
 				        get_name(t->name), get_name(t->name), get_name(t->name));
+				fprintf(output, "}\n\n");
+
+				// The ray shaders live in one library which the pipeline references by name
+				write_pipeline_hash_function(output, api, t->name, pipeline_state_hash(api, t, NULL), NULL, 0, false);
 			}
 		}
 
-		fprintf(output, "}\n");
+		write_pipeline_creation(output, api, pipelines, pipelines_count, threaded_pipelines);
+		write_pipeline_cache(output, pipelines, pipelines_count);
 
-		fclose(output);
+		close_output_if_changed(output, filename);
 	}
 
 	if (api == API_DIRECT3D12) {
 		char filename[512];
 		sprintf(filename, "%s/%s", directory, "kong_ray_root_signatures.c");
 
-		FILE *output = fopen(filename, "wb");
+		FILE *output = open_output(filename);
 
 		fprintf(output, "#include <kore3/gpu/device.h>\n\n");
 		fprintf(output, "#include <d3d12.h>\n\n");
@@ -3700,13 +5330,13 @@ void kore3_export(char *directory, api_kind api) {
 			}
 		}
 
-		fclose(output);
+		close_output_if_changed(output, filename);
 	}
 	else if (api == API_VULKAN) {
 		char filename[512];
 		sprintf(filename, "%s/%s", directory, "kong_descriptor_sets.c");
 
-		FILE *output = fopen(filename, "wb");
+		FILE *output = open_output(filename);
 
 		fprintf(output, "#include <kore3/gpu/device.h>\n\n");
 
@@ -3837,13 +5467,13 @@ void kore3_export(char *directory, api_kind api) {
 
 		fprintf(output, "}\n");
 
-		fclose(output);
+		close_output_if_changed(output, filename);
 	}
 	else if (api == API_WEBGPU) {
 		char filename[512];
 		sprintf(filename, "%s/%s", directory, "kong_bind_groups.c");
 
-		FILE *output = fopen(filename, "wb");
+		FILE *output = open_output(filename);
 
 		fprintf(output, "#include <kore3/gpu/device.h>\n\n");
 
@@ -3976,7 +5606,10 @@ void kore3_export(char *directory, api_kind api) {
 				else if (is_sampler(g->type)) {
 					fprintf(output, "\t\t\t{\n");
 					fprintf(output, "\t\t\t\t.binding = %zu,\n", global_index);
-					if ((g->usage & GLOBAL_USAGE_SAMPLE_DEPTH) != 0) {
+					if ((g->usage & GLOBAL_USAGE_SAMPLE_COMPARE) != 0) {
+						fprintf(output, "\t\t\t\t.sampler = {.type = WGPUSamplerBindingType_Comparison},\n");
+					}
+					else if ((g->usage & GLOBAL_USAGE_SAMPLE_DEPTH) != 0) {
 						fprintf(output, "\t\t\t\t.sampler = {.type = WGPUSamplerBindingType_NonFiltering},\n");
 					}
 					else {
@@ -4026,6 +5659,6 @@ void kore3_export(char *directory, api_kind api) {
 
 		fprintf(output, "}\n");
 
-		fclose(output);
+		close_output_if_changed(output, filename);
 	}
 }
@@ -8,11 +8,15 @@
 #include "log.h"
 #include "names.h"
 #include "parser.h"
+#include "permutations.h"
+#include "sets.h"
+#include "stats.h"
 #include "tokenizer.h"
 #include "transformer.h"
 #include "typer.h"
 #include "types.h"
 
+#include "backends/blobs.h"
 #include "backends/cpu.h"
 #include "backends/glsl.h"
 #include "backends/hlsl.h"
@@ -31,7 +35,23 @@
 #include <stdlib.h>
 #include <string.h>
 
-typedef enum arg_mode { MODE_MODECHECK, MODE_INPUT, MODE_OUTPUT, MODE_PLATFORM, MODE_API, MODE_INTEGRATION } arg_mode;
+typedef enum arg_mode {
+	MODE_MODECHECK,
+	MODE_INPUT,
+	MODE_OUTPUT,
+	MODE_PLATFORM,
+	MODE_API,
+	MODE_INTEGRATION,
+	MODE_STATS_JSON,
+	MODE_TRACE,
+	MODE_BLOBS,
+	MODE_16BIT_TYPES,
+	MODE_SPECIALIZE,
+	MODE_PERMUTATION,
+	MODE_ROOT_CONSTANTS_BUDGET,
+} arg_mode;
+
+typedef enum sixteen_bit_types { SIXTEEN_BIT_TYPES_DEFAULT, SIXTEEN_BIT_TYPES_NATIVE, SIXTEEN_BIT_TYPES_FALLBACK } sixteen_bit_types;
 
 static void help(const char *basename) {
 	printf("\n");
@@ -47,6 +67,14 @@ static void help(const char *basename) {
 	printf("      --debug                 Enable debug mode\n");
 	printf("  -a, --api <api>             Shader API (auto-detected if omitted)\n");
 	printf("  -n, --integration <name>    Enable Kore3 integration\n");
+	printf("      --stats                 Print time and memory per phase and compiler counters\n");
+	printf("      --stats-json <file>     Write the --stats report as JSON to <file>\n");
+	printf("      --trace <file>          Write a Chrome trace of all compiler phases to <file>\n");
+	printf("      --blobs <mode>          How shader code is embedded in the generated sources\n");
+	printf("      --16bit-types <types>   Whether half, short and ushort map to native 16 bit types\n");
+	printf("      --specialize <name=value> Bakes the value of a #[specialize] const and removes the branches it decides\n");
+	printf("      --permutation <a=1,b=true> Adds a permutation of #[specialize] values, pipelines are set per permutation\n");
+	printf("      --root-constants-budget <bytes> Promotes a small struct const to root constants, also ones without #[per_draw]\n");
 
 	printf("\nInformation:\n");
 	printf("  <platform>		Automatic API resolution only applies if <platform> is one of:\n");
@@ -55,6 +83,10 @@ static void help(const char *basename) {
 	printf("    			    direct3d11, direct3d12, opengl, metal, webgpu, vulkan\n");
 	printf("  <integration>		Supported:\n");
 	printf("    			    kore3\n");
+	printf("  <mode>			Supported:\n");
+	printf("    			    strings (default), deduplicated, compressed, incbin, pack\n");
+	printf("  <types>		Supported:\n");
+	printf("    			    default (native for direct3d11, direct3d12, opengl and metal), native, fallback\n");
 	printf("\n");
 }
 
@@ -81,15 +113,117 @@ static void read_file(char *filename) {
 
 	fclose(file);
 
+	stats_begin("tokenize %s", filename);
 	tokens tokens = tokenize(filename, data);
+	stats_end();
+
+	stats_count(STATS_COUNTER_FILES, 1);
+	stats_count(STATS_COUNTER_TOKENS, tokens.current_size);
 
 	free(data);
 
+	stats_begin("parse %s", filename);
 	parse(filename, &tokens);
+	stats_end();
+}
+
+static const char *api_name(api_kind api) {
+	switch (api) {
+	case API_DIRECT3D11:
+	case API_DIRECT3D12:
+		return "hlsl";
+	case API_OPENGL:
+		return "glsl";
+	case API_METAL:
+		return "metal";
+	case API_WEBGPU:
+		return "wgsl";
+	case API_VULKAN:
+		return "spirv";
+	case API_KOMPJUTA:
+		return "kompjuta";
+	default:
+		return "unknown";
+	}
+}
+
+static void collect_stats(void) {
+	uint64_t functions = 0;
+	uint64_t opcodes   = 0;
+	for (function_id i = 0; get_function(i) != NULL; ++i) {
+		function *f = get_function(i);
+		functions += 1;
+		for (size_t index = 0; index < f->code.size; index += ((opcode *)&f->code.o[index])->size) {
+			opcodes += 1;
+		}
+	}
+	stats_set(STATS_COUNTER_FUNCTIONS, functions);
+	stats_set(STATS_COUNTER_OPCODES, opcodes);
+
+	stats_set(STATS_COUNTER_VARIABLES, allocated_variables_count());
+
+	uint64_t types = 0;
+	for (type_id i = 0; get_type(i) != NULL; ++i) {
+		types += 1;
+	}
+	stats_set(STATS_COUNTER_TYPES, types);
+
+	uint64_t globals = 0;
+	for (global_id i = 0; get_global(i) != NULL && get_global(i)->type != NO_TYPE; ++i) {
+		globals += 1;
+	}
+	stats_set(STATS_COUNTER_GLOBALS, globals);
 }
 
 typedef enum integration_kind { INTEGRATION_KORE3 } integration_kind;
 
+static void transform_code(api_kind api, bool fold_constants) {
+	stats_begin("transform");
+	transform(TRANSFORM_FLAG_UNROLL_LOOPS | (fold_constants ? TRANSFORM_FLAG_FOLD_CONSTANTS : 0) | TRANSFORM_FLAG_REDUCE_BLOCKS);
+
+	//
+
+	switch (api) {
+	case API_VULKAN:
+		transform(TRANSFORM_FLAG_ONE_COMPONENT_SWIZZLE | TRANSFORM_FLAG_BINARY_UNIFY_LENGTH);
+		break;
+	case API_WEBGPU:
+		transform(TRANSFORM_FLAG_ONE_COMPONENT_SWIZZLE);
+		break;
+	default:
+		break;
+	}
+	stats_end();
+}
+
+static void export_code(char *output, api_kind api, bool debug) {
+	switch (api) {
+	case API_DIRECT3D11:
+	case API_DIRECT3D12:
+		hlsl_export(output, api, debug);
+		break;
+	case API_OPENGL:
+		glsl_export(output);
+		break;
+	case API_METAL:
+		metal_export(output);
+		break;
+	case API_WEBGPU:
+		wgsl_export(output);
+		break;
+	case API_VULKAN:
+		spirv_export(output, debug);
+		break;
+	case API_KOMPJUTA:
+		kompjuta_export(output);
+		break;
+	default: {
+		debug_context context = KONG_INIT_ZERO;
+		error(context, "Unknown API");
+	}
+	}
+}
+
 int main(int argc, char **argv) {
 	arg_mode mode = MODE_MODECHECK;
 
@@ -100,6 +234,16 @@ int main(int argc, char **argv) {
 	integration_kind integration = INTEGRATION_KORE3;
 	bool             debug       = false;
 	char            *output      = NULL;
+	bool             stats       = false;
+	char            *stats_json  = NULL;
+	char            *trace       = NULL;
+
+	int root_constants_budget = -1;
+
+	char  *specializations[256] = KONG_INIT_ZERO;
+	size_t specializations_size = 0;
+
+	sixteen_bit_types sixteen_bits = SIXTEEN_BIT_TYPES_DEFAULT;
 
 	for (int i = 1; i < argc; ++i) {
 		char *arg = argv[i];
@@ -125,6 +269,34 @@ int main(int argc, char **argv) {
 					else if (strcmp(&arg[2], "debug") == 0) {
 						debug = true;
 					}
+					else if (strcmp(&arg[2], "stats") == 0) {
+						stats = true;
+						stats_enable();
+					}
+					else if (strcmp(&arg[2], "stats-json") == 0) {
+						stats = true;
+						stats_enable();
+						mode = MODE_STATS_JSON;
+					}
+					else if (strcmp(&arg[2], "trace") == 0) {
+						stats_enable();
+						mode = MODE_TRACE;
+					}
+					else if (strcmp(&arg[2], "blobs") == 0) {
+						mode = MODE_BLOBS;
+					}
+					else if (strcmp(&arg[2], "16bit-types") == 0) {
+						mode = MODE_16BIT_TYPES;
+					}
+					else if (strcmp(&arg[2], "specialize") == 0) {
+						mode = MODE_SPECIALIZE;
+					}
+					else if (strcmp(&arg[2], "permutation") == 0) {
+						mode = MODE_PERMUTATION;
+					}
+					else if (strcmp(&arg[2], "root-constants-budget") == 0) {
+						mode = MODE_ROOT_CONSTANTS_BUDGET;
+					}
 					else if (strcmp(&arg[2], "help") == 0) {
 						help(argv[0]);
 						return 0;
@@ -234,6 +406,74 @@ int main(int argc, char **argv) {
 			mode = MODE_MODECHECK;
 			break;
 		}
+		case MODE_STATS_JSON: {
+			stats_json = arg;
+			mode       = MODE_MODECHECK;
+			break;
+		}
+		case MODE_TRACE: {
+			trace = arg;
+			mode  = MODE_MODECHECK;
+			break;
+		}
+		case MODE_BLOBS: {
+			if (strcmp(arg, "strings") == 0) {
+				set_blob_mode(BLOB_MODE_STRINGS);
+			}
+			else if (strcmp(arg, "deduplicated") == 0) {
+				set_blob_mode(BLOB_MODE_DEDUPLICATED);
+			}
+			else if (strcmp(arg, "compressed") == 0) {
+				set_blob_mode(BLOB_MODE_COMPRESSED);
+			}
+			else if (strcmp(arg, "incbin") == 0) {
+				set_blob_mode(BLOB_MODE_INCBIN);
+			}
+			else if (strcmp(arg, "pack") == 0) {
+				set_blob_mode(BLOB_MODE_PACK);
+			}
+			else {
+				debug_context context = KONG_INIT_ZERO;
+				error(context, "Unknown blob mode %s", arg);
+			}
+			mode = MODE_MODECHECK;
+			break;
+		}
+		case MODE_16BIT_TYPES: {
+			if (strcmp(arg, "default") == 0) {
+				sixteen_bits = SIXTEEN_BIT_TYPES_DEFAULT;
+			}
+			else if (strcmp(arg, "native") == 0) {
+				sixteen_bits = SIXTEEN_BIT_TYPES_NATIVE;
+			}
+			else if (strcmp(arg, "fallback") == 0) {
+				sixteen_bits = SIXTEEN_BIT_TYPES_FALLBACK;
+			}
+			else {
+				debug_context context = KONG_INIT_ZERO;
+				error(context, "Unknown 16 bit types mode %s", arg);
+			}
+			mode = MODE_MODECHECK;
+			break;
+		}
+		case MODE_SPECIALIZE: {
+			debug_context context = KONG_INIT_ZERO;
+			check(specializations_size < 256, context, "Too many specializations");
+			specializations[specializations_size] = arg;
+			specializations_size += 1;
+			mode = MODE_MODECHECK;
+			break;
+		}
+		case MODE_PERMUTATION: {
+			add_permutation(arg);
+			mode = MODE_MODECHECK;
+			break;
+		}
+		case MODE_ROOT_CONSTANTS_BUDGET: {
+			root_constants_budget = atoi(arg);
+			mode                  = MODE_MODECHECK;
+			break;
+		}
 		}
 	}
 
@@ -270,11 +510,23 @@ int main(int argc, char **argv) {
 	check(dir_exists(output) == 1, context, "output directory doesn't exist or isn't a directory");
 	check(api != API_DEFAULT, context, "api parameter not found");
 
+	// HLSL (min16float), GLSL (mediump) and Metal take 16 bit types as precision hints, WGSL (f16 only) and SPIR-V
+	// (Float16, Int16 and the 16 bit storage capabilities) need device features and only use them when asked to
+	bool sixteen_bits_hint   = api == API_DIRECT3D11 || api == API_DIRECT3D12 || api == API_OPENGL || api == API_METAL;
+	bool sixteen_bits_native = sixteen_bits == SIXTEEN_BIT_TYPES_NATIVE;
+	bool native_halfs        = sixteen_bits != SIXTEEN_BIT_TYPES_FALLBACK &&
+	                           (sixteen_bits_hint || (sixteen_bits_native && (api == API_WEBGPU || api == API_VULKAN)));
+	bool native_shorts       = sixteen_bits != SIXTEEN_BIT_TYPES_FALLBACK && (sixteen_bits_hint || (sixteen_bits_native && api == API_VULKAN));
+
+	stats_begin("init");
 	names_init();
+	set_16bit_types(native_halfs, native_shorts);
 	types_init();
 	functions_init();
 	globals_init();
+	stats_end();
 
+	stats_begin("read");
 	for (size_t i = 0; i < inputs_size; ++i) {
 		directory dir = open_dir(inputs[i]);
 
@@ -296,6 +548,20 @@ int main(int argc, char **argv) {
 
 		close_dir(&dir);
 	}
+	stats_end();
+
+	for (size_t i = 0; i < specializations_size; ++i) {
+		char *separator = strchr(specializations[i], '=');
+		check(separator != NULL, context, "--specialize expects name=value but got %s", specializations[i]);
+		*separator = 0;
+		specialize_global(add_name(specializations[i]), separator + 1);
+	}
+
+	// every permutation is a separate compile, so the values can be folded into the code,
+	// --permutation bakes its values later on because all permutations share the compiled code
+	if (specializations_size > 0 && permutations_count() == 0) {
+		bake_specializations();
+	}
 
 #ifndef NDEBUG
 	kong_log(LOG_LEVEL_INFO, "Functions:");
@@ -311,67 +577,106 @@ int main(int argc, char **argv) {
 	kong_log(LOG_LEVEL_INFO, "");
 #endif
 
+	stats_begin("resolve_types");
 	resolve_types();
+	stats_end();
 
+	stats_begin("allocate_globals");
 	allocate_globals();
+	stats_end();
+
+	stats_begin("compile");
 	for (function_id i = 0; get_function(i) != NULL; ++i) {
-		compile_function_block(&get_function(i)->code, get_function(i)->block);
+		function *f = get_function(i);
+		if (f->block == NULL) {
+			// built-in
+			continue;
+		}
+		stats_begin("compile_function_block %s", get_name(f->name));
+		compile_function_block(&f->code, f->block);
+		stats_end();
 	}
+	stats_end();
 
-	analyze();
+	for (global_id i = 0; get_global(i) != NULL && get_global(i)->type != NO_TYPE; ++i) {
+		check(api == API_DIRECT3D12 || !global_is_bindless(get_global(i)), context, "Bindless textures are not supported for %s", api_name(api));
+	}
 
-	transform(TRANSFORM_FLAG_REDUCE_BLOCKS);
+	stats_begin("promote_root_constants");
+	if (root_constants_budget >= 0) {
+		promote_root_constants(api, (uint32_t)root_constants_budget, true);
+	}
+	else {
+		promote_root_constants(api, default_root_constants_budget(api), false);
+	}
+	stats_end();
 
-	//
+	stats_begin("analyze");
+	analyze();
+	stats_end();
 
-	switch (api) {
-	case API_VULKAN:
-		transform(TRANSFORM_FLAG_ONE_COMPONENT_SWIZZLE | TRANSFORM_FLAG_BINARY_UNIFY_LENGTH);
-		break;
-	case API_WEBGPU:
-		transform(TRANSFORM_FLAG_ONE_COMPONENT_SWIZZLE);
-		break;
-	default:
-		break;
+	bool fold_constants = specializations_size > 0 || permutations_count() > 0;
+
+	if (permutations_count() > 0) {
+		check(api != API_METAL && api != API_KOMPJUTA, context,
+		      "Permutations are not supported for %s, Metal selects #[specialize] values with function constants", api_name(api));
+		save_permutation_base();
 	}
 
+	// the compiled code is shared, only the transforms and the backend run again for every permutation
+	uint32_t permutations = permutations_count() > 0 ? permutations_count() : 1;
+	for (uint32_t permutation = 0; permutation < permutations; ++permutation) {
+		if (permutations_count() > 0) {
+			apply_permutation(permutation);
+		}
+
+		transform_code(api, fold_constants);
+
+		if (permutations_count() > 0) {
+			hash_permutation(permutation);
+		}
+
 #ifndef NDEBUG
-	disassemble();
+		disassemble();
 #endif
 
-	switch (api) {
-	case API_DIRECT3D11:
-	case API_DIRECT3D12:
-		hlsl_export(output, api, debug);
-		break;
-	case API_OPENGL:
-		glsl_export(output);
-		break;
-	case API_METAL:
-		metal_export(output);
-		break;
-	case API_WEBGPU:
-		wgsl_export(output);
-		break;
-	case API_VULKAN:
-		spirv_export(output, debug);
-		break;
-	case API_KOMPJUTA:
-		kompjuta_export(output);
-		break;
-	default: {
-		debug_context context = KONG_INIT_ZERO;
-		error(context, "Unknown API");
+		stats_begin("%s_export", api_name(api));
+		export_code(output, api, debug);
+		if (permutation == permutations - 1) {
+			write_blobs(output);
+		}
+		stats_end();
 	}
+
+	// the CPU code and the integration are written for the first permutation
+	if (permutations > 1) {
+		apply_permutation(0);
+		transform_code(api, fold_constants);
 	}
 
+	stats_begin("cpu_export");
 	cpu_export(output);
+	stats_end();
 
 	switch (integration) {
 	case INTEGRATION_KORE3:
+		stats_begin("kore3_export");
 		kore3_export(output, api);
+		stats_end();
 		break;
 	}
 
+	if (stats) {
+		collect_stats();
+		stats_print();
+		if (stats_json != NULL) {
+			stats_write_json(stats_json);
+		}
+	}
+
+	if (trace != NULL) {
+		stats_write_trace(trace);
+	}
+
 	return 0;
 }
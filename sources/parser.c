@@ -4,6 +4,7 @@
 #include "functions.h"
 #include "global.h"
 #include "sets.h"
+#include "stats.h"
 #include "tokenizer.h"
 #include "types.h"
 
@@ -15,6 +16,7 @@ static statement *statement_allocate(void) {
 	statement    *s       = (statement *)malloc(sizeof(statement));
 	debug_context context = KONG_INIT_ZERO;
 	check(s != NULL, context, "Could not allocate statement");
+	stats_count(STATS_COUNTER_AST_NODES, 1);
 	return s;
 }
 
@@ -35,6 +37,7 @@ static expression *expression_allocate(void) {
 	expression   *e       = (expression *)malloc(sizeof(expression));
 	debug_context context = KONG_INIT_ZERO;
 	check(e != NULL, context, "Could not allocate expression");
+	stats_count(STATS_COUNTER_AST_NODES, 1);
 	init_type_ref(&e->type, NO_NAME);
 	return e;
 }
@@ -157,6 +160,7 @@ typedef struct modifiers {
 static definition parse_struct(state *state);
 static definition parse_function(state *state);
 static definition parse_const(state *state, attribute_list attributes);
+static definition parse_group_shared(state *state, attribute_list attributes);
 
 static double attribute_parameter_to_number(name_id attribute_name, name_id parameter_name) {
 	if (attribute_name == add_name("topology") && parameter_name == add_name("triangle")) {
@@ -236,6 +240,9 @@ static definition parse_definition(state *state) {
 				advance_state(state);
 			}
 
+			debug_context context = KONG_INIT_ZERO;
+			check(attributes.attributes_count < MAX_ATTRIBUTES, context, "Too many attributes");
+
 			attributes.attributes[attributes.attributes_count] = current_attribute;
 			attributes.attributes_count += 1;
 
@@ -278,9 +285,17 @@ static definition parse_definition(state *state) {
 
 		return d;
 	}
+	case TOKEN_VAR: {
+		if (current_sets_count != 0) {
+			debug_context context = KONG_INIT_ZERO;
+			error(context, "A group shared variable can not be assigned to a set");
+		}
+
+		return parse_group_shared(state, attributes);
+	}
 	default: {
 		update_debug_context(state);
-		error(state->context, "Expected a struct, a function or a const");
+		error(state->context, "Expected a struct, a function, a const or a var");
 
 		definition d = KONG_INIT_ZERO;
 		return d;
@@ -375,10 +390,12 @@ static statement *parse_statement(state *state, block *parent_block) {
 
 		statement *while_block = parse_statement(state, parent_block);
 
-		statement *s          = statement_allocate();
-		s->kind               = STATEMENT_WHILE;
-		s->whiley.test        = test;
-		s->whiley.while_block = while_block;
+		statement *s           = statement_allocate();
+		s->kind                = STATEMENT_WHILE;
+		s->whiley.test         = test;
+		s->whiley.while_block  = while_block;
+		s->whiley.hint         = LOOP_HINT_NONE;
+		s->whiley.unroll_count = 0;
 
 		return s;
 	}
@@ -387,9 +404,11 @@ static statement *parse_statement(state *state, block *parent_block) {
 
 		statement *do_block = parse_statement(state, parent_block);
 
-		statement *s          = statement_allocate();
-		s->kind               = STATEMENT_DO_WHILE;
-		s->whiley.while_block = do_block;
+		statement *s           = statement_allocate();
+		s->kind                = STATEMENT_DO_WHILE;
+		s->whiley.while_block  = do_block;
+		s->whiley.hint         = LOOP_HINT_NONE;
+		s->whiley.unroll_count = 0;
 
 		match_token(state, TOKEN_WHILE, "Expected \"while\"");
 		advance_state(state);
@@ -407,6 +426,56 @@ static statement *parse_statement(state *state, block *parent_block) {
 
 		return s;
 	}
+	case TOKEN_HASH: {
+		advance_state(state);
+		match_token(state, TOKEN_LEFT_SQUARE, "Expected an opening square bracket");
+		advance_state(state);
+		match_token(state, TOKEN_IDENTIFIER, "Expected an identifier");
+		name_id attribute_name = current(state).identifier;
+		advance_state(state);
+
+		loop_hint hint         = LOOP_HINT_NONE;
+		uint32_t  unroll_count = 0;
+
+		debug_context context = KONG_INIT_ZERO;
+
+		if (attribute_name == add_name("unroll")) {
+			hint = LOOP_HINT_UNROLL;
+
+			if (current(state).kind == TOKEN_LEFT_PAREN) {
+				advance_state(state);
+				match_token(state, TOKEN_INT, "Expected an unroll count");
+				check(current(state).number >= 1, context, "The unroll count has to be at least one");
+				unroll_count = (uint32_t)current(state).number;
+				advance_state(state);
+				match_token(state, TOKEN_RIGHT_PAREN, "Expected a closing bracket");
+				advance_state(state);
+			}
+		}
+		else if (attribute_name == add_name("loop")) {
+			hint = LOOP_HINT_LOOP;
+		}
+		else {
+			error(context, "Unknown statement attribute %s", get_name(attribute_name));
+		}
+
+		match_token(state, TOKEN_RIGHT_SQUARE, "Expected a closing square bracket");
+		advance_state(state);
+
+		check(current(state).kind == TOKEN_FOR || current(state).kind == TOKEN_WHILE || current(state).kind == TOKEN_DO, context,
+		      "Loop attributes have to be followed by a loop");
+
+		statement *s = parse_statement(state, parent_block);
+
+		// for loops are wrapped in a block which holds the loop variable
+		statement *loop = s->kind == STATEMENT_BLOCK ? s->block.statements.s[s->block.statements.size - 1] : s;
+		assert(loop->kind == STATEMENT_WHILE || loop->kind == STATEMENT_DO_WHILE);
+
+		loop->whiley.hint         = hint;
+		loop->whiley.unroll_count = unroll_count;
+
+		return s;
+	}
 	case TOKEN_FOR: {
 		statements outer_block_statements;
 		statements_init(&outer_block_statements);
@@ -442,10 +511,12 @@ static statement *parse_statement(state *state, block *parent_block) {
 
 		statements_add(&inner_block->block.statements, post_statement);
 
-		statement *s          = statement_allocate();
-		s->kind               = STATEMENT_WHILE;
-		s->whiley.test        = test;
-		s->whiley.while_block = inner_block;
+		statement *s           = statement_allocate();
+		s->kind                = STATEMENT_WHILE;
+		s->whiley.test         = test;
+		s->whiley.while_block  = inner_block;
+		s->whiley.hint         = LOOP_HINT_NONE;
+		s->whiley.unroll_count = 0;
 
 		statements_add(&outer_block->block.statements, s);
 
@@ -940,19 +1011,64 @@ static expression *parse_call(state *state, name_id func_name) {
 	return parse_member_or_element_access(state, call);
 }
 
+static member_format parse_member_format(state *state) {
+	advance_state(state);
+	match_token(state, TOKEN_LEFT_SQUARE, "Expected left square");
+	advance_state(state);
+
+	match_token(state, TOKEN_IDENTIFIER, "Expected an identifier");
+	name_id       name   = current(state).identifier;
+	member_format format = MEMBER_FORMAT_DEFAULT;
+
+	if (name == add_name("unorm8")) {
+		format = MEMBER_FORMAT_UNORM8;
+	}
+	else if (name == add_name("snorm8")) {
+		format = MEMBER_FORMAT_SNORM8;
+	}
+	else if (name == add_name("unorm16")) {
+		format = MEMBER_FORMAT_UNORM16;
+	}
+	else if (name == add_name("snorm16")) {
+		format = MEMBER_FORMAT_SNORM16;
+	}
+	else if (name == add_name("half")) {
+		format = MEMBER_FORMAT_HALF;
+	}
+	else if (name == add_name("rgb10a2")) {
+		format = MEMBER_FORMAT_RGB10A2;
+	}
+	else {
+		debug_context context = KONG_INIT_ZERO;
+		error(context, "Unknown member attribute %s", get_name(name));
+	}
+	advance_state(state);
+
+	match_token(state, TOKEN_RIGHT_SQUARE, "Expected right square");
+	advance_state(state);
+
+	return format;
+}
+
 static definition parse_struct_inner(state *state, name_id name) {
 	match_token(state, TOKEN_LEFT_CURLY, "Expected an opening curly bracket");
 	advance_state(state);
 
-	token    member_names[MAX_MEMBERS];
-	type_ref type_refs[MAX_MEMBERS];
-	token    member_values[MAX_MEMBERS];
-	size_t   count = 0;
+	token         member_names[MAX_MEMBERS];
+	type_ref      type_refs[MAX_MEMBERS];
+	token         member_values[MAX_MEMBERS];
+	member_format member_formats[MAX_MEMBERS];
+	size_t        count = 0;
 
 	while (current(state).kind != TOKEN_RIGHT_CURLY) {
 		debug_context context = KONG_INIT_ZERO;
 		check(count < MAX_MEMBERS, context, "Out of members");
 
+		member_formats[count] = MEMBER_FORMAT_DEFAULT;
+		if (current(state).kind == TOKEN_HASH) {
+			member_formats[count] = parse_member_format(state);
+		}
+
 		match_token(state, TOKEN_IDENTIFIER, "Expected an identifier");
 		member_names[count] = current(state);
 
@@ -1011,8 +1127,9 @@ static definition parse_struct_inner(state *state, name_id name) {
 
 	for (size_t i = 0; i < count; ++i) {
 		member member;
-		member.name  = member_names[i].identifier;
-		member.value = member_values[i];
+		member.name   = member_names[i].identifier;
+		member.value  = member_values[i];
+		member.format = member_formats[i];
 		if (member.value.kind != TOKEN_NONE) {
 			if (member.value.kind == TOKEN_BOOLEAN) {
 				init_type_ref(&member.type, add_name("bool"));
@@ -1409,6 +1526,42 @@ static definition parse_const(state *state, attribute_list attributes) {
 		d.kind   = DEFINITION_BVH;
 		d.global = add_global(bvh_type_id, attributes, name.identifier);
 	}
+	else if (type_name == add_name("bool") && !array) {
+		debug_context context = KONG_INIT_ZERO;
+		check(value != NULL, context, "const bool requires an initialization value");
+		check(value->kind == EXPRESSION_BOOLEAN, context, "const bool requires true or false");
+
+		global_value bool_value;
+		bool_value.kind = GLOBAL_VALUE_BOOL;
+
+		bool_value.value.b = value->boolean;
+
+		d.kind   = DEFINITION_CONST_BASIC;
+		d.global = add_global_with_value(bool_id, attributes, name.identifier, bool_value);
+	}
+	else if ((type_name == add_name("int") || type_name == add_name("uint")) && !array) {
+		debug_context context = KONG_INIT_ZERO;
+		check(value != NULL, context, "const %s requires an initialization value", get_name(type_name));
+
+		bool negative = value->kind == EXPRESSION_UNARY && value->unary.op == OPERATOR_MINUS && type_name == add_name("int");
+		if (negative) {
+			value = value->unary.right;
+		}
+		check(value->kind == EXPRESSION_INT, context, "const %s requires an integer", get_name(type_name));
+
+		global_value int_value;
+		if (type_name == add_name("int")) {
+			int_value.kind          = GLOBAL_VALUE_INT;
+			int_value.value.ints[0] = negative ? -(int)value->number : (int)value->number;
+		}
+		else {
+			int_value.kind           = GLOBAL_VALUE_UINT;
+			int_value.value.uints[0] = (unsigned)value->number;
+		}
+
+		d.kind   = DEFINITION_CONST_BASIC;
+		d.global = add_global_with_value(type_name == add_name("int") ? int_id : uint_id, attributes, name.identifier, int_value);
+	}
 	else if (type_name == add_name("float")) {
 		debug_context context = KONG_INIT_ZERO;
 		check(value != NULL, context, "const float requires an initialization value");
@@ -1496,10 +1649,65 @@ static definition parse_const(state *state, attribute_list attributes) {
 			d.global = add_global_with_value(float4_id, attributes, name.identifier, float4_value);
 		}
 	}
+	else if (array && (type_name == add_name("uint") || type_name == add_name("int") || is_indirect_args(find_type_by_name(type_name)))) {
+		debug_context context = KONG_INIT_ZERO;
+		check(value == NULL, context, "const %s[] does not allow an initialization value", get_name(type_name));
+
+		type_id base_type_id = find_type_by_name(type_name);
+
+		type_id array_type_id               = add_type(get_type(base_type_id)->name);
+		get_type(array_type_id)->base       = base_type_id;
+		get_type(array_type_id)->built_in   = true;
+		get_type(array_type_id)->array_size = array_size;
+
+		d.kind   = DEFINITION_CONST_BASIC;
+		d.global = add_global(array_type_id, attributes, name.identifier);
+	}
 	else {
 		debug_context context = KONG_INIT_ZERO;
 		error(context, "Unsupported global");
 	}
 
+	if (has_attribute(&attributes, add_name("specialize"))) {
+		debug_context context = KONG_INIT_ZERO;
+		check(global_is_scalar_constant(get_global(d.global)), context, "Only bool, int, uint and float consts can be specialized");
+	}
+
+	if (has_attribute(&attributes, add_name("bindless"))) {
+		debug_context context = KONG_INIT_ZERO;
+		type_id       t_id    = get_global(d.global)->type;
+		check(get_type(t_id)->array_size == UINT32_MAX && get_type(get_type(t_id)->base)->tex_kind == TEXTURE_KIND_2D, context,
+		      "Only unbounded tex2d[] consts can be bindless");
+	}
+
+	return d;
+}
+
+static definition parse_group_shared(state *state, attribute_list attributes) {
+	advance_state(state);
+	match_token(state, TOKEN_IDENTIFIER, "Expected an identifier");
+
+	token name = current(state);
+	advance_state(state);
+	match_token(state, TOKEN_COLON, "Expected a colon");
+	advance_state(state);
+
+	type_ref type = parse_type_ref(state);
+
+	match_token(state, TOKEN_SEMICOLON, "Expected a semicolon");
+	advance_state(state);
+
+	type_id t = find_type_by_ref(&type);
+	check(t != NO_TYPE, state->context, "Type %s of group shared variable %s not found", get_name(type.unresolved.name), get_name(name.identifier));
+
+	type_id base_type = get_type(t)->base;
+	check(get_type(t)->array_size > 0 && get_type(t)->array_size != UINT32_MAX, state->context, "Group shared variable %s requires a fixed size array type",
+	      get_name(name.identifier));
+	check(base_type != NO_TYPE && (is_vector_or_scalar(base_type) || is_matrix(base_type)), state->context,
+	      "Group shared variable %s requires an array of scalars, vectors or matrices", get_name(name.identifier));
+
+	definition d;
+	d.kind   = DEFINITION_GROUP_SHARED;
+	d.global = add_group_shared_global(t, attributes, name.identifier);
 	return d;
 }
@@ -125,6 +125,8 @@ typedef struct statement {
 		struct {
 			expression       *test;
 			struct statement *while_block;
+			loop_hint         hint;
+			uint32_t          unroll_count;
 		} whiley;
 		block block;
 		struct {
@@ -147,7 +149,8 @@ typedef enum definition_kind {
 	DEFINITION_SAMPLER,
 	DEFINITION_CONST_CUSTOM,
 	DEFINITION_CONST_BASIC,
-	DEFINITION_BVH
+	DEFINITION_BVH,
+	DEFINITION_GROUP_SHARED
 } definition_kind;
 
 typedef struct definition {
@@ -0,0 +1,220 @@
+#include "permutations.h"
+
+#include "analyzer.h"
+#include "compiler.h"
+#include "errors.h"
+#include "globals.h"
+#include "names.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct permutation {
+	char assignments[1024];
+} permutation;
+
+static permutation permutations[MAX_PERMUTATIONS];
+static uint32_t    permutations_size = 0;
+
+static uint32_t current = 0;
+
+static uint8_t     **base_code            = NULL;
+static size_t       *base_code_sizes      = NULL;
+static global_value *base_values          = NULL;
+static bool         *base_specializations = NULL;
+static uint64_t      base_variables_count = 0;
+
+static uint64_t *hashes          = NULL;
+static size_t    functions_count = 0;
+static size_t    globals_count   = 0;
+
+void add_permutation(const char *assignments) {
+	debug_context context = KONG_INIT_ZERO;
+	check(permutations_size < MAX_PERMUTATIONS, context, "Too many permutations");
+	check(strlen(assignments) < sizeof(permutations[0].assignments), context, "Permutation %s is too long", assignments);
+
+	strcpy(permutations[permutations_size].assignments, assignments);
+	permutations_size += 1;
+}
+
+uint32_t permutations_count(void) {
+	return permutations_size;
+}
+
+uint32_t current_permutation(void) {
+	return current;
+}
+
+void save_permutation_base(void) {
+	functions_count = 0;
+	while (get_function((function_id)functions_count) != NULL) {
+		functions_count += 1;
+	}
+
+	globals_count = 0;
+	while (get_global((global_id)globals_count) != NULL) {
+		globals_count += 1;
+	}
+
+	base_code            = (uint8_t **)calloc(functions_count, sizeof(uint8_t *));
+	base_code_sizes      = (size_t *)calloc(functions_count, sizeof(size_t));
+	base_values          = (global_value *)calloc(globals_count, sizeof(global_value));
+	base_specializations = (bool *)calloc(globals_count, sizeof(bool));
+	hashes               = (uint64_t *)calloc(functions_count * permutations_size, sizeof(uint64_t));
+	assert(base_code != NULL && base_code_sizes != NULL && base_values != NULL && base_specializations != NULL && hashes != NULL);
+
+	for (function_id i = 0; i < functions_count; ++i) {
+		function *f = get_function(i);
+		if (f->block == NULL) {
+			continue;
+		}
+
+		base_code[i] = (uint8_t *)malloc(f->code.size);
+		assert(base_code[i] != NULL);
+		memcpy(base_code[i], f->code.o, f->code.size);
+		base_code_sizes[i] = f->code.size;
+	}
+
+	for (global_id i = 0; i < globals_count; ++i) {
+		global *g               = get_global(i);
+		base_values[i]          = g->value;
+		base_specializations[i] = g->specialization;
+	}
+
+	base_variables_count = allocated_variables_count();
+}
+
+void apply_permutation(uint32_t permutation) {
+	assert(permutation < permutations_size);
+	current = permutation;
+
+	for (function_id i = 0; i < functions_count; ++i) {
+		function *f = get_function(i);
+		if (f->block == NULL) {
+			continue;
+		}
+
+		memcpy(f->code.o, base_code[i], base_code_sizes[i]);
+		f->code.size = base_code_sizes[i];
+
+		// the transforms can change which builtins and capabilities are still in use
+		f->used_builtins.builtins_analyzed         = false;
+		f->used_capabilities.capabilities_analyzed = false;
+	}
+
+	for (global_id i = 0; i < globals_count; ++i) {
+		global *g         = get_global(i);
+		g->value          = base_values[i];
+		g->specialization = base_specializations[i];
+	}
+
+	reset_allocated_variables(base_variables_count);
+
+	char assignments[1024];
+	strcpy(assignments, permutations[permutation].assignments);
+
+	debug_context context = KONG_INIT_ZERO;
+
+	for (char *assignment = strtok(assignments, ","); assignment != NULL; assignment = strtok(NULL, ",")) {
+		char *separator = strchr(assignment, '=');
+		check(separator != NULL, context, "--permutation expects name=value pairs but got %s", assignment);
+		*separator = 0;
+		specialize_global(add_name(assignment), separator + 1);
+	}
+
+	bake_specializations();
+}
+
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t size) {
+	const uint8_t *bytes = (const uint8_t *)data;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static uint64_t hash_function(function *f) {
+	function *functions[256];
+	size_t    functions_size = 0;
+
+	functions[functions_size] = f;
+	functions_size += 1;
+
+	find_referenced_functions(f, functions, &functions_size);
+
+	uint64_t hash = 0xcbf29ce484222325ull;
+
+	for (size_t i = 0; i < functions_size; ++i) {
+		hash = hash_bytes(hash, &functions[i]->name, sizeof(functions[i]->name));
+		hash = hash_bytes(hash, functions[i]->code.o, functions[i]->code.size);
+
+		global_array globals = KONG_INIT_ZERO;
+		find_referenced_globals(functions[i], &globals);
+
+		for (size_t j = 0; j < globals.size; ++j) {
+			global *g = get_global(globals.globals[j]);
+			if (global_is_scalar_constant(g)) {
+				hash = hash_bytes(hash, &g->value.kind, sizeof(g->value.kind));
+				hash = hash_bytes(hash, &g->value.value, sizeof(g->value.value));
+			}
+		}
+	}
+
+	return hash;
+}
+
+void hash_permutation(uint32_t permutation) {
+	for (function_id i = 0; i < functions_count; ++i) {
+		function *f = get_function(i);
+		if (f->block != NULL) {
+			hashes[permutation * functions_count + i] = hash_function(f);
+		}
+	}
+}
+
+static size_t function_index(function *f) {
+	for (function_id i = 0; i < functions_count; ++i) {
+		if (get_function(i) == f) {
+			return i;
+		}
+	}
+
+	debug_context context = KONG_INIT_ZERO;
+	error(context, "Function %s was added after the permutation base was saved", get_name(f->name));
+	return 0;
+}
+
+uint32_t shader_permutation(function *f, uint32_t permutation) {
+	if (permutations_size == 0) {
+		return 0;
+	}
+
+	size_t   index = function_index(f);
+	uint64_t hash  = hashes[permutation * functions_count + index];
+
+	for (uint32_t earlier = 0; earlier < permutation; ++earlier) {
+		if (hashes[earlier * functions_count + index] == hash) {
+			return earlier;
+		}
+	}
+
+	return permutation;
+}
+
+char *shader_name(function *f) {
+	uint32_t permutation = shader_permutation(f, current);
+	if (permutation == 0) {
+		return get_name(f->name);
+	}
+
+	char name[512];
+	sprintf(name, "%s_p%u", get_name(f->name), permutation);
+	return get_name(add_name(name));
+}
+
+bool shader_needs_export(function *f) {
+	return shader_permutation(f, current) == current;
+}
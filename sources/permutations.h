@@ -0,0 +1,44 @@
+#ifndef KONG_PERMUTATIONS_HEADER
+#define KONG_PERMUTATIONS_HEADER
+
+#include "functions.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_PERMUTATIONS 256
+
+// Adds a permutation given as comma separated name=value pairs for #[specialize] consts
+void add_permutation(const char *assignments);
+
+uint32_t permutations_count(void);
+
+uint32_t current_permutation(void);
+
+// Remembers the compiled code and the const values which every permutation starts from
+void save_permutation_base(void);
+
+// Resets the code to the saved base and bakes the values of the permutation, the transforms have to run afterwards
+void apply_permutation(uint32_t permutation);
+
+// Hashes the transformed code of all functions together with everything it calls and the consts it reads
+void hash_permutation(uint32_t permutation);
+
+// The first permutation which produces the same code for the shader
+uint32_t shader_permutation(function *f, uint32_t permutation);
+
+// Name of the shader's code in the current permutation, permutations which repeat an earlier one share its name
+char *shader_name(function *f);
+
+// Whether the current permutation produces new code for the shader
+bool shader_needs_export(function *f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
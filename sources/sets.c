@@ -3,6 +3,8 @@
 #include "errors.h"
 #include "global.h"
 
+#include "backends/layout.h"
+
 static descriptor_set sets[MAX_SETS];
 static size_t         sets_count = 0;
 
@@ -51,3 +53,122 @@ void add_definition_to_set(descriptor_set *set, definition def) {
 	set->globals.globals[set->globals.size] = def.global;
 	set->globals.size += 1;
 }
+
+uint32_t default_root_constants_budget(api_kind api) {
+	switch (api) {
+	case API_DIRECT3D12:
+		// leaves most of the 64 DWORD root signature to the descriptor tables
+		return 128;
+	case API_VULKAN:
+		// the smallest maxPushConstantsSize devices have to support
+		return 128;
+	case API_METAL:
+		// setBytes is meant for data up to 4 KB
+		return 4096;
+	case API_OPENGL:
+	case API_WEBGPU:
+		return 128;
+	default:
+		return 0;
+	}
+}
+
+static bool can_be_root_constants(global *g) {
+	type *t = get_type(g->type);
+
+	if (g->sets_count == 0 || t->built_in || t->array_size > 0 || g->group_shared || has_attribute(&g->attributes, add_name("indexed"))) {
+		return false;
+	}
+
+	for (size_t set_index = 0; set_index < g->sets_count; ++set_index) {
+		if (g->sets[set_index]->name == add_name("root_constants")) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void remove_from_set(descriptor_set *set, global_id g) {
+	for (size_t global_index = 0; global_index < set->globals.size; ++global_index) {
+		if (set->globals.globals[global_index] == g) {
+			for (size_t next_index = global_index + 1; next_index < set->globals.size; ++next_index) {
+				set->globals.globals[next_index - 1]  = set->globals.globals[next_index];
+				set->globals.readable[next_index - 1] = set->globals.readable[next_index];
+				set->globals.writable[next_index - 1] = set->globals.writable[next_index];
+			}
+			set->globals.size -= 1;
+			return;
+		}
+	}
+}
+
+void promote_root_constants(api_kind api, uint32_t budget, bool explicit_budget) {
+	descriptor_set *root_constants = NULL;
+	for (size_t set_index = 0; set_index < sets_count; ++set_index) {
+		if (sets[set_index].name == add_name("root_constants")) {
+			root_constants = &sets[set_index];
+		}
+	}
+
+	// shaders only take a single root constants struct
+	if (root_constants != NULL && root_constants->globals.size > 0) {
+		return;
+	}
+
+	global_id best        = 0;
+	bool      found       = false;
+	bool      best_hinted = false;
+	uint32_t  best_size   = 0;
+
+	for (global_id i = 0; get_global(i) != NULL && get_global(i)->type != NO_TYPE; ++i) {
+		global *g = get_global(i);
+
+		if (!can_be_root_constants(g)) {
+			continue;
+		}
+
+		bool hinted = has_attribute(&g->attributes, add_name("per_draw"));
+		if (!hinted && !explicit_budget) {
+			continue;
+		}
+
+		uint32_t size = struct_size(g->type, api_layout_rules(api, true));
+		if (size > budget) {
+			continue;
+		}
+
+		if (!found || (hinted && !best_hinted) || (hinted == best_hinted && size < best_size)) {
+			best        = i;
+			found       = true;
+			best_hinted = hinted;
+			best_size   = size;
+		}
+	}
+
+	if (!found) {
+		return;
+	}
+
+	global *g = get_global(best);
+
+	for (size_t set_index = 0; set_index < g->sets_count; ++set_index) {
+		remove_from_set(g->sets[set_index], best);
+	}
+	g->sets_count = 0;
+
+	// the SPIR-V backend picks the push constant storage class from the attribute
+	attribute root_constants_attribute = KONG_INIT_ZERO;
+	root_constants_attribute.name      = add_name("root_constants");
+
+	debug_context context = KONG_INIT_ZERO;
+	check(g->attributes.attributes_count < MAX_ATTRIBUTES, context, "Too many attributes to promote %s to root constants", get_name(g->name));
+
+	g->attributes.attributes[g->attributes.attributes_count] = root_constants_attribute;
+	g->attributes.attributes_count += 1;
+
+	definition d = KONG_INIT_ZERO;
+	d.kind       = DEFINITION_CONST_CUSTOM;
+	d.global     = best;
+	add_definition_to_set(create_set(add_name("root_constants")), d);
+}
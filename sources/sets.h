@@ -1,6 +1,7 @@
 #ifndef KONG_SETS_HEADER
 #define KONG_SETS_HEADER
 
+#include "api.h"
 #include "names.h"
 #include "parser.h"
 
@@ -26,6 +27,13 @@ size_t get_sets_count(void);
 
 void add_definition_to_set(descriptor_set *set, definition def);
 
+// Bytes of root or push constants a promoted global may use when no budget is given
+uint32_t default_root_constants_budget(api_kind api);
+
+// Moves a small struct const into the root_constants set so kong_set_root_constants updates it instead of a locked buffer,
+// #[per_draw] globals are picked first, an explicit budget also considers unmarked globals by their size
+void promote_root_constants(api_kind api, uint32_t budget, bool explicit_budget);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,269 @@
+#include "stats.h"
+
+#include "errors.h"
+#include "global.h"
+#include "log.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+
+typedef struct _PROCESS_MEMORY_COUNTERS {
+	unsigned long cb;
+	unsigned long PageFaultCount;
+	size_t        PeakWorkingSetSize;
+	size_t        WorkingSetSize;
+	size_t        QuotaPeakPagedPoolUsage;
+	size_t        QuotaPagedPoolUsage;
+	size_t        QuotaPeakNonPagedPoolUsage;
+	size_t        QuotaNonPagedPoolUsage;
+	size_t        PagefileUsage;
+	size_t        PeakPagefileUsage;
+} PROCESS_MEMORY_COUNTERS;
+
+__declspec(dllimport) void *__stdcall GetCurrentProcess(void);
+
+__declspec(dllimport) int __stdcall K32GetProcessMemoryInfo(void *Process, PROCESS_MEMORY_COUNTERS *ppsmemCounters, unsigned long cb);
+
+#else
+
+#include <sys/resource.h>
+
+#endif
+
+#define MAX_STATS_SCOPES (16 * 1024)
+#define MAX_STATS_DEPTH 64
+
+typedef struct stats_scope {
+	char     name[128];
+	uint32_t depth;
+	double   start;
+	double   milliseconds;
+	uint64_t memory_start;
+	uint64_t peak_memory;
+} stats_scope;
+
+static bool   enabled = false;
+static double origin  = 0.0;
+
+static stats_scope scopes[MAX_STATS_SCOPES];
+static size_t      scopes_size = 0;
+
+static size_t open_scopes[MAX_STATS_DEPTH];
+static size_t open_scopes_size = 0;
+static size_t dropped_depth    = 0;
+
+static uint64_t counters[STATS_COUNTER_COUNT];
+
+static const char *counter_names[STATS_COUNTER_COUNT] = {"files", "tokens", "ast_nodes", "functions", "opcodes", "variables", "types", "globals"};
+
+static double now_milliseconds(void) {
+	struct timespec time;
+	timespec_get(&time, TIME_UTC);
+	return (double)time.tv_sec * 1000.0 + (double)time.tv_nsec / 1000000.0;
+}
+
+static uint64_t peak_memory(void) {
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters = KONG_INIT_ZERO;
+	counters.cb                      = sizeof(counters);
+	if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) == 0) {
+		return 0;
+	}
+	return (uint64_t)counters.PeakWorkingSetSize;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+#if defined(__APPLE__)
+	return (uint64_t)usage.ru_maxrss;
+#else
+	return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+void stats_enable(void) {
+	if (!enabled) {
+		enabled = true;
+		origin  = now_milliseconds();
+	}
+}
+
+bool stats_enabled(void) {
+	return enabled;
+}
+
+void stats_begin(const char *format, ...) {
+	if (!enabled) {
+		return;
+	}
+
+	if (open_scopes_size >= MAX_STATS_DEPTH) {
+		dropped_depth += 1;
+		return;
+	}
+
+	if (scopes_size >= MAX_STATS_SCOPES) {
+		open_scopes[open_scopes_size] = MAX_STATS_SCOPES;
+		open_scopes_size += 1;
+		return;
+	}
+
+	stats_scope *scope = &scopes[scopes_size];
+
+	va_list args;
+	va_start(args, format);
+	vsnprintf(scope->name, sizeof(scope->name), format, args);
+	va_end(args);
+
+	scope->depth        = (uint32_t)open_scopes_size;
+	scope->memory_start = peak_memory();
+	scope->start        = now_milliseconds();
+
+	open_scopes[open_scopes_size] = scopes_size;
+	open_scopes_size += 1;
+	scopes_size += 1;
+}
+
+void stats_end(void) {
+	if (!enabled) {
+		return;
+	}
+
+	if (dropped_depth > 0) {
+		dropped_depth -= 1;
+		return;
+	}
+
+	debug_context context = KONG_INIT_ZERO;
+	check(open_scopes_size > 0, context, "stats_end without stats_begin");
+
+	open_scopes_size -= 1;
+
+	if (open_scopes[open_scopes_size] == MAX_STATS_SCOPES) {
+		return;
+	}
+
+	stats_scope *scope  = &scopes[open_scopes[open_scopes_size]];
+	scope->milliseconds = now_milliseconds() - scope->start;
+	scope->peak_memory  = peak_memory();
+}
+
+void stats_count(stats_counter counter, uint64_t amount) {
+	counters[counter] += amount;
+}
+
+void stats_set(stats_counter counter, uint64_t value) {
+	counters[counter] = value;
+}
+
+void stats_print(void) {
+	if (!enabled) {
+		return;
+	}
+
+	kong_log(LOG_LEVEL_INFO, "");
+	kong_log(LOG_LEVEL_INFO, "%-64s %12s %16s %16s", "Phase", "Time (ms)", "Peak (KiB)", "Growth (KiB)");
+
+	for (size_t i = 0; i < scopes_size; ++i) {
+		stats_scope *scope = &scopes[i];
+
+		// two spaces of indentation per level in front of the scope name
+		int  indentation = (int)(scope->depth < MAX_STATS_DEPTH ? scope->depth : MAX_STATS_DEPTH) * 2;
+		char name[MAX_STATS_DEPTH * 2 + sizeof(scope->name)];
+		snprintf(name, sizeof(name), "%*s%.*s", indentation, "", (int)sizeof(scope->name) - 1, scope->name);
+
+		kong_log(LOG_LEVEL_INFO, "%-64s %12.3f %16llu %16llu", name, scope->milliseconds, (unsigned long long)(scope->peak_memory / 1024),
+		         (unsigned long long)((scope->peak_memory - scope->memory_start) / 1024));
+	}
+
+	kong_log(LOG_LEVEL_INFO, "");
+	kong_log(LOG_LEVEL_INFO, "Counters:");
+
+	for (int i = 0; i < STATS_COUNTER_COUNT; ++i) {
+		kong_log(LOG_LEVEL_INFO, "  %-16s %llu", counter_names[i], (unsigned long long)counters[i]);
+	}
+
+	kong_log(LOG_LEVEL_INFO, "");
+}
+
+static void write_json_string(FILE *file, const char *string) {
+	fprintf(file, "\"");
+	for (const char *c = string; *c != 0; ++c) {
+		if (*c == '"' || *c == '\\') {
+			fprintf(file, "\\%c", *c);
+		}
+		else if ((unsigned char)*c < 0x20) {
+			fprintf(file, "\\u%04x", (unsigned char)*c);
+		}
+		else {
+			fprintf(file, "%c", *c);
+		}
+	}
+	fprintf(file, "\"");
+}
+
+void stats_write_trace(const char *filename) {
+	if (!enabled) {
+		return;
+	}
+
+	FILE *file = fopen(filename, "wb");
+
+	debug_context context = KONG_INIT_ZERO;
+	check(file != NULL, context, "Could not open %s for writing", filename);
+
+	fprintf(file, "{\"traceEvents\": [\n");
+	fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"kongruent\"}},\n");
+	fprintf(file, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"main\"}}");
+
+	for (size_t i = 0; i < scopes_size; ++i) {
+		stats_scope *scope = &scopes[i];
+
+		fprintf(file, ",\n{\"name\": ");
+		write_json_string(file, scope->name);
+		fprintf(file, ", \"cat\": \"kong\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"peak_memory\": %llu}}",
+		        (scope->start - origin) * 1000.0, scope->milliseconds * 1000.0, (unsigned long long)scope->peak_memory);
+	}
+
+	fprintf(file, "\n],\n\"displayTimeUnit\": \"ms\"}\n");
+
+	fclose(file);
+}
+
+void stats_write_json(const char *filename) {
+	if (!enabled) {
+		return;
+	}
+
+	FILE *file = fopen(filename, "wb");
+
+	debug_context context = KONG_INIT_ZERO;
+	check(file != NULL, context, "Could not open %s for writing", filename);
+
+	fprintf(file, "{\n\t\"phases\": [\n");
+
+	for (size_t i = 0; i < scopes_size; ++i) {
+		stats_scope *scope = &scopes[i];
+
+		fprintf(file, "\t\t{\"name\": ");
+		write_json_string(file, scope->name);
+		fprintf(file, ", \"depth\": %u, \"milliseconds\": %.3f, \"peak_memory\": %llu, \"memory_growth\": %llu}%s\n", scope->depth, scope->milliseconds,
+		        (unsigned long long)scope->peak_memory, (unsigned long long)(scope->peak_memory - scope->memory_start), i + 1 < scopes_size ? "," : "");
+	}
+
+	fprintf(file, "\t],\n\t\"counters\": {\n");
+
+	for (int i = 0; i < STATS_COUNTER_COUNT; ++i) {
+		fprintf(file, "\t\t\"%s\": %llu%s\n", counter_names[i], (unsigned long long)counters[i], i + 1 < STATS_COUNTER_COUNT ? "," : "");
+	}
+
+	fprintf(file, "\t}\n}\n");
+
+	fclose(file);
+}
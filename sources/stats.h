@@ -0,0 +1,45 @@
+#ifndef KONG_STATS_HEADER
+#define KONG_STATS_HEADER
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum stats_counter {
+	STATS_COUNTER_FILES,
+	STATS_COUNTER_TOKENS,
+	STATS_COUNTER_AST_NODES,
+	STATS_COUNTER_FUNCTIONS,
+	STATS_COUNTER_OPCODES,
+	STATS_COUNTER_VARIABLES,
+	STATS_COUNTER_TYPES,
+	STATS_COUNTER_GLOBALS,
+	STATS_COUNTER_COUNT
+} stats_counter;
+
+void stats_enable(void);
+
+bool stats_enabled(void);
+
+void stats_begin(const char *format, ...);
+
+void stats_end(void);
+
+void stats_count(stats_counter counter, uint64_t amount);
+
+void stats_set(stats_counter counter, uint64_t value);
+
+void stats_print(void);
+
+void stats_write_json(const char *filename);
+
+void stats_write_trace(const char *filename);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -2,6 +2,8 @@
 
 #include "compiler.h"
 #include "functions.h"
+#include "globals.h"
+#include "stats.h"
 #include "types.h"
 
 #include <assert.h>
@@ -19,6 +21,760 @@ static void copy_opcode(opcode *o) {
 	new_code.size += o->size;
 }
 
+// Loops without a hint are unrolled when they are this small
+#define AUTOMATIC_UNROLL_TRIP_COUNT 4
+#define AUTOMATIC_UNROLL_BODY_SIZE  32
+
+#define MAX_UNROLL_TRIP_COUNT 256
+#define MAX_RENAMES           1024
+
+// for (var i = a; i < b; i += c) with a, b and c int constants and no other writes to i
+typedef struct counted_loop {
+	size_t   condition_index;
+	size_t   body_index;
+	size_t   body_end;
+	size_t   end;
+	size_t   body_opcodes;
+	size_t   body_bytes;
+	uint32_t trip_count;
+} counted_loop;
+
+typedef struct renaming {
+	uint64_t from[MAX_RENAMES];
+	uint64_t to[MAX_RENAMES];
+	size_t   size;
+} renaming;
+
+static bool find_int_constant(uint8_t *data, size_t size, uint64_t var_index, int64_t *value) {
+	size_t index = 0;
+	while (index < size) {
+		opcode *o = (opcode *)&data[index];
+		if (o->type == OPCODE_LOAD_INT_CONSTANT && o->op_load_int_constant.to.index == var_index) {
+			*value = o->op_load_int_constant.number;
+			return true;
+		}
+		index += o->size;
+	}
+	return false;
+}
+
+static bool compare(opcode_type type, int64_t left, int64_t right) {
+	switch (type) {
+	case OPCODE_LESS:
+		return left < right;
+	case OPCODE_LESS_EQUAL:
+		return left <= right;
+	case OPCODE_GREATER:
+		return left > right;
+	case OPCODE_GREATER_EQUAL:
+		return left >= right;
+	default:
+		return left != right;
+	}
+}
+
+static bool is_store_variable(opcode_type type) {
+	return type == OPCODE_STORE_VARIABLE || type == OPCODE_SUB_AND_STORE_VARIABLE || type == OPCODE_ADD_AND_STORE_VARIABLE ||
+	       type == OPCODE_DIVIDE_AND_STORE_VARIABLE || type == OPCODE_MULTIPLY_AND_STORE_VARIABLE;
+}
+
+static bool find_counted_loop(uint8_t *data, size_t size, opcode *previous, size_t start_index, counted_loop *loop) {
+	opcode *start = (opcode *)&data[start_index];
+
+	if (previous == NULL || previous->type != OPCODE_STORE_VARIABLE) {
+		return false;
+	}
+
+	uint64_t counter = previous->op_store_var.to.index;
+
+	int64_t initial_value;
+	if (!find_int_constant(data, size, previous->op_store_var.from.index, &initial_value)) {
+		return false;
+	}
+
+	loop->condition_index = start_index + start->size;
+
+	opcode *bound = (opcode *)&data[loop->condition_index];
+	if (bound->type != OPCODE_LOAD_INT_CONSTANT) {
+		return false;
+	}
+
+	opcode *comparison = (opcode *)&data[loop->condition_index + bound->size];
+	if (comparison->type != OPCODE_LESS && comparison->type != OPCODE_LESS_EQUAL && comparison->type != OPCODE_GREATER &&
+	    comparison->type != OPCODE_GREATER_EQUAL && comparison->type != OPCODE_NOT_EQUALS) {
+		return false;
+	}
+
+	bool counter_on_the_left  = comparison->op_binary.left.index == counter && comparison->op_binary.right.index == bound->op_load_int_constant.to.index;
+	bool counter_on_the_right = comparison->op_binary.right.index == counter && comparison->op_binary.left.index == bound->op_load_int_constant.to.index;
+	if (!counter_on_the_left && !counter_on_the_right) {
+		return false;
+	}
+
+	size_t condition_end = loop->condition_index + bound->size + comparison->size;
+
+	opcode *condition = (opcode *)&data[condition_end];
+	if (condition->type != OPCODE_WHILE_CONDITION || condition->op_while.condition.index != comparison->op_binary.result.index) {
+		return false;
+	}
+
+	opcode *body_start = (opcode *)&data[condition_end + condition->size];
+	if (body_start->type != OPCODE_BLOCK_START || body_start->op_block.start_id != start->op_while_start.continue_id) {
+		return false;
+	}
+
+	loop->body_index   = condition_end + condition->size + body_start->size;
+	loop->body_opcodes = 0;
+
+	opcode *increment      = NULL;
+	size_t  counter_writes = 0;
+
+	size_t index = loop->body_index;
+	for (;;) {
+		if (index >= size) {
+			return false;
+		}
+
+		opcode *o = (opcode *)&data[index];
+
+		if (o->type == OPCODE_BLOCK_END && o->op_block.end_id == body_start->op_block.end_id) {
+			break;
+		}
+
+		// nested loops are unrolled first, returns and discards would end the unrolled code in the middle of a block
+		if (o->type == OPCODE_WHILE_START || o->type == OPCODE_WHILE_CONDITION || o->type == OPCODE_WHILE_END || o->type == OPCODE_WHILE_BODY ||
+		    o->type == OPCODE_RETURN || o->type == OPCODE_DISCARD) {
+			return false;
+		}
+
+		if (is_store_variable(o->type) && o->op_store_var.to.index == counter) {
+			counter_writes += 1;
+		}
+
+		increment = o;
+		loop->body_opcodes += 1;
+		index += o->size;
+	}
+
+	loop->body_end   = index;
+	loop->body_bytes = loop->body_end - loop->body_index;
+
+	// the counter is only written by the increment at the end of the body
+	if (counter_writes != 1 || increment == NULL || (increment->type != OPCODE_ADD_AND_STORE_VARIABLE && increment->type != OPCODE_SUB_AND_STORE_VARIABLE) ||
+	    increment->op_store_var.to.index != counter) {
+		return false;
+	}
+
+	int64_t step;
+	if (!find_int_constant(data, size, increment->op_store_var.from.index, &step)) {
+		return false;
+	}
+	if (increment->type == OPCODE_SUB_AND_STORE_VARIABLE) {
+		step = -step;
+	}
+
+	opcode *body_end = (opcode *)&data[loop->body_end];
+	opcode *end      = (opcode *)&data[loop->body_end + body_end->size];
+	if (end->type != OPCODE_WHILE_END || end->op_while_end.end_id != start->op_while_start.end_id) {
+		return false;
+	}
+	loop->end = loop->body_end + body_end->size + end->size;
+
+	int64_t bound_value = bound->op_load_int_constant.number;
+	int64_t value       = initial_value;
+
+	loop->trip_count = 0;
+	while (counter_on_the_left ? compare(comparison->type, value, bound_value) : compare(comparison->type, bound_value, value)) {
+		value += step;
+		loop->trip_count += 1;
+
+		if (loop->trip_count > MAX_UNROLL_TRIP_COUNT) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static uint64_t renamed_index(renaming *r, uint64_t index) {
+	for (size_t i = 0; i < r->size; ++i) {
+		if (r->from[i] == index) {
+			return r->to[i];
+		}
+	}
+	return index;
+}
+
+static void add_rename(renaming *r, uint64_t from, uint64_t to) {
+	assert(r->size < MAX_RENAMES);
+	r->from[r->size] = from;
+	r->to[r->size]   = to;
+	r->size += 1;
+}
+
+static void rename_access_list(renaming *r, kong_access *access_list, uint8_t access_list_size) {
+	for (uint8_t access_index = 0; access_index < access_list_size; ++access_index) {
+		if (access_list[access_index].kind == ACCESS_ELEMENT) {
+			access_list[access_index].access_element.index.index = renamed_index(r, access_list[access_index].access_element.index.index);
+		}
+	}
+}
+
+static void rename_opcode(renaming *r, opcode *o) {
+	switch (o->type) {
+	case OPCODE_VAR:
+		o->op_var.var.index = renamed_index(r, o->op_var.var.index);
+		break;
+	case OPCODE_NOT:
+	case OPCODE_NEGATE:
+		o->op_negate.from.index = renamed_index(r, o->op_negate.from.index);
+		o->op_negate.to.index   = renamed_index(r, o->op_negate.to.index);
+		break;
+	case OPCODE_STORE_VARIABLE:
+	case OPCODE_SUB_AND_STORE_VARIABLE:
+	case OPCODE_ADD_AND_STORE_VARIABLE:
+	case OPCODE_DIVIDE_AND_STORE_VARIABLE:
+	case OPCODE_MULTIPLY_AND_STORE_VARIABLE:
+		o->op_store_var.from.index = renamed_index(r, o->op_store_var.from.index);
+		o->op_store_var.to.index   = renamed_index(r, o->op_store_var.to.index);
+		break;
+	case OPCODE_STORE_ACCESS_LIST:
+	case OPCODE_SUB_AND_STORE_ACCESS_LIST:
+	case OPCODE_ADD_AND_STORE_ACCESS_LIST:
+	case OPCODE_DIVIDE_AND_STORE_ACCESS_LIST:
+	case OPCODE_MULTIPLY_AND_STORE_ACCESS_LIST:
+		o->op_store_access_list.from.index = renamed_index(r, o->op_store_access_list.from.index);
+		o->op_store_access_list.to.index   = renamed_index(r, o->op_store_access_list.to.index);
+		rename_access_list(r, o->op_store_access_list.access_list, o->op_store_access_list.access_list_size);
+		break;
+	case OPCODE_LOAD_FLOAT_CONSTANT:
+		o->op_load_float_constant.to.index = renamed_index(r, o->op_load_float_constant.to.index);
+		break;
+	case OPCODE_LOAD_INT_CONSTANT:
+		o->op_load_int_constant.to.index = renamed_index(r, o->op_load_int_constant.to.index);
+		break;
+	case OPCODE_LOAD_BOOL_CONSTANT:
+		o->op_load_bool_constant.to.index = renamed_index(r, o->op_load_bool_constant.to.index);
+		break;
+	case OPCODE_LOAD_ACCESS_LIST:
+		o->op_load_access_list.from.index = renamed_index(r, o->op_load_access_list.from.index);
+		o->op_load_access_list.to.index   = renamed_index(r, o->op_load_access_list.to.index);
+		rename_access_list(r, o->op_load_access_list.access_list, o->op_load_access_list.access_list_size);
+		break;
+	case OPCODE_CALL:
+		o->op_call.var.index = renamed_index(r, o->op_call.var.index);
+		for (uint8_t parameter_index = 0; parameter_index < o->op_call.parameters_size; ++parameter_index) {
+			o->op_call.parameters[parameter_index].index = renamed_index(r, o->op_call.parameters[parameter_index].index);
+		}
+		break;
+	case OPCODE_ATOMIC:
+		o->op_atomic.var.index   = renamed_index(r, o->op_atomic.var.index);
+		o->op_atomic.to.index    = renamed_index(r, o->op_atomic.to.index);
+		o->op_atomic.index.index = renamed_index(r, o->op_atomic.index.index);
+		for (uint8_t value_index = 0; value_index < o->op_atomic.values_size; ++value_index) {
+			o->op_atomic.values[value_index].index = renamed_index(r, o->op_atomic.values[value_index].index);
+		}
+		break;
+	case OPCODE_IF:
+		o->op_if.condition.index = renamed_index(r, o->op_if.condition.index);
+		o->op_if.start_id        = renamed_index(r, o->op_if.start_id);
+		o->op_if.end_id          = renamed_index(r, o->op_if.end_id);
+		break;
+	case OPCODE_BLOCK_START:
+	case OPCODE_BLOCK_END:
+		o->op_block.start_id = renamed_index(r, o->op_block.start_id);
+		o->op_block.end_id   = renamed_index(r, o->op_block.end_id);
+		break;
+	default:
+		o->op_binary.left.index   = renamed_index(r, o->op_binary.left.index);
+		o->op_binary.right.index  = renamed_index(r, o->op_binary.right.index);
+		o->op_binary.result.index = renamed_index(r, o->op_binary.result.index);
+		break;
+	}
+}
+
+static void add_definition(renaming *r, variable v) {
+	add_rename(r, v.index, allocate_variable(v.type, v.kind).index);
+}
+
+// Every copy of a loop body gets its own values and block ids
+static void copy_loop_body(uint8_t *data, counted_loop *loop, bool fresh_names) {
+	static renaming r;
+	r.size = 0;
+
+	size_t index = loop->body_index;
+	while (fresh_names && index < loop->body_end) {
+		opcode *o = (opcode *)&data[index];
+
+		switch (o->type) {
+		case OPCODE_VAR:
+			add_definition(&r, o->op_var.var);
+			break;
+		case OPCODE_NOT:
+		case OPCODE_NEGATE:
+			add_definition(&r, o->op_negate.to);
+			break;
+		case OPCODE_LOAD_FLOAT_CONSTANT:
+			add_definition(&r, o->op_load_float_constant.to);
+			break;
+		case OPCODE_LOAD_INT_CONSTANT:
+			add_definition(&r, o->op_load_int_constant.to);
+			break;
+		case OPCODE_LOAD_BOOL_CONSTANT:
+			add_definition(&r, o->op_load_bool_constant.to);
+			break;
+		case OPCODE_LOAD_ACCESS_LIST:
+			add_definition(&r, o->op_load_access_list.to);
+			break;
+		case OPCODE_CALL:
+			add_definition(&r, o->op_call.var);
+			break;
+		case OPCODE_ATOMIC:
+			add_definition(&r, o->op_atomic.var);
+			break;
+		case OPCODE_BLOCK_START:
+			add_rename(&r, o->op_block.start_id, allocate_block_id());
+			add_rename(&r, o->op_block.end_id, allocate_block_id());
+			break;
+		case OPCODE_MULTIPLY:
+		case OPCODE_DIVIDE:
+		case OPCODE_MOD:
+		case OPCODE_ADD:
+		case OPCODE_SUB:
+		case OPCODE_EQUALS:
+		case OPCODE_NOT_EQUALS:
+		case OPCODE_GREATER:
+		case OPCODE_GREATER_EQUAL:
+		case OPCODE_LESS:
+		case OPCODE_LESS_EQUAL:
+		case OPCODE_AND:
+		case OPCODE_OR:
+		case OPCODE_BITWISE_XOR:
+		case OPCODE_BITWISE_AND:
+		case OPCODE_BITWISE_OR:
+		case OPCODE_LEFT_SHIFT:
+		case OPCODE_RIGHT_SHIFT:
+			add_definition(&r, o->op_binary.result);
+			break;
+		default:
+			break;
+		}
+
+		index += o->size;
+	}
+
+	index = loop->body_index;
+	while (index < loop->body_end) {
+		opcode *o = (opcode *)&data[index];
+
+		static opcode copy;
+		memcpy(&copy, o, o->size);
+		rename_opcode(&r, &copy);
+		copy_opcode(&copy);
+
+		index += o->size;
+	}
+}
+
+static bool unroll_loops(function *f) {
+	uint8_t *data = f->code.o;
+	size_t   size = f->code.size;
+
+	new_code.size = 0;
+
+	bool unrolled = false;
+
+	opcode *previous = NULL;
+
+	// loops without a hint inside of a fully unrolled loop are unrolled, too
+	bool   enclosing_unrolled[64];
+	size_t loop_depth = 0;
+
+	size_t index = 0;
+	while (index < size) {
+		opcode *o = (opcode *)&data[index];
+
+		bool inside_unrolled_loop = loop_depth > 0 && enclosing_unrolled[loop_depth - 1];
+
+		counted_loop loop;
+		if (o->type == OPCODE_WHILE_START && o->op_while_start.hint != LOOP_HINT_LOOP && find_counted_loop(data, size, previous, index, &loop)) {
+			uint32_t factor = 0;
+
+			if (o->op_while_start.hint == LOOP_HINT_NONE && inside_unrolled_loop) {
+				factor = loop.trip_count;
+			}
+			else if (o->op_while_start.hint == LOOP_HINT_UNROLL) {
+				factor = o->op_while_start.unroll_count == 0 || o->op_while_start.unroll_count > loop.trip_count ? loop.trip_count
+				                                                                                                : o->op_while_start.unroll_count;
+			}
+			else if (loop.trip_count <= AUTOMATIC_UNROLL_TRIP_COUNT && loop.body_opcodes * loop.trip_count <= AUTOMATIC_UNROLL_BODY_SIZE) {
+				factor = loop.trip_count;
+			}
+
+			uint32_t copies = factor == 0 || factor == loop.trip_count ? loop.trip_count : loop.trip_count % factor + factor;
+
+			if (factor > 0 && new_code.size + loop.body_bytes * copies + (loop.end - index) + (size - loop.end) < OPCODES_SIZE) {
+				if (factor == loop.trip_count) {
+					for (uint32_t copy_index = 0; copy_index < loop.trip_count; ++copy_index) {
+						copy_loop_body(data, &loop, copy_index > 0);
+					}
+				}
+				else {
+					// the remaining iterations run first so the loop only runs whole groups of factor iterations
+					for (uint32_t copy_index = 0; copy_index < loop.trip_count % factor; ++copy_index) {
+						copy_loop_body(data, &loop, true);
+					}
+
+					opcode start                      = *o;
+					start.op_while_start.hint         = LOOP_HINT_NONE;
+					start.op_while_start.unroll_count = 0;
+					copy_opcode(&start);
+
+					for (size_t condition_index = loop.condition_index; condition_index < loop.body_index;) {
+						opcode *condition = (opcode *)&data[condition_index];
+						copy_opcode(condition);
+						condition_index += condition->size;
+					}
+
+					for (uint32_t copy_index = 0; copy_index < factor; ++copy_index) {
+						copy_loop_body(data, &loop, copy_index > 0);
+					}
+
+					for (size_t end_index = loop.body_end; end_index < loop.end;) {
+						opcode *end = (opcode *)&data[end_index];
+						copy_opcode(end);
+						end_index += end->size;
+					}
+				}
+
+				unrolled = true;
+				previous = NULL;
+				index    = loop.end;
+				continue;
+			}
+		}
+
+		if (o->type == OPCODE_WHILE_START) {
+			assert(loop_depth < 64);
+			enclosing_unrolled[loop_depth] = (o->op_while_start.hint == LOOP_HINT_UNROLL && o->op_while_start.unroll_count == 0) ||
+			                                 (o->op_while_start.hint == LOOP_HINT_NONE && inside_unrolled_loop);
+			loop_depth += 1;
+		}
+		else if (o->type == OPCODE_WHILE_END) {
+			loop_depth -= 1;
+		}
+
+		copy_opcode(o);
+		previous = o;
+		index += o->size;
+	}
+
+	f->code = new_code;
+
+	return unrolled;
+}
+
+#define MAX_KNOWN_VALUES 4096
+
+// A global const or an internal variable which is only ever assigned a constant
+typedef struct known_value {
+	uint64_t var_index;
+	type_id  type;
+	double   number;
+} known_value;
+
+static known_value known_values[MAX_KNOWN_VALUES];
+static size_t      known_values_size = 0;
+
+static bool is_foldable_type(type_id type) {
+	return type == float_id || type == int_id || type == uint_id || type == bool_id;
+}
+
+static void add_known_value(variable v, double number) {
+	if (known_values_size >= MAX_KNOWN_VALUES || !is_foldable_type(v.type.type)) {
+		return;
+	}
+
+	known_values[known_values_size].var_index = v.index;
+	known_values[known_values_size].type      = v.type.type;
+	known_values[known_values_size].number    = number;
+	known_values_size += 1;
+}
+
+static bool find_known_value(variable v, double *number) {
+	for (size_t i = 0; i < known_values_size; ++i) {
+		if (known_values[i].var_index == v.index) {
+			*number = known_values[i].number;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Rounds the way the result type would
+static double fit_to_type(type_id type, double number) {
+	if (type == float_id) {
+		return (float)number;
+	}
+	else if (type == int_id) {
+		return (int32_t)(int64_t)number;
+	}
+	else if (type == uint_id) {
+		return (uint32_t)(int64_t)number;
+	}
+	else {
+		return number != 0.0 ? 1.0 : 0.0;
+	}
+}
+
+static bool fold_binary(opcode_type type, type_id operand_type, double left, double right, double *result) {
+	bool integer = operand_type != float_id;
+
+	switch (type) {
+	case OPCODE_ADD:
+		*result = left + right;
+		return true;
+	case OPCODE_SUB:
+		*result = left - right;
+		return true;
+	case OPCODE_MULTIPLY:
+		*result = left * right;
+		return true;
+	case OPCODE_DIVIDE:
+		if (right == 0.0) {
+			return false;
+		}
+		*result = integer ? (double)((int64_t)left / (int64_t)right) : left / right;
+		return true;
+	case OPCODE_MOD:
+		if (!integer || right == 0.0) {
+			return false;
+		}
+		*result = (double)((int64_t)left % (int64_t)right);
+		return true;
+	case OPCODE_EQUALS:
+		*result = left == right;
+		return true;
+	case OPCODE_NOT_EQUALS:
+		*result = left != right;
+		return true;
+	case OPCODE_GREATER:
+		*result = left > right;
+		return true;
+	case OPCODE_GREATER_EQUAL:
+		*result = left >= right;
+		return true;
+	case OPCODE_LESS:
+		*result = left < right;
+		return true;
+	case OPCODE_LESS_EQUAL:
+		*result = left <= right;
+		return true;
+	case OPCODE_AND:
+		*result = left != 0.0 && right != 0.0;
+		return true;
+	case OPCODE_OR:
+		*result = left != 0.0 || right != 0.0;
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Replaces the computation of a known value with a load of the constant when there is an opcode for that
+static bool write_known_value(variable to, double number) {
+	// zeroed so the same folds always produce the same bytes, permutations are compared by hashing them
+	opcode o;
+	memset(&o, 0, sizeof(o));
+
+	if (to.type.type == float_id) {
+		o.type                          = OPCODE_LOAD_FLOAT_CONSTANT;
+		o.size                          = OP_SIZE(o, op_load_float_constant);
+		o.op_load_float_constant.number = (float)number;
+		o.op_load_float_constant.to     = to;
+	}
+	else if (to.type.type == int_id) {
+		o.type                        = OPCODE_LOAD_INT_CONSTANT;
+		o.size                        = OP_SIZE(o, op_load_int_constant);
+		o.op_load_int_constant.number = (int)number;
+		o.op_load_int_constant.to     = to;
+	}
+	else if (to.type.type == bool_id) {
+		o.type                          = OPCODE_LOAD_BOOL_CONSTANT;
+		o.size                          = OP_SIZE(o, op_load_bool_constant);
+		o.op_load_bool_constant.boolean = number != 0.0;
+		o.op_load_bool_constant.to      = to;
+	}
+	else {
+		return false;
+	}
+
+	copy_opcode(&o);
+	return true;
+}
+
+// Evaluates everything that only depends on constants and removes the branches of ifs whose conditions are known,
+// with baked #[specialize] consts this drops all code which a permutation does not use
+static void fold_constants(function *f) {
+	uint8_t *data = f->code.o;
+	size_t   size = f->code.size;
+
+	new_code.size = 0;
+
+	known_values_size = 0;
+	for (global_id i = 0; get_global(i) != NULL; ++i) {
+		global *g = get_global(i);
+		if (g->specialization || !global_is_scalar_constant(g) || g->var_index == 0) {
+			continue;
+		}
+
+		variable v;
+		v.kind      = VARIABLE_GLOBAL;
+		v.index     = g->var_index;
+		v.type.type = g->type;
+
+		switch (g->value.kind) {
+		case GLOBAL_VALUE_BOOL:
+			add_known_value(v, g->value.value.b ? 1.0 : 0.0);
+			break;
+		case GLOBAL_VALUE_INT:
+			add_known_value(v, g->value.value.ints[0]);
+			break;
+		case GLOBAL_VALUE_UINT:
+			add_known_value(v, g->value.value.uints[0]);
+			break;
+		default:
+			add_known_value(v, g->value.value.floats[0]);
+			break;
+		}
+	}
+
+	// blocks of ifs which are always taken, they lose their condition
+	uint64_t unconditional_blocks[256];
+	size_t   unconditional_blocks_size = 0;
+
+	size_t index = 0;
+	while (index < size) {
+		opcode *o = (opcode *)&data[index];
+
+		double left;
+		double right;
+		double result;
+
+		switch (o->type) {
+		case OPCODE_LOAD_FLOAT_CONSTANT:
+			if (o->op_load_float_constant.to.kind == VARIABLE_INTERNAL) {
+				add_known_value(o->op_load_float_constant.to, o->op_load_float_constant.number);
+			}
+			copy_opcode(o);
+			break;
+		case OPCODE_LOAD_INT_CONSTANT:
+			if (o->op_load_int_constant.to.kind == VARIABLE_INTERNAL) {
+				add_known_value(o->op_load_int_constant.to, o->op_load_int_constant.number);
+			}
+			copy_opcode(o);
+			break;
+		case OPCODE_LOAD_BOOL_CONSTANT:
+			if (o->op_load_bool_constant.to.kind == VARIABLE_INTERNAL) {
+				add_known_value(o->op_load_bool_constant.to, o->op_load_bool_constant.boolean ? 1.0 : 0.0);
+			}
+			copy_opcode(o);
+			break;
+		case OPCODE_NOT:
+			if (o->op_not.to.kind == VARIABLE_INTERNAL && is_foldable_type(o->op_not.to.type.type) && find_known_value(o->op_not.from, &left)) {
+				add_known_value(o->op_not.to, left == 0.0 ? 1.0 : 0.0);
+				if (!write_known_value(o->op_not.to, left == 0.0 ? 1.0 : 0.0)) {
+					copy_opcode(o);
+				}
+			}
+			else {
+				copy_opcode(o);
+			}
+			break;
+		case OPCODE_NEGATE:
+			if (o->op_negate.to.kind == VARIABLE_INTERNAL && is_foldable_type(o->op_negate.to.type.type) &&
+			    find_known_value(o->op_negate.from, &left)) {
+				result = fit_to_type(o->op_negate.to.type.type, -left);
+				add_known_value(o->op_negate.to, result);
+				if (!write_known_value(o->op_negate.to, result)) {
+					copy_opcode(o);
+				}
+			}
+			else {
+				copy_opcode(o);
+			}
+			break;
+		case OPCODE_ADD:
+		case OPCODE_SUB:
+		case OPCODE_MULTIPLY:
+		case OPCODE_DIVIDE:
+		case OPCODE_MOD:
+		case OPCODE_EQUALS:
+		case OPCODE_NOT_EQUALS:
+		case OPCODE_GREATER:
+		case OPCODE_GREATER_EQUAL:
+		case OPCODE_LESS:
+		case OPCODE_LESS_EQUAL:
+		case OPCODE_AND:
+		case OPCODE_OR:
+			if (o->op_binary.result.kind == VARIABLE_INTERNAL && is_foldable_type(o->op_binary.result.type.type) &&
+			    find_known_value(o->op_binary.left, &left) && find_known_value(o->op_binary.right, &right) &&
+			    fold_binary(o->type, o->op_binary.left.type.type, left, right, &result)) {
+				result = fit_to_type(o->op_binary.result.type.type, result);
+				add_known_value(o->op_binary.result, result);
+				if (!write_known_value(o->op_binary.result, result)) {
+					copy_opcode(o);
+				}
+			}
+			else {
+				copy_opcode(o);
+			}
+			break;
+		case OPCODE_IF:
+			if (find_known_value(o->op_if.condition, &left)) {
+				if (left == 0.0) {
+					uint64_t end_id = o->op_if.end_id;
+
+					index += o->size;
+					for (;;) {
+						opcode *skipped = (opcode *)&data[index];
+						index += skipped->size;
+						if (skipped->type == OPCODE_BLOCK_END && skipped->op_block.end_id == end_id) {
+							break;
+						}
+					}
+					continue;
+				}
+				else if (unconditional_blocks_size < 256) {
+					unconditional_blocks[unconditional_blocks_size] = o->op_if.start_id;
+					unconditional_blocks_size += 1;
+					break;
+				}
+			}
+			copy_opcode(o);
+			break;
+		case OPCODE_BLOCK_START:
+		case OPCODE_BLOCK_END: {
+			opcode block = *o;
+			for (size_t block_index = 0; block_index < unconditional_blocks_size; ++block_index) {
+				if (unconditional_blocks[block_index] == block.op_block.start_id) {
+					block.op_block.condition_block = false;
+				}
+			}
+			copy_opcode(&block);
+			break;
+		}
+		default:
+			copy_opcode(o);
+			break;
+		}
+
+		index += o->size;
+	}
+
+	f->code = new_code;
+}
+
 void transform(uint32_t flags) {
 	for (function_id i = 0; get_function(i) != NULL; ++i) {
 		function *f = get_function(i);
@@ -27,6 +783,17 @@ void transform(uint32_t flags) {
 			continue;
 		}
 
+		stats_begin("transform %s", get_name(f->name));
+
+		if ((flags & TRANSFORM_FLAG_UNROLL_LOOPS) != 0) {
+			// inner loops go first, the loops around them can follow once their bodies are straight
+			while (unroll_loops(f)) {}
+		}
+
+		if ((flags & TRANSFORM_FLAG_FOLD_CONSTANTS) != 0) {
+			fold_constants(f);
+		}
+
 		uint8_t *data = f->code.o;
 		size_t   size = f->code.size;
 
@@ -337,5 +1104,7 @@ void transform(uint32_t flags) {
 		}
 
 		f->code = new_code;
+
+		stats_end();
 	}
 }
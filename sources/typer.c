@@ -9,6 +9,7 @@
 #include "log.h"
 #include "names.h"
 #include "parser.h"
+#include "stats.h"
 #include "tokenizer.h"
 #include "types.h"
 
@@ -64,6 +65,12 @@ static void resolve_types_in_element(statement *parent_block, expression *elemen
 		else if (of->tex_format == TEXTURE_FORMAT_DEPTH) {
 			element->type.type = float_id;
 		}
+		else if (of->tex_format == TEXTURE_FORMAT_R32_UINT) {
+			element->type.type = uint_id;
+		}
+		else if (of->tex_format == TEXTURE_FORMAT_R32_SINT) {
+			element->type.type = int_id;
+		}
 		else {
 			// TODO
 			assert(false);
@@ -194,6 +201,9 @@ static void resolve_types_in_member(statement *parent_block, expression *member)
 				break;
 			}
 		}
+		else if (is_16bit_type(of_type)) {
+			member->type.type = vector_to_size(vector_base_type(of_type), swizzle_size);
+		}
 		else if (of_type == bool_id || of_type == bool2_id || of_type == bool3_id || of_type == bool4_id) {
 			switch (swizzle_size) {
 			case 1:
@@ -237,6 +247,12 @@ static bool types_compatible(type_id left, type_id right) {
 		return true;
 	}
 
+	// 16 bit types only mix with vectors and scalars of their own kind, everything else needs a constructor
+	if (is_16bit_type(left) || is_16bit_type(right)) {
+		return is_vector_or_scalar(left) && is_vector_or_scalar(right) && vector_base_type(left) == vector_base_type(right) &&
+		       (vector_size(left) == 1 || vector_size(right) == 1);
+	}
+
 	if ((left == int_id && right == float_id) || (left == float_id && right == int_id)) {
 		return true;
 	}
@@ -312,6 +328,10 @@ static type_ref upgrade_type(type_ref left_type, type_ref right_type) {
 		return left_type;
 	}
 
+	if (is_16bit_type(left) || is_16bit_type(right)) {
+		return vector_size(left) >= vector_size(right) ? left_type : right_type;
+	}
+
 	if (left == int_id && right == float_id) {
 		return right_type;
 	}
@@ -431,11 +451,126 @@ static type_ref upgrade_type(type_ref left_type, type_ref right_type) {
 	return left_type;
 }
 
+// Literals have no precision of their own, next to a 16 bit value they take its type instead of widening the expression
+static void adopt_literal_type(expression *e, type_id other) {
+	if (!is_16bit_type(other)) {
+		return;
+	}
+
+	type_id base = is_matrix(other) ? half_id : vector_base_type(other);
+
+	switch (e->kind) {
+	case EXPRESSION_FLOAT:
+		if (base == half_id) {
+			e->type.type = half_id;
+		}
+		break;
+	case EXPRESSION_INT:
+		if (base == short_id || base == ushort_id) {
+			e->type.type = base;
+		}
+		break;
+	case EXPRESSION_GROUPING:
+		adopt_literal_type(e->grouping, other);
+		e->type = e->grouping->type;
+		break;
+	case EXPRESSION_UNARY:
+		if (e->unary.op == OPERATOR_MINUS || e->unary.op == OPERATOR_PLUS) {
+			adopt_literal_type(e->unary.right, other);
+			e->type = e->unary.right->type;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+// Wave reductions and broadcasts return whatever they are given
+static bool is_generic_wave_function(name_id name) {
+	return name == add_name("wave_sum") || name == add_name("wave_min") || name == add_name("wave_max") || name == add_name("wave_prefix_sum") ||
+	       name == add_name("wave_read_first") || name == add_name("wave_read_lane");
+}
+
+static bool is_float_math_function(name_id name) {
+	const char *names[] = {"sin", "cos", "asin", "acos", "atan", "atan2", "length", "distance", "frac", "abs", "floor", "ceil", "round", "sqrt", "rsqrt",
+	                       "min", "max", "clamp", "step", "smoothstep", "pow", "dot", "cross", "normalize", "reflect", "saturate", "saturate3", "lerp",
+	                       "ddx", "ddy"};
+	for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+		if (name == add_name(names[i])) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// The float built-ins keep the precision of half arguments, literals next to them become halfs and floats need a constructor
+static void resolve_half_math_call(expression *e) {
+	type_id widest = NO_TYPE;
+	for (size_t i = 0; i < e->call.parameters.size; ++i) {
+		type_id t = e->call.parameters.e[i]->type.type;
+		if (is_16bit_type(t) && is_vector_or_scalar(t) && vector_base_type(t) == half_id && (widest == NO_TYPE || vector_size(t) > vector_size(widest))) {
+			widest = t;
+		}
+	}
+
+	if (widest == NO_TYPE) {
+		return;
+	}
+
+	for (size_t i = 0; i < e->call.parameters.size; ++i) {
+		adopt_literal_type(e->call.parameters.e[i], widest);
+
+		type_id       t       = e->call.parameters.e[i]->type.type;
+		debug_context context = KONG_INIT_ZERO;
+		check(!is_vector_or_scalar(t) || vector_base_type(t) != float_id, context, "%s mixes half and float parameters, convert them with a constructor",
+		      get_name(e->call.func_name));
+	}
+
+	bool reduces = e->call.func_name == add_name("length") || e->call.func_name == add_name("distance") || e->call.func_name == add_name("dot");
+	e->type.type = reduces ? half_id : widest;
+}
+
+// Atomics work directly on an element of a buffer, of a group shared array or of a writable integer texture
+static void check_atomic_call(expression *e) {
+	debug_context context = KONG_INIT_ZERO;
+
+	size_t values_size = e->call.func_name == add_name("atomic_compare_exchange") ? 2 : 1;
+	check(e->call.parameters.size == values_size + 1, context, "%s requires %zu parameters", get_name(e->call.func_name), values_size + 1);
+
+	expression *target = e->call.parameters.e[0];
+	check(target->kind == EXPRESSION_ELEMENT && target->element.of->kind == EXPRESSION_VARIABLE, context,
+	      "The first parameter of %s has to be an element of a global", get_name(e->call.func_name));
+
+	global *g = find_global(target->element.of->variable);
+	check(g != NULL, context, "The first parameter of %s has to be an element of a global", get_name(e->call.func_name));
+
+	type *t = get_type(g->type);
+	if (t->tex_kind != TEXTURE_KIND_NONE) {
+		check(t->tex_kind == TEXTURE_KIND_2D && has_attribute(&g->attributes, add_name("write")), context, "%s requires a writable 2D texture",
+		      get_name(e->call.func_name));
+	}
+	else {
+		check(g->group_shared || global_is_buffer(g), context, "%s requires a buffer, a group shared array or a texture", get_name(e->call.func_name));
+	}
+
+	type_id element_type = target->type.type;
+	check(element_type == uint_id || element_type == int_id, context, "%s only works on int and uint elements", get_name(e->call.func_name));
+
+	for (size_t i = 1; i < e->call.parameters.size; ++i) {
+		type_id value_type = e->call.parameters.e[i]->type.type;
+		check(value_type == uint_id || value_type == int_id, context, "%s only takes int and uint values", get_name(e->call.func_name));
+	}
+
+	e->type = target->type;
+}
+
 void resolve_types_in_expression(statement *parent, expression *e) {
 	switch (e->kind) {
 	case EXPRESSION_BINARY: {
 		resolve_types_in_expression(parent, e->binary.left);
 		resolve_types_in_expression(parent, e->binary.right);
+		adopt_literal_type(e->binary.left, e->binary.right->type.type);
+		adopt_literal_type(e->binary.right, e->binary.left->type.type);
 		switch (e->binary.op) {
 		case OPERATOR_EQUALS:
 		case OPERATOR_NOT_EQUALS:
@@ -460,7 +595,8 @@ void resolve_types_in_expression(statement *parent, expression *e) {
 		case OPERATOR_MULTIPLY_ASSIGN: {
 			type_id left_type  = e->binary.left->type.type;
 			type_id right_type = e->binary.right->type.type;
-			if ((left_type == float4x4_id && right_type == float4_id) || (left_type == float3x3_id && right_type == float3_id)) {
+			if ((left_type == float4x4_id && right_type == float4_id) || (left_type == float3x3_id && right_type == float3_id) ||
+			    (left_type == half4x4_id && right_type == half4_id) || (left_type == half3x3_id && right_type == half3_id)) {
 				e->type = e->binary.right->type;
 			}
 			else if (right_type == float_id && (left_type == float2_id || left_type == float3_id || left_type == float4_id)) {
@@ -580,7 +716,15 @@ void resolve_types_in_expression(statement *parent, expression *e) {
 		break;
 	}
 	case EXPRESSION_CALL: {
-		if (e->call.func_name == add_name("sample") || e->call.func_name == add_name("sample_lod")) {
+		e->call.func_name = resolve_type_alias(e->call.func_name);
+
+		if (e->call.func_name == add_name("sample_compare")) {
+			e->type.type = float_id;
+		}
+		else if (is_gather_function(e->call.func_name)) {
+			e->type.type = float4_id;
+		}
+		else if (is_texture_function(e->call.func_name)) {
 			if (e->call.parameters.e[0]->kind == EXPRESSION_VARIABLE) {
 				global *g = find_global(e->call.parameters.e[0]->variable);
 				assert(g != NULL);
@@ -605,8 +749,36 @@ void resolve_types_in_expression(statement *parent, expression *e) {
 			}
 		}
 
+		function *called = NULL;
+		for (function_id i = 0; get_function(i) != NULL; ++i) {
+			if (get_function(i)->name == e->call.func_name) {
+				called = get_function(i);
+				break;
+			}
+		}
+
 		for (size_t i = 0; i < e->call.parameters.size; ++i) {
 			resolve_types_in_expression(parent, e->call.parameters.e[i]);
+			if (called != NULL && i < called->parameters_size) {
+				adopt_literal_type(e->call.parameters.e[i], called->parameter_types[i].type);
+			}
+		}
+
+		if (is_generic_wave_function(e->call.func_name)) {
+			debug_context context = KONG_INIT_ZERO;
+			check(e->call.parameters.size > 0, context, "%s is missing its parameter", get_name(e->call.func_name));
+			type_id parameter_type = e->call.parameters.e[0]->type.type;
+			check(is_vector_or_scalar(parameter_type) && vector_base_type(parameter_type) != bool_id, context, "%s only works on numeric scalars and vectors",
+			      get_name(e->call.func_name));
+			e->type = e->call.parameters.e[0]->type;
+		}
+
+		if (is_float_math_function(e->call.func_name)) {
+			resolve_half_math_call(e);
+		}
+
+		if (is_atomic_function(e->call.func_name)) {
+			check_atomic_call(e);
 		}
 		break;
 	}
@@ -683,6 +855,7 @@ void resolve_types_in_block(statement *parent, statement *block) {
 
 			if (s->local_variable.init != NULL) {
 				resolve_types_in_expression(block, s->local_variable.init);
+				adopt_literal_type(s->local_variable.init, s->local_variable.var.type.type);
 			}
 
 			block->block.vars.v[block->block.vars.size].name = var_name;
@@ -747,6 +920,8 @@ void resolve_types(void) {
 			++f->block->block.vars.size;
 		}
 
+		stats_begin("resolve_types %s", get_name(f->name));
 		resolve_types_in_block(NULL, f->block);
+		stats_end();
 	}
 }
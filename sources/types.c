@@ -37,10 +37,37 @@ type_id bool_id;
 type_id bool2_id;
 type_id bool3_id;
 type_id bool4_id;
+type_id half_id;
+type_id half2_id;
+type_id half3_id;
+type_id half4_id;
+type_id half2x2_id;
+type_id half3x3_id;
+type_id half4x4_id;
+type_id short_id;
+type_id short2_id;
+type_id short3_id;
+type_id short4_id;
+type_id ushort_id;
+type_id ushort2_id;
+type_id ushort3_id;
+type_id ushort4_id;
 type_id function_type_id;
 type_id sampler_type_id;
 type_id ray_type_id;
 type_id bvh_type_id;
+type_id draw_indirect_args_type_id;
+type_id draw_indexed_indirect_args_type_id;
+type_id dispatch_indirect_args_type_id;
+
+static bool native_half_types  = true;
+static bool native_short_types = true;
+
+#define MAX_TYPE_ALIASES 32
+
+static name_id alias_names[MAX_TYPE_ALIASES];
+static name_id alias_targets[MAX_TYPE_ALIASES];
+static size_t  aliases_count = 0;
 
 typedef struct prefix {
 	char   str[5];
@@ -53,6 +80,50 @@ void init_type_ref(type_ref *t, name_id name) {
 	t->unresolved.array_size = 0;
 }
 
+void set_16bit_types(bool native_halfs, bool native_shorts) {
+	native_half_types  = native_halfs;
+	native_short_types = native_shorts;
+}
+
+static type_id add_16bit_type(const char *name, bool native, type_id fallback) {
+	if (native) {
+		type_id id             = add_type(add_name(name));
+		get_type(id)->built_in = true;
+		return id;
+	}
+
+	assert(aliases_count < MAX_TYPE_ALIASES);
+	alias_names[aliases_count]   = add_name(name);
+	alias_targets[aliases_count] = get_type(fallback)->name;
+	aliases_count += 1;
+
+	return fallback;
+}
+
+// base_vertex is the only signed member
+static type_id add_indirect_args_type(const char *name, const char **member_names, size_t members_size) {
+	type_id id  = add_type(add_name(name));
+	type   *t   = get_type(id);
+	t->built_in = true;
+
+	for (size_t member_index = 0; member_index < members_size; ++member_index) {
+		t->members.m[t->members.size].name      = add_name(member_names[member_index]);
+		t->members.m[t->members.size].type.type = strcmp(member_names[member_index], "base_vertex") == 0 ? int_id : uint_id;
+		++t->members.size;
+	}
+
+	return id;
+}
+
+name_id resolve_type_alias(name_id name) {
+	for (size_t alias_index = 0; alias_index < aliases_count; ++alias_index) {
+		if (alias_names[alias_index] == name) {
+			return alias_targets[alias_index];
+		}
+	}
+	return name;
+}
+
 void types_init(void) {
 	type         *new_types = (type *)realloc(types, types_size * sizeof(type));
 	debug_context context   = KONG_INIT_ZERO;
@@ -138,6 +209,26 @@ void types_init(void) {
 	float4x4_id                     = add_type(add_name("float4x4"));
 	get_type(float4x4_id)->built_in = true;
 
+	aliases_count = 0;
+
+	half_id    = add_16bit_type("half", native_half_types, float_id);
+	half2_id   = add_16bit_type("half2", native_half_types, float2_id);
+	half3_id   = add_16bit_type("half3", native_half_types, float3_id);
+	half4_id   = add_16bit_type("half4", native_half_types, float4_id);
+	half2x2_id = add_16bit_type("half2x2", native_half_types, float2x2_id);
+	half3x3_id = add_16bit_type("half3x3", native_half_types, float3x3_id);
+	half4x4_id = add_16bit_type("half4x4", native_half_types, float4x4_id);
+
+	short_id  = add_16bit_type("short", native_short_types, int_id);
+	short2_id = add_16bit_type("short2", native_short_types, int2_id);
+	short3_id = add_16bit_type("short3", native_short_types, int3_id);
+	short4_id = add_16bit_type("short4", native_short_types, int4_id);
+
+	ushort_id  = add_16bit_type("ushort", native_short_types, uint_id);
+	ushort2_id = add_16bit_type("ushort2", native_short_types, uint2_id);
+	ushort3_id = add_16bit_type("ushort3", native_short_types, uint3_id);
+	ushort4_id = add_16bit_type("ushort4", native_short_types, uint4_id);
+
 	{
 		ray_type_id                     = add_type(add_name("ray"));
 		get_type(ray_type_id)->built_in = true;
@@ -170,6 +261,16 @@ void types_init(void) {
 		function_type_id                     = add_type(add_name("fun"));
 		get_type(function_type_id)->built_in = true;
 	}
+
+	{
+		static const char *draw_members[]         = {"vertex_count", "instance_count", "first_vertex", "first_instance"};
+		static const char *draw_indexed_members[] = {"index_count", "instance_count", "first_index", "base_vertex", "first_instance"};
+		static const char *dispatch_members[]     = {"x", "y", "z"};
+
+		draw_indirect_args_type_id         = add_indirect_args_type("draw_indirect_args", draw_members, 4);
+		draw_indexed_indirect_args_type_id = add_indirect_args_type("draw_indexed_indirect_args", draw_indexed_members, 5);
+		dispatch_indirect_args_type_id     = add_indirect_args_type("dispatch_indirect_args", dispatch_members, 3);
+	}
 }
 
 static void grow_if_needed(uint64_t size) {
@@ -225,6 +326,7 @@ type_id add_full_type(type *t) {
 type_id find_type_by_name(name_id name) {
 	debug_context context = KONG_INIT_ZERO;
 	check(name != NO_NAME, context, "Attempted to find a no-name");
+	name = resolve_type_alias(name);
 	for (type_id i = 0; i < next_type_index; ++i) {
 		if (types[i].name == name) {
 			return i;
@@ -242,19 +344,22 @@ type_id find_type_by_ref(type_ref *t) {
 	debug_context context = KONG_INIT_ZERO;
 	check(t->unresolved.name != NO_NAME, context, "Attempted to find a no-name");
 
+	name_id name         = resolve_type_alias(t->unresolved.name);
 	type_id base_type_id = NO_TYPE;
 
 	for (type_id i = 0; i < next_type_index; ++i) {
-		if (types[i].name == t->unresolved.name) {
+		if (types[i].name == name) {
 			if (types[i].array_size == t->unresolved.array_size) {
 				return i;
 			}
-			base_type_id = i;
+			if (types[i].array_size == 0) {
+				base_type_id = i;
+			}
 		}
 	}
 
 	if (base_type_id != NO_TYPE) {
-		type_id new_type_id  = add_type(t->unresolved.name);
+		type_id new_type_id  = add_type(name);
 		type   *new_type     = get_type(new_type_id);
 		new_type->array_size = t->unresolved.array_size;
 
@@ -295,33 +400,36 @@ attribute *find_attribute(attribute_list *attributes, name_id name) {
 
 bool is_vector_or_scalar(type_id t) {
 	return t == float_id || t == float2_id || t == float3_id || t == float4_id || t == int_id || t == int2_id || t == int3_id || t == int4_id || t == uint_id ||
-	       t == uint2_id || t == uint3_id || t == uint4_id || t == bool_id || t == bool2_id || t == bool3_id || t == bool4_id;
+	       t == uint2_id || t == uint3_id || t == uint4_id || t == bool_id || t == bool2_id || t == bool3_id || t == bool4_id || t == half_id ||
+	       t == half2_id || t == half3_id || t == half4_id || t == short_id || t == short2_id || t == short3_id || t == short4_id || t == ushort_id ||
+	       t == ushort2_id || t == ushort3_id || t == ushort4_id;
 }
 
 bool is_vector(type_id t) {
 	return t == float2_id || t == float3_id || t == float4_id || t == int2_id || t == int3_id || t == int4_id || t == uint2_id || t == uint3_id ||
-	       t == uint4_id || t == bool2_id || t == bool3_id || t == bool4_id;
+	       t == uint4_id || t == bool2_id || t == bool3_id || t == bool4_id || t == half2_id || t == half3_id || t == half4_id || t == short2_id ||
+	       t == short3_id || t == short4_id || t == ushort2_id || t == ushort3_id || t == ushort4_id;
 }
 
 bool is_matrix(type_id t) {
 	return t == float2x2_id || t == float2x3_id || t == float3x2_id || t == float3x3_id || t == float2x4_id || t == float4x2_id || t == float3x4_id ||
-	       t == float4x3_id || t == float4x4_id;
+	       t == float4x3_id || t == float4x4_id || t == half2x2_id || t == half3x3_id || t == half4x4_id;
 }
 
 uint32_t vector_size(type_id t) {
-	if (t == float_id || t == int_id || t == uint_id || t == bool_id) {
+	if (t == float_id || t == int_id || t == uint_id || t == bool_id || t == half_id || t == short_id || t == ushort_id) {
 		return 1u;
 	}
 
-	if (t == float2_id || t == int2_id || t == uint2_id || t == bool2_id) {
+	if (t == float2_id || t == int2_id || t == uint2_id || t == bool2_id || t == half2_id || t == short2_id || t == ushort2_id) {
 		return 2u;
 	}
 
-	if (t == float3_id || t == int3_id || t == uint3_id || t == bool3_id) {
+	if (t == float3_id || t == int3_id || t == uint3_id || t == bool3_id || t == half3_id || t == short3_id || t == ushort3_id) {
 		return 3u;
 	}
 
-	if (t == float4_id || t == int4_id || t == uint4_id || t == bool4_id) {
+	if (t == float4_id || t == int4_id || t == uint4_id || t == bool4_id || t == half4_id || t == short4_id || t == ushort4_id) {
 		return 4u;
 	}
 
@@ -342,6 +450,15 @@ type_id vector_base_type(type_id vector_type) {
 	if (vector_type == bool_id || vector_type == bool2_id || vector_type == bool3_id || vector_type == bool4_id) {
 		return bool_id;
 	}
+	if (vector_type == half_id || vector_type == half2_id || vector_type == half3_id || vector_type == half4_id) {
+		return half_id;
+	}
+	if (vector_type == short_id || vector_type == short2_id || vector_type == short3_id || vector_type == short4_id) {
+		return short_id;
+	}
+	if (vector_type == ushort_id || vector_type == ushort2_id || vector_type == ushort3_id || vector_type == ushort4_id) {
+		return ushort_id;
+	}
 
 	assert(false);
 	return float_id;
@@ -409,12 +526,69 @@ type_id vector_to_size(type_id vector_type, uint32_t size) {
 			return bool_id;
 		}
 	}
+	else if (base_type == half_id) {
+		switch (size) {
+		case 1u:
+			return half_id;
+		case 2u:
+			return half2_id;
+		case 3u:
+			return half3_id;
+		case 4u:
+			return half4_id;
+		default:
+			assert(false);
+			return half_id;
+		}
+	}
+	else if (base_type == short_id) {
+		switch (size) {
+		case 1u:
+			return short_id;
+		case 2u:
+			return short2_id;
+		case 3u:
+			return short3_id;
+		case 4u:
+			return short4_id;
+		default:
+			assert(false);
+			return short_id;
+		}
+	}
+	else if (base_type == ushort_id) {
+		switch (size) {
+		case 1u:
+			return ushort_id;
+		case 2u:
+			return ushort2_id;
+		case 3u:
+			return ushort3_id;
+		case 4u:
+			return ushort4_id;
+		default:
+			assert(false);
+			return ushort_id;
+		}
+	}
 	else {
 		assert(false);
 		return float_id;
 	}
 }
 
+bool is_16bit_type(type_id t) {
+	if (native_half_types &&
+	    (t == half_id || t == half2_id || t == half3_id || t == half4_id || t == half2x2_id || t == half3x3_id || t == half4x4_id)) {
+		return true;
+	}
+	if (native_short_types && (t == short_id || t == short2_id || t == short3_id || t == short4_id || t == ushort_id || t == ushort2_id ||
+	                           t == ushort3_id || t == ushort4_id)) {
+		return true;
+	}
+	return false;
+}
+
 bool is_depth(texture_format format) {
 	switch (format) {
 	case TEXTURE_FORMAT_DEPTH16_UNORM:
@@ -27,10 +27,22 @@ typedef struct type_ref {
 
 void init_type_ref(type_ref *t, name_id name);
 
+// How a vertex input member is stored in the vertex buffer, shaders always see floats
+typedef enum member_format {
+	MEMBER_FORMAT_DEFAULT,
+	MEMBER_FORMAT_UNORM8,
+	MEMBER_FORMAT_SNORM8,
+	MEMBER_FORMAT_UNORM16,
+	MEMBER_FORMAT_SNORM16,
+	MEMBER_FORMAT_HALF,
+	MEMBER_FORMAT_RGB10A2,
+} member_format;
+
 typedef struct member {
-	name_id  name;
-	type_ref type;
-	token    value;
+	name_id       name;
+	type_ref      type;
+	token         value;
+	member_format format;
 } member;
 
 #define MAX_MEMBERS 1024
@@ -46,8 +58,10 @@ typedef struct attribute {
 	uint8_t paramters_count;
 } attribute;
 
+#define MAX_ATTRIBUTES 64
+
 typedef struct attributes {
-	attribute attributes[64];
+	attribute attributes[MAX_ATTRIBUTES];
 	uint8_t   attributes_count;
 } attribute_list;
 
@@ -134,6 +148,9 @@ typedef struct type {
 
 void types_init(void);
 
+// Has to be called before types_init, 16 bit types that are not native become aliases of their 32 bit counterparts
+void set_16bit_types(bool native_halfs, bool native_shorts);
+
 type_id add_type(name_id name);
 
 type_id add_full_type(type *t);
@@ -170,9 +187,27 @@ extern type_id bool_id;
 extern type_id bool2_id;
 extern type_id bool3_id;
 extern type_id bool4_id;
+extern type_id half_id;
+extern type_id half2_id;
+extern type_id half3_id;
+extern type_id half4_id;
+extern type_id half2x2_id;
+extern type_id half3x3_id;
+extern type_id half4x4_id;
+extern type_id short_id;
+extern type_id short2_id;
+extern type_id short3_id;
+extern type_id short4_id;
+extern type_id ushort_id;
+extern type_id ushort2_id;
+extern type_id ushort3_id;
+extern type_id ushort4_id;
 extern type_id sampler_type_id;
 extern type_id ray_type_id;
 extern type_id bvh_type_id;
+extern type_id draw_indirect_args_type_id;
+extern type_id draw_indexed_indirect_args_type_id;
+extern type_id dispatch_indirect_args_type_id;
 
 static inline bool is_texture(type_id id) {
 	while (id != NO_TYPE) {
@@ -196,6 +231,11 @@ static inline bool is_sampler(type_id t) {
 	return t == sampler_type_id;
 }
 
+// The argument structs of indirect draws and dispatches, their members are 32 bit scalars so every API lays them out the same way
+static inline bool is_indirect_args(type_id t) {
+	return t == draw_indirect_args_type_id || t == draw_indexed_indirect_args_type_id || t == dispatch_indirect_args_type_id;
+}
+
 typedef struct swizzle {
 	uint32_t indices[4];
 	uint32_t size;
@@ -213,6 +253,12 @@ type_id vector_base_type(type_id vector_type);
 
 type_id vector_to_size(type_id vector_type, uint32_t size);
 
+// Only true for the 16 bit types that did not fall back to 32 bit types
+bool is_16bit_type(type_id t);
+
+// Maps the name of a 16 bit type that fell back to a 32 bit type to the name of that type
+name_id resolve_type_alias(name_id name);
+
 #ifdef __cplusplus
 }
 #endif